@@ -197,7 +197,8 @@ public class CesiumRuntime : ModuleRules
                     "SlateCore",
                     "WorldBrowser",
                     "ContentBrowser",
-                    "MaterialEditor"
+                    "MaterialEditor",
+                    "Json"
                 }
             );
         }
@@ -0,0 +1,193 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "BackgroundPruningCacheDatabase.h"
+#include "Async/Async.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumRuntime.h"
+#include "CesiumStats.h"
+#include "Containers/Ticker.h"
+#include "HAL/PlatformTime.h"
+#include <mutex>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Cache Prunes Completed"),
+    STAT_CesiumCachePrunesCompleted,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Last Cache Prune Duration (ms)"),
+    STAT_CesiumLastCachePruneDuration,
+    STATGROUP_Cesium);
+DECLARE_MEMORY_STAT(
+    TEXT("Cache Bytes Reclaimed"),
+    STAT_CesiumCacheBytesReclaimed,
+    STATGROUP_Cesium);
+
+namespace {
+
+// How often to check whether the next step of a prune can run.
+constexpr float TickIntervalSeconds = 0.05f;
+
+// The time budget of each step.
+constexpr double StepBudgetSeconds = 0.005;
+
+// How long a prune waits for the network to be idle before it runs anyway.
+constexpr double MaximumWaitSeconds = 30.0;
+
+} // namespace
+
+struct BackgroundPruningCacheDatabase::State {
+  std::shared_ptr<CesiumAsync::ICacheDatabase> pDatabase;
+  PruneStep pruneStep;
+  IsBusy isBusy;
+
+  std::mutex mutex;
+  bool pending = false;
+  bool stepInFlight = false;
+  bool tickerRegistered = false;
+  double requestedTime = 0.0;
+  double workSeconds = 0.0;
+  int64_t bytesReclaimed = 0;
+
+  static bool tick(const std::weak_ptr<State>& pWeakState);
+  static void runStep(const std::shared_ptr<State>& pState);
+};
+
+BackgroundPruningCacheDatabase::BackgroundPruningCacheDatabase(
+    const std::shared_ptr<CesiumAsync::ICacheDatabase>& pDatabase,
+    PruneStep&& pruneStep,
+    IsBusy&& isBusy)
+    : _pState(std::make_shared<State>()) {
+  this->_pState->pDatabase = pDatabase;
+  this->_pState->pruneStep = std::move(pruneStep);
+  this->_pState->isBusy = std::move(isBusy);
+}
+
+// The ticker only holds a weak reference to the state, and unregisters itself
+// once the state is gone.
+BackgroundPruningCacheDatabase::~BackgroundPruningCacheDatabase() = default;
+
+std::optional<CesiumAsync::CacheItem>
+BackgroundPruningCacheDatabase::getEntry(const std::string& key) const {
+  return this->_pState->pDatabase->getEntry(key);
+}
+
+bool BackgroundPruningCacheDatabase::storeEntry(
+    const std::string& key,
+    std::time_t expiryTime,
+    const std::string& url,
+    const std::string& requestMethod,
+    const CesiumAsync::HttpHeaders& requestHeaders,
+    uint16_t statusCode,
+    const CesiumAsync::HttpHeaders& responseHeaders,
+    const gsl::span<const std::byte>& responseData) {
+  return this->_pState->pDatabase->storeEntry(
+      key,
+      expiryTime,
+      url,
+      requestMethod,
+      requestHeaders,
+      statusCode,
+      responseHeaders,
+      responseData);
+}
+
+bool BackgroundPruningCacheDatabase::prune() {
+  std::lock_guard<std::mutex> lock(this->_pState->mutex);
+
+  if (!this->_pState->pending) {
+    this->_pState->pending = true;
+    this->_pState->requestedTime = FPlatformTime::Seconds();
+    this->_pState->workSeconds = 0.0;
+    this->_pState->bytesReclaimed = 0;
+  }
+
+  if (!this->_pState->tickerRegistered) {
+    this->_pState->tickerRegistered = true;
+    FTSTicker::GetCoreTicker().AddTicker(
+        FTickerDelegate::CreateLambda(
+            [pWeakState = std::weak_ptr<State>(this->_pState)](float) {
+              return State::tick(pWeakState);
+            }),
+        TickIntervalSeconds);
+  }
+
+  return true;
+}
+
+bool BackgroundPruningCacheDatabase::clearAll() {
+  return this->_pState->pDatabase->clearAll();
+}
+
+/*static*/ bool BackgroundPruningCacheDatabase::State::tick(
+    const std::weak_ptr<State>& pWeakState) {
+  std::shared_ptr<State> pState = pWeakState.lock();
+  if (!pState) {
+    return false;
+  }
+
+  double requestedTime;
+  {
+    std::lock_guard<std::mutex> lock(pState->mutex);
+    if (!pState->pending) {
+      pState->tickerRegistered = false;
+      return false;
+    }
+    if (pState->stepInFlight) {
+      return true;
+    }
+    requestedTime = pState->requestedTime;
+  }
+
+  bool overdue = FPlatformTime::Seconds() - requestedTime > MaximumWaitSeconds;
+  if (!overdue && pState->isBusy && pState->isBusy()) {
+    return true;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pState->mutex);
+    pState->stepInFlight = true;
+  }
+
+  AsyncTask(ENamedThreads::Type::AnyBackgroundThreadNormalTask, [pState]() {
+    TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::PruneRequestCache)
+    State::runStep(pState);
+  });
+
+  return true;
+}
+
+/*static*/ void BackgroundPruningCacheDatabase::State::runStep(
+    const std::shared_ptr<State>& pState) {
+  double start = FPlatformTime::Seconds();
+  StepResult result = pState->pruneStep(StepBudgetSeconds);
+  double elapsed = FPlatformTime::Seconds() - start;
+
+  double workSeconds;
+  int64_t bytesReclaimed;
+  {
+    std::lock_guard<std::mutex> lock(pState->mutex);
+    pState->stepInFlight = false;
+    pState->workSeconds += elapsed;
+    pState->bytesReclaimed += FMath::Max(result.bytesReclaimed, int64_t(0));
+    workSeconds = pState->workSeconds;
+    bytesReclaimed = pState->bytesReclaimed;
+    if (result.complete) {
+      pState->pending = false;
+    }
+  }
+
+  INC_MEMORY_STAT_BY(
+      STAT_CesiumCacheBytesReclaimed,
+      FMath::Max(result.bytesReclaimed, int64_t(0)));
+
+  if (result.complete) {
+    INC_DWORD_STAT(STAT_CesiumCachePrunesCompleted);
+    SET_FLOAT_STAT(STAT_CesiumLastCachePruneDuration, workSeconds * 1000.0);
+    UE_LOG(
+        LogCesium,
+        Verbose,
+        TEXT("Pruned the request cache in %.2f ms, reclaiming %lld bytes"),
+        workSeconds * 1000.0,
+        bytesReclaimed);
+  }
+}
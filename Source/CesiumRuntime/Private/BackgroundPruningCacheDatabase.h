@@ -0,0 +1,87 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/ICacheDatabase.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * An ICacheDatabase that moves pruning off the request path. The
+ * CachingAssetAccessor calls prune while handling a request, which stalls that
+ * request for as long as the prune takes. Here, prune only schedules the work,
+ * which is then done in a background thread in steps with a small time budget,
+ * while the network is otherwise idle. All other functions are forwarded to
+ * the wrapped database.
+ */
+class BackgroundPruningCacheDatabase : public CesiumAsync::ICacheDatabase {
+public:
+  /**
+   * The result of one step of a prune.
+   */
+  struct StepResult {
+    /**
+     * Whether the prune is complete.
+     */
+    bool complete;
+
+    /**
+     * The size of the cached responses removed in this step, in bytes, if
+     * known.
+     */
+    int64_t bytesReclaimed;
+  };
+
+  /**
+   * Does one step of a prune of the wrapped database, taking roughly the
+   * given time in seconds, and continuing where the last step stopped.
+   */
+  using PruneStep = std::function<StepResult(double timeBudgetSeconds)>;
+
+  /**
+   * Returns true while the streaming load is too high for pruning to run.
+   */
+  using IsBusy = std::function<bool()>;
+
+  /**
+   * Creates a database that prunes the given one in the background.
+   *
+   * @param pDatabase The database to wrap.
+   * @param pruneStep The function that does one step of a prune of the
+   * database. If the database cannot be pruned incrementally, this can do the
+   * whole prune and report that it is complete.
+   * @param isBusy The function that reports whether pruning should wait. A
+   * prune that has waited too long runs anyway.
+   */
+  BackgroundPruningCacheDatabase(
+      const std::shared_ptr<CesiumAsync::ICacheDatabase>& pDatabase,
+      PruneStep&& pruneStep,
+      IsBusy&& isBusy);
+
+  virtual ~BackgroundPruningCacheDatabase();
+
+  virtual std::optional<CesiumAsync::CacheItem>
+  getEntry(const std::string& key) const override;
+
+  virtual bool storeEntry(
+      const std::string& key,
+      std::time_t expiryTime,
+      const std::string& url,
+      const std::string& requestMethod,
+      const CesiumAsync::HttpHeaders& requestHeaders,
+      uint16_t statusCode,
+      const CesiumAsync::HttpHeaders& responseHeaders,
+      const gsl::span<const std::byte>& responseData) override;
+
+  /**
+   * Schedules a prune in the background and returns immediately.
+   */
+  virtual bool prune() override;
+
+  virtual bool clearAll() override;
+
+private:
+  struct State;
+  std::shared_ptr<State> _pState;
+};
@@ -5,6 +5,7 @@
 #include "Camera/CameraTypes.h"
 #include "Camera/PlayerCameraManager.h"
 #include "Cesium3DTilesSelection/IPrepareRendererResources.h"
+#include "Cesium3DTilesSelection/RasterOverlayCollection.h"
 #include "Cesium3DTilesSelection/Tile.h"
 #include "Cesium3DTilesSelection/TilesetLoadFailureDetails.h"
 #include "Cesium3DTilesSelection/TilesetOptions.h"
@@ -25,8 +26,13 @@
 #include "CesiumIonClient/Connection.h"
 #include "CesiumLifetime.h"
 #include "CesiumRasterOverlay.h"
+#include "CesiumRasterOverlays/RasterOverlayTileProvider.h"
 #include "CesiumRuntime.h"
 #include "CesiumRuntimeSettings.h"
+#include "CesiumSceneCaptureSettingsComponent.h"
+#include "CesiumStats.h"
+#include "CesiumTextureMemory.h"
+#include "CesiumTexturePool.h"
 #include "CesiumTextureUtility.h"
 #include "CesiumTileExcluder.h"
 #include "CesiumViewExtension.h"
@@ -42,18 +48,32 @@
 #include "EngineUtils.h"
 #include "GameFramework/PlayerController.h"
 #include "Kismet/GameplayStatics.h"
+#include "LoadLatencyAssetAccessor.h"
 #include "LevelSequenceActor.h"
 #include "LevelSequencePlayer.h"
 #include "Math/UnrealMathUtility.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "PixelFormat.h"
+#include "RequestGroupAssetAccessor.h"
 #include "StereoRendering.h"
+#include "TaskLaneAssetAccessor.h"
+#include "TileLoadCancellation.h"
+#include "UnrealAssetAccessor.h"
+#include "UnrealTaskProcessor.h"
 #include "VecMath.h"
+#include "WarmSetAssetAccessor.h"
 #include <glm/gtc/matrix_inverse.hpp>
 #include <memory>
 #include <spdlog/spdlog.h>
 
 FCesium3DTilesetLoadFailure OnCesium3DTilesetLoadFailure{};
 
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Idle Tileset Updates Skipped"),
+    STAT_CesiumIdleTilesetUpdatesSkipped,
+    STATGROUP_Cesium);
+
 #if WITH_EDITOR
 #include "Editor.h"
 #include "EditorViewportClient.h"
@@ -89,7 +109,22 @@ ACesium3DTileset::ACesium3DTileset()
       _beforeMovieLoadingDescendantLimit{LoadingDescendantLimit},
       _beforeMovieUseLodTransitions{true},
 
-      _tilesetsBeingDestroyed(0) {
+      _tilesetsBeingDestroyed(0),
+
+      _idleAfterLastUpdate(false),
+      _lastCameras(),
+      _lastUnrealWorldToCesiumTileset(1.0),
+      _lastFrameCredits(),
+
+      _tilesPreparedInMainThread(0),
+      _mainThreadPrepareSeconds(0.0),
+
+      _requestGroup(0),
+      _pTileLoadCancellation(),
+      _pTextureMemory(),
+      _textureBudgetScale(1.0),
+      _maximumCachedBytesProperty(-1),
+      _maximumCachedBytes(0) {
 
   PrimaryActorTick.bCanEverTick = true;
   PrimaryActorTick.TickGroup = ETickingGroup::TG_PostUpdateWork;
@@ -574,6 +609,169 @@ ACesium3DTileset::GetCesiumTilesetToUnrealRelativeWorldTransform() const {
       ->GetCesiumTilesetToUnrealRelativeWorldTransform();
 }
 
+FCesium3DTilesetStreamingStatistics
+ACesium3DTileset::GetStreamingStatistics() const {
+  FCesium3DTilesetStreamingStatistics statistics;
+  statistics.TilesRendered = this->_lastTilesRendered;
+  statistics.TilesLoadingInWorkerThread =
+      this->_lastWorkerThreadTileLoadQueueLength;
+  statistics.TilesLoadingInMainThread =
+      this->_lastMainThreadTileLoadQueueLength;
+  statistics.TilesVisited = this->_lastTilesVisited;
+  statistics.TilesCulled = this->_lastTilesCulled;
+  statistics.MaxDepthVisited = this->_lastMaxDepthVisited;
+  statistics.TilesPreparedInMainThread = this->_tilesPreparedInMainThread;
+  statistics.MainThreadPrepareSeconds = this->_mainThreadPrepareSeconds;
+  if (this->_pTileLoadCancellation) {
+    TileLoadCancellation::Statistics cancellation =
+        this->_pTileLoadCancellation->getStatistics();
+    for (int64_t canceled : cancellation.canceled) {
+      statistics.TilePreparationsCanceled += uint64(canceled);
+    }
+    statistics.TilePreparationsWasted = uint64(cancellation.wasted);
+    statistics.WastedPreparationSeconds = cancellation.wastedSeconds;
+  }
+  if (this->_pTextureMemory) {
+    CesiumTextureMemory::Statistics textureMemory =
+        this->_pTextureMemory->getStatistics();
+    statistics.GltfTextureBytes = textureMemory.bytes[size_t(
+        CesiumTextureMemory::Category::GltfTexture)];
+    statistics.MetadataTextureBytes = textureMemory.bytes[size_t(
+        CesiumTextureMemory::Category::MetadataTexture)];
+    statistics.RasterOverlayTextureBytes = textureMemory.bytes[size_t(
+        CesiumTextureMemory::Category::RasterOverlay)];
+  }
+  statistics.AllTilesetsTextureBytes =
+      getGlobalTextureMemory().getStatistics().getTotalBytes();
+  statistics.TextureBudgetScale = this->_textureBudgetScale;
+  return statistics;
+}
+
+namespace {
+
+const TCHAR* WarmSetSnapshotHeader = TEXT("# Cesium for Unreal warm set v1");
+
+std::vector<std::string> loadWarmSetSnapshot(const FString& filename) {
+  std::vector<std::string> result;
+  if (filename.IsEmpty()) {
+    return result;
+  }
+
+  FString path =
+      FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), filename);
+  TArray<FString> lines;
+  if (!FFileHelper::LoadFileToStringArray(lines, *path)) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Could not read warm set snapshot %s. Tiles will be loaded "
+             "without it."),
+        *path);
+    return result;
+  }
+
+  if (lines.Num() == 0 || lines[0] != WarmSetSnapshotHeader) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("%s is not a warm set snapshot. Tiles will be loaded without it."),
+        *path);
+    return result;
+  }
+
+  result.reserve(lines.Num() - 1);
+  for (int32 i = 1; i < lines.Num(); ++i) {
+    FString line = lines[i].TrimStartAndEnd();
+    if (!line.IsEmpty() && !line.StartsWith(TEXT("#"))) {
+      result.emplace_back(TCHAR_TO_UTF8(*line));
+    }
+  }
+
+  return result;
+}
+
+const UCesiumGltfComponent*
+getGltfComponent(const Cesium3DTilesSelection::Tile& tile) {
+  const Cesium3DTilesSelection::TileRenderContent* pRenderContent =
+      tile.getContent().getRenderContent();
+  if (!pRenderContent) {
+    return nullptr;
+  }
+  return static_cast<const UCesiumGltfComponent*>(
+      pRenderContent->getRenderResources());
+}
+
+} // namespace
+
+bool ACesium3DTileset::SaveWarmSetSnapshot(const FString& Filename) const {
+  if (!this->_pWarmSetAccessor) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Cannot save a warm set snapshot for tileset %s because it is "
+             "not loaded."),
+        *this->GetName());
+    return false;
+  }
+
+  // Only the content of the tiles that are rendered for the current view, and
+  // of their ancestors, is needed to reach that view again.
+  std::unordered_set<std::string> viewContentUrls;
+  this->_pTileset->forEachLoadedTile([&viewContentUrls](
+                                         Cesium3DTilesSelection::Tile& tile) {
+    const UCesiumGltfComponent* pGltf = getGltfComponent(tile);
+    if (!pGltf || !pGltf->IsVisible()) {
+      return;
+    }
+    for (const Cesium3DTilesSelection::Tile* pTile = &tile; pTile;
+         pTile = pTile->getParent()) {
+      const UCesiumGltfComponent* pAncestor = getGltfComponent(*pTile);
+      if (pAncestor && !pAncestor->ContentUrl.empty()) {
+        viewContentUrls.insert(pAncestor->ContentUrl);
+      }
+    }
+  });
+
+  std::vector<std::string> urls =
+      this->_pWarmSetAccessor->getRecordedUrls(viewContentUrls);
+
+  FString contents = WarmSetSnapshotHeader;
+  contents += TEXT("\n");
+  for (const std::string& url : urls) {
+    contents += UTF8_TO_TCHAR(url.c_str());
+    contents += TEXT("\n");
+  }
+
+  FString path =
+      FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Filename);
+  if (!FFileHelper::SaveStringToFile(contents, *path)) {
+    UE_LOG(
+        LogCesium,
+        Error,
+        TEXT("Could not write warm set snapshot to %s"),
+        *path);
+    return false;
+  }
+
+  UE_LOG(
+      LogCesium,
+      Log,
+      TEXT("Saved a warm set snapshot of %d URLs for tileset %s to %s"),
+      int32(urls.size()),
+      *this->GetName(),
+      *path);
+  return true;
+}
+
+FCesiumTileLoadLatency
+ACesium3DTileset::GetTileLoadLatency(ECesiumTileLoadStage Stage) const {
+  return this->_tileLoadLatency.summarize(Stage);
+}
+
+void ACesium3DTileset::ResetTileLoadLatency() {
+  this->_tileLoadLatency.reset();
+}
+
 void ACesium3DTileset::UpdateTransformFromCesium() {
 
   const glm::dmat4& CesiumToUnreal =
@@ -639,6 +837,9 @@ void ACesium3DTileset::OnConstruction(const FTransform& Transform) {
   // tick. But if update is suspended, leave the components in their current
   // state.
   if (!this->SuspendUpdate) {
+    // The next tick must not be skipped, or the tiles would stay hidden.
+    this->invalidateIdleState();
+
     TArray<UCesiumGltfComponent*> gltfComponents;
     this->GetComponents<UCesiumGltfComponent>(gltfComponents);
 
@@ -675,7 +876,13 @@ void ACesium3DTileset::NotifyHit(
 class UnrealResourcePreparer
     : public Cesium3DTilesSelection::IPrepareRendererResources {
 public:
-  UnrealResourcePreparer(ACesium3DTileset* pActor) : _pActor(pActor) {}
+  UnrealResourcePreparer(
+      ACesium3DTileset* pActor,
+      const std::shared_ptr<TileLoadCancellation>& pCancellation,
+      const std::shared_ptr<CesiumTextureMemory>& pTextureMemory)
+      : _pActor(pActor),
+        _pCancellation(pCancellation),
+        _pTextureMemory(pTextureMemory) {}
 
   virtual CesiumAsync::Future<
       Cesium3DTilesSelection::TileLoadResultAndRenderResources>
@@ -684,36 +891,45 @@ public:
       Cesium3DTilesSelection::TileLoadResult&& tileLoadResult,
       const glm::dmat4& transform,
       const std::any& rendererOptions) override {
-    CesiumGltf::Model* pModel =
-        std::get_if<CesiumGltf::Model>(&tileLoadResult.contentKind);
-    if (!pModel)
+    if (!std::holds_alternative<CesiumGltf::Model>(tileLoadResult.contentKind))
       return asyncSystem.createResolvedFuture(
           Cesium3DTilesSelection::TileLoadResultAndRenderResources{
               std::move(tileLoadResult),
               nullptr});
 
-    CreateGltfOptions::CreateModelOptions options;
-    options.pModel = pModel;
-    options.alwaysIncludeTangents = this->_pActor->GetAlwaysIncludeTangents();
-    options.createPhysicsMeshes = this->_pActor->GetCreatePhysicsMeshes();
-
-    options.ignoreKhrMaterialsUnlit =
-        this->_pActor->GetIgnoreKhrMaterialsUnlit();
-
-    if (this->_pActor->_featuresMetadataDescription) {
-      options.pFeaturesMetadataDescription =
-          &(*this->_pActor->_featuresMetadataDescription);
-    } else if (this->_pActor->_metadataDescription_DEPRECATED) {
-      options.pEncodedMetadataDescription_DEPRECATED =
-          &(*this->_pActor->_metadataDescription_DEPRECATED);
-    }
-
-    TUniquePtr<UCesiumGltfComponent::HalfConstructed> pHalf =
-        UCesiumGltfComponent::CreateOffGameThread(transform, options);
-    return asyncSystem.createResolvedFuture(
-        Cesium3DTilesSelection::TileLoadResultAndRenderResources{
-            std::move(tileLoadResult),
-            pHalf.Release()});
+    // Without a dedicated pool of worker threads, the lanes have no
+    // priorities, so the tile is prepared in the task that loaded it.
+    if (getTaskProcessor()->getThreadCount() == 0) {
+      return asyncSystem.createResolvedFuture(
+          this->prepareModel(std::move(tileLoadResult), transform));
+    }
+
+    // Otherwise, generate the texture mips in the texture lane and then
+    // create the meshes in the geometry lane, both of which run ahead of
+    // decoding further tiles.
+    UnrealTaskProcessor::LaneScope textureScope(
+        UnrealTaskProcessor::Lane::Texture);
+    return asyncSystem.runInWorkerThread(
+        [this,
+         asyncSystem,
+         tileLoadResult = std::move(tileLoadResult),
+         transform]() mutable {
+          if (!this->_pCancellation->isCanceled()) {
+            CesiumTextureUtility::generateMipMapsAnyThreadPart(
+                std::get<CesiumGltf::Model>(tileLoadResult.contentKind));
+          }
+
+          UnrealTaskProcessor::LaneScope geometryScope(
+              UnrealTaskProcessor::Lane::Geometry);
+          return asyncSystem.runInWorkerThread(
+              [this,
+               tileLoadResult = std::move(tileLoadResult),
+               transform]() mutable {
+                return this->prepareModel(
+                    std::move(tileLoadResult),
+                    transform);
+              });
+        });
   }
 
   virtual void* prepareInMainThread(
@@ -726,7 +942,19 @@ public:
               pLoadThreadResult));
       const Cesium3DTilesSelection::TileRenderContent& renderContent =
           *content.getRenderContent();
-      return UCesiumGltfComponent::CreateOnGameThread(
+
+      const double requestIssuedTime = pHalf->requestIssuedTime;
+      const double responseReceivedTime = pHalf->responseReceivedTime;
+      const double loadThreadDoneTime = pHalf->loadThreadDoneTime;
+
+      if (this->_pActor->_pWarmSetAccessor && !pHalf->contentUrl.empty()) {
+        this->_pActor->_pWarmSetAccessor->markTileContent(pHalf->contentUrl);
+      }
+
+      const double startSeconds = FPlatformTime::Seconds();
+      CesiumTextureMemory::OwnerScope textureMemoryScope(
+          this->_pTextureMemory);
+      UCesiumGltfComponent* pGltf = UCesiumGltfComponent::CreateOnGameThread(
           renderContent.getModel(),
           this->_pActor,
           std::move(pHalf),
@@ -737,6 +965,31 @@ public:
           this->_pActor->GetCustomDepthParameters(),
           tile,
           this->_pActor->GetCreateNavCollision());
+
+      const double endSeconds = FPlatformTime::Seconds();
+      ++this->_pActor->_tilesPreparedInMainThread;
+      this->_pActor->_mainThreadPrepareSeconds += endSeconds - startSeconds;
+
+      CesiumTileLoadLatencyHistograms& latency =
+          this->_pActor->_tileLoadLatency;
+      if (requestIssuedTime > 0.0) {
+        latency.record(
+            ECesiumTileLoadStage::Request,
+            responseReceivedTime - requestIssuedTime);
+        latency.record(
+            ECesiumTileLoadStage::LoadThread,
+            loadThreadDoneTime - responseReceivedTime);
+        latency.record(
+            ECesiumTileLoadStage::Total,
+            endSeconds - requestIssuedTime);
+      }
+      if (loadThreadDoneTime > 0.0) {
+        latency.record(
+            ECesiumTileLoadStage::MainThread,
+            endSeconds - loadThreadDoneTime);
+      }
+
+      return pGltf;
     }
     // UE_LOG(LogCesium, VeryVerbose, TEXT("No content for tile"));
     return nullptr;
@@ -747,9 +1000,12 @@ public:
       void* pLoadThreadResult,
       void* pMainThreadResult) noexcept override {
     if (pLoadThreadResult) {
+      // The tile was prepared in the load thread, but unloaded before it was
+      // ever prepared in the game thread.
       UCesiumGltfComponent::HalfConstructed* pHalf =
           reinterpret_cast<UCesiumGltfComponent::HalfConstructed*>(
               pLoadThreadResult);
+      this->_pCancellation->recordWasted(pHalf->loadThreadSeconds);
       delete pHalf;
     } else if (pMainThreadResult) {
       UCesiumGltfComponent* pGltf =
@@ -770,15 +1026,31 @@ public:
 
     auto pOptions = *ppOptions;
 
+    // Without asynchronous texture creation, the texture is created later on
+    // the render thread from an image that it owns. Nothing reads the raster
+    // tile's pixels once its texture is prepared, so hand the image over
+    // rather than having it copied.
+    CesiumTextureUtility::CesiumTextureSource textureSource;
+    if (GRHISupportsAsyncTextureCreation) {
+      textureSource = CesiumTextureUtility::GltfImagePtr{&image};
+    } else {
+      textureSource =
+          CesiumTextureUtility::EmbeddedImageSource{std::move(image)};
+    }
+
     auto texture = CesiumTextureUtility::loadTextureAnyThreadPart(
-        CesiumTextureUtility::GltfImagePtr{&image},
+        std::move(textureSource),
         TextureAddress::TA_Clamp,
         TextureAddress::TA_Clamp,
         pOptions->filter,
         pOptions->group,
         pOptions->useMipmaps,
-        true); // TODO: sRGB should probably be configurable on the raster
-               // overlay
+        // TODO: sRGB should probably be configurable on the raster overlay
+        true,
+        &getRasterOverlayTexturePool());
+    if (texture) {
+      texture->memoryCategory = CesiumTextureMemory::Category::RasterOverlay;
+    }
     return texture.Release();
   }
 
@@ -803,6 +1075,7 @@ public:
       pImageSource->pImage = &rasterTile.getImage();
     }
 
+    CesiumTextureMemory::OwnerScope textureMemoryScope(this->_pTextureMemory);
     UTexture2D* pTexture =
         CesiumTextureUtility::loadTextureGameThreadPart(pLoadedTexture.Get());
     if (!pTexture) {
@@ -810,6 +1083,9 @@ public:
     }
 
     pTexture->AddToRoot();
+    if (pLoadedTexture->poolKey) {
+      getRasterOverlayTexturePool().track(pTexture, *pLoadedTexture->poolKey);
+    }
     return pTexture;
   }
 
@@ -822,13 +1098,16 @@ public:
           static_cast<CesiumTextureUtility::LoadedTextureResult*>(
               pLoadThreadResult);
       CesiumTextureUtility::destroyHalfLoadedTexture(*pLoadedTexture);
+      // A texture taken from the pool but never used goes back to it.
+      getRasterOverlayTexturePool().release(pLoadedTexture->pPooledTexture);
       delete pLoadedTexture;
     }
 
     if (pMainThreadResult) {
-      UTexture* pTexture = static_cast<UTexture*>(pMainThreadResult);
-      pTexture->RemoveFromRoot();
-      CesiumTextureUtility::destroyTexture(pTexture);
+      // The texture is kept for reuse if there is room in the pool, or is
+      // destroyed.
+      UTexture2D* pTexture = static_cast<UTexture2D*>(pMainThreadResult);
+      getRasterOverlayTexturePool().release(pTexture);
     }
   }
 
@@ -880,7 +1159,81 @@ public:
   }
 
 private:
+  /**
+   * @brief Creates the Unreal resources of a tile's glTF in a worker thread.
+   */
+  Cesium3DTilesSelection::TileLoadResultAndRenderResources prepareModel(
+      Cesium3DTilesSelection::TileLoadResult&& tileLoadResult,
+      const glm::dmat4& transform) {
+    const double startSeconds = FPlatformTime::Seconds();
+
+    // Check before reading the actor's options, because the tileset may
+    // have been destroyed since the tile was requested.
+    TileLoadCancellation::Check cancellationCheck(this->_pCancellation);
+    TUniquePtr<UCesiumGltfComponent::HalfConstructed> pHalf;
+    if (!cancellationCheck.shouldStop(
+            TileLoadCancellation::Stage::AfterDecode)) {
+      CreateGltfOptions::CreateModelOptions options;
+      options.pModel =
+          std::get_if<CesiumGltf::Model>(&tileLoadResult.contentKind);
+      options.alwaysIncludeTangents =
+          this->_pActor->GetAlwaysIncludeTangents();
+      options.createPhysicsMeshes =
+          this->_pActor->GetCreatePhysicsMeshes();
+
+      options.ignoreKhrMaterialsUnlit =
+          this->_pActor->GetIgnoreKhrMaterialsUnlit();
+
+      if (this->_pActor->_featuresMetadataDescription) {
+        options.pFeaturesMetadataDescription =
+            &(*this->_pActor->_featuresMetadataDescription);
+      } else if (this->_pActor->_metadataDescription_DEPRECATED) {
+        options.pEncodedMetadataDescription_DEPRECATED =
+            &(*this->_pActor->_metadataDescription_DEPRECATED);
+      }
+
+      options.pCancellationCheck = &cancellationCheck;
+
+      pHalf =
+          UCesiumGltfComponent::CreateOffGameThread(transform, options);
+    }
+
+    const double endSeconds = FPlatformTime::Seconds();
+
+    std::optional<TileLoadCancellation::Stage> stoppedStage =
+        cancellationCheck.getStoppedStage();
+    if (stoppedStage) {
+      this->_pCancellation->recordCanceled(
+          *stoppedStage,
+          endSeconds - startSeconds);
+
+      // The tileset loads the tile again if it is still needed.
+      tileLoadResult.state =
+          Cesium3DTilesSelection::TileLoadResultState::RetryLater;
+      return Cesium3DTilesSelection::TileLoadResultAndRenderResources{
+          std::move(tileLoadResult),
+          nullptr};
+    }
+
+    if (tileLoadResult.pCompletedRequest) {
+      LoadLatencyAssetRequest::getTimes(
+          *tileLoadResult.pCompletedRequest,
+          pHalf->requestIssuedTime,
+          pHalf->responseReceivedTime);
+      pHalf->contentUrl = WarmSetAssetAccessor::stripCredentials(
+          tileLoadResult.pCompletedRequest->url());
+    }
+    pHalf->loadThreadDoneTime = endSeconds;
+    pHalf->loadThreadSeconds = endSeconds - startSeconds;
+
+    return Cesium3DTilesSelection::TileLoadResultAndRenderResources{
+        std::move(tileLoadResult),
+        pHalf.Release()};
+  }
+
   ACesium3DTileset* _pActor;
+  std::shared_ptr<TileLoadCancellation> _pCancellation;
+  std::shared_ptr<CesiumTextureMemory> _pTextureMemory;
 };
 
 void ACesium3DTileset::UpdateLoadStatus() {
@@ -1035,14 +1388,34 @@ void ACesium3DTileset::LoadTileset() {
   }
 
   if (this->BoundingVolumePoolComponent) {
-    this->BoundingVolumePoolComponent->initPool(this->OcclusionPoolSize);
+    this->BoundingVolumePoolComponent->initPool(
+        this->OcclusionPoolSize,
+        this->_cesiumViewExtension);
   }
 
   ACesiumCreditSystem* pCreditSystem = this->ResolvedCreditSystem;
 
+  this->_requestGroup =
+      getUnrealAssetAccessor()->createRequestGroup(this->RequestPriority);
+
+  this->_pTileLoadCancellation = std::make_shared<TileLoadCancellation>();
+  this->_pTextureMemory = std::make_shared<CesiumTextureMemory>();
+  this->_textureBudgetScale = 1.0;
+  this->_maximumCachedBytesProperty = -1;
+
+  this->_pWarmSetAccessor = std::make_shared<WarmSetAssetAccessor>(
+      std::make_shared<RequestGroupAssetAccessor>(
+          pAssetAccessor,
+          this->_requestGroup),
+      loadWarmSetSnapshot(this->WarmSetSnapshotFile));
+
   Cesium3DTilesSelection::TilesetExternals externals{
-      pAssetAccessor,
-      std::make_shared<UnrealResourcePreparer>(this),
+      std::make_shared<TaskLaneAssetAccessor>(
+          std::make_shared<LoadLatencyAssetAccessor>(this->_pWarmSetAccessor)),
+      std::make_shared<UnrealResourcePreparer>(
+          this,
+          this->_pTileLoadCancellation,
+          this->_pTextureMemory),
       asyncSystem,
       pCreditSystem ? pCreditSystem->GetExternalCreditSystem() : nullptr,
       spdlog::default_logger(),
@@ -1055,6 +1428,10 @@ void ACesium3DTileset::LoadTileset() {
   this->_startTime = std::chrono::high_resolution_clock::now();
 
   this->LoadProgress = 0;
+  this->invalidateIdleState();
+  this->_tilesPreparedInMainThread = 0;
+  this->_mainThreadPrepareSeconds = 0.0;
+  this->_tileLoadLatency.reset();
 
   Cesium3DTilesSelection::TilesetOptions options;
 
@@ -1224,6 +1601,35 @@ void ACesium3DTileset::DestroyTileset() {
     this->_cesiumViewExtension = nullptr;
   }
 
+  this->invalidateIdleState();
+  this->_pWarmSetAccessor = nullptr;
+
+  // A credit that this tileset added first in a frame was not recorded by the
+  // other tilesets that also need it, so have them record it again.
+  UWorld* pWorld = this->GetWorld();
+  if (pWorld) {
+    for (TActorIterator<ACesium3DTileset> it(pWorld); it; ++it) {
+      if (*it != this) {
+        it->invalidateIdleState();
+      }
+    }
+  }
+
+  if (this->_pTileLoadCancellation) {
+    this->_pTileLoadCancellation->cancelAll();
+    this->_pTileLoadCancellation = nullptr;
+  }
+
+  // Textures that outlive the tileset keep counting against its old counts.
+  this->_pTextureMemory = nullptr;
+  this->_textureBudgetScale = 1.0;
+
+  if (this->_requestGroup != 0) {
+    getUnrealAssetAccessor()->cancelRequestGroup(this->_requestGroup);
+    this->_requestGroup = 0;
+  }
+  this->_requestViewCameras.clear();
+
   switch (this->TilesetSource) {
   case ETilesetSource::FromUrl:
     UE_LOG(
@@ -1516,11 +1922,19 @@ std::vector<FCesiumCamera> ACesium3DTileset::GetSceneCaptures() const {
     FRotator captureRotation = pSceneCaptureComponent->GetComponentRotation();
     double captureFov = pSceneCaptureComponent->FOVAngle;
 
-    cameras.emplace_back(
+    FCesiumCamera& camera = cameras.emplace_back(
         renderTargetSize,
         captureLocation,
         captureRotation,
         captureFov);
+
+    const UCesiumSceneCaptureSettingsComponent* pSettings =
+        pSceneCapture
+            ->FindComponentByClass<UCesiumSceneCaptureSettingsComponent>();
+    if (pSettings) {
+      camera.ScreenSpaceErrorMultiplier = pSettings->ScreenSpaceErrorMultiplier;
+      camera.LoadPriorityWeight = pSettings->LoadPriorityWeight;
+    }
   }
 
   return cameras;
@@ -1529,7 +1943,8 @@ std::vector<FCesiumCamera> ACesium3DTileset::GetSceneCaptures() const {
 /*static*/ Cesium3DTilesSelection::ViewState
 ACesium3DTileset::CreateViewStateFromViewParameters(
     const FCesiumCamera& camera,
-    const glm::dmat4& unrealWorldToTileset) {
+    const glm::dmat4& unrealWorldToTileset,
+    double screenSpaceErrorMultiplier) {
 
   double horizontalFieldOfView =
       FMath::DegreesToRadians(camera.FieldOfViewDegrees);
@@ -1561,6 +1976,13 @@ ACesium3DTileset::CreateViewStateFromViewParameters(
   double verticalFieldOfView =
       atan(tan(horizontalFieldOfView * 0.5) / actualAspectRatio) * 2.0;
 
+  // The screen-space error of a tile is proportional to the viewport size, so
+  // shrinking the viewport (while keeping the field of view) has the same
+  // effect as raising the maximum screen-space error for this view only.
+  if (screenSpaceErrorMultiplier > 0.0 && screenSpaceErrorMultiplier != 1.0) {
+    size /= screenSpaceErrorMultiplier;
+  }
+
   FVector direction = camera.Rotation.RotateVector(FVector(1.0f, 0.0f, 0.0f));
   FVector up = camera.Rotation.RotateVector(FVector(0.0f, 0.0f, 1.0f));
 
@@ -1663,6 +2085,23 @@ bool ACesium3DTileset::ShouldTickIfViewportsOnly() const {
 
 namespace {
 
+bool camerasEqual(
+    const std::vector<FCesiumCamera>& lhs,
+    const std::vector<FCesiumCamera>& rhs) {
+  return std::equal(
+      lhs.begin(),
+      lhs.end(),
+      rhs.begin(),
+      rhs.end(),
+      [](const FCesiumCamera& a, const FCesiumCamera& b) {
+        return a.ViewportSize == b.ViewportSize && a.Location == b.Location &&
+               a.Rotation == b.Rotation &&
+               a.FieldOfViewDegrees == b.FieldOfViewDegrees &&
+               a.OverrideAspectRatio == b.OverrideAspectRatio &&
+               a.ScreenSpaceErrorMultiplier == b.ScreenSpaceErrorMultiplier;
+      });
+}
+
 void removeVisibleTilesFromList(
     std::vector<Cesium3DTilesSelection::Tile*>& list,
     const std::vector<Cesium3DTilesSelection::Tile*>& visibleTiles) {
@@ -1778,34 +2217,186 @@ void applyActorCollisionSettings(
     }
   }
 }
+
+/**
+ * @brief Determines whether any camera has turned away from its earlier
+ * direction by more than half of its field of view, so that much of what it
+ * shows is different.
+ */
+bool haveCamerasTurnedAway(
+    const std::vector<FCesiumCamera>& previousCameras,
+    const std::vector<FCesiumCamera>& cameras) {
+  if (previousCameras.size() != cameras.size()) {
+    return true;
+  }
+
+  for (size_t i = 0; i < cameras.size(); ++i) {
+    const double halfFieldOfView =
+        0.5 * FMath::DegreesToRadians(cameras[i].FieldOfViewDegrees);
+    const double cosAngle = FVector::DotProduct(
+        previousCameras[i].Rotation.Vector(),
+        cameras[i].Rotation.Vector());
+    if (cosAngle < FMath::Cos(halfFieldOfView)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Computes the load priority weight of the tileset's requests, which is
+ * the largest weight of the cameras whose view contains the tileset. If no
+ * camera's view contains it, or its bounds are not known yet, it is the
+ * largest weight of any camera.
+ */
+double computeLoadPriorityWeight(
+    const std::vector<FCesiumCamera>& cameras,
+    const std::vector<Cesium3DTilesSelection::ViewState>& frustums,
+    const Cesium3DTilesSelection::Tile* pRootTile) {
+  double anyWeight = 0.0;
+  double visibleWeight = 0.0;
+  bool anyVisible = false;
+  for (size_t i = 0; i < cameras.size() && i < frustums.size(); ++i) {
+    const double weight =
+        FMath::Clamp(cameras[i].LoadPriorityWeight, 0.0, 1.0);
+    anyWeight = FMath::Max(anyWeight, weight);
+    if (pRootTile &&
+        frustums[i].isBoundingVolumeVisible(pRootTile->getBoundingVolume())) {
+      visibleWeight = FMath::Max(visibleWeight, weight);
+      anyVisible = true;
+    }
+  }
+  return anyVisible ? visibleWeight : anyWeight;
+}
 } // namespace
 
-void ACesium3DTileset::updateTilesetOptionsFromProperties() {
+int64 ACesium3DTileset::getMaximumCachedBytes() {
+  // Only computed when the property changes or the tileset is loaded, so that
+  // cesium-native's cache limit does not move as overlay textures come and go.
+  if (this->_maximumCachedBytesProperty == this->MaximumCachedBytes) {
+    return this->_maximumCachedBytes;
+  }
+  this->_maximumCachedBytesProperty = this->MaximumCachedBytes;
+
+  // Without asynchronous texture creation, raster overlay images are handed
+  // over to their textures rather than copied, so cesium-native no longer
+  // counts them in the tileset's cached bytes. Count their textures instead.
+  // Overlay textures created later are bounded by the TextureMemoryBudget.
+  if (GRHISupportsAsyncTextureCreation || !this->_pTextureMemory) {
+    this->_maximumCachedBytes = this->MaximumCachedBytes;
+  } else {
+    const int64 overlayBytes =
+        this->_pTextureMemory->getStatistics().bytes[size_t(
+            CesiumTextureMemory::Category::RasterOverlay)];
+    this->_maximumCachedBytes =
+        FMath::Max(this->MaximumCachedBytes - overlayBytes, int64(0));
+  }
+  return this->_maximumCachedBytes;
+}
+
+bool ACesium3DTileset::updateTilesetOptionsFromProperties() {
   Cesium3DTilesSelection::TilesetOptions& options =
       this->_pTileset->getOptions();
-  options.maximumScreenSpaceError =
-      static_cast<double>(this->MaximumScreenSpaceError);
-  options.maximumCachedBytes = this->MaximumCachedBytes;
-  options.preloadAncestors = this->PreloadAncestors;
-  options.preloadSiblings = this->PreloadSiblings;
-  options.forbidHoles = this->ForbidHoles;
-  options.maximumSimultaneousTileLoads = this->MaximumSimultaneousTileLoads;
-  options.loadingDescendantLimit = this->LoadingDescendantLimit;
-  options.enableFrustumCulling = this->EnableFrustumCulling;
-  options.enableOcclusionCulling =
-      GetDefault<UCesiumRuntimeSettings>()
-          ->EnableExperimentalOcclusionCullingFeature &&
-      this->EnableOcclusionCulling;
-  options.showCreditsOnScreen = this->ShowCreditsOnScreen;
 
-  options.delayRefinementForOcclusion = this->DelayRefinementForOcclusion;
-  options.enableFogCulling = this->EnableFogCulling;
-  options.enforceCulledScreenSpaceError = this->EnforceCulledScreenSpaceError;
-  options.culledScreenSpaceError =
-      static_cast<double>(this->CulledScreenSpaceError);
-  options.enableLodTransitionPeriod = this->UseLodTransitions;
-  options.lodTransitionLength = this->LodTransitionLength;
+  bool changed = false;
+  auto setOption = [&changed](auto& option, auto value) {
+    using OptionType = std::decay_t<decltype(option)>;
+    if (option != static_cast<OptionType>(value)) {
+      option = static_cast<OptionType>(value);
+      changed = true;
+    }
+  };
+
+  // Over the texture budget, coarser tiles are selected, and tiles that are
+  // not rendered are unloaded at once so that their textures are freed.
+  setOption(
+      options.maximumScreenSpaceError,
+      this->MaximumScreenSpaceError * this->_textureBudgetScale);
+  setOption(
+      options.maximumCachedBytes,
+      this->_textureBudgetScale > 1.0 ? 0 : this->getMaximumCachedBytes());
+  setOption(options.preloadAncestors, this->PreloadAncestors);
+  setOption(options.preloadSiblings, this->PreloadSiblings);
+  setOption(options.forbidHoles, this->ForbidHoles);
+  setOption(
+      options.maximumSimultaneousTileLoads,
+      this->MaximumSimultaneousTileLoads);
+  setOption(options.loadingDescendantLimit, this->LoadingDescendantLimit);
+  setOption(options.enableFrustumCulling, this->EnableFrustumCulling);
+  setOption(
+      options.enableOcclusionCulling,
+      GetDefault<UCesiumRuntimeSettings>()
+              ->EnableExperimentalOcclusionCullingFeature &&
+          this->EnableOcclusionCulling);
+  setOption(options.showCreditsOnScreen, this->ShowCreditsOnScreen);
+
+  setOption(
+      options.delayRefinementForOcclusion,
+      this->DelayRefinementForOcclusion);
+  setOption(options.enableFogCulling, this->EnableFogCulling);
+  setOption(
+      options.enforceCulledScreenSpaceError,
+      this->EnforceCulledScreenSpaceError);
+  setOption(options.culledScreenSpaceError, this->CulledScreenSpaceError);
+  setOption(options.enableLodTransitionPeriod, this->UseLodTransitions);
+  setOption(options.lodTransitionLength, this->LodTransitionLength);
   // options.kickDescendantsWhileFadingIn = false;
+
+  return changed;
+}
+
+bool ACesium3DTileset::isIdleAfterUpdate(
+    const Cesium3DTilesSelection::ViewUpdateResult& result) const {
+  // Occlusion results may change the selection at any time. The bounding
+  // volume pool outlives disabling occlusion culling, so check the options the
+  // tileset is actually using.
+  if (this->_captureMovieMode ||
+      this->_pTileset->getOptions().enableOcclusionCulling) {
+    return false;
+  }
+
+  if (this->LoadProgress < 100.0f || !this->_tilesToHideNextFrame.empty() ||
+      !result.tilesFadingOut.empty() ||
+      result.workerThreadTileLoadQueueLength > 0 ||
+      result.mainThreadTileLoadQueueLength > 0) {
+    return false;
+  }
+
+  // Excluders may change their minds at any time.
+  if (!this->_pTileset->getOptions().excluders.empty()) {
+    return false;
+  }
+
+  // Raster overlay tiles are attached to geometry tiles during the traversal,
+  // so keep traversing until they're all loaded.
+  const Cesium3DTilesSelection::RasterOverlayCollection& overlays =
+      this->_pTileset->getOverlays();
+  for (const auto& pTileProvider : overlays.getTileProviders()) {
+    if (pTileProvider->isPlaceholder() ||
+        pTileProvider->getNumberOfTilesLoading() > 0) {
+      return false;
+    }
+  }
+
+  if (this->UseLodTransitions) {
+    for (Cesium3DTilesSelection::Tile* pTile : result.tilesToRenderThisFrame) {
+      const Cesium3DTilesSelection::TileRenderContent* pRenderContent =
+          pTile->getContent().getRenderContent();
+      if (pRenderContent &&
+          pRenderContent->getLodTransitionFadePercentage() < 1.0f) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void ACesium3DTileset::invalidateIdleState() {
+  this->_idleAfterLastUpdate = false;
+  this->_lastCameras.clear();
+  this->_lastFrameCredits.clear();
 }
 
 void ACesium3DTileset::updateLastViewUpdateResultState(
@@ -1932,6 +2523,34 @@ void ACesium3DTileset::showTilesToRender(
   }
 }
 
+void ACesium3DTileset::updateMipResidency(
+    const std::vector<Cesium3DTilesSelection::Tile*>& tiles,
+    const std::vector<FCesiumCamera>& cameras) {
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::UpdateMipResidency)
+
+  if (cameras.empty()) {
+    return;
+  }
+
+  for (Cesium3DTilesSelection::Tile* pTile : tiles) {
+    if (pTile->getState() != Cesium3DTilesSelection::TileLoadState::Done) {
+      continue;
+    }
+
+    const Cesium3DTilesSelection::TileRenderContent* pRenderContent =
+        pTile->getContent().getRenderContent();
+    if (!pRenderContent) {
+      continue;
+    }
+
+    UCesiumGltfComponent* Gltf = static_cast<UCesiumGltfComponent*>(
+        pRenderContent->getRenderResources());
+    if (Gltf) {
+      Gltf->UpdateMipResidency(pRenderContent->getModel(), cameras);
+    }
+  }
+}
+
 static void updateTileFade(Cesium3DTilesSelection::Tile* pTile, bool fadingIn) {
   if (!pTile || !pTile->getContent().isRenderContent()) {
     return;
@@ -1990,29 +2609,32 @@ void ACesium3DTileset::Tick(float DeltaTime) {
     }
   }
 
-  if (this->BoundingVolumePoolComponent && this->_cesiumViewExtension) {
+  if (this->BoundingVolumePoolComponent) {
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::UpdateOcclusion)
-    const TArray<USceneComponent*>& children =
-        this->BoundingVolumePoolComponent->GetAttachChildren();
-    for (USceneComponent* pChild : children) {
-      UCesiumBoundingVolumeComponent* pBoundingVolume =
-          Cast<UCesiumBoundingVolumeComponent>(pChild);
-
-      if (!pBoundingVolume) {
-        continue;
-      }
+    this->BoundingVolumePoolComponent->UpdateOcclusion();
+  }
 
-      pBoundingVolume->UpdateOcclusion(*this->_cesiumViewExtension.Get());
-    }
+  if (this->_pTextureMemory) {
+    this->_textureBudgetScale = CesiumTextureMemory::updateBudgetScale(
+        this->_textureBudgetScale,
+        this->_pTextureMemory->getStatistics().getTotalBytes(),
+        this->TextureMemoryBudget,
+        DeltaTime);
   }
 
-  updateTilesetOptionsFromProperties();
+  bool optionsChanged = updateTilesetOptionsFromProperties();
 
   std::vector<FCesiumCamera> cameras = this->GetCameras();
   if (cameras.empty()) {
     return;
   }
 
+  if (this->_requestGroup != 0 &&
+      haveCamerasTurnedAway(this->_requestViewCameras, cameras)) {
+    getUnrealAssetAccessor()->advanceRequestGroupView(this->_requestGroup);
+    this->_requestViewCameras = cameras;
+  }
+
   glm::dmat4 ueTilesetToUeWorld =
       VecMath::createMatrix4D(this->GetActorTransform().ToMatrixWithScale());
 
@@ -2028,10 +2650,66 @@ void ACesium3DTileset::Tick(float DeltaTime) {
     return;
   }
 
+  for (FCesiumCamera& camera : cameras) {
+    camera.ScreenSpaceErrorMultiplier =
+        FMath::Max(camera.ScreenSpaceErrorMultiplier, 0.0);
+  }
+
+  std::shared_ptr<CesiumUtility::CreditSystem> pCreditSystem =
+      IsValid(this->ResolvedCreditSystem)
+          ? this->ResolvedCreditSystem->GetExternalCreditSystem()
+          : nullptr;
+
+  if (this->SkipUpdatesWhenIdle && this->_idleAfterLastUpdate &&
+      !optionsChanged &&
+      unrealWorldToCesiumTileset == this->_lastUnrealWorldToCesiumTileset &&
+      camerasEqual(cameras, this->_lastCameras)) {
+    TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::SkipIdleUpdate)
+    INC_DWORD_STAT(STAT_CesiumIdleTilesetUpdatesSkipped);
+
+    // The traversal would normally take care of these.
+    getAssetAccessor()->tick();
+    getAsyncSystem().dispatchMainThreadTasks();
+    if (pCreditSystem) {
+      for (const CesiumUtility::Credit& credit : this->_lastFrameCredits) {
+        pCreditSystem->addCreditToFrame(credit);
+      }
+    }
+    return;
+  }
+
+  std::vector<CesiumUtility::Credit> creditsBefore;
+  if (pCreditSystem) {
+    creditsBefore = pCreditSystem->getCreditsToShowThisFrame();
+  }
+
   std::vector<Cesium3DTilesSelection::ViewState> frustums;
   for (const FCesiumCamera& camera : cameras) {
-    frustums.push_back(
-        CreateViewStateFromViewParameters(camera, unrealWorldToCesiumTileset));
+    frustums.push_back(CreateViewStateFromViewParameters(
+        camera,
+        unrealWorldToCesiumTileset,
+        camera.ScreenSpaceErrorMultiplier));
+  }
+
+  // A tileset seen only by secondary views, such as a minimap's scene capture,
+  // sends its requests after those of the tilesets in the main views.
+  if (this->_requestGroup != 0) {
+    const double weight = computeLoadPriorityWeight(
+        cameras,
+        frustums,
+        this->_pTileset->getRootTile());
+    getUnrealAssetAccessor()->setRequestGroupPriority(
+        this->_requestGroup,
+        this->RequestPriority - (1.0 - weight));
+  }
+
+  // Tiles outside the views are loaded on purpose when frustum culling is
+  // disabled, and when culled tiles are refined to CulledScreenSpaceError.
+  if (this->_pTileLoadCancellation) {
+    this->_pTileLoadCancellation->setViews(
+        this->EnableFrustumCulling && !this->EnforceCulledScreenSpaceError
+            ? frustums
+            : std::vector<Cesium3DTilesSelection::ViewState>());
   }
 
   const Cesium3DTilesSelection::ViewUpdateResult* pResult;
@@ -2042,6 +2720,19 @@ void ACesium3DTileset::Tick(float DeltaTime) {
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::updateView)
     pResult = &this->_pTileset->updateView(frustums, DeltaTime);
   }
+
+  // The credits that this tileset's traversal added are those that are shown
+  // now but were not before it.
+  this->_lastFrameCredits.clear();
+  if (pCreditSystem) {
+    for (const CesiumUtility::Credit& credit :
+         pCreditSystem->getCreditsToShowThisFrame()) {
+      if (std::find(creditsBefore.begin(), creditsBefore.end(), credit) ==
+          creditsBefore.end()) {
+        this->_lastFrameCredits.push_back(credit);
+      }
+    }
+  }
   updateLastViewUpdateResultState(*pResult);
 
   removeCollisionForTiles(pResult->tilesFadingOut);
@@ -2064,6 +2755,10 @@ void ACesium3DTileset::Tick(float DeltaTime) {
 
   showTilesToRender(pResult->tilesToRenderThisFrame);
 
+  if (GetDefault<UCesiumRuntimeSettings>()->EnableTextureMipResidency) {
+    updateMipResidency(pResult->tilesToRenderThisFrame, cameras);
+  }
+
   if (this->UseLodTransitions) {
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::UpdateTileFades)
 
@@ -2078,6 +2773,18 @@ void ACesium3DTileset::Tick(float DeltaTime) {
   }
 
   this->UpdateLoadStatus();
+
+  // Once a view with tiles to render has finished loading, every tile it needs
+  // has been requested, so prefetched tiles that were not claimed by then are
+  // not needed.
+  if (this->_pWarmSetAccessor && this->LoadProgress >= 100.0f &&
+      !pResult->tilesToRenderThisFrame.empty()) {
+    this->_pWarmSetAccessor->discardUnclaimedPrefetches();
+  }
+
+  this->_idleAfterLastUpdate = this->isIdleAfterUpdate(*pResult);
+  this->_lastCameras = std::move(cameras);
+  this->_lastUnrealWorldToCesiumTileset = unrealWorldToCesiumTileset;
 }
 
 void ACesium3DTileset::EndPlay(const EEndPlayReason::Type EndPlayReason) {
@@ -2143,6 +2850,8 @@ void ACesium3DTileset::PostEditChangeProperty(
 
   if (PropName == GET_MEMBER_NAME_CHECKED(ACesium3DTileset, TilesetSource) ||
       PropName == GET_MEMBER_NAME_CHECKED(ACesium3DTileset, Url) ||
+      PropName ==
+          GET_MEMBER_NAME_CHECKED(ACesium3DTileset, WarmSetSnapshotFile) ||
       PropName == GET_MEMBER_NAME_CHECKED(ACesium3DTileset, IonAssetID) ||
       PropName == GET_MEMBER_NAME_CHECKED(ACesium3DTileset, IonAccessToken) ||
       PropName ==
@@ -2,47 +2,134 @@
 
 #include "CesiumBoundingVolumeComponent.h"
 #include "CalcBounds.h"
-#include "CesiumGeoreference.h"
-#include "CesiumLifetime.h"
-#include "UObject/UObjectGlobals.h"
+#include "CesiumViewExtension.h"
+#include "RenderingThread.h"
+#include "SceneView.h"
 #include "VecMath.h"
-#include <optional>
+#include <utility>
 #include <variant>
 
 using namespace Cesium3DTilesSelection;
+using namespace CesiumBoundingVolumeOcclusion;
+
+CesiumBoundingVolumeProxy::CesiumBoundingVolumeProxy(
+    UCesiumBoundingVolumePoolComponent* pOwner,
+    int32 slot)
+    : _pOwner(pOwner), _slot(slot) {}
+
+void CesiumBoundingVolumeProxy::reset(const Tile* pTile) {
+  this->_occlusionState = TileOcclusionState::OcclusionUnavailable;
+  if (pTile) {
+    this->_tileBounds = pTile->getBoundingVolume();
+    this->_isMapped = true;
+  } else {
+    this->_isMapped = false;
+  }
+  this->_pOwner->updateSlot(this->_slot);
+}
+
+class FCesiumBoundingVolumePoolSceneProxy : public FPrimitiveSceneProxy {
+public:
+  FCesiumBoundingVolumePoolSceneProxy(
+      UCesiumBoundingVolumePoolComponent* pComponent,
+      const TArray<FBoxSphereBounds>& volumeBounds,
+      const TWeakPtr<CesiumViewExtension, ESPMode::ThreadSafe>& pViewExtension)
+      : FPrimitiveSceneProxy(pComponent),
+        _volumeBounds(volumeBounds),
+        _pViewExtension(pViewExtension) {}
+
+  // The proxy registers itself once it is in the scene, so that the view
+  // extension can find it through its scene info.
+  void CreateRenderThreadResources() override {
+    TSharedPtr<CesiumViewExtension, ESPMode::ThreadSafe> pViewExtension =
+        this->_pViewExtension.Pin();
+    if (pViewExtension) {
+      pViewExtension->registerPrimitive_renderThread(this);
+    }
+  }
+
+  void DestroyRenderThreadResources() override {
+    TSharedPtr<CesiumViewExtension, ESPMode::ThreadSafe> pViewExtension =
+        this->_pViewExtension.Pin();
+    if (pViewExtension) {
+      pViewExtension->unregisterPrimitive_renderThread(this);
+    }
+  }
+
+  SIZE_T GetTypeHash() const override {
+    static size_t UniquePointer;
+    return reinterpret_cast<size_t>(&UniquePointer);
+  }
+
+  uint32 GetMemoryFootprint(void) const override {
+    return sizeof(FCesiumBoundingVolumePoolSceneProxy) + GetAllocatedSize() +
+           this->_volumeBounds.GetAllocatedSize();
+  }
+
+  // Each bounding volume is a sub-primitive occlusion query, so the renderer
+  // keeps an occlusion history for each one, keyed by its slot, which the
+  // view extension reads back.
+  bool HasSubprimitiveOcclusionQueries() const override { return true; }
+
+  const TArray<FBoxSphereBounds>*
+  GetOcclusionQueries(const FSceneView* View) const override {
+    return &this->_volumeBounds;
+  }
+
+  void SetVolumeBounds_RenderThread(TArray<FBoxSphereBounds>&& volumeBounds) {
+    this->_volumeBounds = std::move(volumeBounds);
+  }
+
+private:
+  TArray<FBoxSphereBounds> _volumeBounds;
+  TWeakPtr<CesiumViewExtension, ESPMode::ThreadSafe> _pViewExtension;
+};
 
 UCesiumBoundingVolumePoolComponent::UCesiumBoundingVolumePoolComponent()
     : _cesiumToUnreal(1.0) {
   SetMobility(EComponentMobility::Movable);
+  bUseAsOccluder = false;
+  SetCastShadow(false);
 }
 
-void UCesiumBoundingVolumePoolComponent::initPool(int32 maxPoolSize) {
+void UCesiumBoundingVolumePoolComponent::initPool(
+    int32 maxPoolSize,
+    const TSharedPtr<CesiumViewExtension, ESPMode::ThreadSafe>&
+        pViewExtension) {
+  // The scene proxy registers with the view extension, so create it again if
+  // it was created for a different one.
+  if (this->_pViewExtension.Pin() != pViewExtension) {
+    this->_pViewExtension = pViewExtension;
+    this->MarkRenderStateDirty();
+  }
+
   this->_pPool = std::make_shared<CesiumBoundingVolumePool>(this, maxPoolSize);
 }
 
 TileOcclusionRendererProxy* UCesiumBoundingVolumePoolComponent::createProxy() {
-  UCesiumBoundingVolumeComponent* pBoundingVolume =
-      NewObject<UCesiumBoundingVolumeComponent>(this);
-  pBoundingVolume->SetVisibility(false);
-  pBoundingVolume->bUseAsOccluder = false;
-
-  pBoundingVolume->SetMobility(EComponentMobility::Movable);
-  pBoundingVolume->SetFlags(
-      RF_Transient | RF_DuplicateTransient | RF_TextExportTransient);
-  pBoundingVolume->SetupAttachment(this);
-  pBoundingVolume->RegisterComponent();
+  const int32 slot = this->_slots.allocate();
+  if (this->_slots.getSlotCount() > int32(this->_proxies.size())) {
+    this->_proxies.emplace_back();
+    this->_volumeBounds.Emplace(ForceInit);
+    this->_boundsChangedFrames.emplace_back(GFrameNumber);
+  }
 
-  pBoundingVolume->UpdateTransformFromCesium(this->_cesiumToUnreal);
+  this->_proxies[slot] =
+      std::make_unique<CesiumBoundingVolumeProxy>(this, slot);
+  this->updateSlot(slot);
 
-  return (TileOcclusionRendererProxy*)pBoundingVolume;
+  return this->_proxies[slot].get();
 }
 
 void UCesiumBoundingVolumePoolComponent::destroyProxy(
     TileOcclusionRendererProxy* pProxy) {
-  UCesiumBoundingVolumeComponent* pBoundingVolumeComponent =
-      (UCesiumBoundingVolumeComponent*)pProxy;
-  if (pBoundingVolumeComponent) {
-    CesiumLifetime::destroyComponentRecursively(pBoundingVolumeComponent);
+  CesiumBoundingVolumeProxy* pBoundingVolume =
+      static_cast<CesiumBoundingVolumeProxy*>(pProxy);
+  if (pBoundingVolume) {
+    int32 slot = pBoundingVolume->getSlot();
+    this->_proxies[slot].reset();
+    this->_slots.free(slot);
+    this->updateSlot(slot);
   }
 }
 
@@ -66,85 +153,127 @@ void UCesiumBoundingVolumePoolComponent::UpdateTransformFromCesium(
     const glm::dmat4& CesiumToUnrealTransform) {
   this->_cesiumToUnreal = CesiumToUnrealTransform;
 
-  const TArray<USceneComponent*>& children = this->GetAttachChildren();
-  for (USceneComponent* pChild : children) {
-    UCesiumBoundingVolumeComponent* pBoundingVolume =
-        Cast<UCesiumBoundingVolumeComponent>(pChild);
-    if (pBoundingVolume) {
-      pBoundingVolume->UpdateTransformFromCesium(CesiumToUnrealTransform);
+  for (int32 slot = 0; slot < int32(this->_proxies.size()); ++slot) {
+    if (this->_proxies[slot] && this->_proxies[slot]->isMapped()) {
+      this->updateSlot(slot);
     }
   }
 }
 
-class FCesiumBoundingVolumeSceneProxy : public FPrimitiveSceneProxy {
-public:
-  FCesiumBoundingVolumeSceneProxy(UCesiumBoundingVolumeComponent* pComponent)
-      : FPrimitiveSceneProxy(pComponent /*, name?*/) {}
-  SIZE_T GetTypeHash() const override {
-    static size_t UniquePointer;
-    return reinterpret_cast<size_t>(&UniquePointer);
-  }
+void UCesiumBoundingVolumePoolComponent::UpdateOcclusion() {
+  if (this->_boundsChanged) {
+    TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::SendOcclusionBounds)
 
-  uint32 GetMemoryFootprint(void) const override {
-    return sizeof(FCesiumBoundingVolumeSceneProxy) + GetAllocatedSize();
+    this->_boundsChanged = false;
+
+    FCesiumBoundingVolumePoolSceneProxy* pSceneProxy =
+        static_cast<FCesiumBoundingVolumePoolSceneProxy*>(this->SceneProxy);
+    if (pSceneProxy) {
+      ENQUEUE_RENDER_COMMAND(Cesium_SetOcclusionBounds)
+      ([pSceneProxy, volumeBounds = this->_volumeBounds](
+           FRHICommandListImmediate& RHICmdList) mutable {
+        pSceneProxy->SetVolumeBounds_RenderThread(std::move(volumeBounds));
+      });
+    }
+
+    // Update the bounds of the primitive as a whole, so that it is not frustum
+    // culled while any of its bounding volumes is in view.
+    this->UpdateBounds();
+    this->MarkRenderTransformDirty();
   }
-};
 
-FPrimitiveSceneProxy* UCesiumBoundingVolumeComponent::CreateSceneProxy() {
-  return new FCesiumBoundingVolumeSceneProxy(this);
-}
+  TSharedPtr<CesiumViewExtension, ESPMode::ThreadSafe> pViewExtension =
+      this->_pViewExtension.Pin();
+  if (!pViewExtension) {
+    return;
+  }
 
-void UCesiumBoundingVolumeComponent::UpdateOcclusion(
-    const CesiumViewExtension& cesiumViewExtension) {
-  if (!_isMapped) {
+  const CesiumViewExtension::PrimitiveOcclusionResults* pResults =
+      pViewExtension->getOcclusionResults(this->ComponentId);
+  if (!pResults) {
     return;
   }
 
-  TileOcclusionState occlusionState =
-      cesiumViewExtension.getPrimitiveOcclusionState(
-          this->ComponentId,
-          _occlusionState == TileOcclusionState::Occluded,
-          _mappedFrameTime);
+  // The results are stamped with the frame number of the view family they
+  // were read in, which is the GFrameNumber that the bounds changes were
+  // recorded with.
+  const uint32 resultsFrameNumber =
+      pViewExtension->getOcclusionResultsFrameNumber();
+
+  for (int32 slot = 0; slot < int32(this->_proxies.size()); ++slot) {
+    CesiumBoundingVolumeProxy* pProxy = this->_proxies[slot].get();
+    if (!pProxy || !pProxy->isMapped() ||
+        !areResultsCurrent(
+            resultsFrameNumber,
+            this->_boundsChangedFrames[slot])) {
+      continue;
+    }
+
+    // A view that did not query this slot yet has no result for it.
+    this->_slotResults.clear();
+    for (const std::vector<QueryResult>& viewResults : pResults->views) {
+      this->_slotResults.emplace_back(
+          slot < int32(viewResults.size()) ? viewResults[slot]
+                                           : QueryResult());
+    }
 
-  // If the occlusion result is unavailable, continue using the previous result.
-  if (occlusionState != TileOcclusionState::OcclusionUnavailable) {
-    _occlusionState = occlusionState;
+    // If the occlusion result is unavailable, continue using the previous
+    // result.
+    const TileOcclusionState state = computeOcclusionState(
+        this->_slotResults,
+        pProxy->getOcclusionState() == TileOcclusionState::Occluded);
+    if (state != TileOcclusionState::OcclusionUnavailable) {
+      pProxy->setOcclusionState(state);
+    }
   }
 }
 
-void UCesiumBoundingVolumeComponent::_updateTransform() {
-  const FTransform transform = FTransform(
-      VecMath::createMatrix(this->_cesiumToUnreal * this->_tileTransform));
-
-  this->SetRelativeTransform_Direct(transform);
-  this->SetComponentToWorld(transform);
-  this->MarkRenderTransformDirty();
+FPrimitiveSceneProxy* UCesiumBoundingVolumePoolComponent::CreateSceneProxy() {
+  this->_boundsChanged = false;
+  return new FCesiumBoundingVolumePoolSceneProxy(
+      this,
+      this->_volumeBounds,
+      this->_pViewExtension);
 }
 
-void UCesiumBoundingVolumeComponent::UpdateTransformFromCesium(
-    const glm::dmat4& CesiumToUnrealTransform) {
-  this->_cesiumToUnreal = CesiumToUnrealTransform;
-  this->_updateTransform();
+FBoxSphereBounds UCesiumBoundingVolumePoolComponent::CalcBounds(
+    const FTransform& LocalToWorld) const {
+  // The bounding volumes are already in Unreal world coordinates.
+  FBoxSphereBounds result(ForceInit);
+  bool first = true;
+  for (int32 slot = 0; slot < int32(this->_proxies.size()); ++slot) {
+    if (!this->_proxies[slot] || !this->_proxies[slot]->isMapped()) {
+      continue;
+    }
+
+    if (first) {
+      result = this->_volumeBounds[slot];
+      first = false;
+    } else {
+      result = result + this->_volumeBounds[slot];
+    }
+  }
+  return result;
 }
 
-void UCesiumBoundingVolumeComponent::reset(const Tile* pTile) {
-  if (pTile) {
-    this->_tileTransform = pTile->getTransform();
-    this->_tileBounds = pTile->getBoundingVolume();
-    this->_isMapped = true;
-    this->_mappedFrameTime = GetWorld()->GetRealTimeSeconds();
-    this->_updateTransform();
-    this->SetVisibility(true);
+void UCesiumBoundingVolumePoolComponent::updateSlot(int32 slot) {
+  const CesiumBoundingVolumeProxy* pProxy = this->_proxies[slot].get();
+  if (pProxy && pProxy->isMapped()) {
+    this->_volumeBounds[slot] = this->calcVolumeBounds(pProxy->getTileBounds());
   } else {
-    this->_occlusionState = TileOcclusionState::OcclusionUnavailable;
-    this->_isMapped = false;
-    this->SetVisibility(false);
+    this->_volumeBounds[slot] = FBoxSphereBounds(ForceInit);
   }
+
+  this->_boundsChangedFrames[slot] = GFrameNumber;
+  this->_boundsChanged = true;
 }
 
-FBoxSphereBounds UCesiumBoundingVolumeComponent::CalcBounds(
-    const FTransform& LocalToWorld) const {
-  return std::visit(
-      CalcBoundsOperation{LocalToWorld, this->_tileTransform},
-      this->_tileBounds);
+FBoxSphereBounds UCesiumBoundingVolumePoolComponent::calcVolumeBounds(
+    const BoundingVolume& bounds) const {
+  // Bounding volumes are in tileset coordinates, so the tile's own transform
+  // does not apply.
+  const FTransform tilesetToUnreal(
+      VecMath::createMatrix(this->_cesiumToUnreal));
+  const glm::dmat4 identity(1.0);
+  return std::visit(CalcBoundsOperation{tilesetToUnreal, identity}, bounds);
 }
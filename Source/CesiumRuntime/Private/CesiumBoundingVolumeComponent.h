@@ -2,23 +2,80 @@
 
 #pragma once
 
-#include "CesiumViewExtension.h"
+#include "CesiumBoundingVolumeOcclusion.h"
 #include "Components/PrimitiveComponent.h"
-#include "Components/SceneComponent.h"
 #include "CoreMinimal.h"
 #include "PrimitiveSceneProxy.h"
-#include "SceneView.h"
 #include <Cesium3DTilesSelection/BoundingVolume.h>
 #include <Cesium3DTilesSelection/TileOcclusionRendererProxy.h>
 #include <glm/mat4x4.hpp>
+#include <cstdint>
 #include <memory>
-#include <optional>
+#include <vector>
 #include "CesiumBoundingVolumeComponent.generated.h"
 
-class ACesiumGeoreference;
+class CesiumViewExtension;
+class UCesiumBoundingVolumePoolComponent;
+
+/**
+ * The bounding volume of a tile whose occlusion is tested by a
+ * {@link UCesiumBoundingVolumePoolComponent}. This is a plain object that only
+ * occupies a slot in the pool's array of bounding volumes, rather than a
+ * component of its own.
+ */
+class CesiumBoundingVolumeProxy
+    : public Cesium3DTilesSelection::TileOcclusionRendererProxy {
+public:
+  CesiumBoundingVolumeProxy(
+      UCesiumBoundingVolumePoolComponent* pOwner,
+      int32 slot);
+
+  Cesium3DTilesSelection::TileOcclusionState
+  getOcclusionState() const override {
+    return this->_occlusionState;
+  }
+
+  /**
+   * The index of this bounding volume in the pool's array of bounding volumes.
+   */
+  int32 getSlot() const { return this->_slot; }
+
+  /**
+   * Whether this proxy is currently mapped to a tile.
+   */
+  bool isMapped() const { return this->_isMapped; }
+
+  const Cesium3DTilesSelection::BoundingVolume& getTileBounds() const {
+    return this->_tileBounds;
+  }
+
+  void setOcclusionState(Cesium3DTilesSelection::TileOcclusionState state) {
+    this->_occlusionState = state;
+  }
 
+protected:
+  void reset(const Cesium3DTilesSelection::Tile* pTile) override;
+
+private:
+  UCesiumBoundingVolumePoolComponent* _pOwner;
+  int32 _slot;
+  bool _isMapped = false;
+
+  Cesium3DTilesSelection::TileOcclusionState _occlusionState =
+      Cesium3DTilesSelection::TileOcclusionState::OcclusionUnavailable;
+
+  Cesium3DTilesSelection::BoundingVolume _tileBounds =
+      CesiumGeometry::OrientedBoundingBox(glm::dvec3(0.0), glm::dmat3(1.0));
+};
+
+/**
+ * A single primitive that tests the occlusion of all of the bounding volumes
+ * of a tileset's tiles. Its scene proxy issues one occlusion query for each
+ * bounding volume, and the results are returned to the game thread together,
+ * in one array.
+ */
 UCLASS()
-class UCesiumBoundingVolumePoolComponent : public USceneComponent {
+class UCesiumBoundingVolumePoolComponent : public UPrimitiveComponent {
   GENERATED_BODY()
 
 public:
@@ -26,8 +83,15 @@ public:
 
   /**
    * Initialize the TileOcclusionRendererProxyPool implementation.
+   *
+   * @param maxPoolSize The maximum number of bounding volumes in the pool.
+   * @param pViewExtension The view extension that this component registers
+   * with in order to receive the occlusion results of its bounding volumes.
    */
-  void initPool(int32 maxPoolSize);
+  void initPool(
+      int32 maxPoolSize,
+      const TSharedPtr<CesiumViewExtension, ESPMode::ThreadSafe>&
+          pViewExtension);
 
   /**
    * Updates bounding volume transforms from a new double-precision
@@ -37,14 +101,33 @@ public:
    */
   void UpdateTransformFromCesium(const glm::dmat4& CesiumToUnrealTransform);
 
+  /**
+   * Sends the bounding volumes that changed since the last call to the render
+   * thread, and updates the occlusion state of each mapped bounding volume
+   * from the latest results of the view extension passed to
+   * {@link initPool}.
+   */
+  void UpdateOcclusion();
+
   const std::shared_ptr<Cesium3DTilesSelection::TileOcclusionRendererProxyPool>&
   getPool() {
     return this->_pPool;
   }
 
+  FPrimitiveSceneProxy* CreateSceneProxy() override;
+
+  virtual FBoxSphereBounds
+  CalcBounds(const FTransform& LocalToWorld) const override;
+
 private:
+  friend class CesiumBoundingVolumeProxy;
+
   glm::dmat4 _cesiumToUnreal;
 
+  // The view extension that the scene proxy registers with, so that
+  // occlusion results are aggregated for its bounding volumes.
+  TWeakPtr<CesiumViewExtension, ESPMode::ThreadSafe> _pViewExtension;
+
   // These are really implementations of the functions in
   // TileOcclusionRendererProxyPool, but we can't use multiple inheritance with
   // UObjects. Instead use the CesiumBoundingVolumePool and forward virtual
@@ -54,6 +137,13 @@ private:
 
   void destroyProxy(Cesium3DTilesSelection::TileOcclusionRendererProxy* pProxy);
 
+  // Recomputes the Unreal bounds of the given slot after its proxy was mapped
+  // to a tile or unmapped.
+  void updateSlot(int32 slot);
+
+  FBoxSphereBounds
+  calcVolumeBounds(const Cesium3DTilesSelection::BoundingVolume& bounds) const;
+
   class CesiumBoundingVolumePool
       : public Cesium3DTilesSelection::TileOcclusionRendererProxyPool {
   public:
@@ -73,65 +163,21 @@ private:
 
   std::shared_ptr<Cesium3DTilesSelection::TileOcclusionRendererProxyPool>
       _pPool;
-};
-
-UCLASS()
-class UCesiumBoundingVolumeComponent
-    : public UPrimitiveComponent,
-      public Cesium3DTilesSelection::TileOcclusionRendererProxy {
-  GENERATED_BODY()
-
-public:
-  // Sets default values for this component's properties
-  UCesiumBoundingVolumeComponent(){};
-  virtual ~UCesiumBoundingVolumeComponent() = default;
-
-  FPrimitiveSceneProxy* CreateSceneProxy() override;
-
-  /**
-   * Update the occlusion state for this bounding volume from the
-   * CesiumViewExtension.
-   */
-  void UpdateOcclusion(const CesiumViewExtension& cesiumViewExtension);
-
-  /**
-   * Updates this component's transform from a new double-precision
-   * transformation from the Cesium world to the Unreal Engine world, as well as
-   * the current tile's transform.
-   *
-   * @param CesiumToUnrealTransform The new transformation.
-   */
-  void UpdateTransformFromCesium(const glm::dmat4& CesiumToUnrealTransform);
 
-  virtual FBoxSphereBounds
-  CalcBounds(const FTransform& LocalToWorld) const override;
-
-  bool ShouldRecreateProxyOnUpdateTransform() const override { return true; }
+  // The proxy in each slot, or nullptr if the slot is free.
+  std::vector<std::unique_ptr<CesiumBoundingVolumeProxy>> _proxies;
+  CesiumBoundingVolumeOcclusion::SlotAllocator _slots;
 
-  // virtual void BeginDestroy() override;
-
-  Cesium3DTilesSelection::TileOcclusionState
-  getOcclusionState() const override {
-    return _occlusionState;
-  }
+  // The bounds of each slot in Unreal world coordinates. Unmapped slots have
+  // empty bounds.
+  TArray<FBoxSphereBounds> _volumeBounds;
+  bool _boundsChanged = false;
 
-protected:
-  void reset(const Cesium3DTilesSelection::Tile* pTile) override;
+  // The GFrameNumber in which the bounds of each slot last changed. Occlusion
+  // results read before they are current do not apply to the slot's current
+  // tile.
+  std::vector<uint32> _boundsChangedFrames;
 
-private:
-  void _updateTransform();
-
-  Cesium3DTilesSelection::TileOcclusionState _occlusionState =
-      Cesium3DTilesSelection::TileOcclusionState::OcclusionUnavailable;
-
-  // Whether this proxy is currently mapped to a tile.
-  bool _isMapped = false;
-
-  // The time when this bounding volume was mapped to the tile.
-  float _mappedFrameTime = 0.0f;
-
-  Cesium3DTilesSelection::BoundingVolume _tileBounds =
-      CesiumGeometry::OrientedBoundingBox(glm::dvec3(0.0), glm::dmat3(1.0));
-  glm::dmat4 _tileTransform = glm::dmat4(1.0);
-  glm::dmat4 _cesiumToUnreal = glm::dmat4(1.0);
+  // The results of each view for the slot being updated, reused across slots.
+  std::vector<CesiumBoundingVolumeOcclusion::QueryResult> _slotResults;
 };
@@ -0,0 +1,53 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumBoundingVolumeOcclusion.h"
+
+using namespace Cesium3DTilesSelection;
+
+namespace CesiumBoundingVolumeOcclusion {
+
+bool areResultsCurrent(
+    uint32 resultsFrameNumber,
+    uint32 boundsChangedFrameNumber) {
+  // Unsigned subtraction is correct across wrap-around, and results from
+  // before the change appear as a very large difference.
+  const uint32 elapsed = resultsFrameNumber - boundsChangedFrameNumber;
+  return elapsed >= ResultLatencyFrames && elapsed < (1u << 31);
+}
+
+TileOcclusionState computeOcclusionState(
+    gsl::span<const QueryResult> results,
+    bool previouslyOccluded) {
+  if (results.empty()) {
+    return TileOcclusionState::OcclusionUnavailable;
+  }
+
+  for (const QueryResult& result : results) {
+    if (!result.isDefinite) {
+      return TileOcclusionState::OcclusionUnavailable;
+    }
+
+    if (previouslyOccluded) {
+      if (result.pixelsPercentage > MinimumVisiblePixelsPercentage) {
+        return TileOcclusionState::NotOccluded;
+      }
+    } else if (!result.wasOccluded) {
+      return TileOcclusionState::NotOccluded;
+    }
+  }
+
+  return TileOcclusionState::Occluded;
+}
+
+int32 SlotAllocator::allocate() {
+  if (!this->_freeSlots.empty()) {
+    int32 slot = this->_freeSlots.back();
+    this->_freeSlots.pop_back();
+    return slot;
+  }
+  return this->_slotCount++;
+}
+
+void SlotAllocator::free(int32 slot) { this->_freeSlots.push_back(slot); }
+
+} // namespace CesiumBoundingVolumeOcclusion
@@ -0,0 +1,110 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "HAL/Platform.h"
+#include <Cesium3DTilesSelection/TileOcclusionRendererProxy.h>
+#include <gsl/span>
+#include <vector>
+
+/**
+ * Turns the renderer's occlusion results for the bounding volumes of tiles
+ * into their occlusion states.
+ */
+namespace CesiumBoundingVolumeOcclusion {
+
+/**
+ * The number of frames after a bounding volume's bounds change during which
+ * its occlusion results may still come from queries of its previous bounds,
+ * since Unreal reads occlusion queries back a few frames after issuing them.
+ */
+constexpr uint32 ResultLatencyFrames = 4;
+
+/**
+ * The fraction of a view's pixels that a bounding volume previously found to
+ * be occluded must cover in order to be found visible again. This keeps a
+ * bounding volume at the edge of an occluder from alternating between the two
+ * states.
+ */
+constexpr float MinimumVisiblePixelsPercentage = 0.01f;
+
+/**
+ * The result of one occlusion query in one view, as last recorded in the
+ * renderer's occlusion history.
+ */
+struct QueryResult {
+  /**
+   * The fraction of the view's pixels that passed the query.
+   */
+  float pixelsPercentage = 0.0f;
+
+  /**
+   * Whether the query has a result. Queries that were not issued or read
+   * back in the latest frame have none.
+   */
+  bool isDefinite = false;
+
+  /**
+   * Whether the renderer considered the query's bounds occluded.
+   */
+  bool wasOccluded = false;
+};
+
+/**
+ * Determines whether occlusion results are for a bounding volume's current
+ * bounds, rather than for bounds it had before, such as those of another tile
+ * that used the same slot.
+ *
+ * Both frame numbers must be GFrameNumber values, which is also the frame
+ * number of the view families rendered in that frame. They may wrap around.
+ *
+ * @param resultsFrameNumber The frame in which the results were read.
+ * @param boundsChangedFrameNumber The frame in which the bounds changed.
+ */
+bool areResultsCurrent(
+    uint32 resultsFrameNumber,
+    uint32 boundsChangedFrameNumber);
+
+/**
+ * Combines the results of a bounding volume's query in every view into its
+ * occlusion state. It is not occluded if it is visible in any view, and it is
+ * occluded only if it is known to be occluded in every view. A bounding volume
+ * that was occluded is only visible again once it covers more than
+ * {@link MinimumVisiblePixelsPercentage} of a view.
+ *
+ * @param results The query's result in each view.
+ * @param previouslyOccluded Whether the bounding volume was last found to be
+ * occluded.
+ */
+Cesium3DTilesSelection::TileOcclusionState computeOcclusionState(
+    gsl::span<const QueryResult> results,
+    bool previouslyOccluded);
+
+/**
+ * Hands out the indices of bounding volumes in an array of bounds, reusing the
+ * indices of freed bounding volumes before adding new ones.
+ */
+class SlotAllocator {
+public:
+  /**
+   * Gets the index of a slot that is not in use. It is either a freed slot or
+   * a new one at the end, in which case the slot count grows.
+   */
+  int32 allocate();
+
+  /**
+   * Makes a slot available to be allocated again.
+   */
+  void free(int32 slot);
+
+  /**
+   * Gets the number of slots, in use or freed.
+   */
+  int32 getSlotCount() const { return this->_slotCount; }
+
+private:
+  int32 _slotCount = 0;
+  std::vector<int32> _freeSlots;
+};
+
+} // namespace CesiumBoundingVolumeOcclusion
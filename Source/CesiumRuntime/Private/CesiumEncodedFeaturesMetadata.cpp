@@ -134,6 +134,8 @@ std::optional<EncodedFeatureIdSet> encodeFeatureIdTexture(
     encodedFeatureIdTexture.pTexture->sRGB = false;
     // TODO: upgrade to new texture creation path
     encodedFeatureIdTexture.pTexture->textureSource = LegacyTextureSource{};
+    encodedFeatureIdTexture.pTexture->memoryCategory =
+        CesiumTextureMemory::Category::MetadataTexture;
     featureIdTextureMap.Emplace(
         pFeatureIdImage,
         encodedFeatureIdTexture.pTexture);
@@ -563,6 +565,8 @@ EncodedPropertyTable encodePropertyTableAnyThreadPart(
       encodedProperty.pTexture->sRGB = false;
       // TODO: upgrade to new texture creation path.
       encodedProperty.pTexture->textureSource = LegacyTextureSource{};
+      encodedProperty.pTexture->memoryCategory =
+          CesiumTextureMemory::Category::MetadataTexture;
       encodedProperty.pTexture->pTextureData = createTexturePlatformData(
           textureDimension,
           textureDimension,
@@ -719,6 +723,8 @@ EncodedPropertyTexture encodePropertyTextureAnyThreadPart(
         encodedProperty.pTexture = MakeShared<LoadedTextureResult>();
         // TODO: upgrade to new texture creation path.
         encodedProperty.pTexture->textureSource = LegacyTextureSource{};
+        encodedProperty.pTexture->memoryCategory =
+            CesiumTextureMemory::Category::MetadataTexture;
         propertyTexturePropertyMap.Emplace(pImage, encodedProperty.pTexture);
         // This assumes that the texture's image only contains one byte per
         // channel.
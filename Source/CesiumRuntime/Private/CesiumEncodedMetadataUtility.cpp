@@ -204,6 +204,8 @@ EncodedMetadataFeatureTable encodeMetadataFeatureTableAnyThreadPart(
     encodedProperty.pTexture->sRGB = false;
     // TODO: upgrade to new texture creation path.
     encodedProperty.pTexture->textureSource = LegacyTextureSource{};
+    encodedProperty.pTexture->memoryCategory =
+        CesiumTextureMemory::Category::MetadataTexture;
     encodedProperty.pTexture->pTextureData = createTexturePlatformData(
         ceilSqrtFeatureCount,
         ceilSqrtFeatureCount,
@@ -534,6 +536,8 @@ EncodedMetadataPrimitive encodeMetadataPrimitiveAnyThreadPart(
           // TODO: upgrade to new texture creation path
           encodedFeatureIdTexture.pTexture->textureSource =
               LegacyTextureSource{};
+          encodedFeatureIdTexture.pTexture->memoryCategory =
+              CesiumTextureMemory::Category::MetadataTexture;
           featureIdTextureMap.Emplace(
               pFeatureIdImage,
               encodedFeatureIdTexture.pTexture);
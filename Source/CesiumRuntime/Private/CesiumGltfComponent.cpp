@@ -2,11 +2,13 @@
 
 #include "CesiumGltfComponent.h"
 #include "Async/Async.h"
+#include "CesiumCamera.h"
 #include "CesiumCommon.h"
 #include "CesiumEncodedFeaturesMetadata.h"
 #include "CesiumEncodedMetadataUtility.h"
 #include "CesiumFeatureIdSet.h"
 #include "CesiumGeometry/Axis.h"
+#include "CesiumGeometry/BoundingSphere.h"
 #include "CesiumGeometry/Rectangle.h"
 #include "CesiumGeometry/Transforms.h"
 #include "CesiumGltf/AccessorView.h"
@@ -25,6 +27,7 @@
 #include "CesiumRasterOverlays/RasterOverlay.h"
 #include "CesiumRasterOverlays/RasterOverlayTile.h"
 #include "CesiumRuntime.h"
+#include "CesiumRuntimeSettings.h"
 #include "CesiumTextureUtility.h"
 #include "CesiumTransforms.h"
 #include "CesiumUtility/Tracing.h"
@@ -56,6 +59,8 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/mat3x3.hpp>
 #include <iostream>
+#include <limits>
+#include <optional>
 
 #if WITH_EDITOR
 #include "ScopedTransaction.h"
@@ -70,6 +75,15 @@ namespace {
 using TMeshVector2 = FVector2f;
 using TMeshVector3 = FVector3f;
 using TMeshVector4 = FVector4f;
+
+// Whether the model is no longer wanted, so creating it should stop at the
+// given stage.
+bool shouldStop(
+    const CreateModelOptions& options,
+    TileLoadCancellation::Stage stage) {
+  return options.pCancellationCheck &&
+         options.pCancellationCheck->shouldStop(stage);
+}
 } // namespace
 
 static uint32_t nextMaterialId = 0;
@@ -408,7 +422,8 @@ template <class T>
 static TUniquePtr<CesiumTextureUtility::LoadedTextureResult> loadTexture(
     CesiumGltf::Model& model,
     const std::optional<T>& gltfTexture,
-    bool sRGB) {
+    bool sRGB,
+    double projectedPixels = 0.0) {
   if (!gltfTexture || gltfTexture.value().index < 0 ||
       gltfTexture.value().index >= model.textures.size()) {
     if (gltfTexture && gltfTexture.value().index >= 0) {
@@ -425,7 +440,7 @@ static TUniquePtr<CesiumTextureUtility::LoadedTextureResult> loadTexture(
   const CesiumGltf::Texture& texture =
       model.textures[gltfTexture.value().index];
 
-  return loadTextureAnyThreadPart(model, texture, sRGB);
+  return loadTextureAnyThreadPart(model, texture, sRGB, projectedPixels);
 }
 
 static void applyWaterMask(
@@ -1209,20 +1224,33 @@ static void loadPrimitive(
   std::unordered_map<int32_t, uint32_t>& gltfToUnrealTexCoordMap =
       primitiveResult.GltfToUnrealTexCoordMap;
 
+  if (shouldStop(
+          *options.pMeshOptions->pNodeOptions->pModelOptions,
+          TileLoadCancellation::Stage::BeforeTextures)) {
+    return;
+  }
+
   {
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::loadTextures)
-    primitiveResult.baseColorTexture =
-        loadTexture(model, pbrMetallicRoughness.baseColorTexture, true);
+    const double projectedPixels =
+        options.pMeshOptions->pNodeOptions->pHalfConstructedModelResult
+            ->projectedPixels;
+    primitiveResult.baseColorTexture = loadTexture(
+        model,
+        pbrMetallicRoughness.baseColorTexture,
+        true,
+        projectedPixels);
     primitiveResult.metallicRoughnessTexture = loadTexture(
         model,
         pbrMetallicRoughness.metallicRoughnessTexture,
-        false);
+        false,
+        projectedPixels);
     primitiveResult.normalTexture =
-        loadTexture(model, material.normalTexture, false);
+        loadTexture(model, material.normalTexture, false, projectedPixels);
     primitiveResult.occlusionTexture =
-        loadTexture(model, material.occlusionTexture, false);
+        loadTexture(model, material.occlusionTexture, false, projectedPixels);
     primitiveResult.emissiveTexture =
-        loadTexture(model, material.emissiveTexture, true);
+        loadTexture(model, material.emissiveTexture, true, projectedPixels);
   }
 
   {
@@ -1547,7 +1575,10 @@ static void loadPrimitive(
   primitiveResult.transform = transform * yInvertMatrix;
 
   if (primitive.mode != MeshPrimitive::Mode::POINTS &&
-      options.pMeshOptions->pNodeOptions->pModelOptions->createPhysicsMeshes) {
+      options.pMeshOptions->pNodeOptions->pModelOptions->createPhysicsMeshes &&
+      !shouldStop(
+          *options.pMeshOptions->pNodeOptions->pModelOptions,
+          TileLoadCancellation::Stage::BeforeCooking)) {
     if (StaticMeshBuildVertices.Num() != 0 && indices.Num() != 0) {
       TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::ChaosCook)
       primitiveResult.pCollisionMesh =
@@ -1681,6 +1712,12 @@ static void loadMesh(
   result = LoadMeshResult();
   result->primitiveResults.reserve(mesh.primitives.size());
   for (const CesiumGltf::MeshPrimitive& primitive : mesh.primitives) {
+    if (shouldStop(
+            *options.pNodeOptions->pModelOptions,
+            TileLoadCancellation::Stage::AfterGeometry)) {
+      return;
+    }
+
     CreatePrimitiveOptions primitiveOptions = {&options, &*result, &primitive};
     auto& primitiveResult = result->primitiveResults.emplace_back();
     loadPrimitive(primitiveResult, transform, primitiveOptions);
@@ -1829,6 +1866,62 @@ void applyGltfUpAxisTransform(const Model& model, glm::dmat4x4& rootTransform) {
         gltfUpAxisValue);
   }
 }
+/**
+ * Computes a bounding sphere of the model's default scene from the bounds of
+ * its position accessors, which glTF requires.
+ *
+ * @param model The glTF model
+ * @param rootTransform The transform from the model to the tileset
+ * @return The bounding sphere, in the tileset's coordinate system, or
+ * std::nullopt if a position accessor has no bounds.
+ */
+std::optional<CesiumGeometry::BoundingSphere>
+computeBoundingSphere(const Model& model, const glm::dmat4x4& rootTransform) {
+  glm::dvec3 minimum(std::numeric_limits<double>::max());
+  glm::dvec3 maximum(std::numeric_limits<double>::lowest());
+  bool valid = true;
+  bool found = false;
+
+  model.forEachPrimitiveInScene(
+      -1,
+      [&](const Model& gltf,
+          const Node& node,
+          const Mesh& mesh,
+          const MeshPrimitive& primitive,
+          const glm::dmat4& nodeTransform) {
+        auto positionIt = primitive.attributes.find("POSITION");
+        if (positionIt == primitive.attributes.end()) {
+          return;
+        }
+
+        const Accessor* pAccessor =
+            Model::getSafe(&gltf.accessors, positionIt->second);
+        if (!pAccessor || pAccessor->min.size() != 3 ||
+            pAccessor->max.size() != 3) {
+          valid = false;
+          return;
+        }
+
+        glm::dmat4x4 toTileset = rootTransform * nodeTransform;
+        for (int corner = 0; corner < 8; ++corner) {
+          glm::dvec3 position(
+              (corner & 1) ? pAccessor->max[0] : pAccessor->min[0],
+              (corner & 2) ? pAccessor->max[1] : pAccessor->min[1],
+              (corner & 4) ? pAccessor->max[2] : pAccessor->min[2]);
+          glm::dvec3 transformed(toTileset * glm::dvec4(position, 1.0));
+          minimum = glm::min(minimum, transformed);
+          maximum = glm::max(maximum, transformed);
+        }
+        found = true;
+      });
+
+  if (!valid || !found) {
+    return std::nullopt;
+  }
+
+  glm::dvec3 center = (minimum + maximum) * 0.5;
+  return CesiumGeometry::BoundingSphere(center, glm::length(maximum - center));
+}
 } // namespace
 
 static void loadModelAnyThreadPart(
@@ -1839,6 +1932,33 @@ static void loadModelAnyThreadPart(
 
   const Model& model = *options.pModel;
 
+  glm::dmat4x4 rootTransform = transform;
+
+  {
+    rootTransform =
+        CesiumGltfContent::GltfUtilities::applyRtcCenter(model, rootTransform);
+    applyGltfUpAxisTransform(model, rootTransform);
+  }
+
+  if (options.pCancellationCheck) {
+    std::optional<CesiumGeometry::BoundingSphere> maybeBounds =
+        computeBoundingSphere(model, rootTransform);
+    if (maybeBounds) {
+      options.pCancellationCheck->setBounds(*maybeBounds);
+
+      // Start the textures with the mips the model needs in the current
+      // views, so that distant tiles do not upload mips they will release.
+      if (GetDefault<UCesiumRuntimeSettings>()->EnableTextureMipResidency) {
+        result.projectedPixels =
+            options.pCancellationCheck->computeProjectedPixels();
+      }
+    }
+  }
+
+  if (shouldStop(options, TileLoadCancellation::Stage::AfterDecode)) {
+    return;
+  }
+
   const ExtensionModelExtStructuralMetadata* pMetadataExtension =
       model.getExtension<ExtensionModelExtStructuralMetadata>();
   if (pMetadataExtension) {
@@ -1864,14 +1984,6 @@ static void loadModelAnyThreadPart(
   }
   PRAGMA_ENABLE_DEPRECATION_WARNINGS
 
-  glm::dmat4x4 rootTransform = transform;
-
-  {
-    rootTransform =
-        CesiumGltfContent::GltfUtilities::applyRtcCenter(model, rootTransform);
-    applyGltfUpAxisTransform(model, rootTransform);
-  }
-
   if (model.scene >= 0 && model.scene < model.scenes.size()) {
     // Show the default scene
     const Scene& defaultScene = model.scenes[model.scene];
@@ -2513,6 +2625,41 @@ static void SetMetadataParameterValues_DEPRECATED(
 PRAGMA_ENABLE_DEPRECATION_WARNINGS
 #pragma endregion
 
+static void registerResidentTexture(
+    const TUniquePtr<CesiumTextureUtility::LoadedTextureResult>& pTexture,
+    std::vector<CesiumMipResidency::ResidentTexture>& residentTextures) {
+  // Only textures uploaded straight from a glTF image that keeps all of its
+  // mips can have their upper mips restored later.
+  if (!pTexture || pTexture->sourceImageIndex < 0 ||
+      !pTexture->pTexture.IsValid() ||
+      pTexture->pTexture->GetNumMips() <= 1) {
+    return;
+  }
+
+  for (const CesiumMipResidency::ResidentTexture& texture : residentTextures) {
+    if (texture.pTexture == pTexture->pTexture) {
+      return;
+    }
+  }
+
+  residentTextures.push_back(
+      {pTexture->pTexture,
+       pTexture->sourceImageIndex,
+       pTexture->firstResidentMip});
+}
+
+static void registerResidentTextures(
+    const LoadPrimitiveResult& loadResult,
+    std::vector<CesiumMipResidency::ResidentTexture>& residentTextures) {
+  registerResidentTexture(loadResult.baseColorTexture, residentTextures);
+  registerResidentTexture(
+      loadResult.metallicRoughnessTexture,
+      residentTextures);
+  registerResidentTexture(loadResult.normalTexture, residentTextures);
+  registerResidentTexture(loadResult.emissiveTexture, residentTextures);
+  registerResidentTexture(loadResult.occlusionTexture, residentTextures);
+}
+
 static void loadPrimitiveGameThreadPart(
     const CesiumGltf::Model& model,
     UCesiumGltfComponent* pGltf,
@@ -2783,6 +2930,10 @@ static void loadPrimitiveGameThreadPart(
 
   pMesh->SetMobility(pGltf->Mobility);
 
+  if (GetDefault<UCesiumRuntimeSettings>()->EnableTextureMipResidency) {
+    registerResidentTextures(loadResult, pGltf->ResidentTextures);
+  }
+
   pMesh->SetupAttachment(pGltf);
   pMesh->RegisterComponent();
 }
@@ -2842,6 +2993,7 @@ UCesiumGltfComponent::CreateOffGameThread(
   }
 
   Gltf->CustomDepthParameters = CustomDepthParameters;
+  Gltf->ContentUrl = std::move(pHalfConstructed->contentUrl);
 
   encodeModelMetadataGameThreadPart(Gltf->EncodedMetadata);
 
@@ -3127,6 +3279,72 @@ void UCesiumGltfComponent::UpdateFade(float fadePercentage, bool fadingIn) {
   }
 }
 
+void UCesiumGltfComponent::UpdateMipResidency(
+    const CesiumGltf::Model& model,
+    const std::vector<FCesiumCamera>& cameras) {
+  if (this->ResidentTextures.empty() || !this->IsVisible()) {
+    return;
+  }
+
+  // Textures may be shared by several primitives, so every texture keeps the
+  // mips needed by the largest primitive on the screen.
+  double projectedPixels = 0.0;
+  for (USceneComponent* pChild : this->GetAttachChildren()) {
+    UCesiumGltfPrimitiveComponent* pPrimitive =
+        Cast<UCesiumGltfPrimitiveComponent>(pChild);
+    if (!pPrimitive) {
+      continue;
+    }
+
+    for (const FCesiumCamera& camera : cameras) {
+      double viewportWidth = camera.ViewportSize.X;
+      if (camera.ScreenSpaceErrorMultiplier > 0.0) {
+        viewportWidth /= camera.ScreenSpaceErrorMultiplier;
+      }
+      projectedPixels = FMath::Max(
+          projectedPixels,
+          CesiumMipResidency::computeProjectedPixels(
+              pPrimitive->Bounds.SphereRadius,
+              FVector::Distance(camera.Location, pPrimitive->Bounds.Origin),
+              camera.FieldOfViewDegrees,
+              viewportWidth));
+    }
+  }
+
+  for (CesiumMipResidency::ResidentTexture& texture : this->ResidentTextures) {
+    UTexture2D* pTexture = texture.pTexture.Get();
+    if (!pTexture || texture.imageIndex < 0 ||
+        texture.imageIndex >= int32(model.images.size())) {
+      continue;
+    }
+
+    const CesiumGltf::ImageCesium& image =
+        model.images[texture.imageIndex].cesium;
+    int32 mipCount = int32(image.mipPositions.size());
+    if (image.pixelData.empty() || mipCount <= 1) {
+      continue;
+    }
+
+    int32 firstMip = CesiumMipResidency::updateFirstResidentMip(
+        texture.firstResidentMip,
+        CesiumMipResidency::computeWantedFirstMip(
+            image.width,
+            image.height,
+            mipCount,
+            projectedPixels));
+    if (firstMip != texture.firstResidentMip) {
+      int32 residentMip = CesiumTextureUtility::setFirstResidentMip(
+          pTexture,
+          image,
+          texture.firstResidentMip,
+          firstMip);
+      if (residentMip >= 0) {
+        texture.firstResidentMip = residentMip;
+      }
+    }
+  }
+}
+
 static bool isTriangleDegenerate(
     const Chaos::FTriangleMeshImplicitObject::ParticleVecType& A,
     const Chaos::FTriangleMeshImplicitObject::ParticleVecType& B,
@@ -6,6 +6,7 @@
 #include "Cesium3DTileset.h"
 #include "CesiumEncodedFeaturesMetadata.h"
 #include "CesiumEncodedMetadataUtility.h"
+#include "CesiumMipResidency.h"
 #include "CesiumModelMetadata.h"
 #include "Components/PrimitiveComponent.h"
 #include "Components/SceneComponent.h"
@@ -14,6 +15,8 @@
 #include "Interfaces/IHttpRequest.h"
 #include <glm/mat4x4.hpp>
 #include <memory>
+#include <string>
+#include <vector>
 #include "CesiumGltfComponent.generated.h"
 
 class UMaterialInterface;
@@ -62,6 +65,20 @@ public:
   class HalfConstructed {
   public:
     virtual ~HalfConstructed() = default;
+
+    // The times, in FPlatformTime::Seconds, at which the tile's content was
+    // requested, received, and prepared in the load thread. These feed the
+    // tileset's load latency statistics, and are zero when unknown.
+    double requestIssuedTime = 0.0;
+    double responseReceivedTime = 0.0;
+    double loadThreadDoneTime = 0.0;
+
+    // The time spent creating this in the load thread, in seconds.
+    double loadThreadSeconds = 0.0;
+
+    // The URL from which the tile's content was loaded, with any credentials
+    // removed, or empty if it is not known.
+    std::string contentUrl;
   };
 
   static TUniquePtr<HalfConstructed> CreateOffGameThread(
@@ -95,6 +112,12 @@ public:
   UPROPERTY(EditAnywhere, Category = "Rendering")
   FCustomDepthParameters CustomDepthParameters{};
 
+  /**
+   * The URL from which this model was loaded, with any credentials removed, or
+   * empty if it is not known. It is used to save the tileset's warm set.
+   */
+  std::string ContentUrl;
+
   FCesiumModelMetadata Metadata{};
   CesiumEncodedFeaturesMetadata::EncodedModelMetadata EncodedMetadata{};
 
@@ -125,6 +148,26 @@ public:
 
   void UpdateFade(float fadePercentage, bool fadingIn);
 
+  /**
+   * The textures of this model whose upper mips are released while the model
+   * is far from the cameras. Only used when Enable Texture Mip Residency is
+   * set.
+   */
+  std::vector<CesiumMipResidency::ResidentTexture> ResidentTextures;
+
+  /**
+   * Releases or restores the upper mips of the ResidentTextures according to
+   * the number of pixels that this model's largest primitive covers in the
+   * given views.
+   *
+   * @param model The glTF this component was created from, which holds all of
+   * the mips of its textures' images.
+   * @param cameras The views.
+   */
+  void UpdateMipResidency(
+      const CesiumGltf::Model& model,
+      const std::vector<FCesiumCamera>& cameras);
+
 private:
   UPROPERTY()
   UTexture2D* Transparent1x1 = nullptr;
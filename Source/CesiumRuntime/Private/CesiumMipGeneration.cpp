@@ -0,0 +1,191 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumMipGeneration.h"
+#include "Async/ParallelFor.h"
+#include "HAL/Platform.h"
+#include <CesiumGltfReader/GltfReader.h>
+#include <algorithm>
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#elif PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif
+
+using namespace CesiumGltf;
+
+namespace {
+
+bool isPowerOfTwo(int32_t value) {
+  return value > 0 && (value & (value - 1)) == 0;
+}
+
+// Averages pairs of RGBA texels in two rows, producing two texels at a time,
+// and returns the number of texels produced.
+int32_t generateRgbaTexels(
+    const uint8_t* pRow0,
+    const uint8_t* pRow1,
+    uint8_t* pOut,
+    int32_t width) {
+  int32_t x = 0;
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+  for (; x + 2 <= width; x += 2) {
+    uint8x16_t row0 = vld1q_u8(pRow0 + x * 8);
+    uint8x16_t row1 = vld1q_u8(pRow1 + x * 8);
+    uint16x8_t low = vaddl_u8(vget_low_u8(row0), vget_low_u8(row1));
+    uint16x8_t high = vaddl_u8(vget_high_u8(row0), vget_high_u8(row1));
+    uint16x8_t sum = vaddq_u16(
+        vcombine_u16(vget_low_u16(low), vget_low_u16(high)),
+        vcombine_u16(vget_high_u16(low), vget_high_u16(high)));
+    vst1_u8(pOut + x * 4, vrshrn_n_u16(sum, 2));
+  }
+#elif PLATFORM_CPU_X86_FAMILY
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  for (; x + 2 <= width; x += 2) {
+    __m128i row0 = _mm_loadu_si128((const __m128i*)(pRow0 + x * 8));
+    __m128i row1 = _mm_loadu_si128((const __m128i*)(pRow1 + x * 8));
+    // The sums of the columns of the first two texels, then the second two.
+    __m128i low = _mm_add_epi16(
+        _mm_unpacklo_epi8(row0, zero),
+        _mm_unpacklo_epi8(row1, zero));
+    __m128i high = _mm_add_epi16(
+        _mm_unpackhi_epi8(row0, zero),
+        _mm_unpackhi_epi8(row1, zero));
+    __m128i sum = _mm_add_epi16(
+        _mm_unpacklo_epi64(low, high),
+        _mm_unpackhi_epi64(low, high));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    _mm_storel_epi64((__m128i*)(pOut + x * 4), _mm_packus_epi16(sum, sum));
+  }
+#endif
+  return x;
+}
+
+} // namespace
+
+namespace CesiumMipGeneration {
+
+bool canGenerateMipMaps(const ImageCesium& image) {
+  return image.compressedPixelFormat == GpuCompressedPixelFormat::NONE &&
+         image.bytesPerChannel == 1 && image.channels >= 1 &&
+         image.channels <= 4 && isPowerOfTwo(image.width) &&
+         isPowerOfTwo(image.height) &&
+         image.pixelData.size() >= size_t(image.width) *
+                                       size_t(image.height) *
+                                       size_t(image.channels);
+}
+
+void generateMipRows(
+    const std::byte* pSource,
+    int32_t sourceWidth,
+    int32_t sourceHeight,
+    int32_t channels,
+    std::byte* pDestination,
+    int32_t firstRow,
+    int32_t endRow) {
+  const int32_t width = std::max(sourceWidth >> 1, 1);
+  const size_t sourcePitch = size_t(sourceWidth) * size_t(channels);
+  const size_t pitch = size_t(width) * size_t(channels);
+
+  for (int32_t y = firstRow; y < endRow; ++y) {
+    // A mip one texel high or wide averages the single row or column twice.
+    const uint8_t* pRow0 =
+        reinterpret_cast<const uint8_t*>(pSource) + size_t(2 * y) * sourcePitch;
+    const uint8_t* pRow1 =
+        reinterpret_cast<const uint8_t*>(pSource) +
+        size_t(std::min(2 * y + 1, sourceHeight - 1)) * sourcePitch;
+    uint8_t* pOut =
+        reinterpret_cast<uint8_t*>(pDestination) + size_t(y) * pitch;
+
+    int32_t x = 0;
+    if (channels == 4 && sourceWidth > 1) {
+      x = generateRgbaTexels(pRow0, pRow1, pOut, width);
+    }
+
+    for (; x < width; ++x) {
+      const int32_t x0 = 2 * x * channels;
+      const int32_t x1 = std::min(2 * x + 1, sourceWidth - 1) * channels;
+      for (int32_t c = 0; c < channels; ++c) {
+        pOut[x * channels + c] = uint8_t(
+            (pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c] +
+             2) >>
+            2);
+      }
+    }
+  }
+}
+
+std::optional<std::string>
+generateMipMaps(ImageCesium& image, bool allowParallel) {
+  if (!image.mipPositions.empty() ||
+      image.compressedPixelFormat != GpuCompressedPixelFormat::NONE) {
+    return std::nullopt;
+  }
+
+  if (!canGenerateMipMaps(image)) {
+    return CesiumGltfReader::GltfReader::generateMipMaps(image);
+  }
+
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::GenerateMipMaps)
+
+  const size_t texelBytes = size_t(image.channels);
+
+  // Lay out the whole chain first, so the mips are generated in place in the
+  // buffer that is uploaded.
+  size_t totalSize = 0;
+  int32_t width = image.width;
+  int32_t height = image.height;
+  while (true) {
+    size_t size = size_t(width) * size_t(height) * texelBytes;
+    image.mipPositions.push_back(ImageCesiumMipPosition{totalSize, size});
+    totalSize += size;
+    if (width == 1 && height == 1) {
+      break;
+    }
+    width = std::max(width >> 1, 1);
+    height = std::max(height >> 1, 1);
+  }
+  image.pixelData.resize(totalSize);
+
+  int32_t sourceWidth = image.width;
+  int32_t sourceHeight = image.height;
+  for (size_t i = 1; i < image.mipPositions.size(); ++i) {
+    const std::byte* pSource =
+        image.pixelData.data() + image.mipPositions[i - 1].byteOffset;
+    std::byte* pDestination =
+        image.pixelData.data() + image.mipPositions[i].byteOffset;
+    const int32_t mipWidth = std::max(sourceWidth >> 1, 1);
+    const int32_t mipHeight = std::max(sourceHeight >> 1, 1);
+
+    if (allowParallel && mipWidth * mipHeight >= ParallelTexelCount) {
+      const int32_t taskCount = (mipHeight + RowsPerTask - 1) / RowsPerTask;
+      ParallelFor(taskCount, [&](int32 task) {
+        generateMipRows(
+            pSource,
+            sourceWidth,
+            sourceHeight,
+            image.channels,
+            pDestination,
+            task * RowsPerTask,
+            std::min((task + 1) * RowsPerTask, mipHeight));
+      });
+    } else {
+      generateMipRows(
+          pSource,
+          sourceWidth,
+          sourceHeight,
+          image.channels,
+          pDestination,
+          0,
+          mipHeight);
+    }
+
+    sourceWidth = mipWidth;
+    sourceHeight = mipHeight;
+  }
+
+  return std::nullopt;
+}
+
+} // namespace CesiumMipGeneration
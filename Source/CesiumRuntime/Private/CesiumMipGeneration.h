@@ -0,0 +1,70 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumGltf/ImageCesium.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * Generates the mips of uncompressed images with a 2x2 box filter that uses
+ * SIMD instructions where they are available, and that splits large mips
+ * across the engine's worker threads.
+ */
+namespace CesiumMipGeneration {
+
+/**
+ * The number of texels in a mip at and above which it is generated by several
+ * threads.
+ */
+static constexpr int32_t ParallelTexelCount = 256 * 256;
+
+/**
+ * The number of rows of a mip that each thread generates at a time.
+ */
+static constexpr int32_t RowsPerTask = 32;
+
+/**
+ * Determines whether the box filter can generate the mips of the given image.
+ * This requires uncompressed 8-bit channels and dimensions that are powers of
+ * two, so that each texel of a mip covers exactly 2x2 texels of the mip above
+ * it, or one row or column of two texels once a dimension has reached one.
+ */
+bool canGenerateMipMaps(const CesiumGltf::ImageCesium& image);
+
+/**
+ * Generates rows of one mip from the mip above it.
+ *
+ * @param pSource The texels of the mip above.
+ * @param sourceWidth The width of the mip above.
+ * @param sourceHeight The height of the mip above.
+ * @param channels The number of 8-bit channels in each texel.
+ * @param pDestination The texels of the mip to generate.
+ * @param firstRow The first row of the mip to generate.
+ * @param endRow The row after the last row of the mip to generate.
+ */
+void generateMipRows(
+    const std::byte* pSource,
+    int32_t sourceWidth,
+    int32_t sourceHeight,
+    int32_t channels,
+    std::byte* pDestination,
+    int32_t firstRow,
+    int32_t endRow);
+
+/**
+ * Generates the full chain of mips for the given image, if it does not already
+ * have them. The mips are written after the image in its pixel data, in the
+ * layout that is uploaded to the GPU. Images that the box filter cannot handle
+ * are passed to {@link CesiumGltfReader::GltfReader::generateMipMaps}.
+ *
+ * @param image The image.
+ * @param allowParallel Whether large mips may be split across threads.
+ * @return An error message, if the mips could not be generated.
+ */
+std::optional<std::string>
+generateMipMaps(CesiumGltf::ImageCesium& image, bool allowParallel = true);
+
+} // namespace CesiumMipGeneration
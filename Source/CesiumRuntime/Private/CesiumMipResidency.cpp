@@ -0,0 +1,69 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumMipResidency.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace CesiumMipResidency {
+
+double computeProjectedPixels(
+    double radius,
+    double distance,
+    double fieldOfViewDegrees,
+    double viewportWidth) {
+  if (distance <= radius) {
+    return std::numeric_limits<double>::max();
+  }
+
+  constexpr double degreesToRadians = 3.14159265358979323846 / 180.0;
+  double halfWidth =
+      distance * std::tan(fieldOfViewDegrees * 0.5 * degreesToRadians);
+  if (halfWidth <= 0.0) {
+    return std::numeric_limits<double>::max();
+  }
+
+  return radius / halfWidth * viewportWidth;
+}
+
+int32 computeWantedFirstMip(
+    int32 width,
+    int32 height,
+    int32 mipCount,
+    double projectedPixels) {
+  int32 size = std::max(width, height);
+  if (mipCount <= 1 || size <= MinimumResidentSize) {
+    return 0;
+  }
+
+  // Keep the largest resident mip at least MinimumResidentSize.
+  int32 lastMip = 0;
+  while (lastMip + 1 < mipCount &&
+         (size >> (lastMip + 1)) >= MinimumResidentSize) {
+    ++lastMip;
+  }
+
+  if (projectedPixels <= 1.0) {
+    return lastMip;
+  }
+
+  double ratio = double(size) / projectedPixels;
+  if (ratio <= 1.0) {
+    return 0;
+  }
+
+  int32 mip = static_cast<int32>(std::floor(std::log2(ratio)));
+  return std::clamp(mip, 0, lastMip);
+}
+
+int32 updateFirstResidentMip(int32 current, int32 wanted) {
+  if (current > wanted) {
+    return wanted;
+  }
+  if (current < wanted - 1) {
+    return wanted - 1;
+  }
+  return current;
+}
+
+} // namespace CesiumMipResidency
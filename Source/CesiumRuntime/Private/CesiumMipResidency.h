@@ -0,0 +1,86 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "UObject/WeakObjectPtrTemplates.h"
+#include <cstdint>
+
+class UTexture2D;
+
+/**
+ * Decides how many of the upper mips of a tile's textures need to be resident
+ * on the GPU. A tile far from the camera covers few pixels and only samples
+ * its textures' small mips, so the large ones are released, and uploaded again
+ * from the glTF images as the camera approaches.
+ */
+namespace CesiumMipResidency {
+
+/**
+ * The smallest size, in texels, that the largest resident mip of a texture is
+ * reduced to. Smaller mips are cheap enough to keep.
+ */
+constexpr int32 MinimumResidentSize = 64;
+
+/**
+ * A texture whose upper mips may be released and restored.
+ */
+struct ResidentTexture {
+  TWeakObjectPtr<UTexture2D> pTexture;
+
+  /**
+   * The index of the glTF image that holds all of the texture's mips.
+   */
+  int32_t imageIndex;
+
+  /**
+   * The index of the largest mip of the image that is currently resident.
+   */
+  int32 firstResidentMip;
+};
+
+/**
+ * Computes the approximate number of pixels that an object spans on the
+ * screen.
+ *
+ * @param radius The radius of the object's bounding sphere.
+ * @param distance The distance from the camera to the sphere's center.
+ * @param fieldOfViewDegrees The camera's horizontal field of view.
+ * @param viewportWidth The width of the camera's viewport in pixels.
+ * @return The projected diameter of the sphere, or a very large number when
+ * the camera is inside it.
+ */
+double computeProjectedPixels(
+    double radius,
+    double distance,
+    double fieldOfViewDegrees,
+    double viewportWidth);
+
+/**
+ * Computes the index of the largest mip that a texture needs in order to
+ * provide about one texel for each pixel that it covers.
+ *
+ * @param width The width of the texture's first mip.
+ * @param height The height of the texture's first mip.
+ * @param mipCount The number of mips of the texture.
+ * @param projectedPixels The number of pixels spanned by the object that uses
+ * the texture, as from {@link computeProjectedPixels}.
+ */
+int32 computeWantedFirstMip(
+    int32 width,
+    int32 height,
+    int32 mipCount,
+    double projectedPixels);
+
+/**
+ * Decides which mip should be the largest resident one. Missing mips are
+ * restored as soon as they are wanted, but one more mip than is wanted is
+ * kept, so that a camera moving back and forth does not upload the same mip
+ * repeatedly.
+ *
+ * @param current The largest resident mip.
+ * @param wanted The largest wanted mip, from {@link computeWantedFirstMip}.
+ * @return The new largest resident mip.
+ */
+int32 updateFirstResidentMip(int32 current, int32 wanted);
+
+} // namespace CesiumMipResidency
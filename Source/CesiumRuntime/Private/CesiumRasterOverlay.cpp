@@ -98,6 +98,12 @@ void UCesiumRasterOverlay::AddToTileset() {
     pTileset->getOverlays().add(this->_pOverlay);
 
     this->OnAdd(pTileset, this->_pOverlay);
+
+    // An idle tileset must traverse again to attach the new overlay's tiles.
+    ACesium3DTileset* pActor = this->GetOwner<ACesium3DTileset>();
+    if (pActor) {
+      pActor->invalidateIdleState();
+    }
   }
 }
 
@@ -122,6 +128,11 @@ void UCesiumRasterOverlay::RemoveFromTileset() {
   this->OnRemove(pTileset, this->_pOverlay);
   pTileset->getOverlays().remove(this->_pOverlay);
   this->_pOverlay = nullptr;
+
+  ACesium3DTileset* pActor = this->GetOwner<ACesium3DTileset>();
+  if (pActor) {
+    pActor->invalidateIdleState();
+  }
 }
 
 void UCesiumRasterOverlay::Refresh() {
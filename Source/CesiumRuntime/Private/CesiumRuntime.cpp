@@ -1,17 +1,29 @@
 // Copyright 2020-2021 CesiumGS, Inc. and Contributors
 
 #include "CesiumRuntime.h"
+#include "BackgroundPruningCacheDatabase.h"
 #include "Cesium3DTilesContent/registerAllTileContentTypes.h"
 #include "CesiumAsync/CachingAssetAccessor.h"
 #include "CesiumAsync/GunzipAssetAccessor.h"
 #include "CesiumAsync/SqliteCache.h"
 #include "CesiumRuntimeSettings.h"
+#include "CesiumTexturePool.h"
 #include "CesiumUtility/Tracing.h"
+#include "CoalescingAssetAccessor.h"
+#include "CompressingCacheDatabase.h"
+#include "Engine/World.h"
 #include "HAL/FileManager.h"
 #include "HttpModule.h"
 #include "Interfaces/IPluginManager.h"
+#include "MemoryCacheAssetAccessor.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+#include "RecordingAssetAccessor.h"
+#include "ReplayAssetAccessor.h"
 #include "ShaderCore.h"
+#include "ShardedFileCacheDatabase.h"
 #include "SpdlogUnrealLoggerSink.h"
 #include "UnrealAssetAccessor.h"
 #include "UnrealTaskProcessor.h"
@@ -28,6 +40,26 @@
 
 DEFINE_LOG_CATEGORY(LogCesium);
 
+namespace {
+
+FDelegateHandle worldCleanupHandle;
+
+// The dedicated pool of worker threads of the task processor, if any. The
+// module owns it, rather than the task processor, which lives until static
+// destruction, so that the threads are stopped while the engine and its stats
+// are still running.
+TUniquePtr<FQueuedThreadPool> pWorkerThreadPool;
+
+/**
+ * @brief Destroys the pooled textures when a world is torn down, so that they
+ * are not kept alive for a world that will never use them.
+ */
+void onWorldCleanup(UWorld* pWorld, bool sessionEnded, bool cleanupResources) {
+  getRasterOverlayTexturePool().clear();
+}
+
+} // namespace
+
 void FCesiumRuntimeModule::StartupModule() {
   Cesium3DTilesContent::registerAllTileContentTypes();
 
@@ -50,9 +82,24 @@ void FCesiumRuntimeModule::StartupModule() {
   AddShaderSourceDirectoryMapping(
       TEXT("/Plugin/CesiumForUnreal"),
       PluginShaderDir);
+
+  worldCleanupHandle =
+      FWorldDelegates::OnWorldCleanup.AddStatic(&onWorldCleanup);
 }
 
-void FCesiumRuntimeModule::ShutdownModule() { CESIUM_TRACE_SHUTDOWN(); }
+void FCesiumRuntimeModule::ShutdownModule() {
+  FWorldDelegates::OnWorldCleanup.Remove(worldCleanupHandle);
+  getRasterOverlayTexturePool().clear();
+
+  // Tasks that have not started by now are abandoned with the pool. Any that
+  // are started later run on the engine's background task threads.
+  if (pWorkerThreadPool) {
+    getTaskProcessor()->detachThreadPool();
+    pWorkerThreadPool.Reset();
+  }
+
+  CESIUM_TRACE_SHUTDOWN();
+}
 
 #undef LOCTEXT_NAMESPACE
 
@@ -62,15 +109,23 @@ FCesium3DTilesetIonTroubleshooting OnCesium3DTilesetIonTroubleshooting{};
 FCesiumRasterOverlayIonTroubleshooting
     OnCesiumRasterOverlayIonTroubleshooting{};
 
+const std::shared_ptr<UnrealTaskProcessor>& getTaskProcessor() noexcept {
+  static std::shared_ptr<UnrealTaskProcessor> pTaskProcessor = []() {
+    pWorkerThreadPool = UnrealTaskProcessor::createThreadPool(
+        GetDefault<UCesiumRuntimeSettings>()->WorkerThreadCount);
+    return std::make_shared<UnrealTaskProcessor>(pWorkerThreadPool.Get());
+  }();
+  return pTaskProcessor;
+}
+
 CesiumAsync::AsyncSystem& getAsyncSystem() noexcept {
-  static CesiumAsync::AsyncSystem asyncSystem(
-      std::make_shared<UnrealTaskProcessor>());
+  static CesiumAsync::AsyncSystem asyncSystem(getTaskProcessor());
   return asyncSystem;
 }
 
 namespace {
 
-std::string getCacheDatabaseName() {
+FString getCacheBaseDirectory() {
 #if PLATFORM_ANDROID
   FString BaseDirectory = FPaths::ProjectPersistentDownloadDir();
 #elif PLATFORM_IOS
@@ -83,11 +138,14 @@ std::string getCacheDatabaseName() {
   FString BaseDirectory = FPaths::EngineUserDir();
 #endif
 
-  FString CesiumDBFile =
-      FPaths::Combine(*BaseDirectory, TEXT("cesium-request-cache.sqlite"));
+  return BaseDirectory;
+}
+
+FString getCachePath(const TCHAR* name) {
+  FString CachePath = FPaths::Combine(*getCacheBaseDirectory(), name);
   FString PlatformAbsolutePath =
       IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(
-          *CesiumDBFile);
+          *CachePath);
 
   UE_LOG(
       LogCesium,
@@ -95,33 +153,185 @@ std::string getCacheDatabaseName() {
       TEXT("Caching Cesium requests in %s"),
       *PlatformAbsolutePath);
 
-  return TCHAR_TO_UTF8(*PlatformAbsolutePath);
+  return PlatformAbsolutePath;
+}
+
+std::string getCacheDatabaseName() {
+  return TCHAR_TO_UTF8(*getCachePath(TEXT("cesium-request-cache.sqlite")));
+}
+
+std::shared_ptr<CesiumAsync::ICacheDatabase> createCacheDatabase() {
+  const UCesiumRuntimeSettings* pSettings =
+      GetDefault<UCesiumRuntimeSettings>();
+
+  std::shared_ptr<CesiumAsync::ICacheDatabase> pDatabase;
+  BackgroundPruningCacheDatabase::PruneStep pruneStep;
+
+  switch (pSettings->RequestCacheType) {
+  case ECesiumRequestCacheType::ShardedFiles: {
+    auto pFileCache = std::make_shared<ShardedFileCacheDatabase>(
+        getCachePath(TEXT("cesium-request-cache")),
+        int64_t(pSettings->MaxCacheSizeMB) * 1024 * 1024);
+    pruneStep = [pFileCache](double timeBudgetSeconds) {
+      ShardedFileCacheDatabase::PruneProgress progress =
+          pFileCache->pruneIncrementally(timeBudgetSeconds);
+      return BackgroundPruningCacheDatabase::StepResult{
+          progress.complete,
+          progress.bytesReclaimed};
+    };
+    pDatabase = pFileCache;
+    break;
+  }
+  case ECesiumRequestCacheType::Sqlite:
+  default: {
+    std::string databaseName = getCacheDatabaseName();
+    pDatabase = std::make_shared<CesiumAsync::SqliteCache>(
+        spdlog::default_logger(),
+        databaseName,
+        pSettings->MaxCacheItems);
+    // SqliteCache cannot be pruned incrementally, so the whole prune is done
+    // in one step. It still runs in the background while the network is idle.
+    pruneStep = [pDatabase](double /*timeBudgetSeconds*/) {
+      pDatabase->prune();
+      return BackgroundPruningCacheDatabase::StepResult{true, -1};
+    };
+    break;
+  }
+  }
+
+  FName compressionFormat = NAME_None;
+  switch (pSettings->RequestCacheCompression) {
+  case ECesiumRequestCacheCompression::LZ4:
+    compressionFormat = NAME_LZ4;
+    break;
+  case ECesiumRequestCacheCompression::Zlib:
+    compressionFormat = NAME_Zlib;
+    break;
+  case ECesiumRequestCacheCompression::None:
+  default:
+    break;
+  }
+
+  // Compress entries as they are stored. Prune in the background while no
+  // requests are waiting to be sent, rather than on whichever request the
+  // CachingAssetAccessor is handling.
+  return std::make_shared<CompressingCacheDatabase>(
+      std::make_shared<BackgroundPruningCacheDatabase>(
+          pDatabase,
+          std::move(pruneStep),
+          []() {
+            return getUnrealAssetAccessor()->getQueuedRequestCount() > 0;
+          }),
+      compressionFormat);
 }
 
 } // namespace
 
 std::shared_ptr<CesiumAsync::ICacheDatabase>& getCacheDatabase() {
-  static int MaxCacheItems =
-      GetDefault<UCesiumRuntimeSettings>()->MaxCacheItems;
-
   static std::shared_ptr<CesiumAsync::ICacheDatabase> pCacheDatabase =
-      std::make_shared<CesiumAsync::SqliteCache>(
-          spdlog::default_logger(),
-          getCacheDatabaseName(),
-          MaxCacheItems);
+      createCacheDatabase();
 
   return pCacheDatabase;
 }
 
-const std::shared_ptr<CesiumAsync::IAssetAccessor>& getAssetAccessor() {
-  static int RequestsPerCachePrune =
-      GetDefault<UCesiumRuntimeSettings>()->RequestsPerCachePrune;
-  static std::shared_ptr<CesiumAsync::IAssetAccessor> pAssetAccessor =
+const std::shared_ptr<UnrealAssetAccessor>& getUnrealAssetAccessor() {
+  static std::shared_ptr<UnrealAssetAccessor> pUnrealAssetAccessor = []() {
+    const UCesiumRuntimeSettings* pSettings =
+        GetDefault<UCesiumRuntimeSettings>();
+    auto pAccessor = std::make_shared<UnrealAssetAccessor>();
+    pAccessor->setMaximumSimultaneousRequests(
+        pSettings->MaximumSimultaneousHttpRequests);
+    pAccessor->setMaximumSimultaneousRequestsPerHost(
+        pSettings->MaximumSimultaneousHttpRequestsPerHost);
+    pAccessor->setMaximumRetries(pSettings->MaximumHttpRetries);
+    return pAccessor;
+  }();
+  return pUnrealAssetAccessor;
+}
+
+namespace {
+
+/**
+ * Creates the accessor that provides the responses from the disk cache and
+ * the network. For deterministic load tests, its responses can instead be
+ * recorded to, or replayed from, a directory given on the command line:
+ *
+ *   -CesiumRecordRequests=<directory>
+ *   -CesiumReplayRequests=<directory>
+ *     [-CesiumReplayLatencyMs=<latency>] [-CesiumReplayBandwidthMbps=<rate>]
+ */
+std::shared_ptr<CesiumAsync::IAssetAccessor> createResponseSource() {
+  const TCHAR* commandLine = FCommandLine::Get();
+
+  FString replayDirectory;
+  if (FParse::Value(
+          commandLine,
+          TEXT("CesiumReplayRequests="),
+          replayDirectory)) {
+    double latencyMs = 0.0;
+    double bandwidthMbps = 0.0;
+    FParse::Value(commandLine, TEXT("CesiumReplayLatencyMs="), latencyMs);
+    FParse::Value(
+        commandLine,
+        TEXT("CesiumReplayBandwidthMbps="),
+        bandwidthMbps);
+    UE_LOG(
+        LogCesium,
+        Display,
+        TEXT("Replaying recorded responses from %s with %.0f ms latency and "
+             "%.1f Mbps bandwidth."),
+        *replayDirectory,
+        latencyMs,
+        bandwidthMbps);
+    return std::make_shared<ReplayAssetAccessor>(
+        replayDirectory,
+        latencyMs / 1000.0,
+        bandwidthMbps * 1000.0 * 1000.0 / 8.0);
+  }
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> pAccessor =
       std::make_shared<CesiumAsync::GunzipAssetAccessor>(
           std::make_shared<CesiumAsync::CachingAssetAccessor>(
               spdlog::default_logger(),
-              std::make_shared<UnrealAssetAccessor>(),
+              getUnrealAssetAccessor(),
               getCacheDatabase(),
-              RequestsPerCachePrune));
+              GetDefault<UCesiumRuntimeSettings>()->RequestsPerCachePrune));
+
+  FString recordDirectory;
+  if (FParse::Value(
+          commandLine,
+          TEXT("CesiumRecordRequests="),
+          recordDirectory)) {
+    UE_LOG(
+        LogCesium,
+        Display,
+        TEXT("Recording responses to %s."),
+        *recordDirectory);
+    pAccessor =
+        std::make_shared<RecordingAssetAccessor>(pAccessor, recordDirectory);
+  }
+
+  return pAccessor;
+}
+
+const std::shared_ptr<MemoryCacheAssetAccessor>& getMemoryCacheAssetAccessor() {
+  static std::shared_ptr<MemoryCacheAssetAccessor> pMemoryCacheAssetAccessor =
+      std::make_shared<MemoryCacheAssetAccessor>(
+          createResponseSource(),
+          int64_t(GetDefault<UCesiumRuntimeSettings>()->InMemoryCacheSizeMB) *
+              1024 * 1024);
+  return pMemoryCacheAssetAccessor;
+}
+
+} // namespace
+
+const std::shared_ptr<CesiumAsync::IAssetAccessor>& getAssetAccessor() {
+  static std::shared_ptr<CesiumAsync::IAssetAccessor> pAssetAccessor =
+      std::make_shared<CoalescingAssetAccessor>(getMemoryCacheAssetAccessor());
   return pAssetAccessor;
 }
+
+void clearRequestCache() {
+  getMemoryCacheAssetAccessor()->clear();
+  getCacheDatabase()->clearAll();
+}
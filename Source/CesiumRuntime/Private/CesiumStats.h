@@ -0,0 +1,11 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+/**
+ * The stat group for Cesium for Unreal runtime counters. Show it in-game with
+ * the "stat Cesium" console command.
+ */
+DECLARE_STATS_GROUP(TEXT("Cesium"), STATGROUP_Cesium, STATCAT_Advanced);
@@ -0,0 +1,514 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTextureCompression.h"
+#include "CesiumStats.h"
+#include "HAL/PlatformTime.h"
+#include "PixelFormat.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Textures Compressed to BC1"),
+    STAT_CesiumTexturesCompressedBC1,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Textures Compressed to BC3"),
+    STAT_CesiumTexturesCompressedBC3,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Texture Memory Saved by Compression (MB)"),
+    STAT_CesiumTextureCompressionSavedMB,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Texture Compression Time (ms)"),
+    STAT_CesiumTextureCompressionTime,
+    STATGROUP_Cesium);
+
+using namespace CesiumGltf;
+
+namespace {
+
+uint16_t packColor565(const float* pColor) {
+  auto quantize = [](float value, int32_t maximum) {
+    return std::clamp(
+        int32_t(value * float(maximum) / 255.0f + 0.5f),
+        0,
+        maximum);
+  };
+  return uint16_t(
+      (quantize(pColor[0], 31) << 11) | (quantize(pColor[1], 63) << 5) |
+      quantize(pColor[2], 31));
+}
+
+void unpackColor565(uint16_t packed, int32_t* pColor) {
+  int32_t r = (packed >> 11) & 31;
+  int32_t g = (packed >> 5) & 63;
+  int32_t b = packed & 31;
+  pColor[0] = (r << 3) | (r >> 2);
+  pColor[1] = (g << 2) | (g >> 4);
+  pColor[2] = (b << 3) | (b >> 2);
+}
+
+// Chooses the nearest of the four colors interpolated between the endpoints
+// for each texel, and returns the total squared error.
+int32_t chooseColorIndices(
+    const uint8_t* pTexels,
+    uint16_t color0,
+    uint16_t color1,
+    uint32_t& indices) {
+  int32_t palette[4][3];
+  unpackColor565(color0, palette[0]);
+  unpackColor565(color1, palette[1]);
+  for (int32_t c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  indices = 0;
+  int32_t error = 0;
+  for (int32_t i = 0; i < 16; ++i) {
+    const uint8_t* pTexel = pTexels + i * 4;
+    int32_t bestIndex = 0;
+    int32_t bestDistance = INT_MAX;
+    for (int32_t j = 0; j < 4; ++j) {
+      int32_t distance = 0;
+      for (int32_t c = 0; c < 3; ++c) {
+        int32_t difference = int32_t(pTexel[c]) - palette[j][c];
+        distance += difference * difference;
+      }
+      if (distance < bestDistance) {
+        bestIndex = j;
+        bestDistance = distance;
+      }
+    }
+    indices |= uint32_t(bestIndex) << (2 * i);
+    error += bestDistance;
+  }
+
+  return error;
+}
+
+// Finds the endpoints that best fit the texels, in the least squares sense,
+// given the index chosen for each texel. Returns false if the indices do not
+// determine the endpoints, such as when they are all the same.
+bool fitEndpoints(
+    const uint8_t* pTexels,
+    uint32_t indices,
+    float* pColor0,
+    float* pColor1) {
+  // The weight of the first endpoint in the color of each index.
+  static constexpr float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+  float aa = 0.0f;
+  float bb = 0.0f;
+  float ab = 0.0f;
+  float ax[3] = {0.0f, 0.0f, 0.0f};
+  float bx[3] = {0.0f, 0.0f, 0.0f};
+  for (int32_t i = 0; i < 16; ++i) {
+    float a = weights[(indices >> (2 * i)) & 3];
+    float b = 1.0f - a;
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (int32_t c = 0; c < 3; ++c) {
+      ax[c] += a * float(pTexels[i * 4 + c]);
+      bx[c] += b * float(pTexels[i * 4 + c]);
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f) {
+    return false;
+  }
+
+  for (int32_t c = 0; c < 3; ++c) {
+    pColor0[c] =
+        std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+    pColor1[c] =
+        std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+void findEndpoints(
+    const uint8_t* pTexels,
+    bool highQuality,
+    float* pColor0,
+    float* pColor1) {
+  float minimum[3] = {255.0f, 255.0f, 255.0f};
+  float maximum[3] = {0.0f, 0.0f, 0.0f};
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  for (int32_t i = 0; i < 16; ++i) {
+    for (int32_t c = 0; c < 3; ++c) {
+      float value = float(pTexels[i * 4 + c]);
+      minimum[c] = std::min(minimum[c], value);
+      maximum[c] = std::max(maximum[c], value);
+      mean[c] += value / 16.0f;
+    }
+  }
+
+  if (!highQuality) {
+    // Use the diagonal of the bounding box along which the colors vary: each
+    // channel that decreases as the widest channel increases is flipped.
+    int32_t widest = 0;
+    for (int32_t c = 1; c < 3; ++c) {
+      if (maximum[c] - minimum[c] > maximum[widest] - minimum[widest]) {
+        widest = c;
+      }
+    }
+
+    for (int32_t c = 0; c < 3; ++c) {
+      float covariance = 0.0f;
+      for (int32_t i = 0; i < 16; ++i) {
+        covariance += (float(pTexels[i * 4 + widest]) - mean[widest]) *
+                      (float(pTexels[i * 4 + c]) - mean[c]);
+      }
+
+      // The corners of the bounding box are rarely the best endpoints, so
+      // move them inward a little.
+      float inset = (maximum[c] - minimum[c]) / 16.0f;
+      pColor0[c] = maximum[c] - inset;
+      pColor1[c] = minimum[c] + inset;
+      if (covariance < 0.0f) {
+        std::swap(pColor0[c], pColor1[c]);
+      }
+    }
+    return;
+  }
+
+  // Use the texels that are furthest apart along the principal axis of the
+  // colors, found by power iteration on their covariance.
+  float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for (int32_t i = 0; i < 16; ++i) {
+    float r = float(pTexels[i * 4]) - mean[0];
+    float g = float(pTexels[i * 4 + 1]) - mean[1];
+    float b = float(pTexels[i * 4 + 2]) - mean[2];
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+  float axis[3] = {
+      maximum[0] - minimum[0],
+      maximum[1] - minimum[1],
+      maximum[2] - minimum[2]};
+  for (int32_t iteration = 0; iteration < 4; ++iteration) {
+    float next[3] = {
+        covariance[0] * axis[0] + covariance[1] * axis[1] +
+            covariance[2] * axis[2],
+        covariance[1] * axis[0] + covariance[3] * axis[1] +
+            covariance[4] * axis[2],
+        covariance[2] * axis[0] + covariance[4] * axis[1] +
+            covariance[5] * axis[2]};
+    float length = std::max(
+        std::abs(next[0]),
+        std::max(std::abs(next[1]), std::abs(next[2])));
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int32_t c = 0; c < 3; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  int32_t minimumTexel = 0;
+  int32_t maximumTexel = 0;
+  float minimumProjection = FLT_MAX;
+  float maximumProjection = -FLT_MAX;
+  for (int32_t i = 0; i < 16; ++i) {
+    float projection = float(pTexels[i * 4]) * axis[0] +
+                       float(pTexels[i * 4 + 1]) * axis[1] +
+                       float(pTexels[i * 4 + 2]) * axis[2];
+    if (projection < minimumProjection) {
+      minimumProjection = projection;
+      minimumTexel = i;
+    }
+    if (projection > maximumProjection) {
+      maximumProjection = projection;
+      maximumTexel = i;
+    }
+  }
+
+  for (int32_t c = 0; c < 3; ++c) {
+    pColor0[c] = float(pTexels[maximumTexel * 4 + c]);
+    pColor1[c] = float(pTexels[minimumTexel * 4 + c]);
+  }
+}
+
+void compressColorBlock(
+    const uint8_t* pTexels,
+    bool highQuality,
+    std::byte* pBlock) {
+  float color0[3];
+  float color1[3];
+  findEndpoints(pTexels, highQuality, color0, color1);
+
+  uint16_t packed0 = packColor565(color0);
+  uint16_t packed1 = packColor565(color1);
+  uint32_t indices = 0;
+
+  // When the endpoints are the same, every texel uses the first one.
+  if (packed0 != packed1) {
+    // The first endpoint must be the greater for the four-color mode.
+    if (packed0 < packed1) {
+      std::swap(packed0, packed1);
+    }
+
+    int32_t error = chooseColorIndices(pTexels, packed0, packed1, indices);
+
+    for (int32_t iteration = 0; highQuality && iteration < 2 && error > 0;
+         ++iteration) {
+      if (!fitEndpoints(pTexels, indices, color0, color1)) {
+        break;
+      }
+
+      uint16_t fitted0 = packColor565(color0);
+      uint16_t fitted1 = packColor565(color1);
+      if (fitted0 == fitted1) {
+        break;
+      }
+      if (fitted0 < fitted1) {
+        std::swap(fitted0, fitted1);
+      }
+
+      uint32_t fittedIndices = 0;
+      int32_t fittedError =
+          chooseColorIndices(pTexels, fitted0, fitted1, fittedIndices);
+      if (fittedError >= error) {
+        break;
+      }
+
+      packed0 = fitted0;
+      packed1 = fitted1;
+      indices = fittedIndices;
+      error = fittedError;
+    }
+  }
+
+  pBlock[0] = std::byte(packed0 & 0xff);
+  pBlock[1] = std::byte(packed0 >> 8);
+  pBlock[2] = std::byte(packed1 & 0xff);
+  pBlock[3] = std::byte(packed1 >> 8);
+  for (int32_t i = 0; i < 4; ++i) {
+    pBlock[4 + i] = std::byte((indices >> (8 * i)) & 0xff);
+  }
+}
+
+void compressAlphaBlock(const uint8_t* pTexels, std::byte* pBlock) {
+  int32_t minimum = 255;
+  int32_t maximum = 0;
+  for (int32_t i = 0; i < 16; ++i) {
+    minimum = std::min(minimum, int32_t(pTexels[i * 4 + 3]));
+    maximum = std::max(maximum, int32_t(pTexels[i * 4 + 3]));
+  }
+
+  uint64_t indices = 0;
+
+  // When the endpoints are the same, every texel uses the first one.
+  if (maximum > minimum) {
+    // With the first endpoint the greater, six values are interpolated
+    // between the endpoints.
+    int32_t palette[8];
+    palette[0] = maximum;
+    palette[1] = minimum;
+    for (int32_t k = 1; k < 7; ++k) {
+      palette[k + 1] = ((7 - k) * maximum + k * minimum) / 7;
+    }
+
+    for (int32_t i = 0; i < 16; ++i) {
+      int32_t alpha = int32_t(pTexels[i * 4 + 3]);
+      int32_t bestIndex = 0;
+      int32_t bestDistance = INT_MAX;
+      for (int32_t j = 0; j < 8; ++j) {
+        int32_t distance = std::abs(alpha - palette[j]);
+        if (distance < bestDistance) {
+          bestIndex = j;
+          bestDistance = distance;
+        }
+      }
+      indices |= uint64_t(bestIndex) << (3 * i);
+    }
+  }
+
+  pBlock[0] = std::byte(maximum);
+  pBlock[1] = std::byte(minimum);
+  for (int32_t i = 0; i < 6; ++i) {
+    pBlock[2 + i] = std::byte((indices >> (8 * i)) & 0xff);
+  }
+}
+
+// Gets the texels of one block of a mip, repeating the last row and column of
+// mips that are smaller than a block.
+void readBlock(
+    const std::byte* pMip,
+    int32_t width,
+    int32_t height,
+    int32_t blockX,
+    int32_t blockY,
+    uint8_t* pTexels) {
+  for (int32_t y = 0; y < 4; ++y) {
+    int32_t sourceY = std::min(blockY * 4 + y, height - 1);
+    for (int32_t x = 0; x < 4; ++x) {
+      int32_t sourceX = std::min(blockX * 4 + x, width - 1);
+      std::memcpy(
+          pTexels + (y * 4 + x) * 4,
+          pMip + (size_t(sourceY) * size_t(width) + size_t(sourceX)) * 4,
+          4);
+    }
+  }
+}
+
+} // namespace
+
+namespace CesiumTextureCompression {
+
+void compressBC1Block(
+    const uint8_t* pTexels,
+    bool highQuality,
+    std::byte* pBlock) {
+  compressColorBlock(pTexels, highQuality, pBlock);
+}
+
+void compressBC3Block(
+    const uint8_t* pTexels,
+    bool highQuality,
+    std::byte* pBlock) {
+  compressAlphaBlock(pTexels, pBlock);
+  compressColorBlock(pTexels, highQuality, pBlock + 8);
+}
+
+std::optional<GpuCompressedPixelFormat>
+chooseFormat(const ImageCesium& image) {
+  if (image.compressedPixelFormat != GpuCompressedPixelFormat::NONE ||
+      image.channels != 4 || image.bytesPerChannel != 1 || image.width <= 0 ||
+      image.height <= 0 || image.width % 4 != 0 || image.height % 4 != 0) {
+    return std::nullopt;
+  }
+
+  size_t texelCount = size_t(image.width) * size_t(image.height);
+  size_t mipSize = image.mipPositions.empty() ? image.pixelData.size()
+                                              : image.mipPositions[0].byteSize;
+  if (mipSize < texelCount * 4) {
+    return std::nullopt;
+  }
+
+  size_t mipOffset =
+      image.mipPositions.empty() ? 0 : image.mipPositions[0].byteOffset;
+  for (size_t i = 0; i < texelCount; ++i) {
+    if (image.pixelData[mipOffset + i * 4 + 3] != std::byte(255)) {
+      return GpuCompressedPixelFormat::BC3_RGBA;
+    }
+  }
+
+  return GpuCompressedPixelFormat::BC1_RGB;
+}
+
+ImageCesium compressImage(
+    const ImageCesium& image,
+    GpuCompressedPixelFormat format,
+    bool highQuality) {
+  const bool hasAlpha = format == GpuCompressedPixelFormat::BC3_RGBA;
+  const size_t blockBytes = hasAlpha ? BC3BlockBytes : BC1BlockBytes;
+
+  std::vector<ImageCesiumMipPosition> mips = image.mipPositions;
+  if (mips.empty()) {
+    mips.push_back(ImageCesiumMipPosition{0, image.pixelData.size()});
+  }
+
+  auto blockCount = [](int32_t size) { return (size + 3) / 4; };
+
+  size_t totalSize = 0;
+  for (size_t i = 0; i < mips.size(); ++i) {
+    int32_t width = std::max(image.width >> i, 1);
+    int32_t height = std::max(image.height >> i, 1);
+    totalSize +=
+        size_t(blockCount(width)) * size_t(blockCount(height)) * blockBytes;
+  }
+
+  ImageCesium result;
+  result.width = image.width;
+  result.height = image.height;
+  result.channels = 4;
+  result.bytesPerChannel = 1;
+  result.compressedPixelFormat = format;
+  result.pixelData.resize(totalSize);
+
+  size_t offset = 0;
+  uint8_t texels[64];
+  for (size_t i = 0; i < mips.size(); ++i) {
+    int32_t width = std::max(image.width >> i, 1);
+    int32_t height = std::max(image.height >> i, 1);
+    const std::byte* pMip = image.pixelData.data() + mips[i].byteOffset;
+
+    size_t mipOffset = offset;
+    for (int32_t blockY = 0; blockY < blockCount(height); ++blockY) {
+      for (int32_t blockX = 0; blockX < blockCount(width); ++blockX) {
+        readBlock(pMip, width, height, blockX, blockY, texels);
+        std::byte* pBlock = result.pixelData.data() + offset;
+        if (hasAlpha) {
+          compressBC3Block(texels, highQuality, pBlock);
+        } else {
+          compressBC1Block(texels, highQuality, pBlock);
+        }
+        offset += blockBytes;
+      }
+    }
+
+    if (!image.mipPositions.empty()) {
+      result.mipPositions.push_back(
+          ImageCesiumMipPosition{mipOffset, offset - mipOffset});
+    }
+  }
+
+  return result;
+}
+
+std::optional<ImageCesium> compressForUpload(
+    const ImageCesium& image,
+    ECesiumTextureCompression compression) {
+  if (compression == ECesiumTextureCompression::None) {
+    return std::nullopt;
+  }
+
+  std::optional<GpuCompressedPixelFormat> maybeFormat = chooseFormat(image);
+  if (!maybeFormat) {
+    return std::nullopt;
+  }
+
+  const bool hasAlpha = *maybeFormat == GpuCompressedPixelFormat::BC3_RGBA;
+  if (!GPixelFormats[hasAlpha ? PF_DXT5 : PF_DXT1].Supported) {
+    return std::nullopt;
+  }
+
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::CompressTexture)
+
+  double startTime = FPlatformTime::Seconds();
+  ImageCesium compressed = compressImage(
+      image,
+      *maybeFormat,
+      compression == ECesiumTextureCompression::HighQuality);
+  double seconds = FPlatformTime::Seconds() - startTime;
+
+  if (hasAlpha) {
+    INC_DWORD_STAT(STAT_CesiumTexturesCompressedBC3);
+  } else {
+    INC_DWORD_STAT(STAT_CesiumTexturesCompressedBC1);
+  }
+  INC_FLOAT_STAT_BY(
+      STAT_CesiumTextureCompressionSavedMB,
+      double(image.pixelData.size() - compressed.pixelData.size()) /
+          (1024.0 * 1024.0));
+  INC_FLOAT_STAT_BY(STAT_CesiumTextureCompressionTime, seconds * 1000.0);
+
+  return compressed;
+}
+
+} // namespace CesiumTextureCompression
@@ -0,0 +1,93 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumGltf/ImageCesium.h"
+#include "CesiumRuntimeSettings.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * Compresses uncompressed images to GPU block compression formats in worker
+ * threads, so that they use less GPU memory once uploaded.
+ *
+ * Images with alpha are compressed to BC3 and opaque images to BC1, taking
+ * 16 and 8 bytes per block of 4x4 texels, instead of the 64 bytes of the
+ * uncompressed block.
+ */
+namespace CesiumTextureCompression {
+
+/**
+ * The number of bytes in a compressed BC1 block.
+ */
+static constexpr size_t BC1BlockBytes = 8;
+
+/**
+ * The number of bytes in a compressed BC3 block.
+ */
+static constexpr size_t BC3BlockBytes = 16;
+
+/**
+ * Compresses a block of 4x4 texels to BC1, ignoring their alpha.
+ *
+ * @param pTexels The 16 texels, in rows, with four 8-bit channels each.
+ * @param highQuality Whether to search for the block's colors more accurately
+ * and more slowly.
+ * @param pBlock The 8 bytes of the compressed block.
+ */
+void compressBC1Block(
+    const uint8_t* pTexels,
+    bool highQuality,
+    std::byte* pBlock);
+
+/**
+ * Compresses a block of 4x4 texels to BC3.
+ *
+ * @param pTexels The 16 texels, in rows, with four 8-bit channels each.
+ * @param highQuality Whether to search for the block's colors more accurately
+ * and more slowly.
+ * @param pBlock The 16 bytes of the compressed block.
+ */
+void compressBC3Block(
+    const uint8_t* pTexels,
+    bool highQuality,
+    std::byte* pBlock);
+
+/**
+ * Chooses the format that the given image may be compressed to, regardless of
+ * the platform.
+ *
+ * @return BC3 if the image has any texel that is not opaque, BC1 if it does
+ * not, or nothing if the image is not uncompressed 8-bit RGBA, or its
+ * dimensions are not multiples of four.
+ */
+std::optional<CesiumGltf::GpuCompressedPixelFormat>
+chooseFormat(const CesiumGltf::ImageCesium& image);
+
+/**
+ * Compresses the given image and all of its mips.
+ *
+ * @param image The uncompressed 8-bit RGBA image.
+ * @param format Either BC1_RGB or BC3_RGBA.
+ * @param highQuality Whether to compress more accurately and more slowly.
+ * @return The compressed image.
+ */
+CesiumGltf::ImageCesium compressImage(
+    const CesiumGltf::ImageCesium& image,
+    CesiumGltf::GpuCompressedPixelFormat format,
+    bool highQuality);
+
+/**
+ * Compresses the given image for upload, if compression is enabled, the
+ * image can be compressed, and the platform supports the chosen format. This
+ * is counted in the Cesium stats.
+ *
+ * @return The compressed image, or nothing if the image should be uploaded as
+ * it is.
+ */
+std::optional<CesiumGltf::ImageCesium> compressForUpload(
+    const CesiumGltf::ImageCesium& image,
+    ECesiumTextureCompression compression);
+
+} // namespace CesiumTextureCompression
@@ -0,0 +1,155 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTextureMemory.h"
+#include "CesiumStats.h"
+#include <algorithm>
+#include <cmath>
+
+DECLARE_MEMORY_STAT(
+    TEXT("glTF Texture Memory"),
+    STAT_CesiumGltfTextureMemory,
+    STATGROUP_Cesium);
+DECLARE_MEMORY_STAT(
+    TEXT("Metadata Texture Memory"),
+    STAT_CesiumMetadataTextureMemory,
+    STATGROUP_Cesium);
+DECLARE_MEMORY_STAT(
+    TEXT("Raster Overlay Texture Memory"),
+    STAT_CesiumRasterOverlayTextureMemory,
+    STATGROUP_Cesium);
+
+namespace {
+
+// The owner of the textures created on the game thread, set by OwnerScope.
+std::shared_ptr<CesiumTextureMemory> currentOwner;
+
+// While under the budget, the scale halves over this many seconds.
+constexpr double BudgetRecoverySeconds = 4.0;
+
+void updateStats(CesiumTextureMemory::Category category, int64_t bytes) {
+  switch (category) {
+  case CesiumTextureMemory::Category::GltfTexture:
+    INC_MEMORY_STAT_BY(STAT_CesiumGltfTextureMemory, bytes);
+    break;
+  case CesiumTextureMemory::Category::MetadataTexture:
+    INC_MEMORY_STAT_BY(STAT_CesiumMetadataTextureMemory, bytes);
+    break;
+  case CesiumTextureMemory::Category::RasterOverlay:
+    INC_MEMORY_STAT_BY(STAT_CesiumRasterOverlayTextureMemory, bytes);
+    break;
+  }
+}
+
+} // namespace
+
+int64_t CesiumTextureMemory::Statistics::getTotalBytes() const {
+  int64_t total = 0;
+  for (int64_t categoryBytes : this->bytes) {
+    total += categoryBytes;
+  }
+  return total;
+}
+
+CesiumTextureMemory::Allocation::Allocation() noexcept
+    : _pOwner(), _category(Category::GltfTexture), _bytes(0) {}
+
+CesiumTextureMemory::Allocation::Allocation(
+    const std::shared_ptr<CesiumTextureMemory>& pOwner,
+    Category category,
+    int64_t bytes)
+    : _pOwner(pOwner), _category(category), _bytes(bytes) {
+  getGlobalTextureMemory().add(this->_category, this->_bytes);
+  updateStats(this->_category, this->_bytes);
+  if (this->_pOwner) {
+    this->_pOwner->add(this->_category, this->_bytes);
+  }
+}
+
+CesiumTextureMemory::Allocation::Allocation(Allocation&& rhs) noexcept
+    : _pOwner(std::move(rhs._pOwner)),
+      _category(rhs._category),
+      _bytes(rhs._bytes) {
+  rhs._bytes = 0;
+}
+
+CesiumTextureMemory::Allocation&
+CesiumTextureMemory::Allocation::operator=(Allocation&& rhs) noexcept {
+  if (this != &rhs) {
+    this->reset();
+    this->_pOwner = std::move(rhs._pOwner);
+    this->_category = rhs._category;
+    this->_bytes = rhs._bytes;
+    rhs._bytes = 0;
+  }
+  return *this;
+}
+
+CesiumTextureMemory::Allocation::~Allocation() { this->reset(); }
+
+void CesiumTextureMemory::Allocation::reset() {
+  if (this->_bytes != 0) {
+    getGlobalTextureMemory().add(this->_category, -this->_bytes);
+    updateStats(this->_category, -this->_bytes);
+    if (this->_pOwner) {
+      this->_pOwner->add(this->_category, -this->_bytes);
+    }
+    this->_bytes = 0;
+  }
+  this->_pOwner = nullptr;
+}
+
+CesiumTextureMemory::OwnerScope::OwnerScope(
+    const std::shared_ptr<CesiumTextureMemory>& pOwner)
+    : _pPrevious(std::move(currentOwner)) {
+  currentOwner = pOwner;
+}
+
+CesiumTextureMemory::OwnerScope::~OwnerScope() {
+  currentOwner = std::move(this->_pPrevious);
+}
+
+CesiumTextureMemory::CesiumTextureMemory() : _bytes() {
+  for (std::atomic<int64_t>& bytes : this->_bytes) {
+    bytes = 0;
+  }
+}
+
+CesiumTextureMemory::Statistics CesiumTextureMemory::getStatistics() const {
+  Statistics statistics;
+  for (size_t i = 0; i < CategoryCount; ++i) {
+    statistics.bytes[i] = this->_bytes[i].load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+std::shared_ptr<CesiumTextureMemory> CesiumTextureMemory::getCurrentOwner() {
+  return currentOwner;
+}
+
+double CesiumTextureMemory::updateBudgetScale(
+    double scale,
+    int64_t bytes,
+    int64_t budget,
+    double deltaSeconds) {
+  if (budget <= 0) {
+    return 1.0;
+  }
+
+  deltaSeconds = std::max(deltaSeconds, 0.0);
+  if (bytes > budget) {
+    scale *= std::exp2(deltaSeconds);
+  } else if (double(bytes) < double(budget) * BudgetRecoveryFraction) {
+    scale *= std::exp2(-deltaSeconds / BudgetRecoverySeconds);
+  }
+
+  return std::clamp(scale, 1.0, MaximumBudgetScale);
+}
+
+void CesiumTextureMemory::add(Category category, int64_t bytes) {
+  this->_bytes[size_t(category)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+CesiumTextureMemory& getGlobalTextureMemory() {
+  static CesiumTextureMemory memory;
+  return memory;
+}
@@ -0,0 +1,148 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Counts the bytes of the live GPU textures that Cesium creates, by the kind
+ * of texture. There is one instance for each tileset, counting the textures
+ * created for its tiles, and a global one counting all of them.
+ *
+ * Textures are counted by holding an {@link Allocation} for as long as they
+ * exist. The counts may be read from any thread.
+ */
+class CesiumTextureMemory {
+public:
+  /**
+   * The kinds of textures that are counted separately.
+   */
+  enum class Category : uint8_t {
+    /** Textures referenced by glTF materials. */
+    GltfTexture,
+    /** Textures that encode features and metadata for materials. */
+    MetadataTexture,
+    /** Raster overlay tiles. */
+    RasterOverlay
+  };
+
+  static constexpr size_t CategoryCount = 3;
+
+  /**
+   * The largest factor by which a texture budget may scale the maximum
+   * screen-space error.
+   */
+  static constexpr double MaximumBudgetScale = 16.0;
+
+  /**
+   * The fraction of the texture budget that the texture bytes must fall below
+   * before the scale applied by {@link updateBudgetScale} is reduced again.
+   */
+  static constexpr double BudgetRecoveryFraction = 0.8;
+
+  struct Statistics {
+    /**
+     * The bytes of the live textures in each category.
+     */
+    std::array<int64_t, CategoryCount> bytes;
+
+    int64_t getTotalBytes() const;
+  };
+
+  /**
+   * The memory of one texture. The bytes are added to the counts when this is
+   * constructed, and subtracted when it is destroyed or reset.
+   */
+  class Allocation {
+  public:
+    Allocation() noexcept;
+
+    /**
+     * Counts a texture.
+     *
+     * @param pOwner The counts of the tileset the texture belongs to, if any.
+     * The texture is always counted globally as well.
+     * @param category The kind of texture.
+     * @param bytes The texture's size in bytes.
+     */
+    Allocation(
+        const std::shared_ptr<CesiumTextureMemory>& pOwner,
+        Category category,
+        int64_t bytes);
+
+    Allocation(Allocation&& rhs) noexcept;
+    Allocation& operator=(Allocation&& rhs) noexcept;
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+    ~Allocation();
+
+    /**
+     * Stops counting the texture.
+     */
+    void reset();
+
+  private:
+    std::shared_ptr<CesiumTextureMemory> _pOwner;
+    Category _category;
+    int64_t _bytes;
+  };
+
+  /**
+   * Makes the given counts the owner of the textures created on the game
+   * thread for as long as this exists, such as while a tileset prepares a
+   * tile. Scopes may be nested.
+   */
+  class OwnerScope {
+  public:
+    explicit OwnerScope(const std::shared_ptr<CesiumTextureMemory>& pOwner);
+    OwnerScope(const OwnerScope&) = delete;
+    OwnerScope& operator=(const OwnerScope&) = delete;
+    ~OwnerScope();
+
+  private:
+    std::shared_ptr<CesiumTextureMemory> _pPrevious;
+  };
+
+  CesiumTextureMemory();
+
+  Statistics getStatistics() const;
+
+  /**
+   * Gets the owner set by the innermost {@link OwnerScope}, or nullptr if
+   * there is none. Must be called from the game thread.
+   */
+  static std::shared_ptr<CesiumTextureMemory> getCurrentOwner();
+
+  /**
+   * Adjusts the factor by which a tileset scales its maximum screen-space
+   * error in order to stay within a texture budget. The factor grows while
+   * the texture bytes exceed the budget, doubling every second, and shrinks
+   * back to one more slowly once they are well below it.
+   *
+   * @param scale The current factor.
+   * @param bytes The bytes of the tileset's live textures.
+   * @param budget The budget in bytes. If this is zero or less, there is no
+   * budget and the factor is one.
+   * @param deltaSeconds The time since the factor was last adjusted.
+   * @return The new factor, between one and {@link MaximumBudgetScale}.
+   */
+  static double updateBudgetScale(
+      double scale,
+      int64_t bytes,
+      int64_t budget,
+      double deltaSeconds);
+
+private:
+  void add(Category category, int64_t bytes);
+
+  std::array<std::atomic<int64_t>, CategoryCount> _bytes;
+};
+
+/**
+ * Gets the counts of all of the textures that Cesium has created.
+ */
+CesiumTextureMemory& getGlobalTextureMemory();
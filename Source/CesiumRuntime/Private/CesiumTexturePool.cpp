@@ -0,0 +1,168 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTexturePool.h"
+#include "CesiumRuntimeSettings.h"
+#include "CesiumStats.h"
+#include "CesiumTextureUtility.h"
+#include "Engine/Texture2D.h"
+#include <algorithm>
+#include <functional>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Texture Pool Hits"),
+    STAT_CesiumTexturePoolHits,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Texture Pool Misses"),
+    STAT_CesiumTexturePoolMisses,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Pooled Textures"),
+    STAT_CesiumPooledTextures,
+    STATGROUP_Cesium);
+
+namespace {
+
+// The number of tracked textures at which their keys are first swept.
+constexpr size_t MinimumSweepThreshold = 256;
+
+} // namespace
+
+bool CesiumTexturePool::Key::operator==(const Key& other) const {
+  return this->width == other.width && this->height == other.height &&
+         this->format == other.format && this->mipCount == other.mipCount &&
+         this->sRGB == other.sRGB && this->filter == other.filter &&
+         this->group == other.group;
+}
+
+size_t CesiumTexturePool::KeyHash::operator()(const Key& key) const {
+  size_t hash = std::hash<int32>()(key.width);
+  auto combine = [&hash](size_t value) {
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  };
+  combine(std::hash<int32>()(key.height));
+  combine(size_t(key.format));
+  combine(std::hash<int32>()(key.mipCount));
+  combine(size_t(key.sRGB));
+  combine(size_t(key.filter));
+  combine(size_t(key.group));
+  return hash;
+}
+
+CesiumTexturePool::CesiumTexturePool(int32 maximumSize)
+    : _maximumSize(maximumSize),
+      _mutex(),
+      _unused(),
+      _keys(),
+      _sweepThreshold(MinimumSweepThreshold),
+      _unusedCount(0),
+      _hits(0),
+      _misses(0) {}
+
+UTexture2D* CesiumTexturePool::acquire(const Key& key) {
+  if (this->_maximumSize <= 0) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  auto it = this->_unused.find(key);
+  if (it == this->_unused.end() || it->second.empty()) {
+    ++this->_misses;
+    INC_DWORD_STAT(STAT_CesiumTexturePoolMisses);
+    return nullptr;
+  }
+
+  UTexture2D* pTexture = it->second.back();
+  it->second.pop_back();
+  --this->_unusedCount;
+  ++this->_hits;
+  INC_DWORD_STAT(STAT_CesiumTexturePoolHits);
+  DEC_DWORD_STAT(STAT_CesiumPooledTextures);
+  return pTexture;
+}
+
+void CesiumTexturePool::track(UTexture2D* pTexture, const Key& key) {
+  if (this->_maximumSize <= 0 || !pTexture) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  this->_keys.insert_or_assign(pTexture, Tracked{key, pTexture});
+
+  if (this->_keys.size() >= this->_sweepThreshold) {
+    this->sweepKeys();
+    this->_sweepThreshold =
+        std::max(MinimumSweepThreshold, 2 * this->_keys.size());
+  }
+}
+
+void CesiumTexturePool::release(UTexture2D* pTexture) {
+  if (!pTexture) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto it = this->_keys.find(pTexture);
+    if (it != this->_keys.end()) {
+      if (it->second.pTexture.Get() == pTexture &&
+          this->_unusedCount < this->_maximumSize) {
+        this->_unused[it->second.key].push_back(pTexture);
+        ++this->_unusedCount;
+        INC_DWORD_STAT(STAT_CesiumPooledTextures);
+
+        // A pooled texture no longer counts against the budget of the tileset
+        // it was created for.
+        CesiumTextureUtility::releaseTextureMemoryOwner(pTexture);
+        return;
+      }
+      this->_keys.erase(it);
+    }
+  }
+
+  pTexture->RemoveFromRoot();
+  CesiumTextureUtility::destroyTexture(pTexture);
+}
+
+void CesiumTexturePool::clear() {
+  std::vector<UTexture2D*> textures;
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    for (auto& [key, unused] : this->_unused) {
+      for (UTexture2D* pTexture : unused) {
+        this->_keys.erase(pTexture);
+        textures.push_back(pTexture);
+      }
+    }
+    this->_unused.clear();
+    DEC_DWORD_STAT_BY(STAT_CesiumPooledTextures, this->_unusedCount);
+    this->_unusedCount = 0;
+  }
+
+  for (UTexture2D* pTexture : textures) {
+    pTexture->RemoveFromRoot();
+    CesiumTextureUtility::destroyTexture(pTexture);
+  }
+}
+
+void CesiumTexturePool::sweepKeys() {
+  for (auto it = this->_keys.begin(); it != this->_keys.end();) {
+    if (it->second.pTexture.Get() != it->first) {
+      it = this->_keys.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+CesiumTexturePool::Statistics CesiumTexturePool::getStatistics() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return Statistics{this->_hits, this->_misses, this->_unusedCount};
+}
+
+CesiumTexturePool& getRasterOverlayTexturePool() {
+  static CesiumTexturePool pool(
+      GetDefault<UCesiumRuntimeSettings>()->RasterOverlayTexturePoolSize);
+  return pool;
+}
@@ -0,0 +1,122 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "Engine/Texture.h"
+#include "Engine/TextureDefines.h"
+#include "PixelFormat.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class UTexture2D;
+
+/**
+ * Keeps textures that are no longer used, so that a later texture of the same
+ * size and format can reuse one by replacing its contents, instead of creating
+ * and destroying RHI resources. Raster overlay tiles, which mostly share one
+ * size and format, are loaded and unloaded constantly as the camera moves.
+ *
+ * Textures in the pool are kept rooted, and their memory is no longer counted
+ * against the tileset they were created for. A texture can only be pooled if
+ * the pool was told its key with {@link track} when it was created.
+ *
+ * The pool is cleared when a world is cleaned up and when the module shuts
+ * down.
+ */
+class CesiumTexturePool {
+public:
+  /**
+   * Everything about a texture that must match for it to be reused.
+   */
+  struct Key {
+    int32 width;
+    int32 height;
+    EPixelFormat format;
+    int32 mipCount;
+    bool sRGB;
+    TextureFilter filter;
+    TextureGroup group;
+
+    bool operator==(const Key& other) const;
+  };
+
+  /**
+   * Counts of the requests for pooled textures since the pool was created.
+   */
+  struct Statistics {
+    int64_t hits;
+    int64_t misses;
+    int32 pooled;
+  };
+
+  /**
+   * Creates a pool.
+   *
+   * @param maximumSize The maximum number of unused textures to keep. When
+   * this is zero, textures are never pooled.
+   */
+  explicit CesiumTexturePool(int32 maximumSize);
+
+  /**
+   * Takes an unused texture with the given key out of the pool, or returns
+   * nullptr if there is none. This may be called from any thread, but the
+   * texture may only be used in the game thread.
+   */
+  UTexture2D* acquire(const Key& key);
+
+  /**
+   * Records the key of a texture that was created to be pooled once it is no
+   * longer used. The keys of textures that were destroyed some other way are
+   * forgotten from time to time. Must be called from the game thread.
+   */
+  void track(UTexture2D* pTexture, const Key& key);
+
+  /**
+   * Returns a texture that is no longer used. If the pool knows its key and
+   * has room, the texture is kept for reuse. Otherwise it is unrooted and
+   * destroyed. Must be called from the game thread.
+   */
+  void release(UTexture2D* pTexture);
+
+  /**
+   * Destroys all of the unused textures in the pool. Must be called from the
+   * game thread.
+   */
+  void clear();
+
+  Statistics getStatistics() const;
+
+private:
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Tracked {
+    Key key;
+    // Detects a texture that was destroyed without being released, and
+    // another texture later created at the same address.
+    TWeakObjectPtr<UTexture2D> pTexture;
+  };
+
+  // Forgets the keys of the textures that no longer exist.
+  void sweepKeys();
+
+  int32 _maximumSize;
+
+  mutable std::mutex _mutex;
+  std::unordered_map<Key, std::vector<UTexture2D*>, KeyHash> _unused;
+  std::unordered_map<UTexture2D*, Tracked> _keys;
+  size_t _sweepThreshold;
+  int32 _unusedCount;
+  int64_t _hits;
+  int64_t _misses;
+};
+
+/**
+ * Gets the pool of raster overlay textures, sized by the Raster Overlay
+ * Texture Pool Size setting.
+ */
+CesiumTexturePool& getRasterOverlayTexturePool();
@@ -6,7 +6,12 @@
 #include "Async/TaskGraphInterfaces.h"
 #include "CesiumCommon.h"
 #include "CesiumLifetime.h"
+#include "CesiumMipGeneration.h"
+#include "CesiumMipResidency.h"
 #include "CesiumRuntime.h"
+#include "CesiumRuntimeSettings.h"
+#include "CesiumTextureCompression.h"
+#include "CesiumTextureMemory.h"
 #include "Containers/ResourceArray.h"
 #include "DynamicRHI.h"
 #include "GenericPlatform/GenericPlatformProcess.h"
@@ -22,7 +27,6 @@
 #include <CesiumGltf/ExtensionTextureWebp.h>
 #include <CesiumGltf/ImageCesium.h>
 #include <CesiumGltf/Ktx2TranscodeTargets.h>
-#include <CesiumGltfReader/GltfReader.h>
 #include <CesiumUtility/Tracing.h>
 #include <memory>
 #include <stb_image_resize.h>
@@ -31,70 +35,6 @@
 using namespace CesiumGltf;
 
 namespace {
-// Legacy texture creation code path - creates textures using Unreal's
-// FTexture2DMipMap and Texture2D::UpdateResource(). While this is slightly
-// less efficient than other approaches we've found, the other approaches
-// are not always supported on certain platforms. Once image sources from tiles
-// and raster tiles can be safely read from the render-thread, this approach
-// should no longer be necessary.
-void legacy_populateMips(
-    FTexturePlatformData& platformData,
-    const CesiumGltf::ImageCesium& image,
-    bool generateMipMaps) {
-  uint32 width = static_cast<uint32>(image.width);
-  uint32 height = static_cast<uint32>(image.height);
-
-  if (image.mipPositions.empty()) {
-    // Only the full image is available.
-    FTexture2DMipMap* pMip = new FTexture2DMipMap();
-    platformData.Mips.Add(pMip);
-    pMip->SizeX = width;
-    pMip->SizeY = height;
-
-    pMip->BulkData.Lock(LOCK_READ_WRITE);
-    void* pDest =
-        pMip->BulkData.Realloc(static_cast<int64>(image.pixelData.size()));
-
-    FMemory::Memcpy(pDest, image.pixelData.data(), image.pixelData.size());
-
-    pMip->BulkData.Unlock();
-    pMip->BulkData.SetBulkDataFlags(BULKDATA_SingleUse);
-
-    return;
-  }
-
-  for (const CesiumGltf::ImageCesiumMipPosition& mipPos : image.mipPositions) {
-    FTexture2DMipMap* pMip = new FTexture2DMipMap();
-    platformData.Mips.Add(pMip);
-    pMip->SizeX = width;
-    pMip->SizeY = height;
-
-    pMip->BulkData.Lock(LOCK_READ_WRITE);
-    void* pDest = pMip->BulkData.Realloc(static_cast<int64>(mipPos.byteSize));
-
-    FMemory::Memcpy(
-        pDest,
-        &image.pixelData[mipPos.byteOffset],
-        mipPos.byteSize);
-
-    pMip->BulkData.Unlock();
-    pMip->BulkData.SetBulkDataFlags(BULKDATA_SingleUse);
-
-    if (!generateMipMaps) {
-      // Only populate mip 0 if we don't want the full mip chain.
-      return;
-    }
-
-    if (width > 1) {
-      width >>= 1;
-    }
-
-    if (height > 1) {
-      height >>= 1;
-    }
-  }
-}
-
 struct GetImageFromSource {
   CesiumGltf::ImageCesium*
   operator()(CesiumTextureUtility::GltfImagePtr& imagePtr) {
@@ -230,7 +170,7 @@ ESamplerAddressMode convertAddressMode(TextureAddress address) {
  * FTexture2DRHIRef is given, ownership of it is assumed and it will be
  * destroyed in ReleaseResource. Otherwise, the RHI texture will be created
  * from the in-memory Cesium glTF image in InitRHI (on the render thread).
- *
+ * The RHI texture's memory is counted while it exists.
  */
 class FCesiumTextureResource : public FTextureResource {
 public:
@@ -244,7 +184,9 @@ public:
       TextureAddress addressX,
       TextureAddress addressY,
       bool sRGB,
-      uint32 extData)
+      uint32 extData,
+      CesiumTextureMemory::Category memoryCategory,
+      const std::shared_ptr<CesiumTextureMemory>& pMemoryOwner)
       : _pTexture(pTexture),
         _textureSource(std::move(textureSource)),
         _width(width),
@@ -253,7 +195,11 @@ public:
         _filter(convertFilter(filter)),
         _addressX(convertAddressMode(addressX)),
         _addressY(convertAddressMode(addressY)),
-        _platformExtData(extData) {
+        _platformExtData(extData),
+        _textureSize(0),
+        _memoryCategory(memoryCategory),
+        _pMemoryOwner(pMemoryOwner),
+        _memory() {
     this->bGreyScaleFormat = (_format == PF_G8) || (_format == PF_BC4);
     this->bSRGB = sRGB;
 
@@ -269,6 +215,11 @@ public:
   }
 
   virtual ~FCesiumTextureResource() {
+    // The retained RHI texture is freed along with the resource, so stop
+    // counting its memory now.
+    DEC_DWORD_STAT_BY(STAT_TextureMemory, this->_textureSize);
+    DEC_DWORD_STAT_FNAME_BY(this->_lodGroupStatName, this->_textureSize);
+
     check(this->_pTexture != nullptr);
     this->_pTexture->SetResource(nullptr);
   }
@@ -283,29 +234,6 @@ public:
   virtual void InitRHI() override {
 #endif
 
-#if STATS
-    ETextureCreateFlags textureFlags = TexCreate_ShaderResource;
-    if (this->bSRGB) {
-      textureFlags |= TexCreate_SRGB;
-    }
-
-    const FIntPoint MipExtents =
-        CalcMipMapExtent(this->_width, this->_height, this->_format, 0);
-    uint32 alignment;
-    this->_textureSize = RHICalcTexture2DPlatformSize(
-        MipExtents.X,
-        MipExtents.Y,
-        this->_format,
-        this->GetCurrentMipCount(),
-        1,
-        textureFlags,
-        FRHIResourceCreateInfo(this->_platformExtData),
-        alignment);
-
-    INC_DWORD_STAT_BY(STAT_TextureMemory, this->_textureSize);
-    INC_DWORD_STAT_FNAME_BY(this->_lodGroupStatName, this->_textureSize);
-#endif
-
     FSamplerStateInitializerRHI samplerStateInitializer(
         this->_filter,
         this->_addressX,
@@ -336,99 +264,196 @@ public:
     this->DeferredPassSamplerStateRHI =
         GetOrCreateSamplerState(deferredSamplerStateInitializer);
 
-    if (!this->TextureRHI) {
-      // TODO: Currently copying from `ImageCesium` on the render-thread is
-      // unsafe. Currently we should never hit this code. Remove this in the
-      // future when images from tiles and raster tiles can be safely accessed
-      // from the render thread.
-      checkNoEntry();
+    if (!this->TextureRHI && this->_retainedTextureRHI) {
+      // The resource is being initialized again after ReleaseRHI, and the
+      // pixels the texture was created from are gone, so restore the texture.
+      this->TextureRHI = this->_retainedTextureRHI;
+    }
 
+    if (!this->TextureRHI) {
       // Asynchronous RHI texture creation was not available. So create it now
-      // directly from the in-memory cesium mips.
+      // directly from the in-memory cesium mips, which this resource owns.
       CesiumGltf::ImageCesium* pImage =
           std::visit(GetImageFromSource{}, this->_textureSource);
 
       check(pImage != nullptr);
 
-      // Wrap mip0 as a bulk data source.
-      FCesiumTextureData bulkData(*pImage);
+      this->TextureRHI = this->createRHITexture(*pImage);
+
+      // The pixels are on the GPU now, so free them. The texture is retained
+      // below in their place.
+      *pImage = CesiumGltf::ImageCesium();
+    }
 
-      FRHIResourceCreateInfo createInfo{TEXT("CesiumTextureUtility")};
-      createInfo.BulkData = &bulkData;
-      createInfo.ExtData = _platformExtData;
+    this->_retainedTextureRHI = this->TextureRHI;
 
-      ETextureCreateFlags textureFlags = TexCreate_ShaderResource;
+    // Count the texture's memory once it exists, so that its mips are known.
+    this->updateTextureSize();
 
-      if (this->bSRGB) {
-        textureFlags |= TexCreate_SRGB;
-      }
+    RHIUpdateTextureReference(TextureReferenceRHI, this->TextureRHI);
+  }
 
-      uint32 mipCount =
-          FMath::Max(1, static_cast<int32>(pImage->mipPositions.size()));
+  // The RHI texture itself is retained until the resource is destroyed,
+  // because the pixels it was created from, or the asynchronously created
+  // texture, are not kept, so a later InitRHI could not create it again.
+  // Its memory is still allocated, so it stays counted until the destructor.
+  virtual void ReleaseRHI() override {
+    RHIUpdateTextureReference(TextureReferenceRHI, nullptr);
+
+    FTextureResource::ReleaseRHI();
+  }
 
-      FTexture2DRHIRef rhiTexture;
+  /**
+   * Counts the texture's memory against a different owner and category, such
+   * as when a pooled texture is reused. Must be called on the render thread.
+   */
+  void setMemoryOwner(
+      CesiumTextureMemory::Category memoryCategory,
+      const std::shared_ptr<CesiumTextureMemory>& pMemoryOwner) {
+    this->_memoryCategory = memoryCategory;
+    this->_pMemoryOwner = pMemoryOwner;
+    if (this->_retainedTextureRHI) {
+      this->_memory = CesiumTextureMemory::Allocation(
+          this->_pMemoryOwner,
+          this->_memoryCategory,
+          static_cast<int64_t>(this->_textureSize));
+    }
+  }
 
-      // Copies over mip0, allocates the rest of the mips if needed.
+  /**
+   * Stops counting the texture's memory against its owner, while still
+   * counting it in the total. Must be called on the render thread.
+   */
+  void releaseMemoryOwner() {
+    this->setMemoryOwner(this->_memoryCategory, nullptr);
+  }
 
-      // RHICreateTexture2D can actually copy over all the mips in one shot,
-      // but it expects a particular memory layout. Might be worth configuring
-      // Cesium Native's mip-map generation to obey a standard memory layout.
+  /**
+   * Replaces the RHI texture with one created from the given mips, such as
+   * when the texture's upper mips are released or restored. Materials see the
+   * new texture through the texture reference. Must be called on the render
+   * thread.
+   */
+  void replaceMips(const CesiumGltf::ImageCesium& image) {
+    if (!this->TextureRHI) {
+      // The texture has been released.
+      return;
+    }
+
+    this->TextureRHI = this->createRHITexture(image);
+    this->_retainedTextureRHI = this->TextureRHI;
+    this->_width = static_cast<uint32>(image.width);
+    this->_height = static_cast<uint32>(image.height);
+    this->updateTextureSize();
+
+    RHIUpdateTextureReference(TextureReferenceRHI, this->TextureRHI);
+  }
+
+#if STATS
+  static FName TextureGroupStatFNames[TEXTUREGROUP_MAX];
+#endif
+
+private:
+  // Creates an RHI texture with the image's size and all of its mips.
+  FTexture2DRHIRef
+  createRHITexture(const CesiumGltf::ImageCesium& image) const {
+    // Wrap mip0 as a bulk data source.
+    FCesiumTextureData bulkData(image);
+
+    FRHIResourceCreateInfo createInfo{TEXT("CesiumTextureUtility")};
+    createInfo.BulkData = &bulkData;
+    createInfo.ExtData = _platformExtData;
+
+    ETextureCreateFlags textureFlags = TexCreate_ShaderResource;
+
+    if (this->bSRGB) {
+      textureFlags |= TexCreate_SRGB;
+    }
+
+    uint32 mipCount =
+        FMath::Max(1, static_cast<int32>(image.mipPositions.size()));
+
+    FTexture2DRHIRef rhiTexture;
+
+    // Copies over mip0, allocates the rest of the mips if needed.
+
+    // RHICreateTexture2D can actually copy over all the mips in one shot,
+    // but it expects a particular memory layout. Might be worth configuring
+    // Cesium Native's mip-map generation to obey a standard memory layout.
 #if ENGINE_VERSION_5_3_OR_HIGHER
-      rhiTexture = RHICreateTexture(
-          FRHITextureCreateDesc::Create2D(createInfo.DebugName)
-              .SetExtent(int32(this->_width), int32(this->_height))
-              .SetFormat(this->_format)
-              .SetNumMips(uint8(mipCount))
-              .SetNumSamples(1)
-              .SetFlags(textureFlags)
-              .SetInitialState(ERHIAccess::Unknown)
-              .SetExtData(createInfo.ExtData)
-              .SetBulkData(createInfo.BulkData)
-              .SetGPUMask(createInfo.GPUMask)
-              .SetClearValue(createInfo.ClearValueBinding));
+    rhiTexture = RHICreateTexture(
+        FRHITextureCreateDesc::Create2D(createInfo.DebugName)
+            .SetExtent(image.width, image.height)
+            .SetFormat(this->_format)
+            .SetNumMips(uint8(mipCount))
+            .SetNumSamples(1)
+            .SetFlags(textureFlags)
+            .SetInitialState(ERHIAccess::Unknown)
+            .SetExtData(createInfo.ExtData)
+            .SetBulkData(createInfo.BulkData)
+            .SetGPUMask(createInfo.GPUMask)
+            .SetClearValue(createInfo.ClearValueBinding));
 #else
-      rhiTexture = RHICreateTexture2D(
-          this->_width,
-          this->_height,
-          this->_format,
-          mipCount,
-          1,
-          textureFlags,
-          createInfo);
+    rhiTexture = RHICreateTexture2D(
+        uint32(image.width),
+        uint32(image.height),
+        this->_format,
+        mipCount,
+        1,
+        textureFlags,
+        createInfo);
 #endif
 
-      // Copies over rest of the mips
-      for (uint32 i = 1; i < mipCount; ++i) {
-        uint32 DestPitch;
-        void* pDestination =
-            RHILockTexture2D(rhiTexture, i, RLM_WriteOnly, DestPitch, false);
-        CopyMip(pDestination, DestPitch, _format, *pImage, i);
-        RHIUnlockTexture2D(rhiTexture, i, false);
-      }
-
-      this->TextureRHI = std::move(rhiTexture);
+    // Copies over rest of the mips
+    for (uint32 i = 1; i < mipCount; ++i) {
+      uint32 DestPitch;
+      void* pDestination =
+          RHILockTexture2D(rhiTexture, i, RLM_WriteOnly, DestPitch, false);
+      CopyMip(pDestination, DestPitch, _format, image, i);
+      RHIUnlockTexture2D(rhiTexture, i, false);
     }
 
-    RHIUpdateTextureReference(TextureReferenceRHI, this->TextureRHI);
+    return rhiTexture;
   }
 
-  virtual void ReleaseRHI() override {
+  // Counts the memory of the current RHI texture in place of the previous
+  // one.
+  void updateTextureSize() {
     DEC_DWORD_STAT_BY(STAT_TextureMemory, this->_textureSize);
     DEC_DWORD_STAT_FNAME_BY(this->_lodGroupStatName, this->_textureSize);
 
-    RHIUpdateTextureReference(TextureReferenceRHI, nullptr);
+    ETextureCreateFlags textureFlags = TexCreate_ShaderResource;
+    if (this->bSRGB) {
+      textureFlags |= TexCreate_SRGB;
+    }
 
-    FTextureResource::ReleaseRHI();
-  }
+    const FIntPoint MipExtents =
+        CalcMipMapExtent(this->_width, this->_height, this->_format, 0);
+    uint32 alignment;
+    this->_textureSize = RHICalcTexture2DPlatformSize(
+        MipExtents.X,
+        MipExtents.Y,
+        this->_format,
+        this->GetCurrentMipCount(),
+        1,
+        textureFlags,
+        FRHIResourceCreateInfo(this->_platformExtData),
+        alignment);
 
-#if STATS
-  static FName TextureGroupStatFNames[TEXTUREGROUP_MAX];
-#endif
+    INC_DWORD_STAT_BY(STAT_TextureMemory, this->_textureSize);
+    INC_DWORD_STAT_FNAME_BY(this->_lodGroupStatName, this->_textureSize);
+    this->_memory = CesiumTextureMemory::Allocation(
+        this->_pMemoryOwner,
+        this->_memoryCategory,
+        static_cast<int64_t>(this->_textureSize));
+  }
 
-private:
   UTexture* _pTexture;
   CesiumTextureUtility::CesiumTextureSource _textureSource;
 
+  // The RHI texture, which outlives ReleaseRHI so that InitRHI can restore it.
+  FTextureRHIRef _retainedTextureRHI;
+
   uint32 _width;
   uint32 _height;
   EPixelFormat _format;
@@ -440,6 +465,10 @@ private:
 
   FName _lodGroupStatName;
   uint64 _textureSize;
+
+  CesiumTextureMemory::Category _memoryCategory;
+  std::shared_ptr<CesiumTextureMemory> _pMemoryOwner;
+  CesiumTextureMemory::Allocation _memory;
 };
 
 #if STATS
@@ -601,6 +630,73 @@ createTexturePlatformData(int32 sizeX, int32 sizeY, EPixelFormat format) {
   }
 }
 
+/**
+ * @brief Replaces the contents of every mip of a texture with the given image
+ * on the render thread, and counts its memory against a new owner. The image
+ * must have the texture's size, format, and number of mips. The texture must
+ * have been created by loadTextureGameThreadPart.
+ */
+static void UpdateTexture2D(
+    UTexture2D* pTexture,
+    CesiumGltf::ImageCesium&& image,
+    CesiumTextureMemory::Category memoryCategory,
+    const std::shared_ptr<CesiumTextureMemory>& pMemoryOwner) {
+  FCesiumTextureResource* pResource =
+      static_cast<FCesiumTextureResource*>(pTexture->GetResource());
+  if (!pResource) {
+    return;
+  }
+
+  EPixelFormat format = pTexture->GetPixelFormat();
+
+  ENQUEUE_RENDER_COMMAND(Cesium_UpdatePooledTexture)
+  ([pResource,
+    format,
+    image = std::move(image),
+    memoryCategory,
+    pMemoryOwner](FRHICommandListImmediate& RHICmdList) {
+    pResource->setMemoryOwner(memoryCategory, pMemoryOwner);
+
+    FRHITexture* pRHITexture = pResource->TextureRHI.GetReference();
+    if (!pRHITexture) {
+      return;
+    }
+
+    uint32 mipCount = FMath::Min(
+        FMath::Max(1u, static_cast<uint32>(image.mipPositions.size())),
+        static_cast<uint32>(pRHITexture->GetNumMips()));
+    for (uint32 i = 0; i < mipCount; ++i) {
+      // Block-compressed mips, such as BC1 and BC3, are updated in whole
+      // blocks, including the mips that are smaller than a block.
+      const uint32 blockSizeX =
+          static_cast<uint32>(GPixelFormats[format].BlockSizeX);
+      const uint32 blockSizeY =
+          static_cast<uint32>(GPixelFormats[format].BlockSizeY);
+      uint32 mipWidth =
+          FMath::DivideAndRoundUp(
+              FMath::Max<uint32>(static_cast<uint32>(image.width) >> i, 1),
+              blockSizeX) *
+          blockSizeX;
+      uint32 mipHeight =
+          FMath::DivideAndRoundUp(
+              FMath::Max<uint32>(static_cast<uint32>(image.height) >> i, 1),
+              blockSizeY) *
+          blockSizeY;
+      size_t byteOffset =
+          image.mipPositions.empty() ? 0 : image.mipPositions[i].byteOffset;
+      uint32 pitch = mipWidth / blockSizeX *
+                     static_cast<uint32>(GPixelFormats[format].BlockBytes);
+
+      RHICmdList.UpdateTexture2D(
+          pRHITexture,
+          i,
+          FUpdateTextureRegion2D(0, 0, 0, 0, mipWidth, mipHeight),
+          pitch,
+          reinterpret_cast<const uint8*>(&image.pixelData[byteOffset]));
+    }
+  });
+}
+
 static UTexture2D* CreateTexture2D(LoadedTextureResult* pHalfLoadedTexture) {
   if (!pHalfLoadedTexture) {
     return nullptr;
@@ -631,6 +727,52 @@ static UTexture2D* CreateTexture2D(LoadedTextureResult* pHalfLoadedTexture) {
   return pTexture;
 }
 
+/**
+ * @brief Gets the index of the largest mip, no larger than the given one,
+ * whose size is a whole number of the format's blocks, so that a texture can
+ * start with it.
+ */
+static int32 alignFirstMip(
+    const CesiumGltf::ImageCesium& image,
+    EPixelFormat format,
+    int32 firstMip) {
+  while (firstMip > 0 &&
+         (FMath::Max(image.width >> firstMip, 1) %
+                  GPixelFormats[format].BlockSizeX !=
+              0 ||
+          FMath::Max(image.height >> firstMip, 1) %
+                  GPixelFormats[format].BlockSizeY !=
+              0)) {
+    --firstMip;
+  }
+  return firstMip;
+}
+
+/**
+ * @brief Copies the given mip of an image, and the smaller ones, into an image
+ * of their own.
+ */
+static CesiumGltf::ImageCesium
+copyMips(const CesiumGltf::ImageCesium& image, int32 firstMip) {
+  CesiumGltf::ImageCesium mips;
+  mips.width = FMath::Max(image.width >> firstMip, 1);
+  mips.height = FMath::Max(image.height >> firstMip, 1);
+  mips.channels = image.channels;
+  mips.bytesPerChannel = image.bytesPerChannel;
+  mips.compressedPixelFormat = image.compressedPixelFormat;
+  int32 mipCount = static_cast<int32>(image.mipPositions.size());
+  for (int32 i = firstMip; i < mipCount; ++i) {
+    const CesiumGltf::ImageCesiumMipPosition& position = image.mipPositions[i];
+    mips.mipPositions.push_back({mips.pixelData.size(), position.byteSize});
+    mips.pixelData.insert(
+        mips.pixelData.end(),
+        image.pixelData.begin() + position.byteOffset,
+        image.pixelData.begin() + position.byteOffset + position.byteSize);
+  }
+
+  return mips;
+}
+
 TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     CesiumTextureSource&& imageSource,
     const TextureAddress& addressX,
@@ -638,7 +780,9 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     const TextureFilter& filter,
     const TextureGroup& group,
     bool generateMipMaps,
-    bool sRGB) {
+    bool sRGB,
+    CesiumTexturePool* pPool,
+    double projectedPixels) {
 
   CesiumGltf::ImageCesium* pImage =
       std::visit(GetImageFromSource{}, imageSource);
@@ -652,7 +796,7 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
 
   if (generateMipMaps) {
     std::optional<std::string> errorMessage =
-        CesiumGltfReader::GltfReader::generateMipMaps(image);
+        CesiumMipGeneration::generateMipMaps(image);
     if (errorMessage) {
       UE_LOG(
           LogCesium,
@@ -662,9 +806,23 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     }
   }
 
+  // Color textures may be compressed here, leaving the source image as it is.
+  // Other textures, such as normal maps, hold data that compression would
+  // distort too much.
+  std::optional<CesiumGltf::ImageCesium> maybeCompressed;
+  if (sRGB) {
+    maybeCompressed = CesiumTextureCompression::compressForUpload(
+        image,
+        GetDefault<UCesiumRuntimeSettings>()->TextureCompression);
+  }
+  const bool compressedForUpload = maybeCompressed.has_value();
+
+  const CesiumGltf::ImageCesium& sourceImage =
+      maybeCompressed ? *maybeCompressed : image;
+
   EPixelFormat pixelFormat;
-  if (image.compressedPixelFormat != GpuCompressedPixelFormat::NONE) {
-    switch (image.compressedPixelFormat) {
+  if (sourceImage.compressedPixelFormat != GpuCompressedPixelFormat::NONE) {
+    switch (sourceImage.compressedPixelFormat) {
     case GpuCompressedPixelFormat::ETC1_RGB:
       pixelFormat = EPixelFormat::PF_ETC1;
       break;
@@ -703,7 +861,7 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
       return nullptr;
     };
   } else {
-    switch (image.channels) {
+    switch (sourceImage.channels) {
     case 1:
       pixelFormat = PF_R8;
       break;
@@ -717,9 +875,32 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     };
   }
 
+  // Leave out the upper mips that the object using the texture is too small
+  // on screen to need yet. The source image keeps them, so they can be
+  // restored later.
+  std::optional<CesiumGltf::ImageCesium> maybeFirstMips;
+  int32 firstResidentMip = 0;
+  if (projectedPixels > 0.0 && generateMipMaps && !maybeCompressed &&
+      image.mipPositions.size() > 1) {
+    firstResidentMip = alignFirstMip(
+        image,
+        pixelFormat,
+        CesiumMipResidency::computeWantedFirstMip(
+            image.width,
+            image.height,
+            static_cast<int32>(image.mipPositions.size()),
+            projectedPixels));
+    if (firstResidentMip > 0) {
+      maybeFirstMips = copyMips(image, firstResidentMip);
+    }
+  }
+
+  const CesiumGltf::ImageCesium& gpuImage =
+      maybeFirstMips ? *maybeFirstMips : sourceImage;
+
   TUniquePtr<LoadedTextureResult> pResult = MakeUnique<LoadedTextureResult>();
   pResult->pTextureData =
-      createTexturePlatformData(image.width, image.height, pixelFormat);
+      createTexturePlatformData(gpuImage.width, gpuImage.height, pixelFormat);
 
   if (!pResult->pTextureData) {
     return nullptr;
@@ -731,39 +912,75 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
   pResult->group = group;
   pResult->sRGB = sRGB;
   pResult->generateMipMaps = generateMipMaps;
+  pResult->compressedForUpload = compressedForUpload;
+  pResult->firstResidentMip = firstResidentMip;
+
+  // Gets an image for the texture to own, to create or update it from on the
+  // render thread. An image that the caller handed over, or that was
+  // compressed or copied above, is moved without a copy. An image that still
+  // belongs to a glTF is copied once.
+  auto takeImage = [&]() {
+    EmbeddedImageSource result;
+    EmbeddedImageSource* pEmbeddedImage =
+        std::get_if<EmbeddedImageSource>(&imageSource);
+    if (maybeCompressed) {
+      result.image = std::move(*maybeCompressed);
+    } else if (maybeFirstMips) {
+      result.image = std::move(*maybeFirstMips);
+    } else if (pEmbeddedImage) {
+      result.image = std::move(pEmbeddedImage->image);
+    } else {
+      result.image = image;
+    }
+
+    if (!generateMipMaps && result.image.mipPositions.size() > 1) {
+      // Only use mip 0 if we don't want the full mip chain.
+      result.image.mipPositions.resize(1);
+    }
+    return result;
+  };
+
+  if (pPool) {
+    int32 mipCount =
+        generateMipMaps
+            ? FMath::Max(1, static_cast<int32>(gpuImage.mipPositions.size()))
+            : 1;
+    pResult->poolKey = CesiumTexturePool::Key{
+        gpuImage.width,
+        gpuImage.height,
+        pixelFormat,
+        mipCount,
+        sRGB,
+        filter,
+        group};
+
+    pResult->pPooledTexture = pPool->acquire(*pResult->poolKey);
+    if (pResult->pPooledTexture) {
+      // The pooled texture's contents will be replaced on the render thread.
+      pResult->textureSource = takeImage();
+      return pResult;
+    }
+  }
 
   if (GRHISupportsAsyncTextureCreation) {
     // Create RHI texture resource asynchronously.
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::CreateRHITexture2D)
 
     pResult->textureSource = AsyncCreatedTexture{
-        CreateRHITexture2D_Async(image, pixelFormat, generateMipMaps, sRGB)};
+        CreateRHITexture2D_Async(gpuImage, pixelFormat, generateMipMaps, sRGB)};
   } else {
     // The RHI texture will be created later on the render thread, directly
-    // from this texture source.
-    // pResult->textureSource = std::move(imageSource);
-
-    // TODO: Use the above texture creation path instead when the image source
-    // becomes render-thread safe in the future. Currently that is not the
-    // case for any `CesiumGltf::ImageCesium` from tiles or raster tiles.
-
-    // Legacy texture creation copies mip data into the FTexturePlatformData.
-    legacy_populateMips(*pResult->pTextureData, image, generateMipMaps);
-    // Mark the image source as legacy, so we later know where to look for image
-    // data.
-    pResult->textureSource = LegacyTextureSource{};
+    // from an image that the texture resource owns.
+    pResult->textureSource = takeImage();
   }
 
   return pResult;
 }
 
-TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
-    CesiumGltf::Model& model,
+static int32_t getSourceImageIndex(
+    const CesiumGltf::Model& model,
     const CesiumGltf::Texture& texture,
-    bool sRGB) {
-
-  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::LoadTexture)
-
+    bool logWarnings = true) {
   const CesiumGltf::ExtensionKhrTextureBasisu* pKtxExtension =
       texture.getExtension<CesiumGltf::ExtensionKhrTextureBasisu>();
   const CesiumGltf::ExtensionTextureWebp* pWebpExtension =
@@ -773,43 +990,78 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
   if (pKtxExtension) {
     if (pKtxExtension->source < 0 ||
         pKtxExtension->source >= model.images.size()) {
-      UE_LOG(
-          LogCesium,
-          Warning,
-          TEXT(
-              "KTX texture source index must be non-negative and less than %d, but is %d"),
-          model.images.size(),
-          pKtxExtension->source);
-      return nullptr;
+      if (logWarnings) {
+        UE_LOG(
+            LogCesium,
+            Warning,
+            TEXT(
+                "KTX texture source index must be non-negative and less than %d, but is %d"),
+            model.images.size(),
+            pKtxExtension->source);
+      }
+      return -1;
     }
     source = pKtxExtension->source;
   } else if (pWebpExtension) {
     if (pWebpExtension->source < 0 ||
         pWebpExtension->source >= model.images.size()) {
-      UE_LOG(
-          LogCesium,
-          Warning,
-          TEXT(
-              "WebP texture source index must be non-negative and less than %d, but is %d"),
-          model.images.size(),
-          pWebpExtension->source);
-      return nullptr;
+      if (logWarnings) {
+        UE_LOG(
+            LogCesium,
+            Warning,
+            TEXT(
+                "WebP texture source index must be non-negative and less than %d, but is %d"),
+            model.images.size(),
+            pWebpExtension->source);
+      }
+      return -1;
     }
     source = pWebpExtension->source;
   } else {
     if (texture.source < 0 || texture.source >= model.images.size()) {
-      UE_LOG(
-          LogCesium,
-          Warning,
-          TEXT(
-              "Texture source index must be non-negative and less than %d, but is %d"),
-          model.images.size(),
-          texture.source);
-      return nullptr;
+      if (logWarnings) {
+        UE_LOG(
+            LogCesium,
+            Warning,
+            TEXT(
+                "Texture source index must be non-negative and less than %d, but is %d"),
+            model.images.size(),
+            texture.source);
+      }
+      return -1;
     }
     source = texture.source;
   }
 
+  return source;
+}
+
+static bool usesMipMaps(const CesiumGltf::Sampler& sampler) {
+  switch (sampler.minFilter.value_or(
+      CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_LINEAR)) {
+  case CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_LINEAR:
+  case CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_NEAREST:
+  case CesiumGltf::Sampler::MinFilter::NEAREST_MIPMAP_LINEAR:
+  case CesiumGltf::Sampler::MinFilter::NEAREST_MIPMAP_NEAREST:
+    return true;
+  default: // LINEAR and NEAREST
+    return false;
+  }
+}
+
+TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
+    CesiumGltf::Model& model,
+    const CesiumGltf::Texture& texture,
+    bool sRGB,
+    double projectedPixels) {
+
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::LoadTexture)
+
+  int32_t source = getSourceImageIndex(model, texture);
+  if (source < 0) {
+    return nullptr;
+  }
+
   CesiumGltf::ImageCesium& image = model.images[source].cesium;
   const CesiumGltf::Sampler* pSampler =
       CesiumGltf::Model::getSafe(&model.samplers, texture.sampler);
@@ -886,18 +1138,7 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
       filter = TextureFilter::TF_Default;
     }
 
-    switch (pSampler->minFilter.value_or(
-        CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_LINEAR)) {
-    case CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_LINEAR:
-    case CesiumGltf::Sampler::MinFilter::LINEAR_MIPMAP_NEAREST:
-    case CesiumGltf::Sampler::MinFilter::NEAREST_MIPMAP_LINEAR:
-    case CesiumGltf::Sampler::MinFilter::NEAREST_MIPMAP_NEAREST:
-      useMipMaps = true;
-      break;
-    default: // LINEAR and NEAREST
-      useMipMaps = false;
-      break;
-    }
+    useMipMaps = usesMipMaps(*pSampler);
   }
 
   TUniquePtr<LoadedTextureResult> result = loadTextureAnyThreadPart(
@@ -907,7 +1148,9 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
       filter,
       TextureGroup::TEXTUREGROUP_World,
       useMipMaps,
-      sRGB);
+      sRGB,
+      nullptr,
+      projectedPixels);
 
   // Replace the image pointer with an index, in case the pointer gets
   // invalidated before the main thread loading continues.
@@ -915,9 +1158,65 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     result->textureSource = GltfImageIndex{source};
   }
 
+  // The glTF keeps the image's mips, so they can be uploaded again later.
+  if (result && result->generateMipMaps && !result->compressedForUpload) {
+    result->sourceImageIndex = source;
+  }
+
   return result;
 }
 
+void generateMipMapsAnyThreadPart(CesiumGltf::Model& model) {
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::GenerateModelMipMaps)
+
+  auto generateForTexture = [&model](const auto& maybeTextureInfo) {
+    if (!maybeTextureInfo) {
+      return;
+    }
+
+    const CesiumGltf::Texture* pTexture =
+        CesiumGltf::Model::getSafe(&model.textures, maybeTextureInfo->index);
+    if (!pTexture) {
+      return;
+    }
+
+    const CesiumGltf::Sampler* pSampler =
+        CesiumGltf::Model::getSafe(&model.samplers, pTexture->sampler);
+    if (!pSampler || !usesMipMaps(*pSampler)) {
+      return;
+    }
+
+    // Invalid textures are reported when they are loaded.
+    int32_t source = getSourceImageIndex(model, *pTexture, false);
+    if (source < 0) {
+      return;
+    }
+
+    // Images that already have mips, such as those shared by several
+    // textures, are left as they are.
+    std::optional<std::string> errorMessage =
+        CesiumMipGeneration::generateMipMaps(model.images[source].cesium);
+    if (errorMessage) {
+      UE_LOG(
+          LogCesium,
+          Warning,
+          TEXT("%s"),
+          UTF8_TO_TCHAR(errorMessage->c_str()));
+    }
+  };
+
+  for (const CesiumGltf::Material& material : model.materials) {
+    if (material.pbrMetallicRoughness) {
+      generateForTexture(material.pbrMetallicRoughness->baseColorTexture);
+      generateForTexture(
+          material.pbrMetallicRoughness->metallicRoughnessTexture);
+    }
+    generateForTexture(material.normalTexture);
+    generateForTexture(material.occlusionTexture);
+    generateForTexture(material.emissiveTexture);
+  }
+}
+
 UTexture2D* loadTextureGameThreadPart(LoadedTextureResult* pHalfLoadedTexture) {
   TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::LoadTexture)
 
@@ -929,10 +1228,34 @@ UTexture2D* loadTextureGameThreadPart(LoadedTextureResult* pHalfLoadedTexture) {
     return pHalfLoadedTexture->pTexture.Get();
   }
 
+  if (pHalfLoadedTexture->pPooledTexture) {
+    UTexture2D* pTexture = pHalfLoadedTexture->pPooledTexture;
+    pHalfLoadedTexture->pPooledTexture = nullptr;
+    pHalfLoadedTexture->pTexture = pTexture;
+
+    EmbeddedImageSource* pEmbeddedImage =
+        std::get_if<EmbeddedImageSource>(&pHalfLoadedTexture->textureSource);
+    check(pEmbeddedImage != nullptr);
+    UpdateTexture2D(
+        pTexture,
+        std::move(pEmbeddedImage->image),
+        pHalfLoadedTexture->memoryCategory,
+        CesiumTextureMemory::getCurrentOwner());
+    return pTexture;
+  }
+
   UTexture2D* pTexture = CreateTexture2D(pHalfLoadedTexture);
 
   if (std::get_if<LegacyTextureSource>(&pHalfLoadedTexture->textureSource)) {
     pTexture->UpdateResource();
+    pHalfLoadedTexture->legacyMemory = CesiumTextureMemory::Allocation(
+        CesiumTextureMemory::getCurrentOwner(),
+        pHalfLoadedTexture->memoryCategory,
+        static_cast<int64_t>(CalcTextureSize(
+            static_cast<uint32>(pTexture->GetSizeX()),
+            static_cast<uint32>(pTexture->GetSizeY()),
+            pTexture->GetPixelFormat(),
+            static_cast<uint32>(FMath::Max(1, pTexture->GetNumMips())))));
     return pTexture;
   }
 
@@ -946,7 +1269,9 @@ UTexture2D* loadTextureGameThreadPart(LoadedTextureResult* pHalfLoadedTexture) {
       pHalfLoadedTexture->addressX,
       pHalfLoadedTexture->addressY,
       pHalfLoadedTexture->sRGB,
-      pTexture->GetPlatformData()->GetExtData());
+      pTexture->GetPlatformData()->GetExtData(),
+      pHalfLoadedTexture->memoryCategory,
+      CesiumTextureMemory::getCurrentOwner());
 
   pTexture->SetResource(pCesiumTextureResource);
 
@@ -976,6 +1301,33 @@ UTexture2D* loadTextureGameThreadPart(
   return loadTextureGameThreadPart(pHalfLoadedTexture);
 }
 
+int32 setFirstResidentMip(
+    UTexture2D* pTexture,
+    const CesiumGltf::ImageCesium& image,
+    int32 currentFirstMip,
+    int32 firstMip) {
+  FCesiumTextureResource* pResource =
+      static_cast<FCesiumTextureResource*>(pTexture->GetResource());
+  int32 mipCount = static_cast<int32>(image.mipPositions.size());
+  if (!pResource || firstMip < 0 || firstMip >= mipCount) {
+    return -1;
+  }
+
+  firstMip = alignFirstMip(image, pTexture->GetPixelFormat(), firstMip);
+  if (firstMip == currentFirstMip) {
+    return firstMip;
+  }
+
+  CesiumGltf::ImageCesium mips = copyMips(image, firstMip);
+
+  ENQUEUE_RENDER_COMMAND(Cesium_SetFirstResidentMip)
+  ([pResource, mips = std::move(mips)](FRHICommandListImmediate& RHICmdList) {
+    pResource->replaceMips(mips);
+  });
+
+  return firstMip;
+}
+
 void destroyHalfLoadedTexture(LoadedTextureResult& halfLoaded) {
   AsyncCreatedTexture* pAsyncCreatedTexture =
       std::get_if<AsyncCreatedTexture>(&halfLoaded.textureSource);
@@ -995,4 +1347,17 @@ void destroyTexture(UTexture* pTexture) {
   check(pTexture != nullptr);
   CesiumLifetime::destroy(pTexture);
 }
+
+void releaseTextureMemoryOwner(UTexture2D* pTexture) {
+  FCesiumTextureResource* pResource =
+      static_cast<FCesiumTextureResource*>(pTexture->GetResource());
+  if (!pResource) {
+    return;
+  }
+
+  ENQUEUE_RENDER_COMMAND(Cesium_ReleaseTextureMemoryOwner)
+  ([pResource](FRHICommandListImmediate& RHICmdList) {
+    pResource->releaseMemoryOwner();
+  });
+}
 } // namespace CesiumTextureUtility
@@ -4,6 +4,8 @@
 
 #include "CesiumGltf/Model.h"
 #include "CesiumMetadataValueType.h"
+#include "CesiumTextureMemory.h"
+#include "CesiumTexturePool.h"
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
 #include "Engine/TextureDefines.h"
@@ -47,7 +49,10 @@ struct GltfImageIndex {
 };
 
 /**
- * @brief An embedded image resource.
+ * @brief An embedded image resource, owned by the texture source. When
+ * asynchronous texture creation is not available, the RHI texture is created
+ * from it on the render thread, without copying it first, and its pixels are
+ * then freed.
  */
 struct EmbeddedImageSource {
   CesiumGltf::ImageCesium image;
@@ -89,6 +94,48 @@ struct LoadedTextureResult {
   bool sRGB{true};
   TWeakObjectPtr<UTexture2D> pTexture;
   CesiumTextureSource textureSource;
+
+  /**
+   * @brief The key of this texture in the pool it was loaded for, if any.
+   */
+  std::optional<CesiumTexturePool::Key> poolKey;
+
+  /**
+   * @brief A texture taken from the pool, whose contents are to be replaced
+   * by this image rather than creating a new texture.
+   */
+  UTexture2D* pPooledTexture = nullptr;
+
+  /**
+   * @brief The kind of texture this is, for counting texture memory.
+   */
+  CesiumTextureMemory::Category memoryCategory =
+      CesiumTextureMemory::Category::GltfTexture;
+
+  /**
+   * @brief The memory of a texture created from a LegacyTextureSource, which
+   * is counted for as long as this result exists. Other textures are counted
+   * by their texture resource.
+   */
+  CesiumTextureMemory::Allocation legacyMemory;
+
+  /**
+   * @brief Whether the image was compressed before it was uploaded, so that
+   * the texture's mips are not the source image's own.
+   */
+  bool compressedForUpload = false;
+
+  /**
+   * @brief The index of the glTF image whose mips this texture was created
+   * from, so that they can be uploaded again later, or -1 if there is none.
+   */
+  int32_t sourceImageIndex = -1;
+
+  /**
+   * @brief The index of the source image's mip that the texture was created
+   * starting with. The larger mips were left out.
+   */
+  int32 firstResidentMip = 0;
 };
 
 TUniquePtr<FTexturePlatformData>
@@ -100,13 +147,20 @@ createTexturePlatformData(int32 sizeX, int32 sizeY, EPixelFormat format);
  * this image within the given glTF, if needed.
  *
  * @param imageSource The source for this image. This function may add mip-maps
- * to the image if needed.
+ * to the image if needed, and may move the image out of an EmbeddedImageSource.
  * @param addressX The X addressing mode.
  * @param addressY The Y addressing mode.
  * @param filter The sampler filtering to use for this texture.
  * @param group The texture group of this texture.
  * @param generateMipMaps Whether to generate a mipmap for this image.
  * @param sRGB Whether this texture uses a sRGB color space.
+ * @param pPool The pool to reuse a texture from, if any. The texture is
+ * created from, and is later returned to, this pool.
+ * @param projectedPixels The number of pixels that the object using the
+ * texture is expected to span on the screen, or 0 if it is not known. The
+ * texture starts with the mip it needs, as from
+ * CesiumMipResidency::computeWantedFirstMip, rather than with all of the
+ * image's mips.
  * @return The loaded texture.
  */
 TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
@@ -116,7 +170,9 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     const TextureFilter& filter,
     const TextureGroup& group,
     bool generateMipMaps,
-    bool sRGB);
+    bool sRGB,
+    CesiumTexturePool* pPool = nullptr,
+    double projectedPixels = 0.0);
 
 /**
  * @brief Does the asynchronous part of renderer resource preparation for this
@@ -126,17 +182,32 @@ TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
  * @param model The model.
  * @param texture The texture to load.
  * @param sRGB Whether this texture uses a sRGB color space.
+ * @param projectedPixels The number of pixels that the model is expected to
+ * span on the screen, or 0 if it is not known.
  * @return The loaded texture.
  */
 TUniquePtr<LoadedTextureResult> loadTextureAnyThreadPart(
     CesiumGltf::Model& model,
     const CesiumGltf::Texture& texture,
-    bool sRGB);
+    bool sRGB,
+    double projectedPixels = 0.0);
+
+/**
+ * @brief Generates the mip-maps of the images of the glTF's material textures
+ * that are sampled with mip-maps, which loadTextureAnyThreadPart would
+ * otherwise generate while the glTF's meshes are created. This lets the
+ * texture work be done in a task of its own. Should be called in a background
+ * thread.
+ *
+ * @param model The model.
+ */
+void generateMipMapsAnyThreadPart(CesiumGltf::Model& model);
 
 /**
  * @brief Does the main-thread part of render resource preparation for this
  * image and queues up any required render-thread tasks to finish preparing the
- * image.
+ * image. The texture's memory is counted against the owner set by the current
+ * CesiumTextureMemory::OwnerScope, if any.
  *
  * NOTE: Assumes LoadedTextureResult::textureSource is not GltfImageIndex.
  * Use GltfImageIndex::resolve(...) to convert to a GltfImagePtr.
@@ -160,6 +231,37 @@ UTexture2D* loadTextureGameThreadPart(
     const CesiumGltf::Model& model,
     LoadedTextureResult* pHalfLoadedTexture);
 
+/**
+ * @brief Replaces a texture's RHI texture with one that has only the given mip
+ * of the image and the smaller ones, in order to release or restore its upper
+ * mips. The mips are copied, and the RHI texture is replaced on the render
+ * thread. Must be called from the game thread.
+ *
+ * @param pTexture A texture created by loadTextureGameThreadPart from the
+ * image, other than from a LegacyTextureSource.
+ * @param image The image with all of the texture's mips.
+ * @param currentFirstMip The index of the texture's current largest mip. If
+ * it is the mip to become the largest, nothing is done.
+ * @param firstMip The index of the mip to become the texture's largest. If its
+ * size is not a whole number of the texture format's blocks, a larger mip is
+ * used instead.
+ * @return The index of the texture's largest mip from now on, or -1 if the
+ * texture could not be changed.
+ */
+int32 setFirstResidentMip(
+    UTexture2D* pTexture,
+    const CesiumGltf::ImageCesium& image,
+    int32 currentFirstMip,
+    int32 firstMip);
+
 void destroyHalfLoadedTexture(LoadedTextureResult& halfLoaded);
 void destroyTexture(UTexture* pTexture);
+
+/**
+ * @brief Stops counting a texture's memory against the CesiumTextureMemory it
+ * was created for, while still counting it in the total, such as when the
+ * texture is kept in a pool. The texture must have been created by
+ * loadTextureGameThreadPart. Must be called from the game thread.
+ */
+void releaseTextureMemoryOwner(UTexture2D* pTexture);
 } // namespace CesiumTextureUtility
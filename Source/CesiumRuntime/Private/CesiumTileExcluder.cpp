@@ -54,6 +54,9 @@ void UCesiumTileExcluder::AddToTileset() {
       CesiumTile);
   pExcluderAdapter = pAdapter.get();
   excluders.push_back(std::move(pAdapter));
+
+  // An idle tileset must traverse again to apply the new excluder.
+  CesiumTileset->invalidateIdleState();
 }
 
 void UCesiumTileExcluder::RemoveFromTileset() {
@@ -70,6 +73,7 @@ void UCesiumTileExcluder::RemoveFromTileset() {
   auto it = findExistingExcluder(excluders, *pExcluderAdapter);
   if (it != excluders.end()) {
     excluders.erase(it);
+    CesiumTileset->invalidateIdleState();
   }
 
   CesiumLifetime::destroyComponentRecursively(CesiumTile);
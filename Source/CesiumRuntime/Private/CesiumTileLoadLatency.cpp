@@ -0,0 +1,153 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTileLoadLatency.h"
+#include "Cesium3DTileset.h"
+#include "CesiumRuntime.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include <cmath>
+
+namespace {
+
+constexpr double MinimumBucketSeconds = 1.0e-4;
+
+double bucketLowerBound(size_t bucket, size_t bucketsPerDecade) {
+  if (bucket == 0) {
+    return 0.0;
+  }
+  return MinimumBucketSeconds *
+         std::pow(10.0, double(bucket - 1) / double(bucketsPerDecade));
+}
+
+double bucketUpperBound(size_t bucket, size_t bucketsPerDecade) {
+  return MinimumBucketSeconds *
+         std::pow(10.0, double(bucket) / double(bucketsPerDecade));
+}
+
+const TCHAR* getStageName(ECesiumTileLoadStage stage) {
+  switch (stage) {
+  case ECesiumTileLoadStage::Request:
+    return TEXT("Request");
+  case ECesiumTileLoadStage::LoadThread:
+    return TEXT("Load Thread");
+  case ECesiumTileLoadStage::MainThread:
+    return TEXT("Main Thread");
+  case ECesiumTileLoadStage::Total:
+  default:
+    return TEXT("Total");
+  }
+}
+
+void dumpTileLoadLatency(const TArray<FString>& Args, UWorld* pWorld) {
+  if (!pWorld) {
+    return;
+  }
+
+  bool reset = Args.Contains(TEXT("reset"));
+
+  for (TActorIterator<ACesium3DTileset> it(pWorld); it; ++it) {
+    ACesium3DTileset* pTileset = *it;
+
+    FString report = FString::Printf(
+        TEXT("Tile load latency for %s (milliseconds):\n"),
+        *pTileset->GetName());
+    for (uint8 i = 0; i <= uint8(ECesiumTileLoadStage::Total); ++i) {
+      ECesiumTileLoadStage stage = ECesiumTileLoadStage(i);
+      FCesiumTileLoadLatency latency = pTileset->GetTileLoadLatency(stage);
+      report += FString::Printf(
+          TEXT("  %-12s count %8lld  p50 %9.2f  p95 %9.2f  p99 %9.2f  max "
+               "%9.2f\n"),
+          getStageName(stage),
+          latency.Count,
+          latency.P50Seconds * 1000.0,
+          latency.P95Seconds * 1000.0,
+          latency.P99Seconds * 1000.0,
+          latency.MaxSeconds * 1000.0);
+    }
+    UE_LOG(LogCesium, Display, TEXT("%s"), *report);
+
+    if (reset) {
+      pTileset->ResetTileLoadLatency();
+    }
+  }
+}
+
+FAutoConsoleCommandWithWorldAndArgs DumpTileLoadLatencyCommand(
+    TEXT("Cesium.DumpTileLoadLatency"),
+    TEXT("Logs the p50, p95, and p99 tile load latency of each pipeline stage "
+         "for every Cesium3DTileset in the world. Pass \"reset\" to clear the "
+         "measurements afterward."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(
+        &dumpTileLoadLatency));
+
+} // namespace
+
+void CesiumTileLoadLatencyHistograms::record(
+    ECesiumTileLoadStage stage,
+    double seconds) {
+  if (!(seconds >= 0.0)) {
+    return;
+  }
+
+  size_t bucket = 0;
+  if (seconds >= MinimumBucketSeconds) {
+    double position = std::log10(seconds / MinimumBucketSeconds) *
+                      double(BucketsPerDecade);
+    bucket = FMath::Min(size_t(position) + 1, BucketCount - 1);
+  }
+
+  Histogram& histogram = this->_histograms[size_t(stage)];
+  ++histogram.buckets[bucket];
+  ++histogram.count;
+  histogram.max = FMath::Max(histogram.max, seconds);
+}
+
+FCesiumTileLoadLatency
+CesiumTileLoadLatencyHistograms::summarize(ECesiumTileLoadStage stage) const {
+  const Histogram& histogram = this->_histograms[size_t(stage)];
+
+  FCesiumTileLoadLatency result;
+  result.Count = int64(histogram.count);
+  result.MaxSeconds = histogram.max;
+  if (histogram.count == 0) {
+    return result;
+  }
+
+  auto percentile = [&histogram](double fraction) {
+    uint64_t rank = FMath::Max(
+        uint64_t(1),
+        uint64_t(std::ceil(fraction * double(histogram.count))));
+
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < BucketCount; ++bucket) {
+      uint64_t inBucket = histogram.buckets[bucket];
+      if (cumulative + inBucket < rank) {
+        cumulative += inBucket;
+        continue;
+      }
+
+      // Interpolate within the bucket, geometrically for the logarithmic
+      // buckets and linearly for the first one, which starts at zero.
+      double t = double(rank - cumulative) / double(inBucket);
+      double lower = bucketLowerBound(bucket, BucketsPerDecade);
+      double upper = bucketUpperBound(bucket, BucketsPerDecade);
+      double value =
+          bucket == 0 ? upper * t : lower * std::pow(upper / lower, t);
+      return FMath::Min(value, histogram.max);
+    }
+
+    return histogram.max;
+  };
+
+  result.P50Seconds = percentile(0.50);
+  result.P95Seconds = percentile(0.95);
+  result.P99Seconds = percentile(0.99);
+  return result;
+}
+
+void CesiumTileLoadLatencyHistograms::reset() {
+  for (Histogram& histogram : this->_histograms) {
+    histogram = Histogram();
+  }
+}
@@ -5,56 +5,21 @@
 #include "CesiumCommon.h"
 #include "Runtime/Launch/Resources/Version.h"
 
-using namespace Cesium3DTilesSelection;
+using namespace CesiumBoundingVolumeOcclusion;
 
 CesiumViewExtension::CesiumViewExtension(const FAutoRegister& autoRegister)
     : FSceneViewExtensionBase(autoRegister) {}
 
 CesiumViewExtension::~CesiumViewExtension() {}
 
-TileOcclusionState CesiumViewExtension::getPrimitiveOcclusionState(
-    const FPrimitiveComponentId& id,
-    bool previouslyOccluded,
-    float frameTimeCutoff) const {
-  if (_currentOcclusionResults.occlusionResultsByView.size() == 0) {
-    return TileOcclusionState::OcclusionUnavailable;
-  }
-
-  bool isOccluded = false;
-  bool historyMissing = false;
-
-  for (const SceneViewOcclusionResults& viewOcclusionResults :
-       _currentOcclusionResults.occlusionResultsByView) {
-    const PrimitiveOcclusionResult* pOcclusionResult =
-        viewOcclusionResults.PrimitiveOcclusionResults.Find(id);
-
-    if (pOcclusionResult &&
-        pOcclusionResult->LastConsideredTime >= frameTimeCutoff) {
-      if (!pOcclusionResult->OcclusionStateWasDefiniteLastFrame) {
-        return TileOcclusionState::OcclusionUnavailable;
-      }
-
-      if (previouslyOccluded) {
-        if (pOcclusionResult->LastPixelsPercentage > 0.01f) {
-          return TileOcclusionState::NotOccluded;
-        }
-      } else if (!pOcclusionResult->WasOccludedLastFrame) {
-        return TileOcclusionState::NotOccluded;
-      }
-
-      isOccluded = true;
-    } else {
-      historyMissing = true;
-    }
-  }
+const CesiumViewExtension::PrimitiveOcclusionResults*
+CesiumViewExtension::getOcclusionResults(
+    const FPrimitiveComponentId& id) const {
+  return this->_currentOcclusionResults.primitives.Find(id);
+}
 
-  if (historyMissing) {
-    return TileOcclusionState::OcclusionUnavailable;
-  } else if (isOccluded) {
-    return TileOcclusionState::Occluded;
-  } else {
-    return TileOcclusionState::NotOccluded;
-  }
+uint32 CesiumViewExtension::getOcclusionResultsFrameNumber() const {
+  return this->_currentOcclusionResults.frameNumber;
 }
 
 void CesiumViewExtension::SetupViewFamily(FSceneViewFamily& InViewFamily) {}
@@ -69,19 +34,11 @@ void CesiumViewExtension::BeginRenderViewFamily(
     return;
 
   TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::DequeueOcclusionResults)
-  if (!_occlusionResultsQueue.IsEmpty()) {
-    // Recycle the current occlusion results.
-    for (SceneViewOcclusionResults& occlusionResults :
-         _currentOcclusionResults.occlusionResultsByView) {
-      occlusionResults.PrimitiveOcclusionResults.Reset();
-      _recycledOcclusionResultSets.Enqueue(
-          std::move(occlusionResults.PrimitiveOcclusionResults));
-    }
-    _currentOcclusionResults = {};
 
-    // Update occlusion results from the queue.
-    _currentOcclusionResults = std::move(*_occlusionResultsQueue.Peek());
-    _occlusionResultsQueue.Pop();
+  // Update occlusion results from the queue, keeping only the latest.
+  AggregatedOcclusionUpdate update;
+  while (_occlusionResultsQueue.Dequeue(update)) {
+    _currentOcclusionResults = std::move(update);
   }
 }
 
@@ -109,86 +66,96 @@ getOcclusionHistorySet(const FSceneViewState* pViewState) {
 void CesiumViewExtension::PostRenderViewFamily_RenderThread(
     FRHICommandListImmediate& RHICmdList,
     FSceneViewFamily& InViewFamily) {
-  if (!this->_isEnabled)
+  if (!this->_isEnabled) {
     return;
+  }
 
   if (_frameNumber_renderThread != InViewFamily.FrameNumber) {
     TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::EnqueueAggregatedOcclusion)
     if (_frameNumber_renderThread != -1) {
       _occlusionResultsQueue.Enqueue(
           std::move(_currentAggregation_renderThread));
-      _currentAggregation_renderThread = {};
     }
 
+    _currentAggregation_renderThread = {};
+    _currentAggregation_renderThread.frameNumber = InViewFamily.FrameNumber;
     _frameNumber_renderThread = InViewFamily.FrameNumber;
   }
 
   TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::AggregateOcclusionForViewFamily)
+  FScene* pScene = InViewFamily.Scene ? InViewFamily.Scene->GetRenderScene()
+                                      : nullptr;
+  if (pScene == nullptr) {
+    return;
+  }
+
   for (const FSceneView* pView : InViewFamily.Views) {
     if (pView == nullptr || pView->State == nullptr)
       continue;
 
     const FSceneViewState* pViewState = pView->State->GetConcreteViewState();
-    if (pViewState && getOcclusionHistorySet(pViewState).Num()) {
-      SceneViewOcclusionResults& occlusionResults =
-          _currentAggregation_renderThread.occlusionResultsByView
-              .emplace_back();
-      // Do we actually need the view?
-      occlusionResults.pView = pView;
-
-      if (!_recycledOcclusionResultSets.IsEmpty()) {
-        // Recycle a previously allocated occlusion history set, if one is
-        // available.
-        occlusionResults.PrimitiveOcclusionResults =
-            std::move(*_recycledOcclusionResultSets.Peek());
-        _recycledOcclusionResultSets.Pop();
-      } else {
-        // If no previously-allocated set exists, just allocate a new one. It
-        // will be recycled later.
+    if (!pViewState || !getOcclusionHistorySet(pViewState).Num())
+      continue;
+
+    const auto& occlusionHistorySet = getOcclusionHistorySet(pViewState);
+    const FSceneBitArray* pVisibility =
+        pView->bIsViewInfo
+            ? &static_cast<const FViewInfo*>(pView)->PrimitiveVisibilityMap
+            : nullptr;
+
+    // Only the registered bounding volumes are looked up, rather than copying
+    // the occlusion history of every primitive in the scene.
+    for (const auto& registered : this->_registeredPrimitives_renderThread) {
+      // The editor and play-in-editor worlds are rendered from different
+      // scenes, so skip the primitives of other scenes. The scene keeps each
+      // primitive's index current as its primitive arrays are reordered.
+      const FPrimitiveSceneProxy* pProxy = registered.Value;
+      const FPrimitiveSceneInfo* pSceneInfo = pProxy->GetPrimitiveSceneInfo();
+      if (pSceneInfo == nullptr || pSceneInfo->Scene != pScene) {
+        continue;
+      }
+
+      const int32 index = pSceneInfo->GetIndex();
+      if (index == INDEX_NONE) {
+        continue;
       }
 
-      occlusionResults.PrimitiveOcclusionResults.Reserve(
-          getOcclusionHistorySet(pViewState).Num());
-      for (const auto& element : getOcclusionHistorySet(pViewState)) {
-        occlusionResults.PrimitiveOcclusionResults.Emplace(element);
+      int32 queryCount = 1;
+      if (pProxy->HasSubprimitiveOcclusionQueries()) {
+        const TArray<FBoxSphereBounds>* pQueries =
+            pProxy->GetOcclusionQueries(pView);
+        queryCount = pQueries ? pQueries->Num() : 0;
       }
 
-      // Unreal will not execute occlusion queries that get frustum culled in a
-      // particular view, leaving the occlusion results indefinite. And by just
-      // looking at the PrimitiveOcclusionHistorySet, we can't distinguish
+      // Unreal will not execute occlusion queries that get frustum culled in
+      // a particular view, leaving the occlusion results indefinite. And by
+      // just looking at the PrimitiveOcclusionHistorySet, we can't distinguish
       // occlusion queries that haven't completed "yet" from occlusion queries
       // that were culled. So here we detect primitives that have been
       // conclusively proven to be not visible (outside the view frustum) and
       // also mark them definitely occluded.
-      FScene* pScene = InViewFamily.Scene->GetRenderScene();
-      if (pView->bIsViewInfo && pScene != nullptr) {
-        const FViewInfo* pViewInfo = static_cast<const FViewInfo*>(pView);
-        const FSceneBitArray& visibility = pViewInfo->PrimitiveVisibilityMap;
-        auto& occlusion = occlusionResults.PrimitiveOcclusionResults;
-
-        const uint32 PrimitiveCount = pScene->Primitives.Num();
-        for (uint32 i = 0; i < PrimitiveCount; ++i) {
-          // We're only concerned with primitives that are not visible
-          if (visibility[i])
-            continue;
-
-          FPrimitiveSceneInfo* pSceneInfo = pScene->Primitives[i];
-          if (pSceneInfo == nullptr)
-            continue;
-
-          const PrimitiveOcclusionResult* pOcclusionResult =
-              occlusion.Find(pSceneInfo->PrimitiveComponentId);
-          if (!pOcclusionResult || pOcclusionResult->LastConsideredTime <
-                                       pViewState->LastRenderTime) {
-            // No valid occlusion history for this culled primitive, so create
-            // it.
-            occlusion.Emplace(PrimitiveOcclusionResult(
-                pSceneInfo->PrimitiveComponentId,
-                pViewState->LastRenderTime,
-                0.0f,
-                true,
-                true));
-          }
+      const bool isCulled = pVisibility && index < pVisibility->Num() &&
+                            !(*pVisibility)[index];
+
+      std::vector<QueryResult>& results =
+          _currentAggregation_renderThread.primitives
+              .FindOrAdd(registered.Key)
+              .views.emplace_back(size_t(queryCount));
+      for (int32 i = 0; i < queryCount; ++i) {
+        if (isCulled) {
+          results[i] = QueryResult{0.0f, true, true};
+          continue;
+        }
+
+        // Sub-primitive queries have their own history, keyed by their index.
+        const FPrimitiveOcclusionHistory* pHistory = occlusionHistorySet.Find(
+            FPrimitiveOcclusionHistoryKey(registered.Key, i));
+        if (pHistory &&
+            pHistory->LastConsideredTime >= pViewState->LastRenderTime) {
+          results[i] = QueryResult{
+              pHistory->LastPixelsPercentage,
+              pHistory->OcclusionStateWasDefiniteLastFrame,
+              pHistory->WasOccludedLastFrame};
         }
       }
     }
@@ -198,3 +165,22 @@ void CesiumViewExtension::PostRenderViewFamily_RenderThread(
 void CesiumViewExtension::SetEnabled(bool enabled) {
   this->_isEnabled = enabled;
 }
+
+void CesiumViewExtension::registerPrimitive_renderThread(
+    const FPrimitiveSceneProxy* pProxy) {
+  this->_registeredPrimitives_renderThread.Add(
+      pProxy->GetPrimitiveComponentId(),
+      pProxy);
+}
+
+void CesiumViewExtension::unregisterPrimitive_renderThread(
+    const FPrimitiveSceneProxy* pProxy) {
+  // A replacement proxy for the same primitive may have registered already.
+  const FPrimitiveSceneProxy** ppRegistered =
+      this->_registeredPrimitives_renderThread.Find(
+          pProxy->GetPrimitiveComponentId());
+  if (ppRegistered && *ppRegistered == pProxy) {
+    this->_registeredPrimitives_renderThread.Remove(
+        pProxy->GetPrimitiveComponentId());
+  }
+}
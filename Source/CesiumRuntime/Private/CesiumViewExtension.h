@@ -1,76 +1,40 @@
 
 #pragma once
 
+#include "CesiumBoundingVolumeOcclusion.h"
+#include "Containers/Map.h"
 #include "Containers/Queue.h"
-#include "Containers/Set.h"
 #include "Runtime/Renderer/Private/ScenePrivate.h"
 #include "SceneTypes.h"
 #include "SceneView.h"
 #include "SceneViewExtension.h"
-#include <Cesium3DTilesSelection/TileOcclusionRendererProxy.h>
+#include <atomic>
 #include <cstdint>
-#include <unordered_set>
+#include <vector>
 
 class ACesium3DTileset;
 
 class CesiumViewExtension : public FSceneViewExtensionBase {
-private:
-  // Occlusion results for a single view.
-  struct PrimitiveOcclusionResult {
-    PrimitiveOcclusionResult(
-        const FPrimitiveComponentId primitiveId,
-        float lastConsideredTime,
-        float lastPixelsPercentage,
-        bool occlusionStateWasDefiniteLastFrame,
-        bool wasOccludedLastFrame)
-        : PrimitiveId(primitiveId),
-          LastConsideredTime(lastConsideredTime),
-          LastPixelsPercentage(lastPixelsPercentage),
-          OcclusionStateWasDefiniteLastFrame(
-              occlusionStateWasDefiniteLastFrame),
-          WasOccludedLastFrame(wasOccludedLastFrame) {}
-
-    PrimitiveOcclusionResult(const FPrimitiveOcclusionHistory& renderer)
-        : PrimitiveId(renderer.PrimitiveId),
-          LastConsideredTime(renderer.LastConsideredTime),
-          LastPixelsPercentage(renderer.LastPixelsPercentage),
-          OcclusionStateWasDefiniteLastFrame(
-              renderer.OcclusionStateWasDefiniteLastFrame),
-          WasOccludedLastFrame(renderer.WasOccludedLastFrame) {}
-
-    FPrimitiveComponentId PrimitiveId;
-    float LastConsideredTime;
-    float LastPixelsPercentage;
-    bool OcclusionStateWasDefiniteLastFrame;
-    bool WasOccludedLastFrame;
-  };
-
-  // Defines how PrimitiveOcclusionResult is stored in a TSet
-  struct PrimitiveOcclusionResultKeyFuncs
-      : BaseKeyFuncs<PrimitiveOcclusionResult, FPrimitiveComponentId> {
-    typedef FPrimitiveComponentId KeyInitType;
-
-    static KeyInitType GetSetKey(const PrimitiveOcclusionResult& Element) {
-      return Element.PrimitiveId;
-    }
-
-    static bool Matches(KeyInitType A, KeyInitType B) { return A == B; }
-
-    static uint32 GetKeyHash(KeyInitType Key) {
-      return GetTypeHash(Key.PrimIDValue);
-    }
-  };
-
-  // The occlusion results for a single view.
-  struct SceneViewOcclusionResults {
-    const FSceneView* pView = nullptr;
-    TSet<PrimitiveOcclusionResult, PrimitiveOcclusionResultKeyFuncs>
-        PrimitiveOcclusionResults{};
+public:
+  /**
+   * The occlusion results of one registered primitive.
+   */
+  struct PrimitiveOcclusionResults {
+    /**
+     * The results in each view, with one result for each of the primitive's
+     * sub-primitive occlusion queries, in the order of its
+     * FPrimitiveSceneProxy::GetOcclusionQueries.
+     */
+    std::vector<std::vector<CesiumBoundingVolumeOcclusion::QueryResult>>
+        views{};
   };
 
-  // A collection of occlusion results by view.
+private:
+  // The occlusion results of the registered primitives in one frame.
   struct AggregatedOcclusionUpdate {
-    std::vector<SceneViewOcclusionResults> occlusionResultsByView{};
+    // The frame number of the view families the results were read in.
+    uint32 frameNumber = 0;
+    TMap<FPrimitiveComponentId, PrimitiveOcclusionResults> primitives{};
   };
 
   // The current collection of occlusion results for this frame.
@@ -81,28 +45,35 @@ private:
   // thread.
   TQueue<AggregatedOcclusionUpdate, EQueueMode::Spsc> _occlusionResultsQueue;
 
-  // A queue to recycle the previously-allocated occlusion result sets. The
-  // game thread recycles the sets by moving them into the queue and sending
-  // them back to the render thread.
-  TQueue<
-      TSet<PrimitiveOcclusionResult, PrimitiveOcclusionResultKeyFuncs>,
-      EQueueMode::Spsc>
-      _recycledOcclusionResultSets;
-
   // The last known frame number. This is used to determine when an occlusion
   // results aggregation is complete.
   int64_t _frameNumber_renderThread = -1;
 
+  // The registered primitives, which are the only ones whose occlusion is
+  // aggregated, mapped to their scene proxies. A proxy's scene info knows its
+  // scene and its current index in that scene's primitive arrays.
+  TMap<FPrimitiveComponentId, const FPrimitiveSceneProxy*>
+      _registeredPrimitives_renderThread;
+
   std::atomic<bool> _isEnabled = false;
 
 public:
   CesiumViewExtension(const FAutoRegister& autoRegister);
   ~CesiumViewExtension();
 
-  Cesium3DTilesSelection::TileOcclusionState getPrimitiveOcclusionState(
-      const FPrimitiveComponentId& id,
-      bool previouslyOccluded,
-      float frameTimeCutoff) const;
+  /**
+   * Gets the latest occlusion results of a registered primitive, or nullptr
+   * if there are none. Must be called from the game thread.
+   */
+  const PrimitiveOcclusionResults*
+  getOcclusionResults(const FPrimitiveComponentId& id) const;
+
+  /**
+   * Gets the frame number, as in GFrameNumber, of the frame in which the
+   * latest occlusion results were read from the renderer. Must be called from
+   * the game thread.
+   */
+  uint32 getOcclusionResultsFrameNumber() const;
 
   void SetupViewFamily(FSceneViewFamily& InViewFamily) override;
   void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override;
@@ -118,4 +89,19 @@ public:
       FSceneViewFamily& InViewFamily) override;
 
   void SetEnabled(bool enabled);
+
+  /**
+   * Adds a primitive whose occlusion results are needed, once its scene proxy
+   * has been added to a scene. Occlusion results are only aggregated for
+   * registered primitives, so that the cost does not grow with the number of
+   * other primitives in the scene. Must be called from the render thread.
+   */
+  void registerPrimitive_renderThread(const FPrimitiveSceneProxy* pProxy);
+
+  /**
+   * Removes a primitive added with {@link registerPrimitive_renderThread},
+   * before its scene proxy is destroyed. Must be called from the render
+   * thread.
+   */
+  void unregisterPrimitive_renderThread(const FPrimitiveSceneProxy* pProxy);
 };
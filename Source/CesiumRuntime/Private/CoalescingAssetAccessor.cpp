@@ -0,0 +1,166 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CoalescingAssetAccessor.h"
+#include "CesiumStats.h"
+#include "UnrealAssetAccessor.h"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Coalesced Requests"),
+    STAT_CesiumCoalescedRequests,
+    STATGROUP_Cesium);
+
+CoalescingAssetAccessor::CoalescingAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor)
+    : _pAssetAccessor(pAssetAccessor),
+      _pState(std::make_shared<State>()),
+      _coalescedRequests(0) {}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+CoalescingAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  std::string requestGroup;
+  std::string key = createRequestKey(url, headers, requestGroup);
+
+  // Either join the request that is in flight, or register this one, in a
+  // single step, so that two identical requests cannot both be sent.
+  std::optional<InFlight> maybeInFlight;
+  std::optional<CesiumAsync::Promise<Result>> maybePromise;
+  std::optional<CesiumAsync::SharedFuture<Result>> maybeFuture;
+  uint64_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->_pState->mutex);
+    auto it = this->_pState->inFlight.find(key);
+    if (it != this->_pState->inFlight.end()) {
+      maybeInFlight = it->second;
+    } else {
+      CesiumAsync::Promise<Result> promise =
+          asyncSystem.createPromise<Result>();
+      CesiumAsync::SharedFuture<Result> future = promise.getFuture().share();
+      id = ++this->_pState->nextId;
+      this->_pState->inFlight.emplace(key, InFlight{future, requestGroup, id});
+      maybePromise = std::move(promise);
+      maybeFuture = std::move(future);
+    }
+  }
+
+  if (maybeInFlight) {
+    ++this->_coalescedRequests;
+    INC_DWORD_STAT(STAT_CesiumCoalescedRequests);
+
+    bool sameGroup = maybeInFlight->requestGroup == requestGroup;
+    return maybeInFlight->future.thenImmediately(
+        [asyncSystem,
+         pAssetAccessor = this->_pAssetAccessor,
+         url,
+         headers,
+         sameGroup](const Result& result)
+            -> CesiumAsync::Future<
+                std::shared_ptr<CesiumAsync::IAssetRequest>> {
+          if (result.pRequest) {
+            return asyncSystem.createResolvedFuture(
+                std::shared_ptr<CesiumAsync::IAssetRequest>(result.pRequest));
+          }
+          if (!sameGroup) {
+            return pAssetAccessor->get(asyncSystem, url, headers);
+          }
+          return asyncSystem
+              .createFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>(
+                  [&result](const auto& promise) {
+                    promise.reject(std::runtime_error(result.error));
+                  });
+        });
+  }
+
+  // The request is sent without the lock held, because it may complete
+  // immediately.
+  CesiumAsync::Promise<Result> promise = std::move(*maybePromise);
+  this->_pAssetAccessor->get(asyncSystem, url, headers)
+      .thenImmediately(
+          [promise](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+            promise.resolve(Result{std::move(pRequest), std::string()});
+          })
+      .catchImmediately([promise](std::exception&& e) {
+        promise.resolve(Result{nullptr, e.what()});
+      });
+
+  return maybeFuture->thenImmediately(
+      [asyncSystem, pState = this->_pState, key, id](const Result& result)
+          -> CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>> {
+        {
+          std::lock_guard<std::mutex> lock(pState->mutex);
+          auto it = pState->inFlight.find(key);
+          if (it != pState->inFlight.end() && it->second.id == id) {
+            pState->inFlight.erase(it);
+          }
+        }
+
+        if (result.pRequest) {
+          return asyncSystem.createResolvedFuture(
+              std::shared_ptr<CesiumAsync::IAssetRequest>(result.pRequest));
+        }
+        return asyncSystem
+            .createFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>(
+                [&result](const auto& promise) {
+                  promise.reject(std::runtime_error(result.error));
+                });
+      });
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+CoalescingAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  // Only GET requests are coalesced, because other verbs may have side
+  // effects.
+  return this->_pAssetAccessor
+      ->request(asyncSystem, verb, url, headers, contentPayload);
+}
+
+void CoalescingAssetAccessor::tick() noexcept {
+  this->_pAssetAccessor->tick();
+}
+
+uint64_t CoalescingAssetAccessor::getCoalescedRequestCount() const {
+  return this->_coalescedRequests;
+}
+
+/*static*/ std::string CoalescingAssetAccessor::createRequestKey(
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    std::string& requestGroup) {
+  std::vector<const CesiumAsync::IAssetAccessor::THeader*> sortedHeaders;
+  sortedHeaders.reserve(headers.size());
+  for (const CesiumAsync::IAssetAccessor::THeader& header : headers) {
+    if (header.first == UnrealAssetAccessor::RequestGroupHeaderName) {
+      requestGroup = header.second;
+    } else {
+      sortedHeaders.push_back(&header);
+    }
+  }
+
+  std::sort(
+      sortedHeaders.begin(),
+      sortedHeaders.end(),
+      [](const CesiumAsync::IAssetAccessor::THeader* pLeft,
+         const CesiumAsync::IAssetAccessor::THeader* pRight) {
+        return *pLeft < *pRight;
+      });
+
+  std::string key = url;
+  for (const CesiumAsync::IAssetAccessor::THeader* pHeader : sortedHeaders) {
+    key += '\n';
+    key += pHeader->first;
+    key += ':';
+    key += pHeader->second;
+  }
+  return key;
+}
+
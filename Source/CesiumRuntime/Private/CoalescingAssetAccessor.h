@@ -0,0 +1,95 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/SharedFuture.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An IAssetAccessor that coalesces concurrent GET requests for the same URL
+ * and headers, so that they share a single request to the accessor it wraps
+ * and a single response.
+ *
+ * A request made while an identical one is in flight waits for that one
+ * instead. The request group pseudo-header of {@link UnrealAssetAccessor} is
+ * not considered when comparing headers, so different tilesets can share a
+ * request. If the shared request fails and was made in a different request
+ * group, for example because that group was canceled when its tileset was
+ * destroyed, the waiting request is made again in its own group.
+ */
+class CoalescingAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  CoalescingAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor);
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+  /**
+   * Gets the number of requests that have been served by a request that was
+   * already in flight, rather than being sent themselves.
+   */
+  uint64_t getCoalescedRequestCount() const;
+
+  /**
+   * Creates the key that identifies identical requests: the URL followed by
+   * the sorted headers, without the request group pseudo-header of
+   * {@link UnrealAssetAccessor}.
+   *
+   * @param requestGroup Set to the value of the request group pseudo-header,
+   * if the request has one.
+   */
+  static std::string createRequestKey(
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      std::string& requestGroup);
+
+private:
+  struct Result {
+    std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+    std::string error;
+  };
+
+  struct InFlight {
+    CesiumAsync::SharedFuture<Result> future;
+    std::string requestGroup;
+
+    // Identifies this request, so that a completed request does not remove a
+    // newer request with the same key.
+    uint64_t id;
+  };
+
+  // Shared with the continuations that remove completed requests, which may
+  // run after this accessor is destroyed.
+  struct State {
+    std::mutex mutex;
+    std::unordered_map<std::string, InFlight> inFlight;
+    uint64_t nextId = 0;
+  };
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+  std::shared_ptr<State> _pState;
+  std::atomic<uint64_t> _coalescedRequests;
+};
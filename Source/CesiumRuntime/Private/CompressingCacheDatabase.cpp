@@ -0,0 +1,233 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CompressingCacheDatabase.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumRuntime.h"
+#include "CesiumStats.h"
+#include "Misc/Compression.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Disk Cache Hits"),
+    STAT_CesiumCacheHits,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Disk Cache Misses"),
+    STAT_CesiumCacheMisses,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Disk Cache Hit Rate (%)"),
+    STAT_CesiumCacheHitRate,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Cache Compression Ratio"),
+    STAT_CesiumCacheCompressionRatio,
+    STATGROUP_Cesium);
+
+const std::string CompressingCacheDatabase::EncodingHeaderName =
+    "X-Cesium-Unreal-Cache-Encoding";
+const std::string CompressingCacheDatabase::SizeHeaderName =
+    "X-Cesium-Unreal-Cache-Size";
+
+namespace {
+
+// Bodies smaller than this are not worth compressing.
+constexpr size_t MinimumCompressedSize = 512;
+
+// A compressed body is only stored if it saves at least this fraction of the
+// uncompressed size.
+constexpr double MinimumSavings = 0.125;
+
+std::string getEncoding(FName format) {
+  if (format == NAME_LZ4) {
+    return "lz4";
+  }
+  if (format == NAME_Zlib) {
+    return "zlib";
+  }
+  if (format == NAME_Gzip) {
+    return "gzip";
+  }
+  return std::string();
+}
+
+FName getFormat(const std::string& encoding) {
+  if (encoding == "lz4") {
+    return NAME_LZ4;
+  }
+  if (encoding == "zlib") {
+    return NAME_Zlib;
+  }
+  if (encoding == "gzip") {
+    return NAME_Gzip;
+  }
+  return NAME_None;
+}
+
+double getRatio(int64_t numerator, int64_t denominator) {
+  return denominator > 0 ? double(numerator) / double(denominator) : 0.0;
+}
+
+} // namespace
+
+CompressingCacheDatabase::CompressingCacheDatabase(
+    const std::shared_ptr<CesiumAsync::ICacheDatabase>& pDatabase,
+    FName format)
+    : _pDatabase(pDatabase),
+      _format(getEncoding(format).empty() ? NAME_None : format),
+      _hits(0),
+      _misses(0),
+      _uncompressedBytesStored(0),
+      _compressedBytesStored(0) {}
+
+std::optional<CesiumAsync::CacheItem>
+CompressingCacheDatabase::getEntry(const std::string& key) const {
+  std::optional<CesiumAsync::CacheItem> maybeItem =
+      this->_pDatabase->getEntry(key);
+
+  if (maybeItem) {
+    CesiumAsync::CacheResponse& response = maybeItem->cacheResponse;
+    auto encodingIt = response.headers.find(EncodingHeaderName);
+    if (encodingIt != response.headers.end()) {
+      FName format = getFormat(encodingIt->second);
+
+      int64_t size = -1;
+      auto sizeIt = response.headers.find(SizeHeaderName);
+      if (sizeIt != response.headers.end()) {
+        size = std::strtoll(sizeIt->second.c_str(), nullptr, 10);
+      }
+
+      std::vector<std::byte> data;
+      bool success = format != NAME_None && size >= 0 && size <= MAX_int32 &&
+                     response.data.size() <= size_t(MAX_int32);
+      if (success) {
+        data.resize(size_t(size));
+        success = FCompression::UncompressMemory(
+            format,
+            data.data(),
+            int32(size),
+            response.data.data(),
+            int32(response.data.size()));
+      }
+
+      if (success) {
+        response.data = std::move(data);
+        response.headers.erase(EncodingHeaderName);
+        response.headers.erase(SizeHeaderName);
+      } else {
+        // Treat an entry that cannot be decompressed as missing, so that the
+        // response is requested again and the entry replaced.
+        UE_LOG(
+            LogCesium,
+            Warning,
+            TEXT("Could not decompress cached response for %s"),
+            UTF8_TO_TCHAR(maybeItem->cacheRequest.url.c_str()));
+        maybeItem.reset();
+      }
+    }
+  }
+
+  if (maybeItem) {
+    ++this->_hits;
+    INC_DWORD_STAT(STAT_CesiumCacheHits);
+  } else {
+    ++this->_misses;
+    INC_DWORD_STAT(STAT_CesiumCacheMisses);
+  }
+  int64_t hits = this->_hits;
+  int64_t misses = this->_misses;
+  SET_FLOAT_STAT(
+      STAT_CesiumCacheHitRate,
+      100.0 * getRatio(hits, hits + misses));
+
+  return maybeItem;
+}
+
+bool CompressingCacheDatabase::storeEntry(
+    const std::string& key,
+    std::time_t expiryTime,
+    const std::string& url,
+    const std::string& requestMethod,
+    const CesiumAsync::HttpHeaders& requestHeaders,
+    uint16_t statusCode,
+    const CesiumAsync::HttpHeaders& responseHeaders,
+    const gsl::span<const std::byte>& responseData) {
+  int64_t uncompressedSize = int64_t(responseData.size());
+
+  std::vector<std::byte> compressed;
+  bool compress = this->_format != NAME_None &&
+                  responseData.size() >= MinimumCompressedSize &&
+                  responseData.size() <= size_t(MAX_int32);
+  if (compress) {
+    int32 compressedSize = FCompression::CompressMemoryBound(
+        this->_format,
+        int32(responseData.size()));
+    compressed.resize(size_t(compressedSize));
+    compress = FCompression::CompressMemory(
+                   this->_format,
+                   compressed.data(),
+                   compressedSize,
+                   responseData.data(),
+                   int32(responseData.size())) &&
+               double(compressedSize) <=
+                   double(responseData.size()) * (1.0 - MinimumSavings);
+    compressed.resize(size_t(compressedSize));
+  }
+
+  bool stored;
+  int64_t storedSize;
+  if (compress) {
+    CesiumAsync::HttpHeaders headers = responseHeaders;
+    headers[EncodingHeaderName] = getEncoding(this->_format);
+    headers[SizeHeaderName] = std::to_string(uncompressedSize);
+    storedSize = int64_t(compressed.size());
+    stored = this->_pDatabase->storeEntry(
+        key,
+        expiryTime,
+        url,
+        requestMethod,
+        requestHeaders,
+        statusCode,
+        headers,
+        gsl::span<const std::byte>(compressed.data(), compressed.size()));
+  } else {
+    storedSize = uncompressedSize;
+    stored = this->_pDatabase->storeEntry(
+        key,
+        expiryTime,
+        url,
+        requestMethod,
+        requestHeaders,
+        statusCode,
+        responseHeaders,
+        responseData);
+  }
+
+  if (stored) {
+    int64_t totalUncompressed =
+        this->_uncompressedBytesStored += uncompressedSize;
+    int64_t totalCompressed = this->_compressedBytesStored += storedSize;
+    SET_FLOAT_STAT(
+        STAT_CesiumCacheCompressionRatio,
+        getRatio(totalUncompressed, totalCompressed));
+  }
+
+  return stored;
+}
+
+bool CompressingCacheDatabase::prune() { return this->_pDatabase->prune(); }
+
+bool CompressingCacheDatabase::clearAll() {
+  return this->_pDatabase->clearAll();
+}
+
+CompressingCacheDatabase::Statistics
+CompressingCacheDatabase::getStatistics() const {
+  return Statistics{
+      this->_hits.load(),
+      this->_misses.load(),
+      this->_uncompressedBytesStored.load(),
+      this->_compressedBytesStored.load()};
+}
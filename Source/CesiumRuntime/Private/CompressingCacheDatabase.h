@@ -0,0 +1,93 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/ICacheDatabase.h"
+#include "UObject/NameTypes.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * An ICacheDatabase that compresses response bodies before storing them in
+ * the wrapped database, and decompresses them when they are read.
+ *
+ * The compression format of each entry is recorded in a pseudo-header of the
+ * stored response, which is removed again when the entry is read, so entries
+ * stored with any format, or without compression, can always be read back.
+ * Bodies that are small or that do not compress well, such as images, are
+ * stored as they are.
+ *
+ * The CachingAssetAccessor reads and writes the cache in worker threads, so
+ * compression does not happen in the game thread.
+ */
+class CompressingCacheDatabase : public CesiumAsync::ICacheDatabase {
+public:
+  /**
+   * The name of the pseudo-header that records the compression format of a
+   * stored response.
+   */
+  static const std::string EncodingHeaderName;
+
+  /**
+   * The name of the pseudo-header that records the uncompressed size of a
+   * stored response.
+   */
+  static const std::string SizeHeaderName;
+
+  /**
+   * Counts of the cache's activity since it was created. The hits and misses
+   * count only the lookups that reach this database. Requests served by the
+   * in-memory cache in front of it are counted by the
+   * MemoryCacheAssetAccessor instead.
+   */
+  struct Statistics {
+    int64_t hits;
+    int64_t misses;
+    int64_t uncompressedBytesStored;
+    int64_t compressedBytesStored;
+  };
+
+  /**
+   * Creates a database that compresses entries in the given one.
+   *
+   * @param pDatabase The database to wrap.
+   * @param format The compression format to use for new entries, such as
+   * NAME_LZ4 or NAME_Zlib, or NAME_None to store new entries uncompressed.
+   */
+  CompressingCacheDatabase(
+      const std::shared_ptr<CesiumAsync::ICacheDatabase>& pDatabase,
+      FName format);
+
+  virtual std::optional<CesiumAsync::CacheItem>
+  getEntry(const std::string& key) const override;
+
+  virtual bool storeEntry(
+      const std::string& key,
+      std::time_t expiryTime,
+      const std::string& url,
+      const std::string& requestMethod,
+      const CesiumAsync::HttpHeaders& requestHeaders,
+      uint16_t statusCode,
+      const CesiumAsync::HttpHeaders& responseHeaders,
+      const gsl::span<const std::byte>& responseData) override;
+
+  virtual bool prune() override;
+
+  virtual bool clearAll() override;
+
+  /**
+   * Gets the number of cache hits and misses, and the size of the response
+   * bodies stored before and after compression.
+   */
+  Statistics getStatistics() const;
+
+private:
+  std::shared_ptr<CesiumAsync::ICacheDatabase> _pDatabase;
+  FName _format;
+
+  mutable std::atomic<int64_t> _hits;
+  mutable std::atomic<int64_t> _misses;
+  std::atomic<int64_t> _uncompressedBytesStored;
+  std::atomic<int64_t> _compressedBytesStored;
+};
@@ -8,6 +8,7 @@
 #include "CesiumGltf/Model.h"
 #include "CesiumGltf/Node.h"
 #include "LoadGltfResult.h"
+#include "TileLoadCancellation.h"
 
 // TODO: internal documentation
 namespace CreateGltfOptions {
@@ -24,6 +25,12 @@ struct CreateModelOptions {
   bool alwaysIncludeTangents = false;
   bool createPhysicsMeshes = true;
   bool ignoreKhrMaterialsUnlit = false;
+
+  /**
+   * Checked between the stages of creating the model, which stops early if the
+   * model is no longer wanted. May be nullptr.
+   */
+  TileLoadCancellation::Check* pCancellationCheck = nullptr;
 };
 
 struct CreateNodeOptions {
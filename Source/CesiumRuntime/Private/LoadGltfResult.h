@@ -167,5 +167,9 @@ struct LoadModelResult {
   // For backwards compatibility with CesiumEncodedMetadataComponent.
   std::optional<CesiumEncodedMetadataUtility::EncodedMetadata>
       EncodedMetadata_DEPRECATED{};
+
+  // The number of pixels the model was expected to span on the screen when it
+  // was loaded, or 0 if unknown. Its textures start with the mips it needs.
+  double projectedPixels = 0.0;
 };
 } // namespace LoadGltfResult
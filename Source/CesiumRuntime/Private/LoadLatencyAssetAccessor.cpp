@@ -0,0 +1,115 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "LoadLatencyAssetAccessor.h"
+#include "HAL/PlatformTime.h"
+#include <cstdlib>
+
+namespace {
+
+bool readTime(
+    const CesiumAsync::HttpHeaders& headers,
+    const std::string& name,
+    double& time) {
+  auto it = headers.find(name);
+  if (it == headers.end()) {
+    return false;
+  }
+
+  char* pEnd = nullptr;
+  time = std::strtod(it->second.c_str(), &pEnd);
+  return pEnd != it->second.c_str();
+}
+
+} // namespace
+
+const std::string LoadLatencyAssetRequest::IssuedTimeHeaderName =
+    "X-Cesium-Unreal-Issued-Time";
+const std::string LoadLatencyAssetRequest::ReceivedTimeHeaderName =
+    "X-Cesium-Unreal-Received-Time";
+
+LoadLatencyAssetRequest::LoadLatencyAssetRequest(
+    std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest,
+    double issuedTime,
+    double receivedTime)
+    : _pRequest(std::move(pRequest)), _headers(this->_pRequest->headers()) {
+  this->_headers[IssuedTimeHeaderName] = std::to_string(issuedTime);
+  this->_headers[ReceivedTimeHeaderName] = std::to_string(receivedTime);
+}
+
+/*static*/ bool LoadLatencyAssetRequest::getTimes(
+    const CesiumAsync::IAssetRequest& request,
+    double& issuedTime,
+    double& receivedTime) {
+  const CesiumAsync::HttpHeaders& headers = request.headers();
+  double issued = 0.0;
+  double received = 0.0;
+  if (!readTime(headers, IssuedTimeHeaderName, issued) ||
+      !readTime(headers, ReceivedTimeHeaderName, received)) {
+    return false;
+  }
+
+  issuedTime = issued;
+  receivedTime = received;
+  return true;
+}
+
+const std::string& LoadLatencyAssetRequest::method() const {
+  return this->_pRequest->method();
+}
+
+const std::string& LoadLatencyAssetRequest::url() const {
+  return this->_pRequest->url();
+}
+
+const CesiumAsync::HttpHeaders& LoadLatencyAssetRequest::headers() const {
+  return this->_headers;
+}
+
+const CesiumAsync::IAssetResponse* LoadLatencyAssetRequest::response() const {
+  return this->_pRequest->response();
+}
+
+LoadLatencyAssetAccessor::LoadLatencyAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor)
+    : _pAssetAccessor(pAssetAccessor) {}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+LoadLatencyAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  double issuedTime = FPlatformTime::Seconds();
+  return this->_pAssetAccessor->get(asyncSystem, url, headers)
+      .thenImmediately(
+          [issuedTime](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest)
+              -> std::shared_ptr<CesiumAsync::IAssetRequest> {
+            return std::make_shared<LoadLatencyAssetRequest>(
+                std::move(pRequest),
+                issuedTime,
+                FPlatformTime::Seconds());
+          });
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+LoadLatencyAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  double issuedTime = FPlatformTime::Seconds();
+  return this->_pAssetAccessor
+      ->request(asyncSystem, verb, url, headers, contentPayload)
+      .thenImmediately(
+          [issuedTime](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest)
+              -> std::shared_ptr<CesiumAsync::IAssetRequest> {
+            return std::make_shared<LoadLatencyAssetRequest>(
+                std::move(pRequest),
+                issuedTime,
+                FPlatformTime::Seconds());
+          });
+}
+
+void LoadLatencyAssetAccessor::tick() noexcept {
+  this->_pAssetAccessor->tick();
+}
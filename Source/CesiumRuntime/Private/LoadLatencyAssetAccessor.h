@@ -0,0 +1,92 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include <memory>
+#include <string>
+
+/**
+ * An IAssetRequest that records when it was issued and when its response was
+ * received. It is created by {@link LoadLatencyAssetAccessor} and forwards
+ * everything else to the request it wraps.
+ *
+ * The times are added to the request's headers as pseudo-headers, so that
+ * they can be read from any request without knowing its type, as the module is
+ * compiled without RTTI. Use {@link getTimes} to read them.
+ */
+class LoadLatencyAssetRequest : public CesiumAsync::IAssetRequest {
+public:
+  /**
+   * The name of the pseudo-header holding the time, in
+   * FPlatformTime::Seconds, when the request was issued.
+   */
+  static const std::string IssuedTimeHeaderName;
+
+  /**
+   * The name of the pseudo-header holding the time, in
+   * FPlatformTime::Seconds, when the response was received.
+   */
+  static const std::string ReceivedTimeHeaderName;
+
+  LoadLatencyAssetRequest(
+      std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest,
+      double issuedTime,
+      double receivedTime);
+
+  /**
+   * Reads the times recorded for a request made through a
+   * {@link LoadLatencyAssetAccessor}.
+   *
+   * @param request The request.
+   * @param issuedTime Receives the time when the request was issued.
+   * @param receivedTime Receives the time when its response was received.
+   * @return Whether the request has recorded times.
+   */
+  static bool getTimes(
+      const CesiumAsync::IAssetRequest& request,
+      double& issuedTime,
+      double& receivedTime);
+
+  virtual const std::string& method() const override;
+  virtual const std::string& url() const override;
+  virtual const CesiumAsync::HttpHeaders& headers() const override;
+  virtual const CesiumAsync::IAssetResponse* response() const override;
+
+private:
+  std::shared_ptr<CesiumAsync::IAssetRequest> _pRequest;
+  CesiumAsync::HttpHeaders _headers;
+};
+
+/**
+ * An IAssetAccessor that wraps each completed request in a
+ * {@link LoadLatencyAssetRequest}, so that the tileset can attribute the time
+ * spent waiting for tile content to the request stage of its load latency
+ * statistics.
+ */
+class LoadLatencyAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  LoadLatencyAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor);
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+private:
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+};
@@ -0,0 +1,315 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "MemoryCacheAssetAccessor.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumStats.h"
+#include "CoalescingAssetAccessor.h"
+#include "Misc/DateTime.h"
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Memory Cache Hits"),
+    STAT_CesiumMemoryCacheHits,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Memory Cache Misses"),
+    STAT_CesiumMemoryCacheMisses,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Memory Cache Hit Rate (%)"),
+    STAT_CesiumMemoryCacheHitRate,
+    STATGROUP_Cesium);
+DECLARE_MEMORY_STAT(
+    TEXT("Memory Cache Size"),
+    STAT_CesiumMemoryCacheSize,
+    STATGROUP_Cesium);
+
+namespace {
+
+// An estimate of the memory used by each entry in addition to its content.
+constexpr int64_t EntryOverheadBytes = 256;
+
+const char fileProtocol[] = "file:///";
+
+bool isFile(const std::string& url) {
+  return url.compare(0, sizeof(fileProtocol) - 1, fileProtocol) == 0;
+}
+
+void updateHitRate(uint64_t hits, uint64_t misses) {
+  SET_FLOAT_STAT(
+      STAT_CesiumMemoryCacheHitRate,
+      hits + misses > 0 ? 100.0 * double(hits) / double(hits + misses) : 0.0);
+}
+
+/**
+ * @brief Gets the time at which a response expires, or nothing if it must not
+ * be kept.
+ *
+ * These are the rules the CachingAssetAccessor uses for the disk cache: the
+ * response must be successful, must not forbid caching or require
+ * revalidation, and must have a lifetime given by `max-age` or, failing that,
+ * by `Expires`.
+ */
+std::optional<std::time_t>
+getExpiryTime(const CesiumAsync::IAssetRequest& request, std::time_t now) {
+  const CesiumAsync::IAssetResponse* pResponse = request.response();
+  if (!pResponse || pResponse->statusCode() < 200 ||
+      pResponse->statusCode() >= 300) {
+    return std::nullopt;
+  }
+
+  const CesiumAsync::HttpHeaders& headers = pResponse->headers();
+  auto cacheControlIt = headers.find("Cache-Control");
+  if (cacheControlIt != headers.end()) {
+    const std::string& cacheControl = cacheControlIt->second;
+    if (cacheControl.find("no-store") != std::string::npos ||
+        cacheControl.find("no-cache") != std::string::npos ||
+        cacheControl.find("must-revalidate") != std::string::npos) {
+      return std::nullopt;
+    }
+
+    const char maxAge[] = "max-age=";
+    size_t maxAgePos = cacheControl.find(maxAge);
+    if (maxAgePos != std::string::npos) {
+      long seconds = std::strtol(
+          cacheControl.c_str() + maxAgePos + sizeof(maxAge) - 1,
+          nullptr,
+          10);
+      if (seconds <= 0) {
+        return std::nullopt;
+      }
+      return now + std::time_t(seconds);
+    }
+  }
+
+  auto expiresIt = headers.find("Expires");
+  FDateTime expires;
+  if (expiresIt == headers.end() ||
+      !FDateTime::ParseHttpDate(
+          UTF8_TO_TCHAR(expiresIt->second.c_str()),
+          expires) ||
+      expires.ToUnixTimestamp() <= now) {
+    return std::nullopt;
+  }
+  return std::time_t(expires.ToUnixTimestamp());
+}
+
+/**
+ * @brief A copy of a response that is kept in memory.
+ */
+class CachedAssetResponse : public CesiumAsync::IAssetResponse {
+public:
+  explicit CachedAssetResponse(const CesiumAsync::IAssetResponse& response)
+      : _statusCode(response.statusCode()),
+        _contentType(response.contentType()),
+        _headers(response.headers()),
+        _data(response.data().begin(), response.data().end()) {}
+
+  virtual uint16_t statusCode() const override { return this->_statusCode; }
+  virtual std::string contentType() const override {
+    return this->_contentType;
+  }
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+  virtual gsl::span<const std::byte> data() const override {
+    return this->_data;
+  }
+
+private:
+  uint16_t _statusCode;
+  std::string _contentType;
+  CesiumAsync::HttpHeaders _headers;
+  std::vector<std::byte> _data;
+};
+
+/**
+ * @brief A copy of a request and its response that is kept in memory.
+ */
+class CachedAssetRequest : public CesiumAsync::IAssetRequest {
+public:
+  explicit CachedAssetRequest(const CesiumAsync::IAssetRequest& request)
+      : _method(request.method()),
+        _url(request.url()),
+        _headers(request.headers()),
+        _response(*request.response()) {}
+
+  virtual const std::string& method() const override { return this->_method; }
+  virtual const std::string& url() const override { return this->_url; }
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+  virtual const CesiumAsync::IAssetResponse* response() const override {
+    return &this->_response;
+  }
+
+private:
+  std::string _method;
+  std::string _url;
+  CesiumAsync::HttpHeaders _headers;
+  CachedAssetResponse _response;
+};
+
+int64_t getHeadersSize(const CesiumAsync::HttpHeaders& headers) {
+  int64_t size = 0;
+  for (const auto& header : headers) {
+    size += int64_t(header.first.size() + header.second.size());
+  }
+  return size;
+}
+
+} // namespace
+
+MemoryCacheAssetAccessor::MemoryCacheAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+    int64_t maximumBytes)
+    : _pAssetAccessor(pAssetAccessor),
+      _pState(std::make_shared<State>(maximumBytes)) {}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+MemoryCacheAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  if (this->_pState->maximumBytes <= 0 || isFile(url)) {
+    return this->_pAssetAccessor->get(asyncSystem, url, headers);
+  }
+
+  std::string requestGroup;
+  std::string key =
+      CoalescingAssetAccessor::createRequestKey(url, headers, requestGroup);
+
+  std::shared_ptr<CesiumAsync::IAssetRequest> pCached;
+  {
+    std::lock_guard<std::mutex> lock(this->_pState->mutex);
+    auto it = this->_pState->index.find(key);
+    if (it != this->_pState->index.end()) {
+      if (it->second->expiryTime <= std::time(nullptr)) {
+        // An expired response is a miss, and is replaced when the new
+        // response arrives.
+        this->_pState->totalBytes -= it->second->size;
+        this->_pState->entries.erase(it->second);
+        this->_pState->index.erase(it);
+        SET_MEMORY_STAT(
+            STAT_CesiumMemoryCacheSize,
+            this->_pState->totalBytes);
+      } else {
+        this->_pState->entries.splice(
+            this->_pState->entries.begin(),
+            this->_pState->entries,
+            it->second);
+        pCached = it->second->pRequest;
+      }
+    }
+  }
+
+  if (pCached) {
+    ++this->_pState->hits;
+    INC_DWORD_STAT(STAT_CesiumMemoryCacheHits);
+    updateHitRate(this->_pState->hits, this->_pState->misses);
+    return asyncSystem.createResolvedFuture(std::move(pCached));
+  }
+
+  ++this->_pState->misses;
+  INC_DWORD_STAT(STAT_CesiumMemoryCacheMisses);
+  updateHitRate(this->_pState->hits, this->_pState->misses);
+
+  return this->_pAssetAccessor->get(asyncSystem, url, headers)
+      .thenImmediately(
+          [pState = this->_pState, key = std::move(key)](
+              std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+            if (pRequest) {
+              std::optional<std::time_t> expiryTime =
+                  getExpiryTime(*pRequest, std::time(nullptr));
+              if (expiryTime) {
+                pState->add(key, *pRequest, *expiryTime);
+              }
+            }
+            return std::move(pRequest);
+          });
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+MemoryCacheAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  // Only GET requests are cached, because other verbs may have side effects.
+  return this->_pAssetAccessor
+      ->request(asyncSystem, verb, url, headers, contentPayload);
+}
+
+void MemoryCacheAssetAccessor::tick() noexcept {
+  this->_pAssetAccessor->tick();
+}
+
+void MemoryCacheAssetAccessor::clear() {
+  std::lock_guard<std::mutex> lock(this->_pState->mutex);
+  this->_pState->entries.clear();
+  this->_pState->index.clear();
+  this->_pState->totalBytes = 0;
+  SET_MEMORY_STAT(STAT_CesiumMemoryCacheSize, 0);
+}
+
+int64_t MemoryCacheAssetAccessor::getSizeBytes() const {
+  std::lock_guard<std::mutex> lock(this->_pState->mutex);
+  return this->_pState->totalBytes;
+}
+
+MemoryCacheAssetAccessor::State::State(int64_t maximumBytes_)
+    : maximumBytes(maximumBytes_),
+      mutex(),
+      entries(),
+      index(),
+      totalBytes(0),
+      hits(0),
+      misses(0) {}
+
+void MemoryCacheAssetAccessor::State::add(
+    const std::string& key,
+    const CesiumAsync::IAssetRequest& request,
+    std::time_t expiryTime) {
+  const CesiumAsync::IAssetResponse& response = *request.response();
+  int64_t size = int64_t(response.data().size()) +
+                 getHeadersSize(response.headers()) +
+                 getHeadersSize(request.headers()) +
+                 int64_t(request.url().size() + key.size()) +
+                 EntryOverheadBytes;
+
+  // A single large response should not displace many small ones.
+  if (size > this->maximumBytes / 4) {
+    return;
+  }
+
+  // Copy the response so that the entry does not keep the request it came
+  // from alive, which may hold more than the response body, such as the
+  // compressed body of a gzipped response.
+  std::shared_ptr<CesiumAsync::IAssetRequest> pCopy =
+      std::make_shared<CachedAssetRequest>(request);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->index.find(key);
+  if (it != this->index.end()) {
+    this->totalBytes -= it->second->size;
+    this->entries.erase(it->second);
+    this->index.erase(it);
+  }
+
+  this->entries.push_front(Entry{key, std::move(pCopy), size, expiryTime});
+  this->index.emplace(key, this->entries.begin());
+  this->totalBytes += size;
+
+  while (this->totalBytes > this->maximumBytes && !this->entries.empty()) {
+    const Entry& oldest = this->entries.back();
+    this->totalBytes -= oldest.size;
+    this->index.erase(oldest.key);
+    this->entries.pop_back();
+  }
+
+  SET_MEMORY_STAT(STAT_CesiumMemoryCacheSize, this->totalBytes);
+}
@@ -0,0 +1,116 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * An IAssetAccessor that keeps the most recently received responses in memory,
+ * up to a total size in bytes, and serves repeated GET requests for them
+ * without going through the accessor it wraps.
+ *
+ * It is shared by all tilesets and sits in front of the disk cache, so tiles
+ * that were unloaded moments ago, for example when the camera moves back and
+ * forth across a boundary, are loaded again without a database query or a copy
+ * of their content. Each response is copied once when it is kept, so that it
+ * no longer holds on to the request it came from, such as a still-compressed
+ * body, and is then shared, not copied, between the requests it serves.
+ *
+ * Responses are kept by the same rules as the disk cache's
+ * CachingAssetAccessor: only successful responses with a `max-age` or an
+ * `Expires` header, and not those that forbid caching or require
+ * revalidation. A response that has expired is requested again. Responses
+ * from `file:///` URLs are not kept, because they are already cheap to read.
+ */
+class MemoryCacheAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  /**
+   * Creates an accessor.
+   *
+   * @param pAssetAccessor The accessor to wrap.
+   * @param maximumBytes The total size of the responses to keep, in bytes.
+   * Responses larger than a quarter of this are not kept.
+   */
+  MemoryCacheAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+      int64_t maximumBytes);
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+  /**
+   * Discards all responses kept in memory.
+   */
+  void clear();
+
+  /**
+   * Gets the total size of the responses kept in memory, in bytes.
+   */
+  int64_t getSizeBytes() const;
+
+  /**
+   * Gets the number of requests served from memory.
+   */
+  uint64_t getHitCount() const { return this->_pState->hits; }
+
+  /**
+   * Gets the number of GET requests passed to the wrapped accessor.
+   */
+  uint64_t getMissCount() const { return this->_pState->misses; }
+
+private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+    int64_t size;
+    std::time_t expiryTime;
+  };
+
+  // Shared with the continuations that store responses, which may run after
+  // this accessor is destroyed.
+  struct State {
+    explicit State(int64_t maximumBytes);
+
+    void add(
+        const std::string& key,
+        const CesiumAsync::IAssetRequest& request,
+        std::time_t expiryTime);
+
+    const int64_t maximumBytes;
+
+    std::mutex mutex;
+    // Ordered from the most to the least recently used.
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    int64_t totalBytes;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+  };
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+  std::shared_ptr<State> _pState;
+};
@@ -0,0 +1,330 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "PrioritizedRequestQueue.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+double steadyClockSeconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+PrioritizedRequestQueue::PrioritizedRequestQueue(
+    int32_t maximumActiveRequests,
+    int32_t maximumActiveRequestsPerHost,
+    Clock&& clock)
+    : _mutex(),
+      _clock(clock ? std::move(clock) : Clock(steadyClockSeconds)),
+      _maximumActiveRequests(std::max(maximumActiveRequests, int32_t(1))),
+      _maximumActiveRequestsPerHost(
+          std::max(maximumActiveRequestsPerHost, int32_t(1))),
+      _nextGroupId(DefaultGroup + 1),
+      _nextRequestId(1),
+      _groups(),
+      _hosts(),
+      _queuedCount(0),
+      _active() {
+  this->_groups.emplace(DefaultGroup, Group{0.0, 0, 0, {}});
+}
+
+PrioritizedRequestQueue::GroupId
+PrioritizedRequestQueue::createGroup(double priority) {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  GroupId groupId = this->_nextGroupId++;
+  this->_groups.emplace(groupId, Group{priority, 0, 0, {}});
+  return groupId;
+}
+
+void PrioritizedRequestQueue::setGroupPriority(
+    GroupId groupId,
+    double priority) {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  auto it = this->_groups.find(groupId);
+  if (it != this->_groups.end()) {
+    it->second.priority = priority;
+  }
+}
+
+void PrioritizedRequestQueue::advanceGroupView(GroupId groupId) {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  auto it = this->_groups.find(groupId);
+  if (it != this->_groups.end()) {
+    ++it->second.view;
+  }
+}
+
+void PrioritizedRequestQueue::cancelGroup(GroupId groupId) {
+  if (groupId == DefaultGroup) {
+    return;
+  }
+
+  std::vector<CancelCallback> canceledQueued;
+  std::vector<CancelCallback> canceledActive;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    auto groupIt = this->_groups.find(groupId);
+    if (groupIt != this->_groups.end()) {
+      // Cancel the queued requests in the order in which they would have been
+      // started.
+      std::map<QueueKey, Request> queued;
+      for (auto& hostEntry : groupIt->second.queued) {
+        this->_hosts[hostEntry.first].statistics.queued -=
+            hostEntry.second.size();
+        this->_queuedCount -= hostEntry.second.size();
+        queued.merge(hostEntry.second);
+      }
+      for (auto& entry : queued) {
+        canceledQueued.emplace_back(std::move(entry.second.cancel));
+      }
+      this->_groups.erase(groupIt);
+    }
+
+    // Active requests stay in the active set until the transport finishes
+    // them, so that they continue to count against the limit until their
+    // connections are actually released.
+    for (auto& entry : this->_active) {
+      if (entry.second.groupId == groupId && entry.second.cancel) {
+        canceledActive.emplace_back(std::move(entry.second.cancel));
+        entry.second.cancel = nullptr;
+      }
+    }
+  }
+
+  for (CancelCallback& cancel : canceledQueued) {
+    cancel(false);
+  }
+  for (CancelCallback& cancel : canceledActive) {
+    cancel(true);
+  }
+}
+
+PrioritizedRequestQueue::RequestId PrioritizedRequestQueue::enqueue(
+    GroupId groupId,
+    const std::string& host,
+    StartCallback&& start,
+    CancelCallback&& cancel) {
+  std::vector<RequestToStart> toStart;
+  RequestId requestId;
+  bool groupCanceled = false;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    requestId = this->_nextRequestId++;
+
+    auto groupIt = this->_groups.find(groupId);
+    groupCanceled = groupIt == this->_groups.end();
+    if (!groupCanceled) {
+      Host& hostState = this->_hosts[host];
+      hostState.statistics.host = host;
+      ++hostState.statistics.queued;
+      ++this->_queuedCount;
+
+      Group& group = groupIt->second;
+      group.queued[host].emplace(
+          QueueKey{group.view, requestId},
+          Request{
+              requestId,
+              groupId,
+              host,
+              this->_clock(),
+              std::move(start),
+              std::move(cancel)});
+      toStart = this->takeRequestsToStart();
+    }
+  }
+
+  if (groupCanceled) {
+    cancel(false);
+    return requestId;
+  }
+
+  this->startRequests(std::move(toStart));
+  return requestId;
+}
+
+void PrioritizedRequestQueue::finish(RequestId requestId) {
+  std::vector<RequestToStart> toStart;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto it = this->_active.find(requestId);
+    if (it != this->_active.end()) {
+      auto groupIt = this->_groups.find(it->second.groupId);
+      if (groupIt != this->_groups.end()) {
+        --groupIt->second.active;
+      }
+      --this->_hosts[it->second.host].statistics.active;
+      this->_active.erase(it);
+    }
+    toStart = this->takeRequestsToStart();
+  }
+
+  this->startRequests(std::move(toStart));
+}
+
+void PrioritizedRequestQueue::backOffHost(
+    const std::string& host,
+    double seconds) {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  Host& hostState = this->_hosts[host];
+  hostState.statistics.host = host;
+  ++hostState.statistics.backOffs;
+  hostState.backOffUntil =
+      std::max(hostState.backOffUntil, this->_clock() + seconds);
+}
+
+void PrioritizedRequestQueue::tick() {
+  std::vector<RequestToStart> toStart;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    toStart = this->takeRequestsToStart();
+  }
+
+  this->startRequests(std::move(toStart));
+}
+
+void PrioritizedRequestQueue::setMaximumActiveRequests(
+    int32_t maximumActiveRequests) {
+  std::vector<RequestToStart> toStart;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_maximumActiveRequests = std::max(maximumActiveRequests, int32_t(1));
+    toStart = this->takeRequestsToStart();
+  }
+
+  this->startRequests(std::move(toStart));
+}
+
+void PrioritizedRequestQueue::setMaximumActiveRequestsPerHost(
+    int32_t maximumActiveRequestsPerHost) {
+  std::vector<RequestToStart> toStart;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_maximumActiveRequestsPerHost =
+        std::max(maximumActiveRequestsPerHost, int32_t(1));
+    toStart = this->takeRequestsToStart();
+  }
+
+  this->startRequests(std::move(toStart));
+}
+
+size_t PrioritizedRequestQueue::getQueuedCount() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return this->_queuedCount;
+}
+
+size_t PrioritizedRequestQueue::getActiveCount() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return this->_active.size();
+}
+
+std::vector<PrioritizedRequestQueue::HostStatistics>
+PrioritizedRequestQueue::getHostStatistics() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  std::vector<HostStatistics> result;
+  result.reserve(this->_hosts.size());
+  for (const auto& entry : this->_hosts) {
+    result.push_back(entry.second.statistics);
+  }
+  return result;
+}
+
+std::vector<PrioritizedRequestQueue::RequestToStart>
+PrioritizedRequestQueue::takeRequestsToStart() {
+  std::vector<RequestToStart> toStart;
+  if (this->_queuedCount == 0) {
+    return toStart;
+  }
+
+  double now = this->_clock();
+
+  while (this->_active.size() < size_t(this->_maximumActiveRequests)) {
+    // Priorities and active counts change all the time, so the best group is
+    // found by scanning the groups, of which there are few. Within each group,
+    // only the first queued request to each host that can accept another
+    // request is a candidate. Ties between groups go to the earliest request.
+    Group* pBestGroup = nullptr;
+    std::map<QueueKey, Request>* pBestQueue = nullptr;
+    for (auto& groupEntry : this->_groups) {
+      Group& group = groupEntry.second;
+      if (pBestGroup && (group.priority < pBestGroup->priority ||
+                         (group.priority == pBestGroup->priority &&
+                          group.active > pBestGroup->active))) {
+        continue;
+      }
+
+      std::map<QueueKey, Request>* pGroupQueue = nullptr;
+      for (auto& hostEntry : group.queued) {
+        const Host& host = this->_hosts[hostEntry.first];
+        if (host.backOffUntil > now ||
+            host.statistics.active >=
+                size_t(this->_maximumActiveRequestsPerHost)) {
+          continue;
+        }
+
+        if (!pGroupQueue || hostEntry.second.begin()->first <
+                                pGroupQueue->begin()->first) {
+          pGroupQueue = &hostEntry.second;
+        }
+      }
+
+      if (!pGroupQueue) {
+        continue;
+      }
+
+      if (!pBestGroup || group.priority > pBestGroup->priority ||
+          group.active < pBestGroup->active ||
+          pGroupQueue->begin()->second.id < pBestQueue->begin()->second.id) {
+        pBestGroup = &group;
+        pBestQueue = pGroupQueue;
+      }
+    }
+
+    if (!pBestGroup) {
+      break;
+    }
+
+    auto best = pBestQueue->begin();
+    Request request = std::move(best->second);
+    pBestQueue->erase(best);
+    if (pBestQueue->empty()) {
+      pBestGroup->queued.erase(request.host);
+    }
+    --this->_queuedCount;
+    ++pBestGroup->active;
+
+    HostStatistics& statistics = this->_hosts[request.host].statistics;
+    double queueSeconds = std::max(now - request.enqueueTime, 0.0);
+    --statistics.queued;
+    ++statistics.active;
+    ++statistics.requestsStarted;
+    statistics.totalQueueSeconds += queueSeconds;
+    statistics.maximumQueueSeconds =
+        std::max(statistics.maximumQueueSeconds, queueSeconds);
+
+    RequestId id = request.id;
+    toStart.emplace_back(id, std::move(request.start));
+    request.start = nullptr;
+    this->_active.emplace(id, std::move(request));
+  }
+
+  return toStart;
+}
+
+void PrioritizedRequestQueue::startRequests(
+    std::vector<RequestToStart>&& toStart) {
+  for (RequestToStart& request : toStart) {
+    request.second(request.first);
+  }
+}
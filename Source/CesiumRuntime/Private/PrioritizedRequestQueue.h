@@ -0,0 +1,259 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A queue of pending requests in front of a transport such as FHttpModule. It
+ * limits the number of requests that are active at once, both in total and
+ * for each host, starts queued requests in priority order, and allows
+ * requests to be canceled.
+ *
+ * Requests belong to groups, and each group has a priority that may change at
+ * any time. Queued requests in a group with a higher priority are started
+ * first. Among groups of equal priority, requests from the group with the
+ * fewest active requests are started first, so that one busy group cannot
+ * starve the others. Requests within a group are started in the order in
+ * which they were enqueued, except that the requests enqueued since the
+ * group's view last changed are started before the requests enqueued for
+ * earlier views. This lets a tileset whose camera turns away load the tiles
+ * of its new view first rather than those it no longer shows.
+ *
+ * A host can be told to back off, for example after it responds with 429 Too
+ * Many Requests. None of its queued requests are started until the back-off
+ * time has passed and {@link tick} or {@link finish} is called.
+ *
+ * All functions are thread-safe. The start and cancel callbacks are invoked
+ * without any lock held, in the thread that caused them to be invoked.
+ */
+class PrioritizedRequestQueue {
+public:
+  using GroupId = uint64_t;
+  using RequestId = uint64_t;
+
+  /**
+   * The group of requests that are not enqueued in any other group. It has a
+   * priority of zero and cannot be canceled.
+   */
+  static constexpr GroupId DefaultGroup = 0;
+
+  /**
+   * Starts a request. The transport must call {@link finish} with the given
+   * request ID when the request completes, whether it succeeds or not.
+   */
+  using StartCallback = std::function<void(RequestId requestId)>;
+
+  /**
+   * Cancels a request. The parameter is true if the request was active, in
+   * which case the transport should abort it and still call
+   * {@link finish}, or false if it was still queued and will never be started.
+   */
+  using CancelCallback = std::function<void(bool wasActive)>;
+
+  /**
+   * Returns the current time in seconds. Only differences between times are
+   * used.
+   */
+  using Clock = std::function<double()>;
+
+  /**
+   * Statistics for the requests to one host.
+   */
+  struct HostStatistics {
+    std::string host;
+
+    /**
+     * The number of requests that have been started.
+     */
+    uint64_t requestsStarted = 0;
+
+    /**
+     * The total time that started requests spent in the queue, in seconds.
+     */
+    double totalQueueSeconds = 0.0;
+
+    /**
+     * The longest time that a started request spent in the queue, in seconds.
+     */
+    double maximumQueueSeconds = 0.0;
+
+    /**
+     * The number of times the host was told to back off.
+     */
+    uint64_t backOffs = 0;
+
+    /**
+     * The number of requests that are currently active.
+     */
+    size_t active = 0;
+
+    /**
+     * The number of requests that are currently queued.
+     */
+    size_t queued = 0;
+  };
+
+  /**
+   * Creates a queue.
+   *
+   * @param maximumActiveRequests The maximum number of active requests.
+   * @param maximumActiveRequestsPerHost The maximum number of active requests
+   * to any one host.
+   * @param clock The source of the current time, or nullptr to use a
+   * monotonic system clock.
+   */
+  PrioritizedRequestQueue(
+      int32_t maximumActiveRequests,
+      int32_t maximumActiveRequestsPerHost,
+      Clock&& clock = nullptr);
+
+  /**
+   * Creates a new group of requests with the given priority.
+   */
+  GroupId createGroup(double priority);
+
+  /**
+   * Changes the priority of a group. This affects the order in which its
+   * queued requests are started, but not requests that are already active.
+   */
+  void setGroupPriority(GroupId groupId, double priority);
+
+  /**
+   * Notifies the queue that the view for which a group's requests are made
+   * has changed, such as when the camera turns away from the tiles that were
+   * requested. The group's queued requests are started after any requests
+   * that are enqueued in the group afterward.
+   */
+  void advanceGroupView(GroupId groupId);
+
+  /**
+   * Cancels every queued and active request in a group and removes the group.
+   * Requests that are enqueued in the group afterward are canceled
+   * immediately.
+   */
+  void cancelGroup(GroupId groupId);
+
+  /**
+   * Adds a request to the queue, starting it immediately if the limits allow.
+   *
+   * @param groupId The group of the request.
+   * @param host The host that the request is sent to, which is compared
+   * exactly. It is usually the scheme, host name, and port of a URL.
+   * @param start The callback that starts the request.
+   * @param cancel The callback that cancels the request.
+   */
+  RequestId enqueue(
+      GroupId groupId,
+      const std::string& host,
+      StartCallback&& start,
+      CancelCallback&& cancel);
+
+  /**
+   * Notifies the queue that an active request has completed, so that the next
+   * queued request can be started.
+   */
+  void finish(RequestId requestId);
+
+  /**
+   * Prevents any queued request to the given host from being started for the
+   * given number of seconds. If the host is already backing off for longer,
+   * this has no effect on the time.
+   */
+  void backOffHost(const std::string& host, double seconds);
+
+  /**
+   * Starts any queued requests whose host is no longer backing off. This
+   * should be called regularly, such as once per frame.
+   */
+  void tick();
+
+  /**
+   * Sets the maximum number of requests that may be active at once. Values
+   * less than one are treated as one.
+   */
+  void setMaximumActiveRequests(int32_t maximumActiveRequests);
+
+  /**
+   * Sets the maximum number of requests to one host that may be active at
+   * once. Values less than one are treated as one.
+   */
+  void setMaximumActiveRequestsPerHost(int32_t maximumActiveRequestsPerHost);
+
+  /**
+   * Gets the number of requests waiting to be started.
+   */
+  size_t getQueuedCount() const;
+
+  /**
+   * Gets the number of requests that have been started but not finished.
+   */
+  size_t getActiveCount() const;
+
+  /**
+   * Gets the statistics of every host that has been sent a request.
+   */
+  std::vector<HostStatistics> getHostStatistics() const;
+
+private:
+  struct Request {
+    RequestId id;
+    GroupId groupId;
+    std::string host;
+    double enqueueTime;
+    StartCallback start;
+    CancelCallback cancel;
+  };
+
+  // The order in which the queued requests of a group are started: those of
+  // the latest view first, and then in the order in which they were enqueued.
+  struct QueueKey {
+    uint64_t view;
+    RequestId id;
+
+    bool operator<(const QueueKey& other) const {
+      return this->view != other.view ? this->view > other.view
+                                      : this->id < other.id;
+    }
+  };
+
+  struct Group {
+    double priority;
+    size_t active;
+    uint64_t view;
+
+    // The queued requests of the group, by host.
+    std::unordered_map<std::string, std::map<QueueKey, Request>> queued;
+  };
+
+  struct Host {
+    HostStatistics statistics;
+    double backOffUntil = 0.0;
+  };
+
+  using RequestToStart = std::pair<RequestId, StartCallback>;
+
+  // Removes the requests that should be started now from the queue and marks
+  // them active. Must be called with the lock held.
+  std::vector<RequestToStart> takeRequestsToStart();
+
+  void startRequests(std::vector<RequestToStart>&& toStart);
+
+  mutable std::mutex _mutex;
+  Clock _clock;
+  int32_t _maximumActiveRequests;
+  int32_t _maximumActiveRequestsPerHost;
+  GroupId _nextGroupId;
+  RequestId _nextRequestId;
+  std::unordered_map<GroupId, Group> _groups;
+  std::unordered_map<std::string, Host> _hosts;
+  size_t _queuedCount;
+  std::unordered_map<RequestId, Request> _active;
+};
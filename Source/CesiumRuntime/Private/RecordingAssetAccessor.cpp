@@ -0,0 +1,96 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "RecordingAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "ShardedFileCacheDatabase.h"
+#include <ctime>
+#include <limits>
+
+namespace {
+
+// Recorded responses never expire.
+constexpr std::time_t RecordingExpiryTime =
+    std::time_t(std::numeric_limits<int32_t>::max());
+
+} // namespace
+
+RecordingAssetAccessor::RecordingAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+    const FString& directory)
+    : _pAssetAccessor(pAssetAccessor),
+      _pRecording(std::make_shared<ShardedFileCacheDatabase>(
+          directory,
+          std::numeric_limits<int64_t>::max())),
+      _pRecordedCount(std::make_shared<std::atomic<uint64_t>>(0)) {}
+
+RecordingAssetAccessor::~RecordingAssetAccessor() = default;
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+RecordingAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  return this->record(
+      this->_pAssetAccessor->get(asyncSystem, url, headers),
+      "GET",
+      url);
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+RecordingAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  return this->record(
+      this->_pAssetAccessor
+          ->request(asyncSystem, verb, url, headers, contentPayload),
+      verb.empty() ? std::string("GET") : verb,
+      url);
+}
+
+void RecordingAssetAccessor::tick() noexcept { this->_pAssetAccessor->tick(); }
+
+/*static*/ std::string RecordingAssetAccessor::createKey(
+    const std::string& verb,
+    const std::string& url) {
+  return verb + " " + url;
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+RecordingAssetAccessor::record(
+    CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>&& future,
+    const std::string& verb,
+    const std::string& url) {
+  return std::move(future).thenInWorkerThread(
+      [pRecording = this->_pRecording,
+       pRecordedCount = this->_pRecordedCount,
+       key = createKey(verb, url),
+       verb](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+        const CesiumAsync::IAssetResponse* pResponse = pRequest->response();
+        if (pResponse) {
+          bool stored = pRecording->storeEntry(
+              key,
+              RecordingExpiryTime,
+              pRequest->url(),
+              verb,
+              pRequest->headers(),
+              pResponse->statusCode(),
+              pResponse->headers(),
+              pResponse->data());
+          if (stored) {
+            ++*pRecordedCount;
+          } else {
+            UE_LOG(
+                LogCesium,
+                Warning,
+                TEXT("Could not record the response to %s"),
+                UTF8_TO_TCHAR(pRequest->url().c_str()));
+          }
+        }
+        return std::move(pRequest);
+      });
+}
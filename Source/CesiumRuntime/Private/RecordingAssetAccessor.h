@@ -0,0 +1,81 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "Containers/UnrealString.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class ShardedFileCacheDatabase;
+
+/**
+ * An IAssetAccessor that saves every response received through it to a
+ * recording directory, so that a streaming session can later be replayed
+ * without a network by a {@link ReplayAssetAccessor}.
+ *
+ * Responses are keyed by their verb and URL only, because request headers,
+ * such as access tokens, may legitimately differ between the recording and
+ * the replay. The request body of a POST is not part of the key. A response
+ * to the same request is replaced by the latest one.
+ *
+ * Responses are written in worker threads as they arrive, using the storage
+ * format of {@link ShardedFileCacheDatabase}, so a recording is complete up
+ * to the last response even if the session ends abruptly.
+ */
+class RecordingAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  /**
+   * Creates an accessor.
+   *
+   * @param pAssetAccessor The accessor whose responses to record.
+   * @param directory The recording directory. It is created if it does not
+   * exist, and responses already in it are kept unless they are recorded
+   * again.
+   */
+  RecordingAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+      const FString& directory);
+
+  virtual ~RecordingAssetAccessor();
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+  /**
+   * Gets the number of responses recorded so far.
+   */
+  uint64_t getRecordedCount() const { return *this->_pRecordedCount; }
+
+  /**
+   * Creates the key under which the response to a request is recorded.
+   */
+  static std::string createKey(const std::string& verb, const std::string& url);
+
+private:
+  CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>> record(
+      CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>&&
+          future,
+      const std::string& verb,
+      const std::string& url);
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+  std::shared_ptr<ShardedFileCacheDatabase> _pRecording;
+  std::shared_ptr<std::atomic<uint64_t>> _pRecordedCount;
+};
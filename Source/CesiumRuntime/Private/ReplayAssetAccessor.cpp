@@ -0,0 +1,272 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "ReplayAssetAccessor.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "RecordingAssetAccessor.h"
+#include "ShardedFileCacheDatabase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace {
+
+double steadyClockSeconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class ReplayedAssetResponse : public CesiumAsync::IAssetResponse {
+public:
+  ReplayedAssetResponse(
+      uint16_t statusCode,
+      CesiumAsync::HttpHeaders&& headers,
+      std::vector<std::byte>&& data)
+      : _statusCode(statusCode),
+        _headers(std::move(headers)),
+        _data(std::move(data)) {}
+
+  virtual uint16_t statusCode() const override { return this->_statusCode; }
+
+  virtual std::string contentType() const override {
+    auto it = this->_headers.find("Content-Type");
+    return it == this->_headers.end() ? std::string() : it->second;
+  }
+
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+
+  virtual gsl::span<const std::byte> data() const override {
+    return gsl::span<const std::byte>(this->_data);
+  }
+
+private:
+  uint16_t _statusCode;
+  CesiumAsync::HttpHeaders _headers;
+  std::vector<std::byte> _data;
+};
+
+class ReplayedAssetRequest : public CesiumAsync::IAssetRequest {
+public:
+  ReplayedAssetRequest(
+      const std::string& method,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      ReplayedAssetResponse&& response)
+      : _method(method),
+        _url(url),
+        _headers(headers.begin(), headers.end()),
+        _response(std::move(response)) {}
+
+  virtual const std::string& method() const override { return this->_method; }
+
+  virtual const std::string& url() const override { return this->_url; }
+
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+
+  virtual const CesiumAsync::IAssetResponse* response() const override {
+    return &this->_response;
+  }
+
+private:
+  std::string _method;
+  std::string _url;
+  CesiumAsync::HttpHeaders _headers;
+  ReplayedAssetResponse _response;
+};
+
+} // namespace
+
+struct ReplayAssetAccessor::State {
+  State(
+      const FString& directory,
+      double latencySeconds_,
+      double bytesPerSecond_,
+      Clock&& clock_)
+      : recording(directory, std::numeric_limits<int64_t>::max()),
+        latencySeconds(std::max(latencySeconds_, 0.0)),
+        bytesPerSecond(std::max(bytesPerSecond_, 0.0)),
+        clock(std::move(clock_)),
+        mutex(),
+        linkAvailableTime(0.0),
+        pending(),
+        missing(0) {}
+
+  struct Pending {
+    CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>> promise;
+    std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+  };
+
+  void schedule(
+      CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>>&&
+          promise,
+      std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest);
+
+  ShardedFileCacheDatabase recording;
+  const double latencySeconds;
+  const double bytesPerSecond;
+  const Clock clock;
+
+  std::mutex mutex;
+  double linkAvailableTime;
+  // The responses in transit, by their arrival time.
+  std::multimap<double, Pending> pending;
+  std::atomic<uint64_t> missing;
+};
+
+ReplayAssetAccessor::ReplayAssetAccessor(
+    const FString& directory,
+    double latencySeconds,
+    double bytesPerSecond,
+    Clock&& clock)
+    : _pState(std::make_shared<State>(
+          directory,
+          latencySeconds,
+          bytesPerSecond,
+          clock ? std::move(clock) : Clock(steadyClockSeconds))) {}
+
+ReplayAssetAccessor::~ReplayAssetAccessor() {
+  // Deliver the responses still in transit rather than leaving their
+  // requests waiting forever.
+  std::multimap<double, State::Pending> pending;
+  {
+    std::lock_guard<std::mutex> lock(this->_pState->mutex);
+    pending.swap(this->_pState->pending);
+  }
+  for (auto& item : pending) {
+    item.second.promise.resolve(std::move(item.second.pRequest));
+  }
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+ReplayAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  return this->request(
+      asyncSystem,
+      "GET",
+      url,
+      headers,
+      gsl::span<const std::byte>());
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+ReplayAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& /*contentPayload*/) {
+  std::string method = verb.empty() ? std::string("GET") : verb;
+
+  auto promise =
+      asyncSystem.createPromise<std::shared_ptr<CesiumAsync::IAssetRequest>>();
+  auto future = promise.getFuture();
+
+  // Read the recorded response in a worker thread, and then wait for its
+  // simulated arrival.
+  asyncSystem.runInWorkerThread(
+      [pState = this->_pState,
+       promise = std::move(promise),
+       method,
+       url,
+       headers]() mutable {
+        std::optional<CesiumAsync::CacheItem> maybeItem =
+            pState->recording.getEntry(
+                RecordingAssetAccessor::createKey(method, url));
+
+        std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+        if (maybeItem) {
+          CesiumAsync::CacheResponse& response = maybeItem->cacheResponse;
+          pRequest = std::make_shared<ReplayedAssetRequest>(
+              method,
+              url,
+              headers,
+              ReplayedAssetResponse(
+                  response.statusCode,
+                  std::move(response.headers),
+                  std::move(response.data)));
+        } else {
+          ++pState->missing;
+          UE_LOG(
+              LogCesium,
+              Warning,
+              TEXT("No recorded response for %s %s"),
+              UTF8_TO_TCHAR(method.c_str()),
+              UTF8_TO_TCHAR(url.c_str()));
+          pRequest = std::make_shared<ReplayedAssetRequest>(
+              method,
+              url,
+              headers,
+              ReplayedAssetResponse(404, {}, {}));
+        }
+
+        pState->schedule(std::move(promise), std::move(pRequest));
+      });
+
+  return future;
+}
+
+void ReplayAssetAccessor::tick() noexcept {
+  double now = this->_pState->clock();
+
+  // Deliver responses in the order in which they arrived.
+  std::vector<State::Pending> arrived;
+  {
+    std::lock_guard<std::mutex> lock(this->_pState->mutex);
+    std::multimap<double, State::Pending>& pending = this->_pState->pending;
+    auto it = pending.begin();
+    while (it != pending.end() && it->first <= now) {
+      arrived.push_back(std::move(it->second));
+      it = pending.erase(it);
+    }
+  }
+
+  for (State::Pending& item : arrived) {
+    item.promise.resolve(std::move(item.pRequest));
+  }
+}
+
+uint64_t ReplayAssetAccessor::getMissingCount() const {
+  return this->_pState->missing;
+}
+
+size_t ReplayAssetAccessor::getInTransitCount() const {
+  std::lock_guard<std::mutex> lock(this->_pState->mutex);
+  return this->_pState->pending.size();
+}
+
+void ReplayAssetAccessor::State::schedule(
+    CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>>&&
+        promise,
+    std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+  double size = double(pRequest->response()->data().size());
+  double firstByteTime = this->clock() + this->latencySeconds;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  double arrivalTime = firstByteTime;
+  if (this->bytesPerSecond > 0.0) {
+    // The body cannot start to transfer until the link has finished
+    // transferring the bodies scheduled before it.
+    double transferStart = std::max(firstByteTime, this->linkAvailableTime);
+    arrivalTime = transferStart + size / this->bytesPerSecond;
+    this->linkAvailableTime = arrivalTime;
+  }
+
+  this->pending.emplace(
+      arrivalTime,
+      Pending{std::move(promise), std::move(pRequest)});
+}
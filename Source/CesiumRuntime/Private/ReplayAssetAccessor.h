@@ -0,0 +1,85 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "Containers/UnrealString.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * An IAssetAccessor that serves the responses saved by a
+ * {@link RecordingAssetAccessor} instead of sending requests, so that
+ * streaming tests can run without a network and without depending on the
+ * timing of live servers.
+ *
+ * Each response is delivered after a simulated latency, and then after the
+ * time its body takes to transfer at a simulated bandwidth, which is shared by
+ * all responses as if they arrived one after another over a single link.
+ * Responses are only delivered when this accessor is ticked. Requests that
+ * were not recorded receive a 404 response.
+ */
+class ReplayAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  /**
+   * Returns the current time in seconds. Only differences between times are
+   * used.
+   */
+  using Clock = std::function<double()>;
+
+  /**
+   * Creates an accessor.
+   *
+   * @param directory The recording directory.
+   * @param latencySeconds The simulated time before the first byte of each
+   * response arrives, in seconds.
+   * @param bytesPerSecond The simulated bandwidth, in bytes per second, or zero
+   * for unlimited bandwidth.
+   * @param clock The source of the current time, or nullptr to use a
+   * monotonic system clock.
+   */
+  ReplayAssetAccessor(
+      const FString& directory,
+      double latencySeconds,
+      double bytesPerSecond,
+      Clock&& clock = nullptr);
+
+  virtual ~ReplayAssetAccessor();
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  /**
+   * Delivers the responses whose simulated arrival time has passed.
+   */
+  virtual void tick() noexcept override;
+
+  /**
+   * Gets the number of requests that were not found in the recording.
+   */
+  uint64_t getMissingCount() const;
+
+  /**
+   * Gets the number of responses that have been read from the recording but
+   * not yet delivered.
+   */
+  size_t getInTransitCount() const;
+
+private:
+  struct State;
+  std::shared_ptr<State> _pState;
+};
@@ -0,0 +1,50 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "RequestGroupAssetAccessor.h"
+#include "UnrealAssetAccessor.h"
+
+RequestGroupAssetAccessor::RequestGroupAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+    uint64_t requestGroup)
+    : _pAssetAccessor(pAssetAccessor), _requestGroup(requestGroup) {}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+RequestGroupAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  return this->_pAssetAccessor->get(
+      asyncSystem,
+      url,
+      this->addRequestGroupHeader(headers));
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+RequestGroupAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  return this->_pAssetAccessor->request(
+      asyncSystem,
+      verb,
+      url,
+      this->addRequestGroupHeader(headers),
+      contentPayload);
+}
+
+void RequestGroupAssetAccessor::tick() noexcept {
+  this->_pAssetAccessor->tick();
+}
+
+std::vector<CesiumAsync::IAssetAccessor::THeader>
+RequestGroupAssetAccessor::addRequestGroupHeader(
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) const {
+  std::vector<CesiumAsync::IAssetAccessor::THeader> result;
+  result.reserve(headers.size() + 1);
+  result.insert(result.end(), headers.begin(), headers.end());
+  result.emplace_back(
+      UnrealAssetAccessor::requestGroupHeader(this->_requestGroup));
+  return result;
+}
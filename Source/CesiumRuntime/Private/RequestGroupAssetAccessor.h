@@ -0,0 +1,46 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include <cstdint>
+#include <memory>
+
+/**
+ * An IAssetAccessor that assigns every request made through it to a request
+ * group of the {@link UnrealAssetAccessor}, so that the requests of one
+ * tileset can be prioritized and canceled together. The group is identified
+ * by a pseudo-header, which passes through any accessors between this one and
+ * the UnrealAssetAccessor.
+ */
+class RequestGroupAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  RequestGroupAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+      uint64_t requestGroup);
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+private:
+  std::vector<CesiumAsync::IAssetAccessor::THeader>
+  addRequestGroupHeader(
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) const;
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+  uint64_t _requestGroup;
+};
@@ -0,0 +1,652 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "ShardedFileCacheDatabase.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumRuntime.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+namespace {
+
+constexpr uint32_t EntryMagic = 0x43465343; // "CSFC"
+constexpr uint32_t EntryVersion = 1;
+
+// The magic number, version, and expiry time at the start of every entry,
+// which is all that is read when the index is built.
+constexpr int64 EntryPreambleSize = 16;
+
+const TCHAR EntryExtension[] = TEXT(".entry");
+
+constexpr int64_t TemporaryFileLifetimeSeconds = 3600;
+
+constexpr int32 ReplaceAttempts = 3;
+constexpr float ReplaceRetryDelaySeconds = 0.002f;
+
+uint64_t hashKey(const std::string& key) {
+  return CityHash64(key.data(), uint32(key.size()));
+}
+
+// Reads up to the given number of bytes from the start of a file.
+bool readFile(
+    const FString& filename,
+    TArray64<uint8>& buffer,
+    int64 maximumBytes = MAX_int64) {
+#if PLATFORM_WINDOWS
+  // The engine opens files without delete sharing, which would make storing
+  // or removing an entry fail while it is being read.
+  HANDLE handle = ::CreateFileW(
+      *FPaths::ConvertRelativePathToFull(filename),
+      GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  bool success = ::GetFileSizeEx(handle, &fileSize) != 0;
+  if (success) {
+    int64 size = FMath::Min(int64(fileSize.QuadPart), maximumBytes);
+    buffer.SetNumUninitialized(size);
+    int64 offset = 0;
+    while (success && offset < size) {
+      DWORD bytesRead = 0;
+      DWORD bytesToRead = DWORD(FMath::Min(size - offset, int64(MAX_int32)));
+      success = ::ReadFile(
+                    handle,
+                    buffer.GetData() + offset,
+                    bytesToRead,
+                    &bytesRead,
+                    nullptr) != 0 &&
+                bytesRead > 0;
+      offset += bytesRead;
+    }
+  }
+
+  ::CloseHandle(handle);
+  return success;
+#else
+  // Elsewhere, a file that is open can be replaced or removed.
+  TUniquePtr<IFileHandle> pFile(
+      FPlatformFileManager::Get().GetPlatformFile().OpenRead(*filename));
+  if (!pFile) {
+    return false;
+  }
+  int64 size = FMath::Min(pFile->Size(), maximumBytes);
+  buffer.SetNumUninitialized(size);
+  return pFile->Read(buffer.GetData(), size);
+#endif
+}
+
+// Moves a file over another one in a single step, so that a reader sees
+// either the old file or the new one, never neither.
+bool replaceFile(const FString& to, const FString& from) {
+  // Other processes that open files without delete sharing, such as virus
+  // scanners, can make the move fail briefly, so it is retried.
+  for (int32 attempt = 0; attempt < ReplaceAttempts; ++attempt) {
+    if (attempt > 0) {
+      FPlatformProcess::Sleep(ReplaceRetryDelaySeconds);
+    }
+#if PLATFORM_WINDOWS
+    // MoveFile fails on Windows if the destination exists.
+    if (::MoveFileExW(
+            *FPaths::ConvertRelativePathToFull(from),
+            *FPaths::ConvertRelativePathToFull(to),
+            MOVEFILE_REPLACE_EXISTING) != 0) {
+      return true;
+    }
+#else
+    // Elsewhere, MoveFile is a rename, which replaces the destination.
+    if (FPlatformFileManager::Get().GetPlatformFile().MoveFile(*to, *from)) {
+      return true;
+    }
+#endif
+  }
+  return false;
+}
+
+class EntryWriter {
+public:
+  void writeUint16(uint16_t value) { this->writeBytes(&value, sizeof(value)); }
+  void writeUint32(uint32_t value) { this->writeBytes(&value, sizeof(value)); }
+  void writeInt64(int64_t value) { this->writeBytes(&value, sizeof(value)); }
+
+  void writeString(const std::string& value) {
+    this->writeUint32(uint32_t(value.size()));
+    this->writeBytes(value.data(), value.size());
+  }
+
+  void writeHeaders(const CesiumAsync::HttpHeaders& headers) {
+    this->writeUint32(uint32_t(headers.size()));
+    for (const auto& header : headers) {
+      this->writeString(header.first);
+      this->writeString(header.second);
+    }
+  }
+
+  void writeData(const gsl::span<const std::byte>& data) {
+    this->writeInt64(int64_t(data.size()));
+    this->writeBytes(data.data(), data.size());
+  }
+
+  const TArray64<uint8>& getBuffer() const { return this->_buffer; }
+
+private:
+  void writeBytes(const void* pData, size_t size) {
+    this->_buffer.Append(static_cast<const uint8*>(pData), int64(size));
+  }
+
+  TArray64<uint8> _buffer;
+};
+
+class EntryReader {
+public:
+  EntryReader(const TArray64<uint8>& buffer) : _buffer(buffer), _offset(0) {}
+
+  bool readUint16(uint16_t& value) {
+    return this->readBytes(&value, sizeof(value));
+  }
+  bool readUint32(uint32_t& value) {
+    return this->readBytes(&value, sizeof(value));
+  }
+  bool readInt64(int64_t& value) {
+    return this->readBytes(&value, sizeof(value));
+  }
+
+  bool readString(std::string& value) {
+    uint32_t size;
+    if (!this->readUint32(size) || !this->hasBytes(size)) {
+      return false;
+    }
+    value.assign(
+        reinterpret_cast<const char*>(this->_buffer.GetData() + this->_offset),
+        size);
+    this->_offset += size;
+    return true;
+  }
+
+  bool readHeaders(CesiumAsync::HttpHeaders& headers) {
+    uint32_t count;
+    if (!this->readUint32(count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      std::string name;
+      std::string value;
+      if (!this->readString(name) || !this->readString(value)) {
+        return false;
+      }
+      headers.emplace(std::move(name), std::move(value));
+    }
+    return true;
+  }
+
+  bool readData(std::vector<std::byte>& data) {
+    int64_t size;
+    if (!this->readInt64(size) || size < 0 || !this->hasBytes(size)) {
+      return false;
+    }
+    const std::byte* pStart = reinterpret_cast<const std::byte*>(
+        this->_buffer.GetData() + this->_offset);
+    data.assign(pStart, pStart + size);
+    this->_offset += size;
+    return true;
+  }
+
+private:
+  bool hasBytes(int64 size) const {
+    return size <= this->_buffer.Num() - this->_offset;
+  }
+
+  bool readBytes(void* pData, size_t size) {
+    if (!this->hasBytes(int64(size))) {
+      return false;
+    }
+    std::memcpy(pData, this->_buffer.GetData() + this->_offset, size);
+    this->_offset += int64(size);
+    return true;
+  }
+
+  const TArray64<uint8>& _buffer;
+  int64 _offset;
+};
+
+} // namespace
+
+ShardedFileCacheDatabase::ShardedFileCacheDatabase(
+    const FString& directory,
+    int64_t maximumBytes)
+    : _directory(directory),
+      _maximumBytes(maximumBytes),
+      _shards(),
+      _totalBytes(0),
+      _pruneMutex(),
+      _pruning(false),
+      _pruneStartTime(0),
+      _victims(),
+      _nextVictim(0),
+      _lastAccessTimes(new std::atomic<int64_t>[AccessSlotCount]),
+      _nextTemporaryFile(0) {
+  for (size_t i = 0; i < AccessSlotCount; ++i) {
+    this->_lastAccessTimes[i] = 0;
+  }
+
+  IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+  for (size_t i = 0; i < ShardCount; ++i) {
+    platformFile.CreateDirectoryTree(*this->getShardDirectory(i));
+  }
+
+  // The index is built up front, so that the total size includes the entries
+  // stored by earlier instances from the start.
+  for (size_t i = 0; i < ShardCount; ++i) {
+    this->indexShard(i);
+  }
+}
+
+std::optional<CesiumAsync::CacheItem>
+ShardedFileCacheDatabase::getEntry(const std::string& key) const {
+  uint64_t hash = hashKey(key);
+  FString filename = this->getEntryFilename(hash);
+
+  TArray64<uint8> buffer;
+  if (!readFile(filename, buffer)) {
+    return std::nullopt;
+  }
+
+  EntryReader reader(buffer);
+
+  uint32_t magic;
+  uint32_t version;
+  int64_t expiryTime;
+  std::string storedKey;
+  uint16_t statusCode;
+  std::string url;
+  std::string method;
+  CesiumAsync::HttpHeaders requestHeaders;
+  CesiumAsync::HttpHeaders responseHeaders;
+  std::vector<std::byte> data;
+
+  if (!reader.readUint32(magic) || magic != EntryMagic ||
+      !reader.readUint32(version) || version != EntryVersion ||
+      !reader.readInt64(expiryTime) || !reader.readString(storedKey)) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Ignoring invalid request cache entry %s"),
+        *filename);
+    return std::nullopt;
+  }
+
+  // Different keys with the same hash share a file, and the most recently
+  // stored one wins.
+  if (storedKey != key) {
+    return std::nullopt;
+  }
+
+  if (!reader.readUint16(statusCode) || !reader.readString(url) ||
+      !reader.readString(method) || !reader.readHeaders(requestHeaders) ||
+      !reader.readHeaders(responseHeaders) || !reader.readData(data)) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Ignoring invalid request cache entry %s"),
+        *filename);
+    return std::nullopt;
+  }
+
+  this->recordAccess(hash);
+
+  return CesiumAsync::CacheItem{
+      std::time_t(expiryTime),
+      CesiumAsync::CacheRequest(
+          std::move(requestHeaders),
+          std::move(method),
+          std::move(url)),
+      CesiumAsync::CacheResponse(
+          statusCode,
+          std::move(responseHeaders),
+          std::move(data))};
+}
+
+bool ShardedFileCacheDatabase::storeEntry(
+    const std::string& key,
+    std::time_t expiryTime,
+    const std::string& url,
+    const std::string& requestMethod,
+    const CesiumAsync::HttpHeaders& requestHeaders,
+    uint16_t statusCode,
+    const CesiumAsync::HttpHeaders& responseHeaders,
+    const gsl::span<const std::byte>& responseData) {
+  EntryWriter writer;
+  writer.writeUint32(EntryMagic);
+  writer.writeUint32(EntryVersion);
+  writer.writeInt64(int64_t(expiryTime));
+  writer.writeString(key);
+  writer.writeUint16(statusCode);
+  writer.writeString(url);
+  writer.writeString(requestMethod);
+  writer.writeHeaders(requestHeaders);
+  writer.writeHeaders(responseHeaders);
+  writer.writeData(responseData);
+
+  uint64_t hash = hashKey(key);
+  FString filename = this->getEntryFilename(hash);
+
+  // Write to a temporary file and move it into place, so that readers, which
+  // take no locks, never see a partially-written entry.
+  FString temporaryFilename = FString::Printf(
+      TEXT("%s.%llu.tmp"),
+      *filename,
+      uint64(this->_nextTemporaryFile++));
+  if (!FFileHelper::SaveArrayToFile(writer.getBuffer(), *temporaryFilename)) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Failed to write request cache entry %s"),
+        *temporaryFilename);
+    return false;
+  }
+
+  // The shard is locked while the entry is replaced and indexed, so that a
+  // concurrent prune cannot delete the new file or leave the index
+  // describing a different one.
+  Shard& shard = this->_shards[hash % ShardCount];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  if (!replaceFile(filename, temporaryFilename)) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Failed to replace request cache entry %s"),
+        *filename);
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(
+        *temporaryFilename);
+    return false;
+  }
+
+  this->addToIndex(
+      shard,
+      hash,
+      IndexEntry{
+          writer.getBuffer().Num(),
+          int64_t(expiryTime),
+          int64_t(std::time(nullptr))});
+  return true;
+}
+
+bool ShardedFileCacheDatabase::prune() {
+  bool success = true;
+  PruneProgress progress;
+  do {
+    progress = this->pruneIncrementally(
+        std::numeric_limits<double>::infinity());
+    success &= progress.success;
+  } while (!progress.complete);
+  return success;
+}
+
+ShardedFileCacheDatabase::PruneProgress
+ShardedFileCacheDatabase::pruneIncrementally(double timeBudgetSeconds) {
+  std::lock_guard<std::mutex> lock(this->_pruneMutex);
+
+  double deadline = FPlatformTime::Seconds() + timeBudgetSeconds;
+  PruneProgress progress;
+
+  if (!this->_pruning) {
+    this->planPrune();
+    this->_pruning = true;
+  }
+
+  while (this->_nextVictim < this->_victims.size()) {
+    int64_t bytesRemoved = this->removeEntry(
+        this->_victims[this->_nextVictim++],
+        this->_pruneStartTime);
+    if (bytesRemoved < 0) {
+      progress.success = false;
+    } else if (bytesRemoved > 0) {
+      progress.bytesReclaimed += bytesRemoved;
+      ++progress.entriesRemoved;
+    }
+
+    if (FPlatformTime::Seconds() >= deadline) {
+      return progress;
+    }
+  }
+
+  this->_victims.clear();
+  this->_nextVictim = 0;
+  this->_pruning = false;
+  progress.complete = true;
+  return progress;
+}
+
+bool ShardedFileCacheDatabase::clearAll() {
+  for (Shard& shard : this->_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+  }
+  this->_totalBytes = 0;
+
+  IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+  bool success = true;
+  for (size_t i = 0; i < ShardCount; ++i) {
+    FString shardDirectory = this->getShardDirectory(i);
+    success &= platformFile.DeleteDirectoryRecursively(*shardDirectory);
+    platformFile.CreateDirectoryTree(*shardDirectory);
+  }
+
+  return success;
+}
+
+FString ShardedFileCacheDatabase::getShardDirectory(size_t shard) const {
+  return FPaths::Combine(
+      this->_directory,
+      FString::Printf(TEXT("%02x"), uint32(shard)));
+}
+
+FString ShardedFileCacheDatabase::getEntryFilename(uint64_t hash) const {
+  return FPaths::Combine(
+      this->getShardDirectory(size_t(hash % ShardCount)),
+      FString::Printf(TEXT("%016llx%s"), hash, EntryExtension));
+}
+
+void ShardedFileCacheDatabase::recordAccess(uint64_t hash) const {
+  this->_lastAccessTimes[hash % AccessSlotCount].store(
+      int64_t(std::time(nullptr)),
+      std::memory_order_relaxed);
+}
+
+int64_t ShardedFileCacheDatabase::getLastUseTime(
+    uint64_t hash,
+    const IndexEntry& entry) const {
+  return std::max(
+      entry.writeTime,
+      this->_lastAccessTimes[hash % AccessSlotCount].load(
+          std::memory_order_relaxed));
+}
+
+void ShardedFileCacheDatabase::addToIndex(
+    Shard& shard,
+    uint64_t hash,
+    const IndexEntry& entry) {
+  auto result = shard.entries.emplace(hash, entry);
+  if (!result.second) {
+    this->_totalBytes -= result.first->second.size;
+    result.first->second = entry;
+  }
+  this->_totalBytes += entry.size;
+}
+
+void ShardedFileCacheDatabase::planPrune() {
+  struct Candidate {
+    uint64_t hash;
+    int64_t size;
+    int64_t lastUseTime;
+  };
+
+  int64_t now = int64_t(std::time(nullptr));
+  std::vector<Candidate> candidates;
+  this->_pruneStartTime = now;
+  this->_victims.clear();
+  this->_nextVictim = 0;
+
+  for (Shard& shard : this->_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& entry : shard.entries) {
+      if (entry.second.expiryTime < now) {
+        this->_victims.push_back(entry.first);
+      } else {
+        candidates.push_back(Candidate{
+            entry.first,
+            entry.second.size,
+            this->getLastUseTime(entry.first, entry.second)});
+      }
+    }
+  }
+
+  int64_t bytesToRemove = this->_totalBytes - this->_maximumBytes;
+  for (uint64_t hash : this->_victims) {
+    Shard& shard = this->_shards[hash % ShardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(hash);
+    if (it != shard.entries.end()) {
+      bytesToRemove -= it->second.size;
+    }
+  }
+
+  if (bytesToRemove <= 0) {
+    return;
+  }
+
+  std::sort(
+      candidates.begin(),
+      candidates.end(),
+      [](const Candidate& left, const Candidate& right) {
+        return left.lastUseTime < right.lastUseTime;
+      });
+
+  for (const Candidate& candidate : candidates) {
+    if (bytesToRemove <= 0) {
+      break;
+    }
+    this->_victims.push_back(candidate.hash);
+    bytesToRemove -= candidate.size;
+  }
+}
+
+int64_t
+ShardedFileCacheDatabase::removeEntry(uint64_t hash, int64_t writtenBefore) {
+  Shard& shard = this->_shards[hash % ShardCount];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // An entry that was stored again since the prune was planned is kept.
+  auto it = shard.entries.find(hash);
+  if (it == shard.entries.end() || it->second.writeTime > writtenBefore) {
+    return 0;
+  }
+
+  // The shard stays locked while the file is deleted, so that a concurrent
+  // store of the same entry is not removed from the index after it is
+  // written.
+  IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+  FString filename = this->getEntryFilename(hash);
+  if (!platformFile.DeleteFile(*filename) &&
+      platformFile.FileExists(*filename)) {
+    UE_LOG(
+        LogCesium,
+        Verbose,
+        TEXT("Failed to remove request cache entry %s"),
+        *filename);
+    return -1;
+  }
+
+  int64_t size = it->second.size;
+  this->_totalBytes -= size;
+  shard.entries.erase(it);
+  return size;
+}
+
+void ShardedFileCacheDatabase::indexShard(size_t shardIndex) {
+  IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+  int64_t now = int64_t(std::time(nullptr));
+
+  FString shardDirectory = this->getShardDirectory(shardIndex);
+  std::vector<std::pair<uint64_t, IndexEntry>> found;
+  std::vector<FString> leftovers;
+
+  platformFile.IterateDirectoryStat(
+      *shardDirectory,
+      [&found, &leftovers, now](
+          const TCHAR* pFilename,
+          const FFileStatData& statData) {
+        if (statData.bIsDirectory) {
+          return true;
+        }
+
+        FString filename(pFilename);
+        if (!filename.EndsWith(EntryExtension)) {
+          // Temporary files left behind when the process exited mid-write.
+          // Recent ones may still be being written.
+          if (statData.ModificationTime.ToUnixTimestamp() <
+              now - TemporaryFileLifetimeSeconds) {
+            leftovers.push_back(filename);
+          }
+          return true;
+        }
+
+        FString hashString = FPaths::GetBaseFilename(filename);
+        uint64_t hash = FCString::Strtoui64(*hashString, nullptr, 16);
+
+        IndexEntry entry{
+            statData.FileSize,
+            std::numeric_limits<int64_t>::max(),
+            statData.ModificationTime.ToUnixTimestamp()};
+
+        // Only the preamble is read, to get the expiry time.
+        TArray64<uint8> preamble;
+        if (readFile(filename, preamble, EntryPreambleSize) &&
+            preamble.Num() == EntryPreambleSize) {
+          uint32_t magic;
+          std::memcpy(&magic, preamble.GetData(), sizeof(magic));
+          if (magic == EntryMagic) {
+            std::memcpy(
+                &entry.expiryTime,
+                preamble.GetData() + 8,
+                sizeof(int64_t));
+          }
+        }
+
+        found.emplace_back(hash, entry);
+        return true;
+      });
+
+  for (const FString& leftover : leftovers) {
+    platformFile.DeleteFile(*leftover);
+  }
+
+  Shard& shard = this->_shards[shardIndex];
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  for (const auto& entry : found) {
+    // Entries stored since this cache was created are already indexed.
+    if (shard.entries.emplace(entry.first, entry.second).second) {
+      this->_totalBytes += entry.second.size;
+    }
+  }
+}
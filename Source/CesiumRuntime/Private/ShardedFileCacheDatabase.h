@@ -0,0 +1,155 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/ICacheDatabase.h"
+#include "Containers/UnrealString.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An ICacheDatabase that stores each cached response in its own file, spread
+ * across subdirectories by a hash of its key, and limits the cache by its
+ * total size in bytes rather than by its number of entries.
+ *
+ * Reads take no locks: an entry is read directly from its file, which is
+ * written to a temporary file and then renamed over the old entry so that it
+ * is never seen partially written. Files are read with delete sharing on
+ * Windows, so that an entry can be replaced or removed while it is being
+ * read. Writes and pruning only lock the in-memory index of one shard at a
+ * time, so concurrent requests do not contend on a single database as they do
+ * with the SQLite cache.
+ *
+ * The index of entry sizes and last-use times, which pruning needs, is built
+ * by scanning the cache directory when the cache is created, and is then kept
+ * up to date as entries are stored. Pruning can be done in small steps with a
+ * time budget, using {@link pruneIncrementally}.
+ */
+class ShardedFileCacheDatabase : public CesiumAsync::ICacheDatabase {
+public:
+  /**
+   * Creates a cache.
+   *
+   * @param directory The directory in which to store cached responses. It is
+   * created if it does not exist.
+   * @param maximumBytes The total size of the cached responses, in bytes,
+   * above which the least recently used entries are removed when the cache is
+   * pruned.
+   */
+  ShardedFileCacheDatabase(const FString& directory, int64_t maximumBytes);
+
+  virtual std::optional<CesiumAsync::CacheItem>
+  getEntry(const std::string& key) const override;
+
+  virtual bool storeEntry(
+      const std::string& key,
+      std::time_t expiryTime,
+      const std::string& url,
+      const std::string& requestMethod,
+      const CesiumAsync::HttpHeaders& requestHeaders,
+      uint16_t statusCode,
+      const CesiumAsync::HttpHeaders& responseHeaders,
+      const gsl::span<const std::byte>& responseData) override;
+
+  /**
+   * Removes expired entries, and then the least recently used entries until
+   * the cache is no larger than its maximum size.
+   */
+  virtual bool prune() override;
+
+  /**
+   * The result of one step of {@link pruneIncrementally}.
+   */
+  struct PruneProgress {
+    /**
+     * Whether the prune is complete. If not, call pruneIncrementally again to
+     * continue it.
+     */
+    bool complete = false;
+
+    /**
+     * Whether every entry to be removed in this step was removed.
+     */
+    bool success = true;
+
+    /**
+     * The size of the entries removed in this step, in bytes.
+     */
+    int64_t bytesReclaimed = 0;
+
+    /**
+     * The number of entries removed in this step.
+     */
+    int64_t entriesRemoved = 0;
+  };
+
+  /**
+   * Does the same work as {@link prune}, but stops once the given time has
+   * passed, so that a large prune can be spread across several steps. Each
+   * call continues the prune where the last one stopped. The entries to
+   * remove are chosen at the start of each prune.
+   *
+   * @param timeBudgetSeconds The time after which to stop, in seconds. At
+   * least one entry is removed in each step that has entries to remove.
+   */
+  PruneProgress pruneIncrementally(double timeBudgetSeconds);
+
+  virtual bool clearAll() override;
+
+  /**
+   * Gets the total size of the cached responses, in bytes, as last known by
+   * the index, including the responses stored by earlier instances.
+   */
+  int64_t getTotalBytes() const { return this->_totalBytes; }
+
+private:
+  static constexpr size_t ShardCount = 256;
+  static constexpr size_t AccessSlotCount = 65536;
+
+  struct IndexEntry {
+    int64_t size;
+    int64_t expiryTime;
+    int64_t writeTime;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, IndexEntry> entries;
+  };
+
+  FString getShardDirectory(size_t shard) const;
+  FString getEntryFilename(uint64_t hash) const;
+  void recordAccess(uint64_t hash) const;
+  int64_t getLastUseTime(uint64_t hash, const IndexEntry& entry) const;
+  // Must be called with the shard's lock held.
+  void addToIndex(Shard& shard, uint64_t hash, const IndexEntry& entry);
+  void planPrune();
+  int64_t removeEntry(uint64_t hash, int64_t writtenBefore);
+  void indexShard(size_t shardIndex);
+
+  FString _directory;
+  int64_t _maximumBytes;
+
+  std::array<Shard, ShardCount> _shards;
+  std::atomic<int64_t> _totalBytes;
+
+  // The state of the prune in progress, if any.
+  std::mutex _pruneMutex;
+  bool _pruning;
+  int64_t _pruneStartTime;
+  std::vector<uint64_t> _victims;
+  size_t _nextVictim;
+
+  // The last time that any entry whose hash maps to each slot was read. Many
+  // entries share a slot, so this can only make an entry appear more
+  // recently used than it was. It is updated without locks.
+  mutable std::unique_ptr<std::atomic<int64_t>[]> _lastAccessTimes;
+
+  std::atomic<uint64_t> _nextTemporaryFile;
+};
@@ -0,0 +1,77 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "TaskLaneAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "UnrealTaskProcessor.h"
+#include <stdexcept>
+
+namespace {
+
+UnrealTaskProcessor::Lane
+getContinuationLane(const CesiumAsync::IAssetRequest& request) {
+  const CesiumAsync::IAssetResponse* pResponse = request.response();
+  if (pResponse && pResponse->contentType().rfind("image/", 0) == 0) {
+    return UnrealTaskProcessor::Lane::Texture;
+  }
+  return UnrealTaskProcessor::getCurrentLane();
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+continueInLane(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>&&
+        future) {
+  // The request is completed through a promise, so that the lane is in scope
+  // when its continuations are started. A request that has already completed,
+  // such as one served from memory, is continued in the lane of the thread
+  // that continues it instead.
+  CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>> promise =
+      asyncSystem.createPromise<std::shared_ptr<CesiumAsync::IAssetRequest>>();
+  CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>> result =
+      promise.getFuture();
+
+  std::move(future)
+      .thenImmediately(
+          [promise](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+            UnrealTaskProcessor::LaneScope laneScope(
+                getContinuationLane(*pRequest));
+            promise.resolve(std::move(pRequest));
+          })
+      .catchImmediately([promise](std::exception&& e) {
+        promise.reject(std::runtime_error(e.what()));
+      });
+
+  return result;
+}
+
+} // namespace
+
+TaskLaneAssetAccessor::TaskLaneAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor)
+    : _pAssetAccessor(pAssetAccessor) {}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+TaskLaneAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  return continueInLane(
+      asyncSystem,
+      this->_pAssetAccessor->get(asyncSystem, url, headers));
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+TaskLaneAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  return continueInLane(
+      asyncSystem,
+      this->_pAssetAccessor
+          ->request(asyncSystem, verb, url, headers, contentPayload));
+}
+
+void TaskLaneAssetAccessor::tick() noexcept { this->_pAssetAccessor->tick(); }
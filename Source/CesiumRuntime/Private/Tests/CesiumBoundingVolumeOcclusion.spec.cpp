@@ -0,0 +1,159 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumBoundingVolumeOcclusion.h"
+#include "Misc/AutomationTest.h"
+#include <vector>
+
+using namespace Cesium3DTilesSelection;
+using namespace CesiumBoundingVolumeOcclusion;
+
+BEGIN_DEFINE_SPEC(
+    FCesiumBoundingVolumeOcclusionSpec,
+    "Cesium.Unit.BoundingVolumeOcclusion",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+END_DEFINE_SPEC(FCesiumBoundingVolumeOcclusionSpec)
+
+namespace {
+
+const QueryResult visible{0.5f, true, false};
+const QueryResult barelyVisible{0.001f, true, false};
+const QueryResult occluded{0.0f, true, true};
+const QueryResult indefinite{};
+
+} // namespace
+
+void FCesiumBoundingVolumeOcclusionSpec::Define() {
+  Describe("areResultsCurrent", [this]() {
+    It("waits for the queries of the new bounds to be read back", [this]() {
+      TestFalse("same frame", areResultsCurrent(100, 100));
+      TestFalse(
+          "last stale frame",
+          areResultsCurrent(100 + ResultLatencyFrames - 1, 100));
+      TestTrue(
+          "first current frame",
+          areResultsCurrent(100 + ResultLatencyFrames, 100));
+      TestTrue("later frame", areResultsCurrent(1000, 100));
+    });
+
+    It("rejects results read before the bounds changed", [this]() {
+      TestFalse("earlier frame", areResultsCurrent(99, 100));
+      TestFalse("much earlier frame", areResultsCurrent(0, 100));
+    });
+
+    It("handles the frame number wrapping around", [this]() {
+      const uint32 changed = 0xFFFFFFFEu;
+      TestFalse("stale", areResultsCurrent(1, changed));
+      TestTrue("current", areResultsCurrent(changed + 10, changed));
+    });
+  });
+
+  Describe("computeOcclusionState", [this]() {
+    It("is unavailable without results", [this]() {
+      TestTrue(
+          "state",
+          computeOcclusionState({}, false) ==
+              TileOcclusionState::OcclusionUnavailable);
+    });
+
+    It("follows the renderer when not previously occluded", [this]() {
+      std::vector<QueryResult> results{barelyVisible};
+      TestTrue(
+          "barely visible",
+          computeOcclusionState(results, false) ==
+              TileOcclusionState::NotOccluded);
+      results = {occluded};
+      TestTrue(
+          "occluded",
+          computeOcclusionState(results, false) ==
+              TileOcclusionState::Occluded);
+    });
+
+    It("needs enough pixels to stop being occluded", [this]() {
+      std::vector<QueryResult> results{barelyVisible};
+      TestTrue(
+          "barely visible",
+          computeOcclusionState(results, true) ==
+              TileOcclusionState::Occluded);
+      results = {visible};
+      TestTrue(
+          "visible",
+          computeOcclusionState(results, true) ==
+              TileOcclusionState::NotOccluded);
+    });
+
+    It("is not occluded when visible in any view", [this]() {
+      std::vector<QueryResult> results{occluded, visible};
+      TestTrue(
+          "state",
+          computeOcclusionState(results, false) ==
+              TileOcclusionState::NotOccluded);
+    });
+
+    It("is occluded only when occluded in every view", [this]() {
+      std::vector<QueryResult> results{occluded, occluded};
+      TestTrue(
+          "state",
+          computeOcclusionState(results, false) ==
+              TileOcclusionState::Occluded);
+    });
+
+    It("is unavailable when any view has no result", [this]() {
+      std::vector<QueryResult> results{occluded, indefinite};
+      TestTrue(
+          "state",
+          computeOcclusionState(results, false) ==
+              TileOcclusionState::OcclusionUnavailable);
+    });
+  });
+
+  Describe("SlotAllocator", [this]() {
+    It("hands out consecutive slots", [this]() {
+      SlotAllocator slots;
+      TestEqual("first", slots.allocate(), 0);
+      TestEqual("second", slots.allocate(), 1);
+      TestEqual("third", slots.allocate(), 2);
+      TestEqual("count", slots.getSlotCount(), 3);
+    });
+
+    It("reuses freed slots before adding new ones", [this]() {
+      SlotAllocator slots;
+      slots.allocate();
+      slots.allocate();
+      slots.allocate();
+      slots.free(1);
+      TestEqual("reused", slots.allocate(), 1);
+      TestEqual("count", slots.getSlotCount(), 3);
+      TestEqual("new", slots.allocate(), 3);
+      TestEqual("grown count", slots.getSlotCount(), 4);
+    });
+
+    It("ignores results for a slot reused while queries are in flight",
+       [this]() {
+         // A bounding volume in slot 0 is removed and another one is added
+         // in frame 10, while the queries issued for the old one are still
+         // being read back.
+         SlotAllocator slots;
+         std::vector<uint32> boundsChangedFrames;
+         boundsChangedFrames.emplace_back(1);
+         const int32 first = slots.allocate();
+
+         slots.free(first);
+         const int32 second = slots.allocate();
+         TestEqual("slot", second, first);
+         boundsChangedFrames[second] = 10;
+
+         // Results read in the following frames were for the old bounds.
+         for (uint32 frame = 10; frame < 10 + ResultLatencyFrames; ++frame) {
+           TestFalse(
+               "in flight",
+               areResultsCurrent(frame, boundsChangedFrames[second]));
+         }
+         TestTrue(
+             "read back",
+             areResultsCurrent(
+                 10 + ResultLatencyFrames,
+                 boundsChangedFrames[second]));
+       });
+  });
+}
@@ -0,0 +1,545 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#if WITH_EDITOR
+
+#include "Cesium3DTileset.h"
+#include "CesiumCamera.h"
+#include "CesiumCameraManager.h"
+#include "CesiumGeoreference.h"
+#include "CesiumRuntime.h"
+
+#include "Dom/JsonObject.h"
+#include "Editor.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Tests/AutomationCommon.h"
+#include "Tests/AutomationEditorCommon.h"
+
+#include <algorithm>
+#include <vector>
+
+//
+// Replays a recorded camera path against a tileset served from local files,
+// and writes per-frame streaming statistics to a JSON file. The replay runs in
+// an editor world with the camera supplied through ACesiumCameraManager, so it
+// needs neither Play-in-Editor, a GPU, nor network access. For example:
+//
+//   UnrealEditor-Cmd TestsProject.uproject -nullrhi -unattended
+//     -ExecCmds="Automation RunTests Cesium.Performance.CameraPathReplay;Quit"
+//     -CesiumReplayTileset=/data/city/tileset.json
+//     -CesiumReplayPath=/data/city/flythrough.json
+//     -CesiumReplayOutput=/tmp/flythrough-results.json
+//
+// The camera path file has this form, where locations are Unreal world
+// coordinates (centimeters) relative to the georeference origin and rotations
+// are pitch, yaw, and roll in degrees:
+//
+//   {
+//     "origin": [-104.988892, 39.743462, 1798.679443],
+//     "viewportWidth": 1280,
+//     "viewportHeight": 720,
+//     "keyframes": [
+//       { "time": 0.0, "location": [0, 0, 0], "rotation": [-5, -149, 0],
+//         "fieldOfView": 90.0 },
+//       ...
+//     ]
+//   }
+//
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+    FCesiumCameraPathReplay,
+    "Cesium.Performance.CameraPathReplay",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+namespace Cesium {
+
+struct CameraPathKeyframe {
+  double time = 0.0;
+  FVector location = FVector::ZeroVector;
+  FRotator rotation = FRotator::ZeroRotator;
+  double fieldOfView = 90.0;
+};
+
+struct CameraPath {
+  FVector origin = FVector::ZeroVector;
+  int32 viewportWidth = 1280;
+  int32 viewportHeight = 720;
+  std::vector<CameraPathKeyframe> keyframes;
+
+  double duration() const {
+    return keyframes.empty() ? 0.0 : keyframes.back().time;
+  }
+
+  CameraPathKeyframe sample(double time) const {
+    check(!keyframes.empty());
+
+    if (time <= keyframes.front().time) {
+      return keyframes.front();
+    }
+    if (time >= keyframes.back().time) {
+      return keyframes.back();
+    }
+
+    auto it = std::upper_bound(
+        keyframes.begin(),
+        keyframes.end(),
+        time,
+        [](double t, const CameraPathKeyframe& keyframe) {
+          return t < keyframe.time;
+        });
+    const CameraPathKeyframe& next = *it;
+    const CameraPathKeyframe& previous = *(it - 1);
+
+    double span = next.time - previous.time;
+    double alpha = span > 0.0 ? (time - previous.time) / span : 1.0;
+
+    CameraPathKeyframe result;
+    result.time = time;
+    result.location = FMath::Lerp(previous.location, next.location, alpha);
+    result.rotation = FQuat::Slerp(
+                          previous.rotation.Quaternion(),
+                          next.rotation.Quaternion(),
+                          alpha)
+                          .Rotator();
+    result.fieldOfView =
+        FMath::Lerp(previous.fieldOfView, next.fieldOfView, alpha);
+    return result;
+  }
+};
+
+struct ReplayFrame {
+  double time;
+  double deltaTime;
+  bool onPath;
+  float loadProgress;
+  FCesium3DTilesetStreamingStatistics statistics;
+  uint64 tilesPreparedInMainThread;
+  double mainThreadPrepareSeconds;
+
+  uint32 tilesMissing() const {
+    return statistics.TilesLoadingInWorkerThread +
+           statistics.TilesLoadingInMainThread;
+  }
+};
+
+struct CameraPathReplayContext {
+  CameraPath path;
+  FString tilesetPath;
+  FString pathFile;
+  FString outputFile;
+
+  UWorld* world = nullptr;
+  ACesium3DTileset* tileset = nullptr;
+  ACesiumCameraManager* cameraManager = nullptr;
+  int32 cameraId = -1;
+
+  bool started = false;
+  double startMark = 0.0;
+  double lastMark = 0.0;
+  double pathEndMark = -1.0;
+  FCesium3DTilesetStreamingStatistics lastStatistics;
+  std::vector<ReplayFrame> frames;
+
+  void reset() { *this = CameraPathReplayContext(); }
+};
+
+CameraPathReplayContext gCameraPathReplayContext;
+
+namespace {
+
+bool readVector(
+    const TSharedPtr<FJsonObject>& pObject,
+    const FString& field,
+    FVector& result) {
+  const TArray<TSharedPtr<FJsonValue>>* pArray;
+  if (!pObject->TryGetArrayField(field, pArray) || pArray->Num() != 3) {
+    return false;
+  }
+  result = FVector(
+      (*pArray)[0]->AsNumber(),
+      (*pArray)[1]->AsNumber(),
+      (*pArray)[2]->AsNumber());
+  return true;
+}
+
+bool loadCameraPath(
+    FAutomationTestBase& test,
+    const FString& filename,
+    CameraPath& path) {
+  FString json;
+  if (!FFileHelper::LoadFileToString(json, *filename)) {
+    test.AddError(FString::Printf(
+        TEXT("Could not read camera path file %s"),
+        *filename));
+    return false;
+  }
+
+  TSharedPtr<FJsonObject> pRoot;
+  TSharedRef<TJsonReader<>> pReader = TJsonReaderFactory<>::Create(json);
+  if (!FJsonSerializer::Deserialize(pReader, pRoot) || !pRoot.IsValid()) {
+    test.AddError(FString::Printf(
+        TEXT("Camera path file %s is not valid JSON"),
+        *filename));
+    return false;
+  }
+
+  readVector(pRoot, TEXT("origin"), path.origin);
+  pRoot->TryGetNumberField(TEXT("viewportWidth"), path.viewportWidth);
+  pRoot->TryGetNumberField(TEXT("viewportHeight"), path.viewportHeight);
+
+  const TArray<TSharedPtr<FJsonValue>>* pKeyframes;
+  if (!pRoot->TryGetArrayField(TEXT("keyframes"), pKeyframes)) {
+    test.AddError(FString::Printf(
+        TEXT("Camera path file %s does not have a keyframes array"),
+        *filename));
+    return false;
+  }
+
+  for (const TSharedPtr<FJsonValue>& pValue : *pKeyframes) {
+    const TSharedPtr<FJsonObject>* ppKeyframe;
+    if (!pValue->TryGetObject(ppKeyframe)) {
+      continue;
+    }
+
+    CameraPathKeyframe keyframe;
+    FVector rotation;
+    if (!(*ppKeyframe)->TryGetNumberField(TEXT("time"), keyframe.time) ||
+        !readVector(*ppKeyframe, TEXT("location"), keyframe.location) ||
+        !readVector(*ppKeyframe, TEXT("rotation"), rotation)) {
+      test.AddError(FString::Printf(
+          TEXT("Keyframe %d in %s must have time, location, and rotation"),
+          int32(path.keyframes.size()),
+          *filename));
+      return false;
+    }
+    keyframe.rotation = FRotator(rotation.X, rotation.Y, rotation.Z);
+    (*ppKeyframe)
+        ->TryGetNumberField(TEXT("fieldOfView"), keyframe.fieldOfView);
+
+    path.keyframes.push_back(keyframe);
+  }
+
+  if (path.keyframes.empty()) {
+    test.AddError(FString::Printf(
+        TEXT("Camera path file %s has no keyframes"),
+        *filename));
+    return false;
+  }
+
+  std::stable_sort(
+      path.keyframes.begin(),
+      path.keyframes.end(),
+      [](const CameraPathKeyframe& lhs, const CameraPathKeyframe& rhs) {
+        return lhs.time < rhs.time;
+      });
+
+  return true;
+}
+
+FCesiumCamera createCamera(const CameraPath& path, double time) {
+  CameraPathKeyframe keyframe = path.sample(time);
+  return FCesiumCamera(
+      FVector2D(path.viewportWidth, path.viewportHeight),
+      keyframe.location,
+      keyframe.rotation,
+      keyframe.fieldOfView);
+}
+
+bool writeResults(const CameraPathReplayContext& context) {
+  FString output;
+  TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> pWriter =
+      TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(
+          &output);
+
+  // Summarize the intervals in which tiles needed by the view were missing.
+  // The length of such an interval is the latency with which the tileset
+  // caught up with the camera.
+  int32 stallCount = 0;
+  double longestStall = 0.0;
+  double totalStall = 0.0;
+  double stallStart = -1.0;
+  uint32 maxTilesMissing = 0;
+  double maxMainThreadPrepareSeconds = 0.0;
+  for (const ReplayFrame& frame : context.frames) {
+    maxTilesMissing = FMath::Max(maxTilesMissing, frame.tilesMissing());
+    maxMainThreadPrepareSeconds =
+        FMath::Max(maxMainThreadPrepareSeconds, frame.mainThreadPrepareSeconds);
+
+    bool stalled = frame.tilesMissing() > 0 || frame.loadProgress < 100.0f;
+    if (stalled && stallStart < 0.0) {
+      stallStart = frame.time;
+    } else if (!stalled && stallStart >= 0.0) {
+      double duration = frame.time - stallStart;
+      ++stallCount;
+      totalStall += duration;
+      longestStall = FMath::Max(longestStall, duration);
+      stallStart = -1.0;
+    }
+  }
+
+  bool settled = stallStart < 0.0;
+  double settleTime =
+      context.frames.empty() ? 0.0 : context.frames.back().time;
+  double pathEnd = context.pathEndMark >= 0.0
+                       ? context.pathEndMark - context.startMark
+                       : settleTime;
+
+  pWriter->WriteObjectStart();
+  pWriter->WriteValue(TEXT("tileset"), context.tilesetPath);
+  pWriter->WriteValue(TEXT("cameraPath"), context.pathFile);
+  pWriter->WriteValue(TEXT("viewportWidth"), context.path.viewportWidth);
+  pWriter->WriteValue(TEXT("viewportHeight"), context.path.viewportHeight);
+
+  pWriter->WriteObjectStart(TEXT("summary"));
+  pWriter->WriteValue(TEXT("frames"), int32(context.frames.size()));
+  pWriter->WriteValue(TEXT("pathDurationSeconds"), context.path.duration());
+  pWriter->WriteValue(TEXT("settled"), settled);
+  pWriter->WriteValue(
+      TEXT("settleSecondsAfterPathEnd"),
+      settled ? FMath::Max(settleTime - pathEnd, 0.0) : -1.0);
+  pWriter->WriteValue(TEXT("loadStalls"), stallCount);
+  pWriter->WriteValue(TEXT("longestLoadStallSeconds"), longestStall);
+  pWriter->WriteValue(
+      TEXT("meanLoadStallSeconds"),
+      stallCount > 0 ? totalStall / stallCount : 0.0);
+  pWriter->WriteValue(TEXT("maxTilesMissing"), int64(maxTilesMissing));
+  pWriter->WriteValue(
+      TEXT("tilesPreparedInMainThread"),
+      int64(context.lastStatistics.TilesPreparedInMainThread));
+  pWriter->WriteValue(
+      TEXT("mainThreadPrepareSeconds"),
+      context.lastStatistics.MainThreadPrepareSeconds);
+  pWriter->WriteValue(
+      TEXT("maxFrameMainThreadPrepareSeconds"),
+      maxMainThreadPrepareSeconds);
+  pWriter->WriteValue(
+      TEXT("tilePreparationsCanceled"),
+      int64(context.lastStatistics.TilePreparationsCanceled));
+  pWriter->WriteValue(
+      TEXT("tilePreparationsWasted"),
+      int64(context.lastStatistics.TilePreparationsWasted));
+  pWriter->WriteValue(
+      TEXT("wastedPreparationSeconds"),
+      context.lastStatistics.WastedPreparationSeconds);
+  pWriter->WriteObjectEnd();
+
+  pWriter->WriteArrayStart(TEXT("frames"));
+  for (const ReplayFrame& frame : context.frames) {
+    pWriter->WriteObjectStart();
+    pWriter->WriteValue(TEXT("time"), frame.time);
+    pWriter->WriteValue(TEXT("deltaTime"), frame.deltaTime);
+    pWriter->WriteValue(TEXT("onPath"), frame.onPath);
+    pWriter->WriteValue(TEXT("loadProgress"), frame.loadProgress);
+    pWriter->WriteValue(
+        TEXT("tilesRendered"),
+        int64(frame.statistics.TilesRendered));
+    pWriter->WriteValue(TEXT("tilesMissing"), int64(frame.tilesMissing()));
+    pWriter->WriteValue(
+        TEXT("tilesLoadingInWorkerThread"),
+        int64(frame.statistics.TilesLoadingInWorkerThread));
+    pWriter->WriteValue(
+        TEXT("tilesLoadingInMainThread"),
+        int64(frame.statistics.TilesLoadingInMainThread));
+    pWriter->WriteValue(
+        TEXT("tilesVisited"),
+        int64(frame.statistics.TilesVisited));
+    pWriter->WriteValue(
+        TEXT("tilesPreparedInMainThread"),
+        int64(frame.tilesPreparedInMainThread));
+    pWriter->WriteValue(
+        TEXT("mainThreadPrepareSeconds"),
+        frame.mainThreadPrepareSeconds);
+    pWriter->WriteObjectEnd();
+  }
+  pWriter->WriteArrayEnd();
+
+  pWriter->WriteObjectEnd();
+  pWriter->Close();
+
+  return FFileHelper::SaveStringToFile(output, *context.outputFile);
+}
+
+} // namespace
+
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(
+    CameraPathReplayCommand,
+    FAutomationTestBase&,
+    test,
+    CameraPathReplayContext&,
+    context);
+bool CameraPathReplayCommand::Update() {
+  double timeMark = FPlatformTime::Seconds();
+
+  if (!context.started) {
+    context.started = true;
+    context.startMark = context.lastMark = timeMark;
+    context.tileset->SuspendUpdate = false;
+    UE_LOG(
+        LogCesium,
+        Display,
+        TEXT("-- Camera path replay start mark -- %s"),
+        *context.pathFile);
+    return false;
+  }
+
+  // Record the outcome of the tile selection made since the last update,
+  // which used the camera that was set at the last update.
+  FCesium3DTilesetStreamingStatistics statistics =
+      context.tileset->GetStreamingStatistics();
+
+  ReplayFrame& frame = context.frames.emplace_back();
+  frame.time = context.lastMark - context.startMark;
+  frame.deltaTime = timeMark - context.lastMark;
+  frame.onPath = context.pathEndMark < 0.0;
+  frame.loadProgress = context.tileset->GetLoadProgress();
+  frame.statistics = statistics;
+  frame.tilesPreparedInMainThread =
+      statistics.TilesPreparedInMainThread -
+      context.lastStatistics.TilesPreparedInMainThread;
+  frame.mainThreadPrepareSeconds =
+      statistics.MainThreadPrepareSeconds -
+      context.lastStatistics.MainThreadPrepareSeconds;
+
+  context.lastStatistics = statistics;
+  context.lastMark = timeMark;
+
+  double time = timeMark - context.startMark;
+  if (time <= context.path.duration()) {
+    FCesiumCamera camera = createCamera(context.path, time);
+    context.cameraManager->UpdateCamera(context.cameraId, camera);
+    return false;
+  }
+
+  if (context.pathEndMark < 0.0) {
+    context.pathEndMark = timeMark;
+    FCesiumCamera camera = createCamera(context.path, context.path.duration());
+    context.cameraManager->UpdateCamera(context.cameraId, camera);
+    UE_LOG(
+        LogCesium,
+        Display,
+        TEXT("-- Camera path replay end mark -- %s"),
+        *context.pathFile);
+    return false;
+  }
+
+  // After the path ends, keep recording until the final view is fully loaded.
+  // Wait for a maximum of 30 seconds.
+  const double settleTimeout = 30.0;
+  bool loaded = context.tileset->GetLoadProgress() >= 100.0f &&
+                frame.tilesMissing() == 0;
+  bool timedOut = timeMark - context.pathEndMark >= settleTimeout;
+  if (!loaded && !timedOut) {
+    return false;
+  }
+
+  if (timedOut) {
+    UE_LOG(
+        LogCesium,
+        Error,
+        TEXT("TIMED OUT: Final view did not load within %.2f seconds"),
+        settleTimeout);
+  }
+
+  if (writeResults(context)) {
+    UE_LOG(
+        LogCesium,
+        Display,
+        TEXT("Camera path replay recorded %d frames to %s"),
+        int32(context.frames.size()),
+        *context.outputFile);
+  } else {
+    test.AddError(FString::Printf(
+        TEXT("Could not write camera path replay results to %s"),
+        *context.outputFile));
+  }
+
+  context.cameraManager->RemoveCamera(context.cameraId);
+  context.tileset->SuspendUpdate = true;
+  return true;
+}
+
+} // namespace Cesium
+
+using namespace Cesium;
+
+bool FCesiumCameraPathReplay::RunTest(const FString& Parameters) {
+  CameraPathReplayContext& context = gCameraPathReplayContext;
+  context.reset();
+
+  const TCHAR* commandLine = FCommandLine::Get();
+  if (!FParse::Value(
+          commandLine,
+          TEXT("CesiumReplayTileset="),
+          context.tilesetPath) ||
+      !FParse::Value(
+          commandLine,
+          TEXT("CesiumReplayPath="),
+          context.pathFile)) {
+    AddWarning(TEXT("Skipping camera path replay. Specify a local tileset and "
+                    "a camera path with -CesiumReplayTileset=<tileset.json> "
+                    "and -CesiumReplayPath=<path.json>."));
+    return true;
+  }
+
+  if (!FParse::Value(
+          commandLine,
+          TEXT("CesiumReplayOutput="),
+          context.outputFile)) {
+    context.outputFile = FPaths::Combine(
+        FPaths::AutomationDir(),
+        FPaths::GetBaseFilename(context.pathFile) + TEXT("-replay.json"));
+  }
+
+  if (!loadCameraPath(*this, context.pathFile, context.path)) {
+    return false;
+  }
+
+  FString tilesetFilename =
+      FPaths::ConvertRelativePathToFull(context.tilesetPath);
+  if (!IFileManager::Get().FileExists(*tilesetFilename)) {
+    AddError(
+        FString::Printf(TEXT("Tileset %s does not exist"), *tilesetFilename));
+    return false;
+  }
+
+  //
+  // Programmatically set up the world. The editor world is used rather than
+  // Play-in-Editor so that the replay also works without a viewport.
+  //
+  context.world = FAutomationEditorCommonUtils::CreateNewMap();
+
+  ACesiumGeoreference* pGeoreference =
+      ACesiumGeoreference::GetDefaultGeoreference(context.world);
+  pGeoreference->SetOriginLongitudeLatitudeHeight(context.path.origin);
+
+  context.cameraManager =
+      ACesiumCameraManager::GetDefaultCameraManager(context.world);
+  context.cameraId = context.cameraManager->AddCamera(
+      createCamera(context.path, context.path.keyframes.front().time));
+
+  context.tileset = context.world->SpawnActor<ACesium3DTileset>();
+  context.tileset->SetTilesetSource(ETilesetSource::FromUrl);
+  context.tileset->SetUrl(
+      (tilesetFilename.StartsWith(TEXT("/")) ? TEXT("file://")
+                                             : TEXT("file:///")) +
+      tilesetFilename);
+  context.tileset->SetActorLabel(TEXT("Camera Path Replay Tileset"));
+  context.tileset->SuspendUpdate = true;
+
+  // Start from a cold cache so that runs are comparable
+  clearRequestCache();
+
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForShadersToFinishCompiling);
+  ADD_LATENT_AUTOMATION_COMMAND(CameraPathReplayCommand(*this, context));
+
+  return true;
+}
+
+#endif
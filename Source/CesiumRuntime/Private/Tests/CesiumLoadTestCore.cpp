@@ -4,7 +4,6 @@
 
 #include "CesiumLoadTestCore.h"
 
-#include "CesiumAsync/ICacheDatabase.h"
 #include "CesiumRuntime.h"
 
 #include "Editor.h"
@@ -182,11 +181,7 @@ bool InitForPlayWhenReady::Update() {
   return true;
 }
 
-void clearCacheDb() {
-  std::shared_ptr<CesiumAsync::ICacheDatabase> pCacheDatabase =
-      getCacheDatabase();
-  pCacheDatabase->clearAll();
-}
+void clearCacheDb() { clearRequestCache(); }
 
 bool RunLoadTest(
     const FString& testName,
@@ -31,6 +31,11 @@ struct TestPass {
 
 typedef std::function<void(const std::vector<TestPass>&)> ReportCallback;
 
+// Load tests stream from live servers unless the responses are replayed from
+// a recording. To run one without a network, run it once with
+// -CesiumRecordRequests=<directory>, and then with
+// -CesiumReplayRequests=<directory>, optionally adding
+// -CesiumReplayLatencyMs=<latency> and -CesiumReplayBandwidthMbps=<rate>.
 bool RunLoadTest(
     const FString& testName,
     std::function<void(SceneGenerationContext&)> locationSetup,
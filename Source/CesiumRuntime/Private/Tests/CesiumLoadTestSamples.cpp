@@ -6,7 +6,6 @@
 
 #include "Misc/AutomationTest.h"
 
-#include "CesiumAsync/ICacheDatabase.h"
 #include "CesiumGltfComponent.h"
 #include "CesiumIonRasterOverlay.h"
 #include "CesiumRuntime.h"
@@ -223,9 +222,7 @@ bool FSampleMaxTileLoads::RunTest(const FString& Parameters) {
   auto setupPass = [this](
                        SceneGenerationContext& context,
                        TestPass::TestingParameter parameter) {
-    std::shared_ptr<CesiumAsync::ICacheDatabase> pCacheDatabase =
-        getCacheDatabase();
-    pCacheDatabase->clearAll();
+    clearRequestCache();
 
     int maxLoadsTarget = std::get<int>(parameter);
     context.setMaximumSimultaneousTileLoads(maxLoadsTarget);
@@ -0,0 +1,130 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumMipGeneration.h"
+#include "Misc/AutomationTest.h"
+#include <cstddef>
+#include <cstdint>
+
+using namespace CesiumGltf;
+
+BEGIN_DEFINE_SPEC(
+    FCesiumMipGenerationSpec,
+    "Cesium.Unit.MipGeneration",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+ImageCesium MakeImage(int32 width, int32 height, int32 channels) {
+  ImageCesium image;
+  image.width = width;
+  image.height = height;
+  image.channels = channels;
+  image.bytesPerChannel = 1;
+  image.pixelData.resize(size_t(width * height * channels));
+  for (size_t i = 0; i < image.pixelData.size(); ++i) {
+    image.pixelData[i] = std::byte((i * 37 + i / 5) & 0xff);
+  }
+  return image;
+}
+
+uint8 At(const ImageCesium& image, size_t mip, size_t index) {
+  return uint8(image.pixelData[image.mipPositions[mip].byteOffset + index]);
+}
+
+END_DEFINE_SPEC(FCesiumMipGenerationSpec)
+
+void FCesiumMipGenerationSpec::Define() {
+  It("lays out the whole chain after the image", [this]() {
+    ImageCesium image = MakeImage(8, 2, 4);
+    TestFalse(
+        "error",
+        CesiumMipGeneration::generateMipMaps(image).has_value());
+
+    const int64 expectedSizes[] = {64, 16, 8, 4};
+    TestEqual("mips", int(image.mipPositions.size()), 4);
+    int64 offset = 0;
+    for (size_t i = 0; i < image.mipPositions.size(); ++i) {
+      TestEqual(
+          "offset",
+          int64(image.mipPositions[i].byteOffset),
+          offset);
+      TestEqual(
+          "size",
+          int64(image.mipPositions[i].byteSize),
+          expectedSizes[i]);
+      offset += int64(image.mipPositions[i].byteSize);
+    }
+    TestEqual("total", int64(image.pixelData.size()), offset);
+  });
+
+  for (int32 channels : {1, 2, 3, 4}) {
+    It(FString::Printf(TEXT("averages 2x2 texels with %d channels"), channels),
+       [this, channels]() {
+         ImageCesium image = MakeImage(4, 4, channels);
+         ImageCesium source = image;
+         CesiumMipGeneration::generateMipMaps(image);
+
+         for (int32 y = 0; y < 2; ++y) {
+           for (int32 x = 0; x < 2; ++x) {
+             for (int32 c = 0; c < channels; ++c) {
+               auto texel = [&](int32 sx, int32 sy) {
+                 return int32(At(source, 0, (sy * 4 + sx) * channels + c));
+               };
+               int32 expected =
+                   (texel(2 * x, 2 * y) + texel(2 * x + 1, 2 * y) +
+                    texel(2 * x, 2 * y + 1) + texel(2 * x + 1, 2 * y + 1) +
+                    2) /
+                   4;
+               TestEqual(
+                   "texel",
+                   int32(At(image, 1, (y * 2 + x) * channels + c)),
+                   expected);
+             }
+           }
+         }
+       });
+  }
+
+  It("averages pairs once a dimension reaches one", [this]() {
+    ImageCesium image = MakeImage(4, 1, 4);
+    ImageCesium source = image;
+    CesiumMipGeneration::generateMipMaps(image);
+
+    for (size_t i = 0; i < 8; ++i) {
+      size_t sourceIndex = (i / 4) * 8 + i % 4;
+      int32 expected =
+          (int32(At(source, 0, sourceIndex)) +
+           int32(At(source, 0, sourceIndex + 4)) + 1) /
+          2;
+      TestEqual("texel", int32(At(image, 1, i)), expected);
+    }
+  });
+
+  It("produces the same mips in parallel", [this]() {
+    ImageCesium parallel = MakeImage(1024, 512, 4);
+    ImageCesium serial = parallel;
+    CesiumMipGeneration::generateMipMaps(parallel, true);
+    CesiumMipGeneration::generateMipMaps(serial, false);
+    TestTrue("same", parallel.pixelData == serial.pixelData);
+  });
+
+  It("passes other images to the glTF reader", [this]() {
+    ImageCesium image = MakeImage(6, 6, 4);
+    TestFalse(
+        "box filter",
+        CesiumMipGeneration::canGenerateMipMaps(image));
+    CesiumMipGeneration::generateMipMaps(image);
+    TestTrue("mips", image.mipPositions.size() > 1);
+    TestEqual(
+        "first mip size",
+        int64(image.mipPositions[1].byteSize),
+        int64(3 * 3 * 4));
+  });
+
+  It("leaves images with mips alone", [this]() {
+    ImageCesium image = MakeImage(4, 4, 4);
+    image.mipPositions.push_back({0, image.pixelData.size()});
+    CesiumMipGeneration::generateMipMaps(image);
+    TestEqual("mips", int(image.mipPositions.size()), 1);
+    TestEqual("size", int64(image.pixelData.size()), int64(64));
+  });
+}
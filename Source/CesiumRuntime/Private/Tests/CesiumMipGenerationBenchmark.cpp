@@ -0,0 +1,108 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumMipGeneration.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include <CesiumGltfReader/GltfReader.h>
+#include <cstddef>
+#include <functional>
+
+//
+// Compares the time taken to generate the mips of synthetic RGBA images with
+// the glTF reader's mip generator, which Cesium used before, and with
+// Cesium's box filter, on one thread and split across worker threads. The
+// mean time for each is logged. For example:
+//
+//   UnrealEditor-Cmd TestsProject.uproject -nullrhi -unattended
+//     -ExecCmds="Automation RunTests Cesium.Performance.MipGeneration;Quit"
+//     -CesiumBenchmarkSize=4096 -CesiumBenchmarkIterations=10
+//
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+    FCesiumMipGenerationBenchmark,
+    "Cesium.Performance.MipGeneration",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::PerfFilter)
+
+namespace {
+
+CesiumGltf::ImageCesium makeImage(int32 size) {
+  CesiumGltf::ImageCesium image;
+  image.width = size;
+  image.height = size;
+  image.channels = 4;
+  image.bytesPerChannel = 1;
+  image.pixelData.resize(size_t(size) * size_t(size) * 4);
+  uint32 value = 0x12345678;
+  for (std::byte& byte : image.pixelData) {
+    value = value * 1664525u + 1013904223u;
+    byte = std::byte(value >> 24);
+  }
+  return image;
+}
+
+// Returns the mean seconds taken to generate the mips of a fresh copy of the
+// image.
+double measure(
+    const CesiumGltf::ImageCesium& source,
+    int32 iterations,
+    const std::function<void(CesiumGltf::ImageCesium&)>& generate) {
+  double totalSeconds = 0.0;
+  for (int32 i = 0; i < iterations; ++i) {
+    CesiumGltf::ImageCesium image = source;
+    double startTime = FPlatformTime::Seconds();
+    generate(image);
+    totalSeconds += FPlatformTime::Seconds() - startTime;
+  }
+  return totalSeconds / double(iterations);
+}
+
+} // namespace
+
+bool FCesiumMipGenerationBenchmark::RunTest(const FString& Parameters) {
+  int32 size = 2048;
+  FParse::Value(FCommandLine::Get(), TEXT("CesiumBenchmarkSize="), size);
+  int32 iterations = 5;
+  FParse::Value(
+      FCommandLine::Get(),
+      TEXT("CesiumBenchmarkIterations="),
+      iterations);
+  iterations = FMath::Max(iterations, 1);
+
+  CesiumGltf::ImageCesium source = makeImage(size);
+
+  double readerSeconds =
+      measure(source, iterations, [](CesiumGltf::ImageCesium& image) {
+        CesiumGltfReader::GltfReader::generateMipMaps(image);
+      });
+  double serialSeconds =
+      measure(source, iterations, [](CesiumGltf::ImageCesium& image) {
+        CesiumMipGeneration::generateMipMaps(image, false);
+      });
+  double parallelSeconds =
+      measure(source, iterations, [](CesiumGltf::ImageCesium& image) {
+        CesiumMipGeneration::generateMipMaps(image, true);
+      });
+
+  AddInfo(FString::Printf(
+      TEXT(
+          "%dx%d RGBA: glTF reader %.2f ms, box filter %.2f ms (%.1fx), parallel box filter %.2f ms (%.1fx)"),
+      size,
+      size,
+      readerSeconds * 1000.0,
+      serialSeconds * 1000.0,
+      readerSeconds / serialSeconds,
+      parallelSeconds * 1000.0,
+      readerSeconds / parallelSeconds));
+
+  CesiumGltf::ImageCesium image = source;
+  CesiumMipGeneration::generateMipMaps(image);
+  TestEqual(
+      "mips",
+      int32(image.mipPositions.size()),
+      int32(FMath::FloorLog2(uint32(size))) + 1);
+
+  return true;
+}
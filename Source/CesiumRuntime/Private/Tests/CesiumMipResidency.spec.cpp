@@ -0,0 +1,86 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumMipResidency.h"
+#include "Misc/AutomationTest.h"
+#include <limits>
+
+BEGIN_DEFINE_SPEC(
+    FCesiumMipResidencySpec,
+    "Cesium.Unit.MipResidency",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+END_DEFINE_SPEC(FCesiumMipResidencySpec)
+
+void FCesiumMipResidencySpec::Define() {
+  Describe("computeProjectedPixels", [this]() {
+    It("spans the viewport when the sphere fills the view", [this]() {
+      // With a 90 degree field of view, the view is as wide as twice the
+      // distance.
+      TestEqual(
+          "pixels",
+          CesiumMipResidency::computeProjectedPixels(10.0, 10.0001, 90.0, 1e3),
+          1000.0,
+          0.1);
+    });
+
+    It("halves when the distance doubles", [this]() {
+      double near =
+          CesiumMipResidency::computeProjectedPixels(1.0, 100.0, 60.0, 1920.0);
+      double far =
+          CesiumMipResidency::computeProjectedPixels(1.0, 200.0, 60.0, 1920.0);
+      TestEqual("ratio", near / far, 2.0, 1e-9);
+    });
+
+    It("is unbounded inside the sphere", [this]() {
+      TestEqual(
+          "pixels",
+          CesiumMipResidency::computeProjectedPixels(10.0, 5.0, 60.0, 1920.0),
+          std::numeric_limits<double>::max());
+    });
+  });
+
+  Describe("computeWantedFirstMip", [this]() {
+    It("wants the first mip when the texture is magnified", [this]() {
+      TestEqual(
+          "mip",
+          CesiumMipResidency::computeWantedFirstMip(1024, 1024, 11, 2048.0),
+          0);
+    });
+
+    It("skips a mip each time the projected size halves", [this]() {
+      TestEqual(
+          "half",
+          CesiumMipResidency::computeWantedFirstMip(1024, 512, 11, 512.0),
+          1);
+      TestEqual(
+          "quarter",
+          CesiumMipResidency::computeWantedFirstMip(1024, 512, 11, 200.0),
+          2);
+    });
+
+    It("keeps the minimum resident size", [this]() {
+      TestEqual(
+          "distant",
+          CesiumMipResidency::computeWantedFirstMip(1024, 1024, 11, 0.5),
+          4);
+      TestEqual(
+          "small",
+          CesiumMipResidency::computeWantedFirstMip(64, 64, 7, 1.0),
+          0);
+    });
+  });
+
+  Describe("updateFirstResidentMip", [this]() {
+    It("restores wanted mips at once", [this]() {
+      TestEqual("mip", CesiumMipResidency::updateFirstResidentMip(4, 1), 1);
+    });
+
+    It("keeps one more mip than wanted", [this]() {
+      TestEqual("held", CesiumMipResidency::updateFirstResidentMip(2, 3), 2);
+      TestEqual(
+          "released",
+          CesiumMipResidency::updateFirstResidentMip(0, 4),
+          3);
+    });
+  });
+}
@@ -0,0 +1,181 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumAsync/ICacheDatabase.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * In-memory stand-ins for the network and the cache database, shared by the
+ * specs of the asset accessors and cache databases that wrap them.
+ */
+namespace CesiumTestFakes {
+
+class FakeAssetResponse : public CesiumAsync::IAssetResponse {
+public:
+  FakeAssetResponse(
+      uint16_t statusCode,
+      CesiumAsync::HttpHeaders&& headers,
+      std::vector<std::byte>&& data)
+      : _statusCode(statusCode),
+        _headers(std::move(headers)),
+        _data(std::move(data)) {}
+
+  virtual uint16_t statusCode() const override { return this->_statusCode; }
+  virtual std::string contentType() const override {
+    auto it = this->_headers.find("Content-Type");
+    return it == this->_headers.end() ? std::string() : it->second;
+  }
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+  virtual gsl::span<const std::byte> data() const override {
+    return this->_data;
+  }
+
+private:
+  uint16_t _statusCode;
+  CesiumAsync::HttpHeaders _headers;
+  std::vector<std::byte> _data;
+};
+
+class FakeAssetRequest : public CesiumAsync::IAssetRequest {
+public:
+  /**
+   * Creates a request that has no response, as if it failed to connect.
+   */
+  explicit FakeAssetRequest(const std::string& url) : _url(url) {}
+
+  FakeAssetRequest(const std::string& url, FakeAssetResponse&& response)
+      : _url(url), _response(std::move(response)) {}
+
+  virtual const std::string& method() const override { return this->_method; }
+  virtual const std::string& url() const override { return this->_url; }
+  virtual const CesiumAsync::HttpHeaders& headers() const override {
+    return this->_headers;
+  }
+  virtual const CesiumAsync::IAssetResponse* response() const override {
+    return this->_response ? &*this->_response : nullptr;
+  }
+
+private:
+  std::string _method = "GET";
+  std::string _url;
+  CesiumAsync::HttpHeaders _headers;
+  std::optional<FakeAssetResponse> _response;
+};
+
+/**
+ * An accessor that records the URLs it is asked for. By default it responds
+ * immediately with a body of the configured size, status, and headers. When
+ * `deferResponses` is set, its requests complete only when the test resolves
+ * the corresponding promise.
+ */
+class FakeAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override {
+    this->urls.push_back(url);
+
+    if (this->deferResponses) {
+      auto promise = asyncSystem.createPromise<
+          std::shared_ptr<CesiumAsync::IAssetRequest>>();
+      this->promises.push_back(promise);
+      return promise.getFuture();
+    }
+
+    return asyncSystem.createResolvedFuture(
+        std::shared_ptr<CesiumAsync::IAssetRequest>(
+            std::make_shared<FakeAssetRequest>(
+                url,
+                FakeAssetResponse(
+                    this->statusCode,
+                    CesiumAsync::HttpHeaders(this->responseHeaders),
+                    std::vector<std::byte>(this->size, std::byte('x'))))));
+  }
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override {
+    return this->get(asyncSystem, url, headers);
+  }
+
+  virtual void tick() noexcept override {}
+
+  std::vector<std::string> urls;
+
+  uint16_t statusCode = 200;
+  size_t size = 1000;
+  CesiumAsync::HttpHeaders responseHeaders;
+
+  bool deferResponses = false;
+  std::vector<
+      CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>>>
+      promises;
+};
+
+/**
+ * A cache database that keeps its entries in memory.
+ */
+class FakeCacheDatabase : public CesiumAsync::ICacheDatabase {
+public:
+  virtual std::optional<CesiumAsync::CacheItem>
+  getEntry(const std::string& key) const override {
+    auto it = this->items.find(key);
+    if (it == this->items.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  virtual bool storeEntry(
+      const std::string& key,
+      std::time_t expiryTime,
+      const std::string& url,
+      const std::string& requestMethod,
+      const CesiumAsync::HttpHeaders& requestHeaders,
+      uint16_t statusCode,
+      const CesiumAsync::HttpHeaders& responseHeaders,
+      const gsl::span<const std::byte>& responseData) override {
+    this->items.insert_or_assign(
+        key,
+        CesiumAsync::CacheItem{
+            expiryTime,
+            CesiumAsync::CacheRequest(requestHeaders, requestMethod, url),
+            CesiumAsync::CacheResponse(
+                statusCode,
+                responseHeaders,
+                std::vector<std::byte>(
+                    responseData.begin(),
+                    responseData.end()))});
+    return true;
+  }
+
+  virtual bool prune() override { return true; }
+
+  virtual bool clearAll() override {
+    this->items.clear();
+    return true;
+  }
+
+  std::map<std::string, CesiumAsync::CacheItem> items;
+};
+
+} // namespace CesiumTestFakes
@@ -0,0 +1,257 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTextureCompression.h"
+#include "Misc/AutomationTest.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace CesiumGltf;
+
+BEGIN_DEFINE_SPEC(
+    FCesiumTextureCompressionSpec,
+    "Cesium.Unit.TextureCompression",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+// Decodes the color of one texel of a BC1 block in the four-color mode.
+void DecodeColor(const std::byte* pBlock, int32 texel, int32* pColor) {
+  auto unpack = [](uint32 packed, int32* pResult) {
+    uint32 r = (packed >> 11) & 31;
+    uint32 g = (packed >> 5) & 63;
+    uint32 b = packed & 31;
+    pResult[0] = int32((r << 3) | (r >> 2));
+    pResult[1] = int32((g << 2) | (g >> 4));
+    pResult[2] = int32((b << 3) | (b >> 2));
+  };
+
+  uint32 color0 = uint32(pBlock[0]) | (uint32(pBlock[1]) << 8);
+  uint32 color1 = uint32(pBlock[2]) | (uint32(pBlock[3]) << 8);
+  uint32 index = (uint32(pBlock[4 + texel / 4]) >> ((texel % 4) * 2)) & 3;
+
+  int32 endpoint0[3];
+  int32 endpoint1[3];
+  unpack(color0, endpoint0);
+  unpack(color1, endpoint1);
+  for (int32 c = 0; c < 3; ++c) {
+    switch (index) {
+    case 0:
+      pColor[c] = endpoint0[c];
+      break;
+    case 1:
+      pColor[c] = endpoint1[c];
+      break;
+    case 2:
+      pColor[c] = (2 * endpoint0[c] + endpoint1[c]) / 3;
+      break;
+    default:
+      pColor[c] = (endpoint0[c] + 2 * endpoint1[c]) / 3;
+      break;
+    }
+  }
+}
+
+// Decodes the alpha of one texel of a BC3 block.
+int32 DecodeAlpha(const std::byte* pBlock, int32 texel) {
+  int32 alpha0 = int32(pBlock[0]);
+  int32 alpha1 = int32(pBlock[1]);
+  uint64 bits = 0;
+  for (int32 i = 0; i < 6; ++i) {
+    bits |= uint64(pBlock[2 + i]) << (8 * i);
+  }
+  int32 index = int32((bits >> (3 * texel)) & 7);
+  if (index == 0) {
+    return alpha0;
+  }
+  if (index == 1) {
+    return alpha1;
+  }
+  return ((8 - index) * alpha0 + (index - 1) * alpha1) / 7;
+}
+
+ImageCesium MakeImage(int32 width, int32 height, uint8 alpha) {
+  ImageCesium image;
+  image.width = width;
+  image.height = height;
+  image.channels = 4;
+  image.bytesPerChannel = 1;
+  image.pixelData.resize(size_t(width * height * 4));
+  for (int32 i = 0; i < width * height; ++i) {
+    image.pixelData[i * 4] = std::byte(i * 7);
+    image.pixelData[i * 4 + 1] = std::byte(i * 3);
+    image.pixelData[i * 4 + 2] = std::byte(255 - i);
+    image.pixelData[i * 4 + 3] = std::byte(alpha);
+  }
+  return image;
+}
+
+END_DEFINE_SPEC(FCesiumTextureCompressionSpec)
+
+void FCesiumTextureCompressionSpec::Define() {
+  for (bool highQuality : {false, true}) {
+    Describe(
+        highQuality ? TEXT("high quality") : TEXT("fast"),
+        [this, highQuality]() {
+          It("keeps a solid block's color", [this, highQuality]() {
+            uint8 texels[64];
+            for (int32 i = 0; i < 16; ++i) {
+              texels[i * 4] = 255;
+              texels[i * 4 + 1] = 0;
+              texels[i * 4 + 2] = 0;
+              texels[i * 4 + 3] = 255;
+            }
+
+            std::byte block[CesiumTextureCompression::BC1BlockBytes];
+            CesiumTextureCompression::compressBC1Block(
+                texels,
+                highQuality,
+                block);
+
+            int32 color[3];
+            DecodeColor(block, 5, color);
+            TestEqual("red", color[0], 255);
+            TestEqual("green", color[1], 0);
+            TestEqual("blue", color[2], 0);
+          });
+
+          It("approximates a gradient", [this, highQuality]() {
+            uint8 texels[64];
+            for (int32 i = 0; i < 16; ++i) {
+              texels[i * 4] = uint8(i * 16);
+              texels[i * 4 + 1] = uint8(i * 8);
+              texels[i * 4 + 2] = uint8(255 - i * 16);
+              texels[i * 4 + 3] = 255;
+            }
+
+            std::byte block[CesiumTextureCompression::BC1BlockBytes];
+            CesiumTextureCompression::compressBC1Block(
+                texels,
+                highQuality,
+                block);
+
+            uint32 color0 = uint32(block[0]) | (uint32(block[1]) << 8);
+            uint32 color1 = uint32(block[2]) | (uint32(block[3]) << 8);
+            TestTrue("four-color mode", color0 > color1);
+
+            for (int32 i = 0; i < 16; ++i) {
+              int32 color[3];
+              DecodeColor(block, i, color);
+              for (int32 c = 0; c < 3; ++c) {
+                TestTrue(
+                    "close",
+                    std::abs(color[c] - int32(texels[i * 4 + c])) <= 48);
+              }
+            }
+          });
+
+          It("keeps the alpha of two-valued blocks", [this, highQuality]() {
+            uint8 texels[64];
+            for (int32 i = 0; i < 16; ++i) {
+              texels[i * 4] = 40;
+              texels[i * 4 + 1] = 80;
+              texels[i * 4 + 2] = 120;
+              texels[i * 4 + 3] = i % 2 == 0 ? 0 : 200;
+            }
+
+            std::byte block[CesiumTextureCompression::BC3BlockBytes];
+            CesiumTextureCompression::compressBC3Block(
+                texels,
+                highQuality,
+                block);
+
+            for (int32 i = 0; i < 16; ++i) {
+              TestEqual(
+                  "alpha",
+                  DecodeAlpha(block, i),
+                  int32(texels[i * 4 + 3]));
+            }
+          });
+        });
+  }
+
+  It("chooses BC1 for opaque images and BC3 for others", [this]() {
+    std::optional<GpuCompressedPixelFormat> opaque =
+        CesiumTextureCompression::chooseFormat(MakeImage(8, 8, 255));
+    TestTrue("opaque", opaque.has_value());
+    TestEqual(
+        "opaque format",
+        int(opaque.value_or(GpuCompressedPixelFormat::NONE)),
+        int(GpuCompressedPixelFormat::BC1_RGB));
+
+    std::optional<GpuCompressedPixelFormat> translucent =
+        CesiumTextureCompression::chooseFormat(MakeImage(8, 8, 128));
+    TestTrue("translucent", translucent.has_value());
+    TestEqual(
+        "translucent format",
+        int(translucent.value_or(GpuCompressedPixelFormat::NONE)),
+        int(GpuCompressedPixelFormat::BC3_RGBA));
+  });
+
+  It("does not compress images it cannot", [this]() {
+    TestFalse(
+        "not a multiple of four",
+        CesiumTextureCompression::chooseFormat(MakeImage(6, 8, 255))
+            .has_value());
+
+    ImageCesium threeChannels = MakeImage(8, 8, 255);
+    threeChannels.channels = 3;
+    TestFalse(
+        "three channels",
+        CesiumTextureCompression::chooseFormat(threeChannels).has_value());
+
+    ImageCesium compressed = MakeImage(8, 8, 255);
+    compressed.compressedPixelFormat = GpuCompressedPixelFormat::BC7_RGBA;
+    TestFalse(
+        "already compressed",
+        CesiumTextureCompression::chooseFormat(compressed).has_value());
+
+    TestFalse(
+        "disabled",
+        CesiumTextureCompression::compressForUpload(
+            MakeImage(8, 8, 255),
+            ECesiumTextureCompression::None)
+            .has_value());
+  });
+
+  It("compresses every mip", [this]() {
+    ImageCesium image = MakeImage(8, 8, 128);
+    size_t mip0Size = image.pixelData.size();
+    image.pixelData.resize(mip0Size + 4 * 4 * 4 + 2 * 2 * 4 + 4);
+    image.mipPositions = {
+        {0, mip0Size},
+        {mip0Size, 64},
+        {mip0Size + 64, 16},
+        {mip0Size + 80, 4}};
+
+    ImageCesium compressed = CesiumTextureCompression::compressImage(
+        image,
+        GpuCompressedPixelFormat::BC3_RGBA,
+        false);
+
+    TestEqual("width", compressed.width, 8);
+    TestEqual(
+        "format",
+        int(compressed.compressedPixelFormat),
+        int(GpuCompressedPixelFormat::BC3_RGBA));
+    TestEqual("mips", int(compressed.mipPositions.size()), 4);
+
+    // Mips smaller than a block still take a whole block.
+    const int32 expectedBlocks[] = {4, 1, 1, 1};
+    size_t offset = 0;
+    for (size_t i = 0; i < compressed.mipPositions.size(); ++i) {
+      TestEqual(
+          "offset",
+          int64(compressed.mipPositions[i].byteOffset),
+          int64(offset));
+      TestEqual(
+          "size",
+          int64(compressed.mipPositions[i].byteSize),
+          int64(expectedBlocks[i] * 16));
+      offset += compressed.mipPositions[i].byteSize;
+    }
+    TestEqual(
+        "total size",
+        int64(compressed.pixelData.size()),
+        int64(offset));
+  });
+}
@@ -0,0 +1,148 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTextureMemory.h"
+#include "Misc/AutomationTest.h"
+#include <memory>
+#include <utility>
+
+BEGIN_DEFINE_SPEC(
+    FCesiumTextureMemorySpec,
+    "Cesium.Unit.TextureMemory",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+using Category = CesiumTextureMemory::Category;
+
+int64 BytesOf(const CesiumTextureMemory& memory, Category category) {
+  return memory.getStatistics().bytes[size_t(category)];
+}
+
+END_DEFINE_SPEC(FCesiumTextureMemorySpec)
+
+void FCesiumTextureMemorySpec::Define() {
+  Describe("Allocation", [this]() {
+    It("counts a texture against its owner and globally", [this]() {
+      auto pOwner = std::make_shared<CesiumTextureMemory>();
+      int64 globalBefore =
+          getGlobalTextureMemory().getStatistics().getTotalBytes();
+
+      {
+        CesiumTextureMemory::Allocation gltf(
+            pOwner,
+            Category::GltfTexture,
+            1000);
+        CesiumTextureMemory::Allocation overlay(
+            pOwner,
+            Category::RasterOverlay,
+            24);
+        TestEqual("glTF", BytesOf(*pOwner, Category::GltfTexture), int64(1000));
+        TestEqual(
+            "metadata",
+            BytesOf(*pOwner, Category::MetadataTexture),
+            int64(0));
+        TestEqual(
+            "overlay",
+            BytesOf(*pOwner, Category::RasterOverlay),
+            int64(24));
+        TestEqual(
+            "total",
+            pOwner->getStatistics().getTotalBytes(),
+            int64(1024));
+        TestEqual(
+            "global",
+            getGlobalTextureMemory().getStatistics().getTotalBytes(),
+            globalBefore + 1024);
+      }
+
+      TestEqual("freed", pOwner->getStatistics().getTotalBytes(), int64(0));
+      TestEqual(
+          "global freed",
+          getGlobalTextureMemory().getStatistics().getTotalBytes(),
+          globalBefore);
+    });
+
+    It("moves and resets", [this]() {
+      auto pFirst = std::make_shared<CesiumTextureMemory>();
+      auto pSecond = std::make_shared<CesiumTextureMemory>();
+
+      CesiumTextureMemory::Allocation allocation(
+          pFirst,
+          Category::MetadataTexture,
+          64);
+      CesiumTextureMemory::Allocation moved(std::move(allocation));
+      allocation.reset();
+      TestEqual(
+          "moved",
+          BytesOf(*pFirst, Category::MetadataTexture),
+          int64(64));
+
+      moved = CesiumTextureMemory::Allocation(
+          pSecond,
+          Category::MetadataTexture,
+          16);
+      TestEqual("first", BytesOf(*pFirst, Category::MetadataTexture), int64(0));
+      TestEqual(
+          "second",
+          BytesOf(*pSecond, Category::MetadataTexture),
+          int64(16));
+
+      moved.reset();
+      TestEqual(
+          "reset",
+          BytesOf(*pSecond, Category::MetadataTexture),
+          int64(0));
+    });
+  });
+
+  It("restores the previous owner when a scope ends", [this]() {
+    auto pOuter = std::make_shared<CesiumTextureMemory>();
+    auto pInner = std::make_shared<CesiumTextureMemory>();
+    TestNull("none", CesiumTextureMemory::getCurrentOwner().get());
+    {
+      CesiumTextureMemory::OwnerScope outer(pOuter);
+      {
+        CesiumTextureMemory::OwnerScope inner(pInner);
+        TestTrue("inner", CesiumTextureMemory::getCurrentOwner() == pInner);
+      }
+      TestTrue("outer", CesiumTextureMemory::getCurrentOwner() == pOuter);
+    }
+    TestNull("none again", CesiumTextureMemory::getCurrentOwner().get());
+  });
+
+  Describe("updateBudgetScale", [this]() {
+    It("is one without a budget", [this]() {
+      TestEqual(
+          "scale",
+          CesiumTextureMemory::updateBudgetScale(4.0, 1000, 0, 1.0),
+          1.0);
+    });
+
+    It("doubles every second over the budget, up to a limit", [this]() {
+      TestEqual(
+          "one second",
+          CesiumTextureMemory::updateBudgetScale(1.0, 200, 100, 1.0),
+          2.0);
+      TestEqual(
+          "limit",
+          CesiumTextureMemory::updateBudgetScale(8.0, 200, 100, 10.0),
+          CesiumTextureMemory::MaximumBudgetScale);
+    });
+
+    It("holds near the budget", [this]() {
+      TestEqual(
+          "scale",
+          CesiumTextureMemory::updateBudgetScale(4.0, 90, 100, 1.0),
+          4.0);
+    });
+
+    It("recovers slowly well under the budget", [this]() {
+      double scale =
+          CesiumTextureMemory::updateBudgetScale(4.0, 10, 100, 4.0);
+      TestEqual("halved", scale, 2.0);
+      TestEqual(
+          "not below one",
+          CesiumTextureMemory::updateBudgetScale(1.1, 10, 100, 100.0),
+          1.0);
+    });
+  });
+}
@@ -0,0 +1,91 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTexturePool.h"
+#include "Engine/Texture2D.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+BEGIN_DEFINE_SPEC(
+    FCesiumTexturePoolSpec,
+    "Cesium.Unit.TexturePool",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+const CesiumTexturePool::Key overlayKey{
+    256,
+    256,
+    PF_R8G8B8A8,
+    9,
+    true,
+    TF_Default,
+    TEXTUREGROUP_World};
+
+UTexture2D* MakeTexture() {
+  UTexture2D* pTexture = NewObject<UTexture2D>(GetTransientPackage());
+  pTexture->AddToRoot();
+  return pTexture;
+}
+
+END_DEFINE_SPEC(FCesiumTexturePoolSpec)
+
+void FCesiumTexturePoolSpec::Define() {
+  It("reuses a released texture with the same key", [this]() {
+    CesiumTexturePool pool(4);
+    TestNull("empty", pool.acquire(overlayKey));
+
+    UTexture2D* pTexture = MakeTexture();
+    pool.track(pTexture, overlayKey);
+    pool.release(pTexture);
+    TestTrue("still rooted", pTexture->IsRooted());
+
+    CesiumTexturePool::Key otherKey = overlayKey;
+    otherKey.mipCount = 1;
+    TestNull("other key", pool.acquire(otherKey));
+    TestTrue("same key", pool.acquire(overlayKey) == pTexture);
+    TestNull("taken", pool.acquire(overlayKey));
+
+    CesiumTexturePool::Statistics statistics = pool.getStatistics();
+    TestEqual("hits", statistics.hits, int64_t(1));
+    TestEqual("misses", statistics.misses, int64_t(3));
+    TestEqual("pooled", statistics.pooled, 0);
+
+    pool.release(pTexture);
+    pool.clear();
+    TestFalse("cleared", pTexture->IsRooted());
+  });
+
+  It("destroys textures beyond its size", [this]() {
+    CesiumTexturePool pool(1);
+    UTexture2D* pFirst = MakeTexture();
+    UTexture2D* pSecond = MakeTexture();
+    pool.track(pFirst, overlayKey);
+    pool.track(pSecond, overlayKey);
+
+    pool.release(pFirst);
+    pool.release(pSecond);
+    TestTrue("first kept", pFirst->IsRooted());
+    TestFalse("second destroyed", pSecond->IsRooted());
+    TestEqual("pooled", pool.getStatistics().pooled, 1);
+
+    pool.clear();
+    TestEqual("cleared", pool.getStatistics().pooled, 0);
+  });
+
+  It("destroys textures it was not told about", [this]() {
+    CesiumTexturePool pool(4);
+    UTexture2D* pTexture = MakeTexture();
+    pool.release(pTexture);
+    TestFalse("destroyed", pTexture->IsRooted());
+    TestNull("not pooled", pool.acquire(overlayKey));
+  });
+
+  It("never pools when its size is zero", [this]() {
+    CesiumTexturePool pool(0);
+    UTexture2D* pTexture = MakeTexture();
+    pool.track(pTexture, overlayKey);
+    pool.release(pTexture);
+    TestFalse("destroyed", pTexture->IsRooted());
+    TestNull("not pooled", pool.acquire(overlayKey));
+    TestEqual("misses", pool.getStatistics().misses, int64_t(0));
+  });
+}
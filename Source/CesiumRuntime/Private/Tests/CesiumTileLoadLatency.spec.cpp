@@ -0,0 +1,176 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CesiumTileLoadLatency.h"
+#include "CesiumRuntime.h"
+#include "CesiumTestFakes.h"
+#include "LoadLatencyAssetAccessor.h"
+#include "Misc/AutomationTest.h"
+#include <limits>
+#include <memory>
+
+using namespace CesiumTestFakes;
+
+BEGIN_DEFINE_SPEC(
+    FCesiumTileLoadLatencySpec,
+    "Cesium.Unit.TileLoadLatency",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+CesiumTileLoadLatencyHistograms histograms;
+
+END_DEFINE_SPEC(FCesiumTileLoadLatencySpec)
+
+namespace {
+
+// The ratio between the bounds of one histogram bucket, 10^(1/8), rounded up.
+// A percentile estimated from the buckets is within this factor of the true
+// value.
+constexpr double BucketFactor = 1.34;
+
+bool isWithinBucket(double actual, double expected) {
+  return actual >= expected / BucketFactor && actual <= expected * BucketFactor;
+}
+
+} // namespace
+
+void FCesiumTileLoadLatencySpec::Define() {
+  BeforeEach([this]() { histograms.reset(); });
+
+  Describe("CesiumTileLoadLatencyHistograms", [this]() {
+    It("reports nothing without measurements", [this]() {
+      FCesiumTileLoadLatency latency =
+          histograms.summarize(ECesiumTileLoadStage::Total);
+      TestEqual("count", latency.Count, int64(0));
+      TestEqual("p50", latency.P50Seconds, 0.0);
+      TestEqual("p99", latency.P99Seconds, 0.0);
+      TestEqual("max", latency.MaxSeconds, 0.0);
+    });
+
+    It("reports identical latencies without exceeding them", [this]() {
+      for (int i = 0; i < 100; ++i) {
+        histograms.record(ECesiumTileLoadStage::Request, 0.02);
+      }
+
+      FCesiumTileLoadLatency latency =
+          histograms.summarize(ECesiumTileLoadStage::Request);
+      TestEqual("count", latency.Count, int64(100));
+      TestTrue("p50", isWithinBucket(latency.P50Seconds, 0.02));
+      TestTrue("p99", isWithinBucket(latency.P99Seconds, 0.02));
+      TestTrue("p50 not above", latency.P50Seconds <= 0.02);
+      TestTrue("p99 not above", latency.P99Seconds <= 0.02);
+      TestEqual("max", latency.MaxSeconds, 0.02);
+    });
+
+    It("estimates the percentiles of known latencies", [this]() {
+      // 1 to 100 milliseconds, so the nth percentile is n milliseconds.
+      for (int i = 1; i <= 100; ++i) {
+        histograms.record(ECesiumTileLoadStage::LoadThread, i * 0.001);
+      }
+
+      FCesiumTileLoadLatency latency =
+          histograms.summarize(ECesiumTileLoadStage::LoadThread);
+      TestEqual("count", latency.Count, int64(100));
+      TestTrue("p50", isWithinBucket(latency.P50Seconds, 0.050));
+      TestTrue("p95", isWithinBucket(latency.P95Seconds, 0.095));
+      TestTrue("p99", isWithinBucket(latency.P99Seconds, 0.099));
+      TestTrue("p50 <= p95", latency.P50Seconds <= latency.P95Seconds);
+      TestTrue("p95 <= p99", latency.P95Seconds <= latency.P99Seconds);
+      TestEqual("max", latency.MaxSeconds, 0.1);
+    });
+
+    It("finds a slow tail", [this]() {
+      // 95 fast loads and 5 slow ones.
+      for (int i = 0; i < 95; ++i) {
+        histograms.record(ECesiumTileLoadStage::MainThread, 0.005);
+      }
+      for (int i = 0; i < 5; ++i) {
+        histograms.record(ECesiumTileLoadStage::MainThread, 2.0);
+      }
+
+      FCesiumTileLoadLatency latency =
+          histograms.summarize(ECesiumTileLoadStage::MainThread);
+      TestTrue("p50", isWithinBucket(latency.P50Seconds, 0.005));
+      TestTrue("p95", isWithinBucket(latency.P95Seconds, 0.005));
+      TestTrue("p99", isWithinBucket(latency.P99Seconds, 2.0));
+      TestEqual("max", latency.MaxSeconds, 2.0);
+    });
+
+    It("ignores negative and invalid latencies", [this]() {
+      histograms.record(ECesiumTileLoadStage::Total, -1.0);
+      histograms.record(
+          ECesiumTileLoadStage::Total,
+          std::numeric_limits<double>::quiet_NaN());
+      TestEqual(
+          "count",
+          histograms.summarize(ECesiumTileLoadStage::Total).Count,
+          int64(0));
+    });
+
+    It("keeps latencies outside the bucket range", [this]() {
+      histograms.record(ECesiumTileLoadStage::Request, 1.0e-6);
+      FCesiumTileLoadLatency fast =
+          histograms.summarize(ECesiumTileLoadStage::Request);
+      TestEqual("fast count", fast.Count, int64(1));
+      TestEqual("fast p50", fast.P50Seconds, 1.0e-6);
+
+      histograms.record(ECesiumTileLoadStage::Total, 5000.0);
+      FCesiumTileLoadLatency slow =
+          histograms.summarize(ECesiumTileLoadStage::Total);
+      TestEqual("slow count", slow.Count, int64(1));
+      TestEqual("slow p50 at the top bucket", slow.P50Seconds, 1000.0);
+      TestEqual("slow max", slow.MaxSeconds, 5000.0);
+    });
+
+    It("keeps the stages apart and resets them", [this]() {
+      histograms.record(ECesiumTileLoadStage::Request, 0.01);
+      TestEqual(
+          "other stage",
+          histograms.summarize(ECesiumTileLoadStage::LoadThread).Count,
+          int64(0));
+
+      histograms.reset();
+      FCesiumTileLoadLatency latency =
+          histograms.summarize(ECesiumTileLoadStage::Request);
+      TestEqual("count", latency.Count, int64(0));
+      TestEqual("max", latency.MaxSeconds, 0.0);
+    });
+  });
+
+  Describe("LoadLatencyAssetAccessor", [this]() {
+    It("records the times of a request in its headers", [this]() {
+      std::shared_ptr<FakeAssetAccessor> pFake =
+          std::make_shared<FakeAssetAccessor>();
+      LoadLatencyAssetAccessor accessor(pFake);
+
+      std::shared_ptr<CesiumAsync::IAssetRequest> pRequest =
+          accessor.get(getAsyncSystem(), "https://example.com/a", {}).wait();
+
+      double issuedTime = 0.0;
+      double receivedTime = 0.0;
+      TestTrue(
+          "has times",
+          LoadLatencyAssetRequest::getTimes(
+              *pRequest,
+              issuedTime,
+              receivedTime));
+      TestTrue("issued", issuedTime > 0.0);
+      TestTrue("received after issued", receivedTime >= issuedTime);
+      TestEqual("url", pRequest->url(), std::string("https://example.com/a"));
+      TestNotNull("response", pRequest->response());
+    });
+
+    It("finds no times on other requests", [this]() {
+      FakeAssetRequest request("https://example.com/a");
+      double issuedTime = 1.0;
+      double receivedTime = 2.0;
+      TestFalse(
+          "has times",
+          LoadLatencyAssetRequest::getTimes(
+              request,
+              issuedTime,
+              receivedTime));
+      TestEqual("issued unchanged", issuedTime, 1.0);
+      TestEqual("received unchanged", receivedTime, 2.0);
+    });
+  });
+}
@@ -0,0 +1,165 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/QueuedThreadPool.h"
+#include "UnrealTaskProcessor.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//
+// Measures the throughput and latency of Cesium's background tasks with a
+// CPU-only workload that resembles tile loading, without a GPU, network
+// access, or a world. Each simulated tile is a decode task that starts a
+// geometry task and a texture task when it finishes, and is complete when both
+// have run. The workload runs on the engine's background task threads and on
+// a dedicated pool, and the time taken, the mean time to complete a tile, and
+// the time tasks spent waiting in each lane are logged. For example:
+//
+//   UnrealEditor-Cmd TestsProject.uproject -nullrhi -unattended
+//     -ExecCmds="Automation RunTests Cesium.Performance.WorkerPool;Quit"
+//     -CesiumBenchmarkTiles=4000 -CesiumBenchmarkThreads=6
+//
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+    FCesiumWorkerPoolBenchmark,
+    "Cesium.Performance.WorkerPool",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::PerfFilter)
+
+namespace {
+
+// Does roughly the given number of microseconds of arithmetic, which the
+// compiler cannot remove.
+uint64_t spin(int32 microseconds) {
+  uint64_t value = 0x9E3779B97F4A7C15ull;
+  for (int32 i = 0; i < microseconds * 200; ++i) {
+    value ^= value << 13;
+    value ^= value >> 7;
+    value ^= value << 17;
+  }
+  return value;
+}
+
+struct BenchmarkResult {
+  double seconds;
+  double meanTileSeconds;
+  UnrealTaskProcessor::LaneStatistics lanes[UnrealTaskProcessor::LaneCount];
+};
+
+BenchmarkResult runBenchmark(int32 threadCount, int32 tileCount) {
+  TUniquePtr<FQueuedThreadPool> pThreadPool =
+      UnrealTaskProcessor::createThreadPool(threadCount);
+  UnrealTaskProcessor processor(pThreadPool.Get());
+
+  std::vector<double> startTimes(size_t(tileCount), 0.0);
+  std::vector<std::atomic<int>> remainingParts(size_t(tileCount));
+  std::atomic<uint64_t> totalTileNanoseconds(0);
+  std::atomic<int32> completedTiles(0);
+  std::atomic<uint64_t> sink(0);
+
+  auto completePart = [&](int32 tile) {
+    if (--remainingParts[size_t(tile)] == 0) {
+      double seconds = FPlatformTime::Seconds() - startTimes[size_t(tile)];
+      totalTileNanoseconds += uint64_t(seconds * 1e9);
+      ++completedTiles;
+    }
+  };
+
+  double startTime = FPlatformTime::Seconds();
+  for (int32 tile = 0; tile < tileCount; ++tile) {
+    startTimes[size_t(tile)] = FPlatformTime::Seconds();
+    remainingParts[size_t(tile)] = 2;
+    processor.startTask(
+        UnrealTaskProcessor::Lane::Decode,
+        [&, tile]() {
+          sink += spin(200);
+          processor.startTask(
+              UnrealTaskProcessor::Lane::Geometry,
+              [&, tile]() {
+                sink += spin(300);
+                completePart(tile);
+              });
+          processor.startTask(
+              UnrealTaskProcessor::Lane::Texture,
+              [&, tile]() {
+                sink += spin(100);
+                completePart(tile);
+              });
+        });
+  }
+
+  while (completedTiles.load() < tileCount) {
+    FPlatformProcess::Sleep(0.001f);
+  }
+  double endTime = FPlatformTime::Seconds();
+
+  // Let the last tasks finish counting themselves.
+  FPlatformProcess::Sleep(0.05f);
+
+  BenchmarkResult result;
+  result.seconds = endTime - startTime;
+  result.meanTileSeconds =
+      double(totalTileNanoseconds.load()) * 1e-9 / double(tileCount);
+  for (size_t i = 0; i < UnrealTaskProcessor::LaneCount; ++i) {
+    result.lanes[i] =
+        processor.getLaneStatistics(UnrealTaskProcessor::Lane(i));
+  }
+  return result;
+}
+
+} // namespace
+
+bool FCesiumWorkerPoolBenchmark::RunTest(const FString& Parameters) {
+  int32 tileCount = 2000;
+  FParse::Value(FCommandLine::Get(), TEXT("CesiumBenchmarkTiles="), tileCount);
+  int32 threadCount =
+      FMath::Max(FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 2, 1);
+  FParse::Value(
+      FCommandLine::Get(),
+      TEXT("CesiumBenchmarkThreads="),
+      threadCount);
+
+  const TCHAR* laneNames[] = {
+      TEXT("decode"),
+      TEXT("geometry"),
+      TEXT("texture")};
+
+  for (int32 threads : {0, threadCount}) {
+    BenchmarkResult result = runBenchmark(threads, tileCount);
+
+    FString label = threads > 0
+                        ? FString::Printf(TEXT("%d Cesium threads"), threads)
+                        : FString(TEXT("Engine threads"));
+    FString report = FString::Printf(
+        TEXT("%s: %d tiles in %.3f s (%.0f tiles/s), mean tile %.2f ms"),
+        *label,
+        tileCount,
+        result.seconds,
+        double(tileCount) / result.seconds,
+        result.meanTileSeconds * 1000.0);
+    for (size_t i = 0; i < UnrealTaskProcessor::LaneCount; ++i) {
+      const UnrealTaskProcessor::LaneStatistics& lane = result.lanes[i];
+      double completed = double(FMath::Max(lane.completed, uint64_t(1)));
+      report += FString::Printf(
+          TEXT(", %s wait mean %.2f ms max %.2f ms"),
+          laneNames[i],
+          lane.totalWaitSeconds / completed * 1000.0,
+          lane.maximumWaitSeconds * 1000.0);
+    }
+    AddInfo(report);
+
+    TestEqual(
+        "completed",
+        int64(result.lanes[size_t(UnrealTaskProcessor::Lane::Decode)]
+                  .completed),
+        int64(tileCount));
+  }
+
+  return true;
+}
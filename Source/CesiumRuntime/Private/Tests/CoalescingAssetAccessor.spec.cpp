@@ -0,0 +1,108 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CoalescingAssetAccessor.h"
+#include "CesiumRuntime.h"
+#include "CesiumTestFakes.h"
+#include "Misc/AutomationTest.h"
+#include "UnrealAssetAccessor.h"
+#include <optional>
+#include <vector>
+
+using namespace CesiumTestFakes;
+
+BEGIN_DEFINE_SPEC(
+    FCoalescingAssetAccessorSpec,
+    "Cesium.Unit.CoalescingAssetAccessor",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::shared_ptr<FakeAssetAccessor> pFake;
+std::shared_ptr<CoalescingAssetAccessor> pAccessor;
+
+END_DEFINE_SPEC(FCoalescingAssetAccessorSpec)
+
+void FCoalescingAssetAccessorSpec::Define() {
+  BeforeEach([this]() {
+    pFake = std::make_shared<FakeAssetAccessor>();
+    pFake->deferResponses = true;
+    pAccessor = std::make_shared<CoalescingAssetAccessor>(pFake);
+  });
+
+  AfterEach([this]() {
+    pAccessor.reset();
+    pFake.reset();
+  });
+
+  It("shares one request between identical concurrent requests", [this]() {
+    const CesiumAsync::AsyncSystem& asyncSystem = getAsyncSystem();
+    auto first = pAccessor->get(asyncSystem, "https://example.com/a", {});
+    auto second = pAccessor->get(asyncSystem, "https://example.com/a", {});
+
+    TestEqual("inner requests", pFake->urls.size(), size_t(1));
+    TestEqual("coalesced", pAccessor->getCoalescedRequestCount(), uint64_t(1));
+
+    auto pRequest = std::make_shared<FakeAssetRequest>("https://example.com/a");
+    pFake->promises[0].resolve(pRequest);
+
+    TestTrue("first is shared", first.wait() == pRequest);
+    TestTrue("second is shared", second.wait() == pRequest);
+
+    // Once the request completes, the next one is sent again.
+    auto third = pAccessor->get(asyncSystem, "https://example.com/a", {});
+    TestEqual("inner requests", pFake->urls.size(), size_t(2));
+  });
+
+  It("does not share requests with different headers", [this]() {
+    const CesiumAsync::AsyncSystem& asyncSystem = getAsyncSystem();
+    auto first =
+        pAccessor->get(asyncSystem, "https://example.com/a", {{"A", "1"}});
+    auto second =
+        pAccessor->get(asyncSystem, "https://example.com/a", {{"A", "2"}});
+    auto third = pAccessor->get(asyncSystem, "https://example.com/b", {});
+
+    TestEqual("inner requests", pFake->urls.size(), size_t(3));
+    TestEqual("coalesced", pAccessor->getCoalescedRequestCount(), uint64_t(0));
+  });
+
+  It("shares requests between request groups", [this]() {
+    const CesiumAsync::AsyncSystem& asyncSystem = getAsyncSystem();
+    auto first = pAccessor->get(
+        asyncSystem,
+        "https://example.com/a",
+        {UnrealAssetAccessor::requestGroupHeader(1), {"A", "1"}});
+    auto second = pAccessor->get(
+        asyncSystem,
+        "https://example.com/a",
+        {{"A", "1"}, UnrealAssetAccessor::requestGroupHeader(2)});
+
+    TestEqual("inner requests", pFake->urls.size(), size_t(1));
+    TestEqual("coalesced", pAccessor->getCoalescedRequestCount(), uint64_t(1));
+  });
+
+  It("retries in its own group when another group's request fails", [this]() {
+    const CesiumAsync::AsyncSystem& asyncSystem = getAsyncSystem();
+    auto first = pAccessor->get(
+        asyncSystem,
+        "https://example.com/a",
+        {UnrealAssetAccessor::requestGroupHeader(1)});
+    auto second = pAccessor->get(
+        asyncSystem,
+        "https://example.com/a",
+        {UnrealAssetAccessor::requestGroupHeader(2)});
+
+    pFake->promises[0].reject(std::runtime_error("Request canceled."));
+    TestEqual("inner requests", pFake->urls.size(), size_t(2));
+
+    bool firstFailed = false;
+    try {
+      first.wait();
+    } catch (const std::exception&) {
+      firstFailed = true;
+    }
+    TestTrue("first failed", firstFailed);
+
+    auto pRequest = std::make_shared<FakeAssetRequest>("https://example.com/a");
+    pFake->promises[1].resolve(pRequest);
+    TestTrue("second succeeded", second.wait() == pRequest);
+  });
+}
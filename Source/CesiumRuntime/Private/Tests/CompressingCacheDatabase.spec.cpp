@@ -0,0 +1,138 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "CompressingCacheDatabase.h"
+#include "CesiumAsync/CacheItem.h"
+#include "CesiumTestFakes.h"
+#include "Misc/AutomationTest.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace CesiumTestFakes;
+
+namespace {
+
+std::vector<std::byte> makeCompressibleData() {
+  std::vector<std::byte> data(64 * 1024);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = std::byte(i % 16);
+  }
+  return data;
+}
+
+std::vector<std::byte> makeRandomData() {
+  std::mt19937 random(42);
+  std::vector<std::byte> data(64 * 1024);
+  for (std::byte& value : data) {
+    value = std::byte(random() & 0xff);
+  }
+  return data;
+}
+
+} // namespace
+
+BEGIN_DEFINE_SPEC(
+    FCompressingCacheDatabaseSpec,
+    "Cesium.Unit.CompressingCacheDatabase",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::shared_ptr<FakeCacheDatabase> pFake;
+
+void Store(
+    CesiumAsync::ICacheDatabase& cache,
+    const std::string& key,
+    const std::vector<std::byte>& data) {
+  cache.storeEntry(
+      key,
+      std::time(nullptr) + 3600,
+      "https://example.com/" + key,
+      "GET",
+      CesiumAsync::HttpHeaders{},
+      200,
+      CesiumAsync::HttpHeaders{{"Content-Type", "model/gltf-binary"}},
+      data);
+}
+
+END_DEFINE_SPEC(FCompressingCacheDatabaseSpec)
+
+void FCompressingCacheDatabaseSpec::Define() {
+  BeforeEach([this]() { pFake = std::make_shared<FakeCacheDatabase>(); });
+
+  AfterEach([this]() { pFake.reset(); });
+
+  It("compresses entries that compress well", [this]() {
+    CompressingCacheDatabase cache(pFake, NAME_LZ4);
+    std::vector<std::byte> data = makeCompressibleData();
+    Store(cache, "a", data);
+
+    const CesiumAsync::CacheResponse& stored =
+        pFake->items.at("a").cacheResponse;
+    TestTrue("smaller", stored.data.size() < data.size());
+    TestEqual(
+        "encoding",
+        stored.headers.at(CompressingCacheDatabase::EncodingHeaderName),
+        std::string("lz4"));
+
+    std::optional<CesiumAsync::CacheItem> maybeItem = cache.getEntry("a");
+    TestTrue("found", maybeItem.has_value());
+    if (!maybeItem) {
+      return;
+    }
+    TestTrue("data", maybeItem->cacheResponse.data == data);
+    TestEqual("headers", maybeItem->cacheResponse.headers.size(), size_t(1));
+
+    CompressingCacheDatabase::Statistics statistics = cache.getStatistics();
+    TestEqual("hits", statistics.hits, int64_t(1));
+    TestEqual(
+        "uncompressed",
+        statistics.uncompressedBytesStored,
+        int64_t(data.size()));
+    TestEqual(
+        "compressed",
+        statistics.compressedBytesStored,
+        int64_t(stored.data.size()));
+  });
+
+  It("stores entries that do not compress well as they are", [this]() {
+    CompressingCacheDatabase cache(pFake, NAME_LZ4);
+    std::vector<std::byte> data = makeRandomData();
+    Store(cache, "a", data);
+
+    const CesiumAsync::CacheResponse& stored =
+        pFake->items.at("a").cacheResponse;
+    TestTrue("unchanged", stored.data == data);
+    TestEqual("headers", stored.headers.size(), size_t(1));
+
+    std::optional<CesiumAsync::CacheItem> maybeItem = cache.getEntry("a");
+    TestTrue("found", maybeItem.has_value());
+    if (maybeItem) {
+      TestTrue("data", maybeItem->cacheResponse.data == data);
+    }
+  });
+
+  It("reads entries stored with another format", [this]() {
+    std::vector<std::byte> data = makeCompressibleData();
+    {
+      CompressingCacheDatabase cache(pFake, NAME_Zlib);
+      Store(cache, "a", data);
+    }
+
+    CompressingCacheDatabase cache(pFake, NAME_None);
+    std::optional<CesiumAsync::CacheItem> maybeItem = cache.getEntry("a");
+    TestTrue("found", maybeItem.has_value());
+    if (maybeItem) {
+      TestTrue("data", maybeItem->cacheResponse.data == data);
+    }
+
+    Store(cache, "b", data);
+    TestTrue("uncompressed", pFake->items.at("b").cacheResponse.data == data);
+  });
+
+  It("counts misses", [this]() {
+    CompressingCacheDatabase cache(pFake, NAME_LZ4);
+    TestFalse("found", cache.getEntry("missing").has_value());
+    TestEqual("misses", cache.getStatistics().misses, int64_t(1));
+    TestEqual("hits", cache.getStatistics().hits, int64_t(0));
+  });
+}
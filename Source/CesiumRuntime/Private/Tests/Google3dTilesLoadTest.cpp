@@ -8,7 +8,6 @@
 #include "Misc/AutomationTest.h"
 
 #include "Cesium3DTileset.h"
-#include "CesiumAsync/ICacheDatabase.h"
 #include "CesiumRuntime.h"
 #include "CesiumSunSky.h"
 
@@ -247,9 +246,7 @@ bool FGoogleTilesMaxTileLoads::RunTest(const FString& Parameters) {
   auto setupPass = [this](
                        SceneGenerationContext& context,
                        TestPass::TestingParameter parameter) {
-    std::shared_ptr<CesiumAsync::ICacheDatabase> pCacheDatabase =
-        getCacheDatabase();
-    pCacheDatabase->clearAll();
+    clearRequestCache();
 
     int maxLoadsTarget = std::get<int>(parameter);
     context.setMaximumSimultaneousTileLoads(maxLoadsTarget);
@@ -0,0 +1,120 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "MemoryCacheAssetAccessor.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "CesiumTestFakes.h"
+#include "Misc/AutomationTest.h"
+#include "UnrealAssetAccessor.h"
+#include <vector>
+
+using namespace CesiumTestFakes;
+
+BEGIN_DEFINE_SPEC(
+    FMemoryCacheAssetAccessorSpec,
+    "Cesium.Unit.MemoryCacheAssetAccessor",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::shared_ptr<FakeAssetAccessor> pFake;
+
+std::shared_ptr<CesiumAsync::IAssetRequest>
+Get(MemoryCacheAssetAccessor& accessor,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers = {}) {
+  return accessor.get(getAsyncSystem(), url, headers).wait();
+}
+
+END_DEFINE_SPEC(FMemoryCacheAssetAccessorSpec)
+
+void FMemoryCacheAssetAccessorSpec::Define() {
+  BeforeEach([this]() {
+    pFake = std::make_shared<FakeAssetAccessor>();
+    pFake->responseHeaders = {{"Cache-Control", "max-age=3600"}};
+  });
+
+  AfterEach([this]() { pFake.reset(); });
+
+  It("serves repeated requests from memory", [this]() {
+    MemoryCacheAssetAccessor accessor(pFake, 1024 * 1024);
+    Get(accessor, "https://example.com/a");
+    auto pSecond = Get(
+        accessor,
+        "https://example.com/a",
+        {UnrealAssetAccessor::requestGroupHeader(7)});
+    auto pThird = Get(accessor, "https://example.com/a");
+
+    TestEqual("inner requests", pFake->urls.size(), size_t(1));
+    TestTrue("shared", pSecond == pThird);
+    TestEqual("size", pSecond->response()->data().size(), size_t(1000));
+    TestEqual("hits", accessor.getHitCount(), uint64_t(2));
+    TestEqual("misses", accessor.getMissCount(), uint64_t(1));
+  });
+
+  It("evicts the least recently used responses", [this]() {
+    // Each entry takes about 420 bytes with its headers and overhead, so four
+    // fit.
+    MemoryCacheAssetAccessor accessor(pFake, 2000);
+    pFake->size = 100;
+    Get(accessor, "https://example.com/a");
+    Get(accessor, "https://example.com/b");
+    Get(accessor, "https://example.com/c");
+    Get(accessor, "https://example.com/d");
+    Get(accessor, "https://example.com/a");
+    Get(accessor, "https://example.com/e");
+    TestEqual("inner requests", pFake->urls.size(), size_t(5));
+    TestTrue("size", accessor.getSizeBytes() <= 2000);
+
+    // b was the least recently used, so it was evicted.
+    Get(accessor, "https://example.com/a");
+    TestEqual("a kept", pFake->urls.size(), size_t(5));
+    Get(accessor, "https://example.com/b");
+    TestEqual("b evicted", pFake->urls.size(), size_t(6));
+  });
+
+  It("does not keep failed or uncacheable responses", [this]() {
+    MemoryCacheAssetAccessor accessor(pFake, 1024 * 1024);
+    pFake->statusCode = 404;
+    Get(accessor, "https://example.com/a");
+    Get(accessor, "https://example.com/a");
+    TestEqual("failed", pFake->urls.size(), size_t(2));
+
+    pFake->statusCode = 200;
+    pFake->responseHeaders = {{"Cache-Control", "no-store"}};
+    Get(accessor, "https://example.com/b");
+    Get(accessor, "https://example.com/b");
+    TestEqual("no-store", pFake->urls.size(), size_t(4));
+
+    pFake->responseHeaders = {{"Cache-Control", "max-age=60, must-revalidate"}};
+    Get(accessor, "https://example.com/c");
+    Get(accessor, "https://example.com/c");
+    TestEqual("must-revalidate", pFake->urls.size(), size_t(6));
+  });
+
+  It("does not keep responses without a lifetime", [this]() {
+    MemoryCacheAssetAccessor accessor(pFake, 1024 * 1024);
+    pFake->responseHeaders = {};
+    Get(accessor, "https://example.com/a");
+    Get(accessor, "https://example.com/a");
+    TestEqual("no lifetime", pFake->urls.size(), size_t(2));
+
+    pFake->responseHeaders = {{"Expires", "Wed, 21 Oct 2015 07:28:00 GMT"}};
+    Get(accessor, "https://example.com/b");
+    Get(accessor, "https://example.com/b");
+    TestEqual("expired", pFake->urls.size(), size_t(4));
+
+    pFake->responseHeaders = {{"Expires", "Fri, 01 Jan 2100 00:00:00 GMT"}};
+    Get(accessor, "https://example.com/c");
+    Get(accessor, "https://example.com/c");
+    TestEqual("expires later", pFake->urls.size(), size_t(5));
+  });
+
+  It("discards everything when cleared", [this]() {
+    MemoryCacheAssetAccessor accessor(pFake, 1024 * 1024);
+    Get(accessor, "https://example.com/a");
+    accessor.clear();
+    TestEqual("size", accessor.getSizeBytes(), int64_t(0));
+    Get(accessor, "https://example.com/a");
+    TestEqual("inner requests", pFake->urls.size(), size_t(2));
+  });
+}
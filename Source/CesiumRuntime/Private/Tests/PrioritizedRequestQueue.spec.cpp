@@ -0,0 +1,307 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "Misc/AutomationTest.h"
+#include "PrioritizedRequestQueue.h"
+#include <string>
+#include <vector>
+
+BEGIN_DEFINE_SPEC(
+    FPrioritizedRequestQueueSpec,
+    "Cesium.Unit.PrioritizedRequestQueue",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::vector<std::string> started;
+std::vector<PrioritizedRequestQueue::RequestId> startedIds;
+std::vector<std::string> canceled;
+
+double now;
+
+PrioritizedRequestQueue::Clock MakeClock() {
+  return [this]() { return now; };
+}
+
+void Enqueue(
+    PrioritizedRequestQueue& queue,
+    PrioritizedRequestQueue::GroupId groupId,
+    const std::string& name,
+    const std::string& host = "https://example.com") {
+  queue.enqueue(
+      groupId,
+      host,
+      [this, name](PrioritizedRequestQueue::RequestId requestId) {
+        started.push_back(name);
+        startedIds.push_back(requestId);
+      },
+      [this, name](bool wasActive) {
+        canceled.push_back(name + (wasActive ? " active" : " queued"));
+      });
+}
+
+END_DEFINE_SPEC(FPrioritizedRequestQueueSpec)
+
+void FPrioritizedRequestQueueSpec::Define() {
+  BeforeEach([this]() {
+    started.clear();
+    startedIds.clear();
+    canceled.clear();
+    now = 0.0;
+  });
+
+  It("starts requests immediately while under the limit", [this]() {
+    PrioritizedRequestQueue queue(2, 2);
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "b");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "c");
+
+    TestEqual("started", started.size(), size_t(2));
+    TestEqual("active", queue.getActiveCount(), size_t(2));
+    TestEqual("queued", queue.getQueuedCount(), size_t(1));
+
+    queue.finish(startedIds[0]);
+    TestEqual("started", started.size(), size_t(3));
+    TestEqual("third", started[2], std::string("c"));
+    TestEqual("queued", queue.getQueuedCount(), size_t(0));
+  });
+
+  It("starts queued requests in priority order", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId low = queue.createGroup(-1.0);
+    PrioritizedRequestQueue::GroupId high = queue.createGroup(10.0);
+
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "first");
+    Enqueue(queue, low, "low");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "default");
+    Enqueue(queue, high, "high");
+
+    while (queue.getActiveCount() > 0) {
+      queue.finish(startedIds.back());
+    }
+
+    TestEqual("count", started.size(), size_t(4));
+    TestEqual("0", started[0], std::string("first"));
+    TestEqual("1", started[1], std::string("high"));
+    TestEqual("2", started[2], std::string("default"));
+    TestEqual("3", started[3], std::string("low"));
+  });
+
+  It("starts requests of equal priority in order", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId a = queue.createGroup(1.0);
+    PrioritizedRequestQueue::GroupId b = queue.createGroup(1.0);
+
+    Enqueue(queue, a, "a1");
+    Enqueue(queue, b, "b1");
+    Enqueue(queue, a, "a2");
+    Enqueue(queue, b, "b2");
+
+    while (queue.getActiveCount() > 0) {
+      queue.finish(startedIds.back());
+    }
+
+    TestEqual("count", started.size(), size_t(4));
+    TestEqual("0", started[0], std::string("a1"));
+    TestEqual("1", started[1], std::string("b1"));
+    TestEqual("2", started[2], std::string("a2"));
+    TestEqual("3", started[3], std::string("b2"));
+  });
+
+  It("uses the current priority of a group", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId a = queue.createGroup(2.0);
+    PrioritizedRequestQueue::GroupId b = queue.createGroup(1.0);
+
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "first");
+    Enqueue(queue, a, "a");
+    Enqueue(queue, b, "b");
+
+    queue.setGroupPriority(b, 3.0);
+    queue.finish(startedIds.back());
+
+    TestEqual("second", started[1], std::string("b"));
+  });
+
+  It("cancels queued and active requests in a group", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId group = queue.createGroup(0.0);
+
+    Enqueue(queue, group, "active");
+    Enqueue(queue, group, "queued");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "other");
+
+    queue.cancelGroup(group);
+
+    TestEqual("canceled", canceled.size(), size_t(2));
+    TestEqual("0", canceled[0], std::string("queued queued"));
+    TestEqual("1", canceled[1], std::string("active active"));
+
+    // The canceled active request counts against the limit until finished.
+    TestEqual("started", started.size(), size_t(1));
+    queue.finish(startedIds[0]);
+    TestEqual("started", started.size(), size_t(2));
+    TestEqual("other", started[1], std::string("other"));
+
+    Enqueue(queue, group, "late");
+    TestEqual("canceled", canceled.size(), size_t(3));
+    TestEqual("late", canceled[2], std::string("late queued"));
+  });
+
+  It("does not cancel the default group", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a");
+    queue.cancelGroup(PrioritizedRequestQueue::DefaultGroup);
+    TestEqual("canceled", canceled.size(), size_t(0));
+    TestEqual("active", queue.getActiveCount(), size_t(1));
+  });
+
+  It("starts more requests when the limit is raised", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "b");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "c");
+    TestEqual("started", started.size(), size_t(1));
+
+    queue.setMaximumActiveRequests(3);
+    TestEqual("started", started.size(), size_t(3));
+  });
+
+  It("limits the active requests to each host", [this]() {
+    PrioritizedRequestQueue queue(3, 1);
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a1", "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a2", "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "b1", "b");
+
+    TestEqual("started", started.size(), size_t(2));
+    TestEqual("0", started[0], std::string("a1"));
+    TestEqual("1", started[1], std::string("b1"));
+
+    queue.finish(startedIds[0]);
+    TestEqual("started", started.size(), size_t(3));
+    TestEqual("2", started[2], std::string("a2"));
+  });
+
+  It("shares a host fairly between groups of equal priority", [this]() {
+    PrioritizedRequestQueue queue(2, 2);
+    PrioritizedRequestQueue::GroupId a = queue.createGroup(0.0);
+    PrioritizedRequestQueue::GroupId b = queue.createGroup(0.0);
+
+    Enqueue(queue, a, "a1");
+    Enqueue(queue, a, "a2");
+    Enqueue(queue, a, "a3");
+    Enqueue(queue, b, "b1");
+
+    // With a1 and a2 active, b1 is started before a3 because its group has
+    // fewer active requests.
+    queue.finish(startedIds[0]);
+    TestEqual("started", started.size(), size_t(3));
+    TestEqual("2", started[2], std::string("b1"));
+  });
+
+  It("starts the requests of a group's latest view first", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId group = queue.createGroup(0.0);
+
+    Enqueue(queue, group, "first");
+    Enqueue(queue, group, "old1");
+    Enqueue(queue, group, "old2");
+    queue.advanceGroupView(group);
+    Enqueue(queue, group, "new1");
+    Enqueue(queue, group, "new2");
+
+    while (queue.getActiveCount() > 0) {
+      queue.finish(startedIds.back());
+    }
+
+    TestEqual("count", started.size(), size_t(5));
+    TestEqual("0", started[0], std::string("first"));
+    TestEqual("1", started[1], std::string("new1"));
+    TestEqual("2", started[2], std::string("new2"));
+    TestEqual("3", started[3], std::string("old1"));
+    TestEqual("4", started[4], std::string("old2"));
+  });
+
+  It("reorders only the group whose view changed", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId a = queue.createGroup(0.0);
+    PrioritizedRequestQueue::GroupId b = queue.createGroup(0.0);
+
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "first");
+    Enqueue(queue, a, "a1");
+    Enqueue(queue, b, "b1");
+    Enqueue(queue, b, "b2");
+    queue.advanceGroupView(a);
+    Enqueue(queue, a, "a2");
+
+    while (queue.getActiveCount() > 0) {
+      queue.finish(startedIds.back());
+    }
+
+    // Between groups, the request that was enqueued first is still started
+    // first. Only the order within the group that changed its view changes.
+    TestEqual("count", started.size(), size_t(5));
+    TestEqual("1", started[1], std::string("b1"));
+    TestEqual("2", started[2], std::string("b2"));
+    TestEqual("3", started[3], std::string("a2"));
+    TestEqual("4", started[4], std::string("a1"));
+  });
+
+  It("cancels the queued requests of every view", [this]() {
+    PrioritizedRequestQueue queue(1, 1);
+    PrioritizedRequestQueue::GroupId group = queue.createGroup(0.0);
+
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "first");
+    Enqueue(queue, group, "old", "a");
+    queue.advanceGroupView(group);
+    Enqueue(queue, group, "new", "b");
+    queue.cancelGroup(group);
+
+    TestEqual("canceled", canceled.size(), size_t(2));
+    TestEqual("0", canceled[0], std::string("new queued"));
+    TestEqual("1", canceled[1], std::string("old queued"));
+    TestEqual("queued", queue.getQueuedCount(), size_t(0));
+  });
+
+  It("does not start requests to a host that is backing off", [this]() {
+    PrioritizedRequestQueue queue(4, 4, MakeClock());
+    queue.backOffHost("a", 2.0);
+
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a1", "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "b1", "b");
+    TestEqual("started", started.size(), size_t(1));
+    TestEqual("0", started[0], std::string("b1"));
+
+    now = 1.0;
+    queue.tick();
+    TestEqual("started", started.size(), size_t(1));
+
+    now = 2.5;
+    queue.tick();
+    TestEqual("started", started.size(), size_t(2));
+    TestEqual("1", started[1], std::string("a1"));
+  });
+
+  It("records the queue time of each host", [this]() {
+    PrioritizedRequestQueue queue(1, 1, MakeClock());
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a1", "a");
+    Enqueue(queue, PrioritizedRequestQueue::DefaultGroup, "a2", "a");
+
+    now = 3.0;
+    queue.finish(startedIds[0]);
+    queue.backOffHost("a", 1.0);
+
+    std::vector<PrioritizedRequestQueue::HostStatistics> hosts =
+        queue.getHostStatistics();
+    TestEqual("hosts", hosts.size(), size_t(1));
+    if (hosts.size() != 1) {
+      return;
+    }
+
+    TestEqual("host", hosts[0].host, std::string("a"));
+    TestEqual("requestsStarted", hosts[0].requestsStarted, uint64_t(2));
+    TestEqual("totalQueueSeconds", hosts[0].totalQueueSeconds, 3.0);
+    TestEqual("maximumQueueSeconds", hosts[0].maximumQueueSeconds, 3.0);
+    TestEqual("backOffs", hosts[0].backOffs, uint64_t(1));
+    TestEqual("active", hosts[0].active, size_t(1));
+    TestEqual("queued", hosts[0].queued, size_t(0));
+  });
+}
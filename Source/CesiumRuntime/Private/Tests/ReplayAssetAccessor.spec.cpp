@@ -0,0 +1,147 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "ReplayAssetAccessor.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "CesiumTestFakes.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "RecordingAssetAccessor.h"
+#include <atomic>
+#include <vector>
+
+using namespace CesiumTestFakes;
+
+BEGIN_DEFINE_SPEC(
+    FReplayAssetAccessorSpec,
+    "Cesium.Unit.ReplayAssetAccessor",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+FString Directory;
+double Now;
+
+void Record(const std::vector<std::string>& urls, size_t size) {
+  auto pFake = std::make_shared<FakeAssetAccessor>();
+  pFake->size = size;
+  pFake->responseHeaders = {{"Content-Type", "text/plain"}};
+  RecordingAssetAccessor recorder(pFake, Directory);
+  for (const std::string& url : urls) {
+    recorder.get(getAsyncSystem(), url, {}).wait();
+  }
+  TestEqual("recorded", recorder.getRecordedCount(), uint64_t(urls.size()));
+}
+
+std::unique_ptr<ReplayAssetAccessor>
+CreateReplay(double latencySeconds, double bytesPerSecond) {
+  return std::make_unique<ReplayAssetAccessor>(
+      Directory,
+      latencySeconds,
+      bytesPerSecond,
+      [this]() { return Now; });
+}
+
+// Waits for the worker threads to read the given number of responses from
+// the recording.
+void WaitForInTransit(const ReplayAssetAccessor& replay, size_t count) {
+  double timeout = FPlatformTime::Seconds() + 10.0;
+  while (replay.getInTransitCount() < count &&
+         FPlatformTime::Seconds() < timeout) {
+    FPlatformProcess::Sleep(0.001f);
+  }
+  TestEqual("in transit", replay.getInTransitCount(), count);
+}
+
+END_DEFINE_SPEC(FReplayAssetAccessorSpec)
+
+void FReplayAssetAccessorSpec::Define() {
+  BeforeEach([this]() {
+    Directory = FPaths::ConvertRelativePathToFull(
+        FPaths::CreateTempFilename(*FPaths::ProjectSavedDir()));
+    Now = 0.0;
+  });
+
+  AfterEach([this]() {
+    FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(
+        *Directory);
+  });
+
+  It("replays recorded responses", [this]() {
+    Record({"https://example.com/a"}, 100);
+
+    std::unique_ptr<ReplayAssetAccessor> pReplay = CreateReplay(0.0, 0.0);
+    std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+    pReplay->get(getAsyncSystem(), "https://example.com/a", {})
+        .thenImmediately(
+            [&pRequest](std::shared_ptr<CesiumAsync::IAssetRequest>&& p) {
+              pRequest = std::move(p);
+            });
+
+    WaitForInTransit(*pReplay, 1);
+    pReplay->tick();
+
+    TestNotNull("request", pRequest.get());
+    if (!pRequest) {
+      return;
+    }
+    const CesiumAsync::IAssetResponse* pResponse = pRequest->response();
+    TestEqual("status", pResponse->statusCode(), uint16_t(200));
+    TestEqual("size", pResponse->data().size(), size_t(100));
+    TestEqual(
+        "contentType",
+        pResponse->contentType(),
+        std::string("text/plain"));
+    TestEqual("missing", pReplay->getMissingCount(), uint64_t(0));
+  });
+
+  It("responds to requests that were not recorded with 404", [this]() {
+    std::unique_ptr<ReplayAssetAccessor> pReplay = CreateReplay(0.0, 0.0);
+    std::shared_ptr<CesiumAsync::IAssetRequest> pRequest;
+    pReplay->get(getAsyncSystem(), "https://example.com/missing", {})
+        .thenImmediately(
+            [&pRequest](std::shared_ptr<CesiumAsync::IAssetRequest>&& p) {
+              pRequest = std::move(p);
+            });
+
+    WaitForInTransit(*pReplay, 1);
+    pReplay->tick();
+
+    TestNotNull("request", pRequest.get());
+    if (pRequest) {
+      TestEqual("status", pRequest->response()->statusCode(), uint16_t(404));
+    }
+    TestEqual("missing", pReplay->getMissingCount(), uint64_t(1));
+  });
+
+  It("simulates latency and bandwidth", [this]() {
+    Record({"https://example.com/a", "https://example.com/b"}, 1000);
+
+    // One second of latency, and then one second to transfer each body.
+    std::unique_ptr<ReplayAssetAccessor> pReplay = CreateReplay(1.0, 1000.0);
+    std::atomic<int> delivered(0);
+    for (const char* url : {"https://example.com/a", "https://example.com/b"}) {
+      pReplay->get(getAsyncSystem(), url, {})
+          .thenImmediately(
+              [&delivered](std::shared_ptr<CesiumAsync::IAssetRequest>&&) {
+                ++delivered;
+              });
+    }
+
+    WaitForInTransit(*pReplay, 2);
+
+    Now = 1.5;
+    pReplay->tick();
+    TestEqual("after latency", delivered.load(), 0);
+
+    Now = 2.0;
+    pReplay->tick();
+    TestEqual("after first transfer", delivered.load(), 1);
+
+    Now = 3.0;
+    pReplay->tick();
+    TestEqual("after second transfer", delivered.load(), 2);
+  });
+}
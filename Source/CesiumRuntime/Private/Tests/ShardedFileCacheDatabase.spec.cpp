@@ -0,0 +1,175 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "ShardedFileCacheDatabase.h"
+#include "CesiumAsync/CacheItem.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include <memory>
+#include <vector>
+
+BEGIN_DEFINE_SPEC(
+    FShardedFileCacheDatabaseSpec,
+    "Cesium.Unit.ShardedFileCacheDatabase",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+FString Directory;
+
+std::vector<std::byte> MakeData(size_t size, uint8 value) {
+  return std::vector<std::byte>(size, std::byte(value));
+}
+
+bool Store(
+    ShardedFileCacheDatabase& cache,
+    const std::string& key,
+    const std::vector<std::byte>& data,
+    std::time_t expiryTime = std::time(nullptr) + 3600) {
+  return cache.storeEntry(
+      key,
+      expiryTime,
+      "https://example.com/" + key,
+      "GET",
+      CesiumAsync::HttpHeaders{{"Accept", "*/*"}},
+      200,
+      CesiumAsync::HttpHeaders{{"Content-Type", "application/octet-stream"}},
+      data);
+}
+
+END_DEFINE_SPEC(FShardedFileCacheDatabaseSpec)
+
+void FShardedFileCacheDatabaseSpec::Define() {
+  BeforeEach([this]() {
+    Directory = FPaths::ConvertRelativePathToFull(
+        FPaths::CreateTempFilename(*FPaths::ProjectSavedDir()));
+  });
+
+  AfterEach([this]() {
+    FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(
+        *Directory);
+  });
+
+  It("returns stored entries", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    std::vector<std::byte> data = MakeData(100, 7);
+    TestTrue("stored", Store(cache, "a", data));
+
+    std::optional<CesiumAsync::CacheItem> maybeItem = cache.getEntry("a");
+    TestTrue("found", maybeItem.has_value());
+    if (!maybeItem) {
+      return;
+    }
+
+    const CesiumAsync::CacheItem& item = *maybeItem;
+    TestEqual(
+        "url",
+        item.cacheRequest.url,
+        std::string("https://example.com/a"));
+    TestEqual("method", item.cacheRequest.method, std::string("GET"));
+    TestEqual("statusCode", item.cacheResponse.statusCode, uint16_t(200));
+    TestEqual(
+        "contentType",
+        item.cacheResponse.headers.at("Content-Type"),
+        std::string("application/octet-stream"));
+    TestTrue("data", item.cacheResponse.data == data);
+  });
+
+  It("does not return missing entries", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    TestFalse("found", cache.getEntry("missing").has_value());
+  });
+
+  It("replaces entries with the same key", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    Store(cache, "a", MakeData(10, 1));
+    Store(cache, "a", MakeData(20, 2));
+
+    std::optional<CesiumAsync::CacheItem> maybeItem = cache.getEntry("a");
+    TestTrue("found", maybeItem.has_value());
+    if (maybeItem) {
+      TestTrue("data", maybeItem->cacheResponse.data == MakeData(20, 2));
+    }
+  });
+
+  It("prunes expired entries", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    Store(cache, "expired", MakeData(10, 1), std::time(nullptr) - 10);
+    Store(cache, "fresh", MakeData(10, 1));
+
+    TestTrue("pruned", cache.prune());
+    TestFalse("expired", cache.getEntry("expired").has_value());
+    TestTrue("fresh", cache.getEntry("fresh").has_value());
+  });
+
+  It("prunes to its maximum size", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 2500);
+    for (int i = 0; i < 10; ++i) {
+      Store(cache, std::to_string(i), MakeData(1000, uint8(i)));
+    }
+
+    TestTrue("pruned", cache.prune());
+    TestTrue("size", cache.getTotalBytes() <= 2500);
+
+    int remaining = 0;
+    for (int i = 0; i < 10; ++i) {
+      if (cache.getEntry(std::to_string(i))) {
+        ++remaining;
+      }
+    }
+    TestEqual("remaining", remaining, 2);
+  });
+
+  It("prunes incrementally", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 2500);
+    for (int i = 0; i < 10; ++i) {
+      Store(cache, std::to_string(i), MakeData(1000, uint8(i)));
+    }
+
+    // With no time budget, each step does one unit of work.
+    int steps = 0;
+    int64_t bytesReclaimed = 0;
+    ShardedFileCacheDatabase::PruneProgress progress;
+    do {
+      progress = cache.pruneIncrementally(0.0);
+      bytesReclaimed += progress.bytesReclaimed;
+      ++steps;
+    } while (!progress.complete && steps < 10000);
+
+    TestTrue("complete", progress.complete);
+    TestTrue("steps", steps > 8);
+    TestTrue("size", cache.getTotalBytes() <= 2500);
+    TestTrue("bytesReclaimed", bytesReclaimed >= 8000);
+  });
+
+  It("indexes entries stored by an earlier instance", [this]() {
+    {
+      ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+      Store(cache, "a", MakeData(1000, 1));
+    }
+
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    TestTrue("size", cache.getTotalBytes() > 1000);
+    TestTrue("found", cache.getEntry("a").has_value());
+  });
+
+  It("prunes entries stored by an earlier instance", [this]() {
+    {
+      ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+      for (int i = 0; i < 10; ++i) {
+        Store(cache, std::to_string(i), MakeData(1000, uint8(i)));
+      }
+    }
+
+    ShardedFileCacheDatabase cache(Directory, 2500);
+    TestTrue("pruned", cache.prune());
+    TestTrue("size", cache.getTotalBytes() <= 2500);
+  });
+
+  It("clears all entries", [this]() {
+    ShardedFileCacheDatabase cache(Directory, 1024 * 1024);
+    Store(cache, "a", MakeData(10, 1));
+    TestTrue("cleared", cache.clearAll());
+    TestFalse("found", cache.getEntry("a").has_value());
+    TestEqual("size", cache.getTotalBytes(), int64_t(0));
+  });
+}
@@ -0,0 +1,138 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "TileLoadCancellation.h"
+#include "Misc/AutomationTest.h"
+#include <glm/trigonometric.hpp>
+#include <memory>
+#include <vector>
+
+BEGIN_DEFINE_SPEC(
+    FTileLoadCancellationSpec,
+    "Cesium.Unit.TileLoadCancellation",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::shared_ptr<TileLoadCancellation> pCancellation;
+
+// A view from the origin looking along +X.
+std::vector<Cesium3DTilesSelection::ViewState> MakeViews() {
+  return {Cesium3DTilesSelection::ViewState::create(
+      glm::dvec3(0.0, 0.0, 0.0),
+      glm::dvec3(1.0, 0.0, 0.0),
+      glm::dvec3(0.0, 0.0, 1.0),
+      glm::dvec2(1024.0, 1024.0),
+      glm::radians(60.0),
+      glm::radians(60.0))};
+}
+
+END_DEFINE_SPEC(FTileLoadCancellationSpec)
+
+void FTileLoadCancellationSpec::Define() {
+  BeforeEach([this]() {
+    pCancellation = std::make_shared<TileLoadCancellation>();
+  });
+
+  It("stops every tile once canceled", [this]() {
+    TileLoadCancellation::Check check(pCancellation);
+    TestFalse(
+        "before",
+        check.shouldStop(TileLoadCancellation::Stage::AfterDecode));
+
+    pCancellation->cancelAll();
+    TestTrue(
+        "after",
+        check.shouldStop(TileLoadCancellation::Stage::BeforeTextures));
+    TestTrue("stopped", check.getStoppedStage().has_value());
+    TestEqual(
+        "stage",
+        int(*check.getStoppedStage()),
+        int(TileLoadCancellation::Stage::BeforeTextures));
+  });
+
+  It("stops tiles well outside the views", [this]() {
+    pCancellation->setViews(MakeViews());
+
+    TileLoadCancellation::Check ahead(pCancellation);
+    ahead.setBounds(CesiumGeometry::BoundingSphere(glm::dvec3(100, 0, 0), 1));
+    TestFalse(
+        "ahead",
+        ahead.shouldStop(TileLoadCancellation::Stage::AfterGeometry));
+
+    TileLoadCancellation::Check behind(pCancellation);
+    behind.setBounds(
+        CesiumGeometry::BoundingSphere(glm::dvec3(-100, 0, 0), 1));
+    TestTrue(
+        "behind",
+        behind.shouldStop(TileLoadCancellation::Stage::AfterGeometry));
+
+    // Enlarged, these bounds reach into the view.
+    TileLoadCancellation::Check nearby(pCancellation);
+    nearby.setBounds(CesiumGeometry::BoundingSphere(glm::dvec3(-10, 0, 0), 5));
+    TestFalse(
+        "nearby",
+        nearby.shouldStop(TileLoadCancellation::Stage::AfterGeometry));
+  });
+
+  It("keeps tiles anywhere without views", [this]() {
+    TileLoadCancellation::Check behind(pCancellation);
+    behind.setBounds(
+        CesiumGeometry::BoundingSphere(glm::dvec3(-100, 0, 0), 1));
+    TestFalse(
+        "behind",
+        behind.shouldStop(TileLoadCancellation::Stage::AfterDecode));
+  });
+
+  It("keeps tiles without bounds", [this]() {
+    pCancellation->setViews(MakeViews());
+    TileLoadCancellation::Check check(pCancellation);
+    TestFalse(
+        "unbounded",
+        check.shouldStop(TileLoadCancellation::Stage::AfterDecode));
+  });
+
+  It("continues to stop once stopped", [this]() {
+    pCancellation->setViews(MakeViews());
+    TileLoadCancellation::Check check(pCancellation);
+    check.setBounds(CesiumGeometry::BoundingSphere(glm::dvec3(-100, 0, 0), 1));
+    TestTrue(
+        "first",
+        check.shouldStop(TileLoadCancellation::Stage::AfterDecode));
+
+    pCancellation->setViews({});
+    TestTrue(
+        "second",
+        check.shouldStop(TileLoadCancellation::Stage::BeforeCooking));
+    TestEqual(
+        "stage",
+        int(*check.getStoppedStage()),
+        int(TileLoadCancellation::Stage::AfterDecode));
+  });
+
+  It("counts canceled and wasted work", [this]() {
+    pCancellation->recordCanceled(
+        TileLoadCancellation::Stage::AfterDecode,
+        0.25);
+    pCancellation->recordCanceled(
+        TileLoadCancellation::Stage::BeforeCooking,
+        0.5);
+    pCancellation->recordWasted(1.0);
+
+    TileLoadCancellation::Statistics statistics =
+        pCancellation->getStatistics();
+    TestEqual(
+        "after decode",
+        statistics.canceled[size_t(TileLoadCancellation::Stage::AfterDecode)],
+        int64_t(1));
+    TestEqual(
+        "before textures",
+        statistics
+            .canceled[size_t(TileLoadCancellation::Stage::BeforeTextures)],
+        int64_t(0));
+    TestEqual(
+        "before cooking",
+        statistics.canceled[size_t(TileLoadCancellation::Stage::BeforeCooking)],
+        int64_t(1));
+    TestEqual("wasted", statistics.wasted, int64_t(1));
+    TestEqual("wasted seconds", statistics.wastedSeconds, 1.75, 1e-6);
+  });
+}
@@ -0,0 +1,478 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "TilesetArchive.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "UnrealAssetAccessor.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t Zip64Marker = 0xffffffff;
+
+// Writes a minimal ZIP archive. CRCs are left as zero, because they are not
+// checked when reading.
+class ZipWriter {
+public:
+  /**
+   * @param zip64 Whether to record the sizes and offsets of files, and the
+   * location of the central directory, in ZIP64 fields, as an archive larger
+   * than 4 GiB must.
+   */
+  explicit ZipWriter(bool zip64 = false) : _zip64(zip64) {}
+
+  void addFile(const std::string& path, const std::string& content) {
+    this->addEntry(path, content, 0, content.size());
+  }
+
+  void addDeflatedFile(const std::string& path, const std::string& content) {
+    int32 compressedSize =
+        FCompression::CompressMemoryBound(NAME_Zlib, int32(content.size()));
+    std::string compressed(size_t(compressedSize), '\0');
+    FCompression::CompressMemory(
+        NAME_Zlib,
+        compressed.data(),
+        compressedSize,
+        content.data(),
+        int32(content.size()),
+        COMPRESS_NoFlags,
+        -DEFAULT_ZLIB_BIT_WINDOW);
+    compressed.resize(size_t(compressedSize));
+    this->addEntry(path, compressed, 8, content.size());
+  }
+
+  // Adds a 3D Tiles archive index of the files added so far.
+  void addTilesetIndex() {
+    struct IndexEntry {
+      uint64_t low;
+      uint64_t high;
+      uint64_t offset;
+    };
+    std::vector<IndexEntry> entries;
+    for (const CentralEntry& entry : this->_entries) {
+      uint8 digest[16];
+      FMD5 md5;
+      md5.Update(
+          reinterpret_cast<const uint8*>(entry.path.data()),
+          entry.path.size());
+      md5.Final(digest);
+      IndexEntry indexEntry;
+      std::memcpy(&indexEntry.low, digest, 8);
+      std::memcpy(&indexEntry.high, digest + 8, 8);
+      indexEntry.offset = entry.localOffset;
+      entries.push_back(indexEntry);
+    }
+    std::sort(
+        entries.begin(),
+        entries.end(),
+        [](const IndexEntry& a, const IndexEntry& b) {
+          return a.high < b.high || (a.high == b.high && a.low < b.low);
+        });
+
+    std::string index;
+    for (const IndexEntry& entry : entries) {
+      index.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+    this->addFile("@3dtilesIndex1@", index);
+  }
+
+  /**
+   * Saves the archive.
+   *
+   * @param corruptCentralOffsets Whether to record the wrong local header
+   * offsets in the central directory for every file but the 3D Tiles archive
+   * index, so that those files can only be found with the index.
+   */
+  bool save(const FString& filename, bool corruptCentralOffsets = false) {
+    uint32_t centralOffset = uint32_t(this->_buffer.size());
+    for (const CentralEntry& entry : this->_entries) {
+      uint32_t localOffset = entry.localOffset;
+      if (corruptCentralOffsets && entry.path != "@3dtilesIndex1@") {
+        ++localOffset;
+      }
+
+      this->write32(0x02014b50);
+      this->write16(45);
+      this->write16(45);
+      this->write16(0);
+      this->write16(entry.method);
+      this->write32(0);
+      this->write32(0);
+      this->write32(this->_zip64 ? Zip64Marker : entry.compressedSize);
+      this->write32(this->_zip64 ? Zip64Marker : entry.uncompressedSize);
+      this->write16(uint16_t(entry.path.size()));
+      this->write16(this->_zip64 ? 28 : 0);
+      this->write16(0);
+      this->write16(0);
+      this->write16(0);
+      this->write32(0);
+      this->write32(this->_zip64 ? Zip64Marker : localOffset);
+      this->_buffer.append(entry.path);
+      if (this->_zip64) {
+        this->write16(0x0001);
+        this->write16(24);
+        this->write64(entry.uncompressedSize);
+        this->write64(entry.compressedSize);
+        this->write64(localOffset);
+      }
+    }
+    uint32_t centralSize = uint32_t(this->_buffer.size()) - centralOffset;
+
+    if (this->_zip64) {
+      uint32_t zip64EndOffset = uint32_t(this->_buffer.size());
+      this->write32(0x06064b50);
+      this->write64(44);
+      this->write16(45);
+      this->write16(45);
+      this->write32(0);
+      this->write32(0);
+      this->write64(this->_entries.size());
+      this->write64(this->_entries.size());
+      this->write64(centralSize);
+      this->write64(centralOffset);
+
+      this->write32(0x07064b50);
+      this->write32(0);
+      this->write64(zip64EndOffset);
+      this->write32(1);
+    }
+
+    this->write32(0x06054b50);
+    this->write16(0);
+    this->write16(0);
+    this->write16(this->_zip64 ? 0xffff : uint16_t(this->_entries.size()));
+    this->write16(this->_zip64 ? 0xffff : uint16_t(this->_entries.size()));
+    this->write32(this->_zip64 ? Zip64Marker : centralSize);
+    this->write32(this->_zip64 ? Zip64Marker : centralOffset);
+    this->write16(0);
+
+    return FFileHelper::SaveArrayToFile(
+        TArrayView<const uint8>(
+            reinterpret_cast<const uint8*>(this->_buffer.data()),
+            int32(this->_buffer.size())),
+        *filename);
+  }
+
+private:
+  struct CentralEntry {
+    std::string path;
+    uint16_t method;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+    uint32_t localOffset;
+  };
+
+  void addEntry(
+      const std::string& path,
+      const std::string& data,
+      uint16_t method,
+      size_t uncompressedSize) {
+    CentralEntry entry{
+        path,
+        method,
+        uint32_t(data.size()),
+        uint32_t(uncompressedSize),
+        uint32_t(this->_buffer.size())};
+
+    this->write32(0x04034b50);
+    this->write16(45);
+    this->write16(0);
+    this->write16(method);
+    this->write32(0);
+    this->write32(0);
+    this->write32(this->_zip64 ? Zip64Marker : entry.compressedSize);
+    this->write32(this->_zip64 ? Zip64Marker : entry.uncompressedSize);
+    this->write16(uint16_t(path.size()));
+    this->write16(this->_zip64 ? 20 : 0);
+    this->_buffer.append(path);
+    if (this->_zip64) {
+      this->write16(0x0001);
+      this->write16(16);
+      this->write64(entry.uncompressedSize);
+      this->write64(entry.compressedSize);
+    }
+    this->_buffer.append(data);
+
+    this->_entries.push_back(std::move(entry));
+  }
+
+  void write16(uint16_t value) {
+    this->_buffer.append(reinterpret_cast<const char*>(&value), 2);
+  }
+  void write32(uint32_t value) {
+    this->_buffer.append(reinterpret_cast<const char*>(&value), 4);
+  }
+  void write64(uint64_t value) {
+    this->_buffer.append(reinterpret_cast<const char*>(&value), 8);
+  }
+
+  bool _zip64;
+  std::string _buffer;
+  std::vector<CentralEntry> _entries;
+};
+
+} // namespace
+
+BEGIN_DEFINE_SPEC(
+    FTilesetArchiveSpec,
+    "Cesium.Unit.TilesetArchive",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+FString Filename;
+
+std::string Read(const TilesetArchive& archive, const std::string& path) {
+  std::optional<TilesetArchive::Entry> maybeEntry = archive.findEntry(path);
+  TestTrue("found", maybeEntry.has_value());
+  if (!maybeEntry) {
+    return std::string();
+  }
+
+  if (maybeEntry->isCompressed()) {
+    TArray64<uint8> data;
+    TestTrue("inflated", archive.inflate(*maybeEntry, data));
+    return std::string(
+        reinterpret_cast<const char*>(data.GetData()),
+        size_t(data.Num()));
+  }
+
+  gsl::span<const std::byte> data = archive.getStoredData(*maybeEntry);
+  return std::string(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// Requests a file:/// URL, as a tileset does, and returns the status code and
+// the data of the response.
+std::pair<uint16_t, std::string> Request(const FString& path) {
+  FString uri = TEXT("file:///") + Filename + path;
+  uri.ReplaceCharInline('\\', '/');
+  uri.ReplaceInline(TEXT(" "), TEXT("%20"));
+
+  UnrealAssetAccessor accessor{};
+  bool done = false;
+  std::pair<uint16_t, std::string> result{0, std::string()};
+  accessor.get(getAsyncSystem(), TCHAR_TO_UTF8(*uri), {})
+      .thenInMainThread(
+          [&](std::shared_ptr<CesiumAsync::IAssetRequest>&& pRequest) {
+            const CesiumAsync::IAssetResponse* pResponse =
+                pRequest->response();
+            if (pResponse) {
+              gsl::span<const std::byte> data = pResponse->data();
+              result.first = pResponse->statusCode();
+              result.second.assign(
+                  reinterpret_cast<const char*>(data.data()),
+                  data.size());
+            }
+            done = true;
+          });
+
+  while (!done) {
+    accessor.tick();
+    getAsyncSystem().dispatchMainThreadTasks();
+  }
+
+  return result;
+}
+
+END_DEFINE_SPEC(FTilesetArchiveSpec)
+
+void FTilesetArchiveSpec::Define() {
+  BeforeEach([this]() {
+    Filename = FPaths::ConvertRelativePathToFull(
+                   FPaths::CreateTempFilename(*FPaths::ProjectSavedDir())) +
+               TEXT(".3tz");
+  });
+
+  AfterEach([this]() {
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Filename);
+  });
+
+  It("reads files from its central directory", [this]() {
+    ZipWriter writer;
+    writer.addFile("tileset.json", "{}");
+    writer.addFile("tiles/0.glb", "glTF");
+    TestTrue("saved", writer.save(Filename));
+
+    std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::open(Filename);
+    TestNotNull("archive", pArchive.get());
+    if (!pArchive) {
+      return;
+    }
+
+    TestFalse("index", pArchive->hasTilesetIndex());
+    TestEqual("entries", pArchive->getEntryCount(), int64_t(2));
+    TestEqual("tileset", Read(*pArchive, "tileset.json"), std::string("{}"));
+    TestEqual("tile", Read(*pArchive, "tiles/0.glb"), std::string("glTF"));
+    TestFalse("missing", pArchive->findEntry("tiles/1.glb").has_value());
+  });
+
+  It("reads files with its 3D Tiles archive index", [this]() {
+    ZipWriter writer;
+    for (int i = 0; i < 100; ++i) {
+      writer.addFile("tiles/" + std::to_string(i) + ".glb", std::to_string(i));
+    }
+    writer.addTilesetIndex();
+    TestTrue("saved", writer.save(Filename));
+
+    std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::open(Filename);
+    TestNotNull("archive", pArchive.get());
+    if (!pArchive) {
+      return;
+    }
+
+    TestTrue("index", pArchive->hasTilesetIndex());
+    for (int i = 0; i < 100; ++i) {
+      std::string path = "tiles/" + std::to_string(i) + ".glb";
+      TestTrue(
+          "in index",
+          pArchive->findInTilesetIndex(path).has_value());
+      TestEqual("tile", Read(*pArchive, path), std::to_string(i));
+    }
+    TestFalse(
+        "missing from index",
+        pArchive->findInTilesetIndex("tiles/100.glb").has_value());
+    TestFalse("missing", pArchive->findEntry("tiles/100.glb").has_value());
+  });
+
+  It("does not need the central directory with an index", [this]() {
+    ZipWriter writer;
+    writer.addFile("tileset.json", "{}");
+    writer.addFile("tiles/0.glb", "glTF");
+    writer.addTilesetIndex();
+    TestTrue("saved", writer.save(Filename, true));
+
+    std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::open(Filename);
+    TestNotNull("archive", pArchive.get());
+    if (!pArchive) {
+      return;
+    }
+
+    // The central directory's offsets are wrong, so these files can only be
+    // read if they are found with the index.
+    TestTrue("index", pArchive->hasTilesetIndex());
+    TestFalse(
+        "central directory",
+        pArchive->findInCentralDirectory("tileset.json").has_value());
+    TestEqual("tileset", Read(*pArchive, "tileset.json"), std::string("{}"));
+    TestEqual("tile", Read(*pArchive, "tiles/0.glb"), std::string("glTF"));
+  });
+
+  It("reads ZIP64 sizes and offsets", [this]() {
+    ZipWriter writer(true);
+    writer.addFile("tileset.json", "{}");
+    writer.addDeflatedFile("tiles/0.glb", "glTF glTF glTF glTF");
+    writer.addTilesetIndex();
+    TestTrue("saved", writer.save(Filename));
+
+    std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::open(Filename);
+    TestNotNull("archive", pArchive.get());
+    if (!pArchive) {
+      return;
+    }
+
+    TestEqual("entries", pArchive->getEntryCount(), int64_t(3));
+    TestTrue("index", pArchive->hasTilesetIndex());
+
+    std::optional<TilesetArchive::Entry> maybeCentral =
+        pArchive->findInCentralDirectory("tiles/0.glb");
+    std::optional<TilesetArchive::Entry> maybeIndexed =
+        pArchive->findInTilesetIndex("tiles/0.glb");
+    TestTrue("central directory", maybeCentral.has_value());
+    TestTrue("indexed", maybeIndexed.has_value());
+    if (maybeCentral && maybeIndexed) {
+      TestEqual(
+          "data offset",
+          maybeCentral->dataOffset,
+          maybeIndexed->dataOffset);
+      TestEqual(
+          "uncompressed size",
+          maybeCentral->uncompressedSize,
+          int64_t(19));
+      TestEqual(
+          "compressed size",
+          maybeCentral->compressedSize,
+          maybeIndexed->compressedSize);
+    }
+
+    TestEqual("tileset", Read(*pArchive, "tileset.json"), std::string("{}"));
+    TestEqual(
+        "tile",
+        Read(*pArchive, "tiles/0.glb"),
+        std::string("glTF glTF glTF glTF"));
+  });
+
+  Describe("file:/// URLs", [this]() {
+    BeforeEach([this]() {
+      ZipWriter writer;
+      writer.addFile("tileset.json", "{}");
+      writer.addFile("tiles/0.glb", "glTF");
+      TestTrue("saved", writer.save(Filename));
+    });
+
+    It("are routed to files within the archive", [this]() {
+      std::pair<uint16_t, std::string> result = Request(TEXT("/tiles/0.glb"));
+      TestEqual("status", result.first, uint16_t(200));
+      TestEqual("data", result.second, std::string("glTF"));
+    });
+
+    It("may repeat the slash after the archive", [this]() {
+      std::pair<uint16_t, std::string> result = Request(TEXT("//tiles/0.glb"));
+      TestEqual("status", result.first, uint16_t(200));
+      TestEqual("data", result.second, std::string("glTF"));
+    });
+
+    It("ignore query parameters", [this]() {
+      std::pair<uint16_t, std::string> result =
+          Request(TEXT("/tileset.json?v=1"));
+      TestEqual("status", result.first, uint16_t(200));
+      TestEqual("data", result.second, std::string("{}"));
+    });
+
+    It("are not found for files missing from the archive", [this]() {
+      std::pair<uint16_t, std::string> result = Request(TEXT("/tiles/1.glb"));
+      TestEqual("status", result.first, uint16_t(404));
+    });
+
+    It("use backslashes as separators", [this]() {
+      std::string entryPath;
+      std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::find(
+          TCHAR_TO_UTF8(*(Filename + TEXT("\\tiles\\0.glb"))),
+          entryPath);
+      TestNotNull("archive", pArchive.get());
+      TestEqual("entry path", entryPath, std::string("tiles/0.glb"));
+    });
+  });
+
+  It("decompresses deflated files", [this]() {
+    std::string content;
+    while (content.size() < 10000) {
+      content += "Some compressible text. ";
+    }
+
+    ZipWriter writer;
+    writer.addDeflatedFile("tileset.json", content);
+    TestTrue("saved", writer.save(Filename));
+
+    std::shared_ptr<TilesetArchive> pArchive = TilesetArchive::open(Filename);
+    TestNotNull("archive", pArchive.get());
+    if (!pArchive) {
+      return;
+    }
+
+    TestEqual("content", Read(*pArchive, "tileset.json"), content);
+  });
+
+  It("does not open files that are not archives", [this]() {
+    FFileHelper::SaveStringToFile(TEXT("Not an archive."), *Filename);
+    TestNull("archive", TilesetArchive::open(Filename).get());
+  });
+}
@@ -85,4 +85,31 @@ void FUnrealAssetAccessorSpec::Define() {
 
     TestAccessorRequest(Uri, randomText);
   });
+
+  It("Can access empty file:/// URLs", [this]() {
+    FFileHelper::SaveStringToFile(TEXT(""), *Filename);
+
+    FString Uri = TEXT("file:///") + Filename;
+    Uri.ReplaceCharInline('\\', '/');
+    Uri.ReplaceInline(TEXT(" "), TEXT("%20"));
+
+    TestAccessorRequest(Uri, "");
+  });
+
+  It("Can access large file:/// URLs", [this]() {
+    std::string largeText;
+    while (largeText.size() < 1024 * 1024) {
+      largeText += randomText;
+    }
+    FFileHelper::SaveStringToFile(
+        UTF8_TO_TCHAR(largeText.c_str()),
+        *Filename,
+        FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+
+    FString Uri = TEXT("file:///") + Filename;
+    Uri.ReplaceCharInline('\\', '/');
+    Uri.ReplaceInline(TEXT(" "), TEXT("%20"));
+
+    TestAccessorRequest(Uri, largeText);
+  });
 }
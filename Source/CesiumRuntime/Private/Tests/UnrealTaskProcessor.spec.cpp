@@ -0,0 +1,155 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "UnrealTaskProcessor.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/QueuedThreadPool.h"
+#include <atomic>
+#include <memory>
+
+BEGIN_DEFINE_SPEC(
+    FUnrealTaskProcessorSpec,
+    "Cesium.Unit.UnrealTaskProcessor",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+// Waits up to ten seconds for the given number of tasks to complete.
+bool WaitFor(const std::atomic<int>& completed, int count) {
+  double endTime = FPlatformTime::Seconds() + 10.0;
+  while (completed.load() < count) {
+    if (FPlatformTime::Seconds() > endTime) {
+      return false;
+    }
+    FPlatformProcess::Sleep(0.001f);
+  }
+  return true;
+}
+
+END_DEFINE_SPEC(FUnrealTaskProcessorSpec)
+
+void FUnrealTaskProcessorSpec::Define() {
+  for (int32 threadCount : {0, 2}) {
+    Describe(
+        threadCount > 0 ? TEXT("with dedicated threads")
+                        : TEXT("with engine threads"),
+        [this, threadCount]() {
+          It("runs tasks in the lane of the scope that starts them",
+             [this, threadCount]() {
+               TUniquePtr<FQueuedThreadPool> pThreadPool =
+                   UnrealTaskProcessor::createThreadPool(threadCount);
+               UnrealTaskProcessor processor(pThreadPool.Get());
+               TestEqual(
+                   "thread count",
+                   processor.getThreadCount(),
+                   threadCount);
+
+               std::atomic<int> completed(0);
+               std::atomic<int> lane(-1);
+               {
+                 UnrealTaskProcessor::LaneScope scope(
+                     UnrealTaskProcessor::Lane::Texture);
+                 processor.startTask([&completed, &lane]() {
+                   lane = int(UnrealTaskProcessor::getCurrentLane());
+                   ++completed;
+                 });
+               }
+               TestEqual(
+                   "lane after scope",
+                   int(UnrealTaskProcessor::getCurrentLane()),
+                   int(UnrealTaskProcessor::Lane::Decode));
+
+               TestTrue("completed", WaitFor(completed, 1));
+               TestEqual(
+                   "lane",
+                   lane.load(),
+                   int(UnrealTaskProcessor::Lane::Texture));
+             });
+
+          It("starts continuations in the lane of the running task",
+             [this, threadCount]() {
+               TUniquePtr<FQueuedThreadPool> pThreadPool =
+                   UnrealTaskProcessor::createThreadPool(threadCount);
+               UnrealTaskProcessor processor(pThreadPool.Get());
+
+               std::atomic<int> completed(0);
+               std::atomic<int> lane(-1);
+               processor.startTask(
+                   UnrealTaskProcessor::Lane::Geometry,
+                   [&processor, &completed, &lane]() {
+                     processor.startTask([&completed, &lane]() {
+                       lane = int(UnrealTaskProcessor::getCurrentLane());
+                       ++completed;
+                     });
+                     ++completed;
+                   });
+
+               TestTrue("completed", WaitFor(completed, 2));
+               TestEqual(
+                   "lane",
+                   lane.load(),
+                   int(UnrealTaskProcessor::Lane::Geometry));
+             });
+
+          It("counts the tasks in each lane", [this, threadCount]() {
+            TUniquePtr<FQueuedThreadPool> pThreadPool =
+                UnrealTaskProcessor::createThreadPool(threadCount);
+            UnrealTaskProcessor processor(pThreadPool.Get());
+
+            std::atomic<int> completed(0);
+            for (int i = 0; i < 10; ++i) {
+              processor.startTask(
+                  UnrealTaskProcessor::Lane::Decode,
+                  [&completed]() {
+                    FPlatformProcess::Sleep(0.001f);
+                    ++completed;
+                  });
+            }
+            processor.startTask(
+                UnrealTaskProcessor::Lane::Texture,
+                [&completed]() { ++completed; });
+
+            TestTrue("completed", WaitFor(completed, 11));
+
+            // The counters are updated just after each task returns.
+            FPlatformProcess::Sleep(0.05f);
+
+            UnrealTaskProcessor::LaneStatistics decode =
+                processor.getLaneStatistics(UnrealTaskProcessor::Lane::Decode);
+            TestEqual("decode started", int64(decode.started), int64(10));
+            TestEqual("decode completed", int64(decode.completed), int64(10));
+            TestEqual("decode queued", int64(decode.queued), int64(0));
+            TestTrue("decode execution", decode.totalExecutionSeconds >= 0.005);
+            TestTrue(
+                "decode maximum execution",
+                decode.maximumExecutionSeconds <=
+                    decode.totalExecutionSeconds);
+
+            UnrealTaskProcessor::LaneStatistics texture =
+                processor.getLaneStatistics(
+                    UnrealTaskProcessor::Lane::Texture);
+            TestEqual("texture completed", int64(texture.completed), int64(1));
+
+            UnrealTaskProcessor::LaneStatistics geometry =
+                processor.getLaneStatistics(
+                    UnrealTaskProcessor::Lane::Geometry);
+            TestEqual("geometry started", int64(geometry.started), int64(0));
+          });
+        });
+  }
+
+  It("runs tasks on engine threads once its pool is detached", [this]() {
+    TUniquePtr<FQueuedThreadPool> pThreadPool =
+        UnrealTaskProcessor::createThreadPool(2);
+    UnrealTaskProcessor processor(pThreadPool.Get());
+    TestEqual("thread count", processor.getThreadCount(), 2);
+
+    processor.detachThreadPool();
+    pThreadPool.Reset();
+    TestEqual("detached thread count", processor.getThreadCount(), 0);
+
+    std::atomic<int> completed(0);
+    processor.startTask([&completed]() { ++completed; });
+    TestTrue("completed", WaitFor(completed, 1));
+  });
+}
@@ -0,0 +1,225 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "WarmSetAssetAccessor.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include "CesiumTestFakes.h"
+#include "Misc/AutomationTest.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace CesiumTestFakes;
+
+BEGIN_DEFINE_SPEC(
+    FWarmSetAssetAccessorSpec,
+    "Cesium.Unit.WarmSetAssetAccessor",
+    EAutomationTestFlags::ApplicationContextMask |
+        EAutomationTestFlags::ProductFilter)
+
+std::shared_ptr<FakeAssetAccessor> pFake;
+
+std::shared_ptr<WarmSetAssetAccessor>
+createAccessor(std::vector<std::string>&& warmSet) {
+  return std::make_shared<WarmSetAssetAccessor>(pFake, std::move(warmSet));
+}
+
+END_DEFINE_SPEC(FWarmSetAssetAccessorSpec)
+
+void FWarmSetAssetAccessorSpec::Define() {
+  BeforeEach([this]() { pFake = std::make_shared<FakeAssetAccessor>(); });
+
+  AfterEach([this]() { pFake.reset(); });
+
+  Describe("get", [this]() {
+    It("prefetches the warm set with the first request's credentials",
+       [this]() {
+         auto pAccessor = createAccessor(
+             {"https://tile.googleapis.com/a.glb",
+              "https://tile.googleapis.com/b.glb"});
+         pAccessor
+             ->get(
+                 getAsyncSystem(),
+                 "https://tile.googleapis.com/a.glb?key=k",
+                 {})
+             .wait();
+
+         TestEqual("inner requests", pFake->urls.size(), size_t(2));
+         TestEqual(
+             "prefetch",
+             pFake->urls[0],
+             std::string("https://tile.googleapis.com/b.glb?key=k"));
+         TestEqual(
+             "request",
+             pFake->urls[1],
+             std::string("https://tile.googleapis.com/a.glb?key=k"));
+       });
+
+    It("serves a prefetched response", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://example.com/a.glb", "https://example.com/b.glb?lod=2&v=1"});
+      pAccessor->get(getAsyncSystem(), "https://example.com/a.glb", {}).wait();
+
+      // The query parameters may be in another order.
+      auto pRequest =
+          pAccessor
+              ->get(getAsyncSystem(), "https://example.com/b.glb?v=1&lod=2", {})
+              .wait();
+      TestEqual("inner requests", pFake->urls.size(), size_t(2));
+      TestEqual("status", pRequest->response()->statusCode(), uint16_t(200));
+    });
+
+    It("requests URLs that are not in the warm set", [this]() {
+      auto pAccessor = createAccessor({"https://example.com/a.glb"});
+      pAccessor->get(getAsyncSystem(), "https://example.com/c.glb", {}).wait();
+      TestEqual("inner requests", pFake->urls.size(), size_t(1));
+    });
+
+    It("serves a prefetched response only once", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://example.com/a.glb", "https://example.com/b.glb"});
+      pAccessor->get(getAsyncSystem(), "https://example.com/a.glb", {}).wait();
+      pAccessor->get(getAsyncSystem(), "https://example.com/b.glb", {}).wait();
+      TestEqual("claimed", pFake->urls.size(), size_t(2));
+
+      pAccessor->get(getAsyncSystem(), "https://example.com/b.glb", {}).wait();
+      TestEqual("requested again", pFake->urls.size(), size_t(3));
+    });
+
+    It("does not serve a prefetch made with other headers", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://example.com/a.glb", "https://example.com/b.glb"});
+      pAccessor
+          ->get(getAsyncSystem(), "https://example.com/a.glb", {{"A", "1"}})
+          .wait();
+      pAccessor
+          ->get(getAsyncSystem(), "https://example.com/b.glb", {{"A", "2"}})
+          .wait();
+      TestEqual("inner requests", pFake->urls.size(), size_t(3));
+    });
+
+    It("does not serve a prefetch made with other credentials", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://tile.googleapis.com/a.glb",
+           "https://tile.googleapis.com/b.glb"});
+      pAccessor
+          ->get(getAsyncSystem(), "https://tile.googleapis.com/a.glb?key=1", {})
+          .wait();
+      pAccessor
+          ->get(getAsyncSystem(), "https://tile.googleapis.com/b.glb?key=2", {})
+          .wait();
+      TestEqual("inner requests", pFake->urls.size(), size_t(3));
+    });
+
+    It("requests a URL again if its prefetch failed", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://example.com/a.glb", "https://example.com/b.glb"});
+      pFake->statusCode = 500;
+      pAccessor->get(getAsyncSystem(), "https://example.com/a.glb", {}).wait();
+
+      pFake->statusCode = 200;
+      auto pRequest =
+          pAccessor->get(getAsyncSystem(), "https://example.com/b.glb", {})
+              .wait();
+      TestEqual("inner requests", pFake->urls.size(), size_t(3));
+      TestEqual("status", pRequest->response()->statusCode(), uint16_t(200));
+    });
+
+    It("prefetches each server's URLs on its first request", [this]() {
+      auto pAccessor = createAccessor(
+          {"https://api.example.com/endpoint",
+           "https://assets.example.com/a.glb",
+           "https://assets.example.com/b.glb"});
+      pAccessor
+          ->get(getAsyncSystem(), "https://api.example.com/endpoint", {})
+          .wait();
+      TestEqual("api server", pFake->urls.size(), size_t(1));
+
+      pAccessor
+          ->get(getAsyncSystem(), "https://assets.example.com/a.glb", {})
+          .wait();
+      TestEqual("asset server", pFake->urls.size(), size_t(3));
+    });
+  });
+
+  Describe("getRecordedUrls", [this]() {
+    It("records every URL without credentials", [this]() {
+      auto pAccessor = createAccessor({});
+      pAccessor
+          ->get(
+              getAsyncSystem(),
+              "https://tile.googleapis.com/root.json?key=k",
+              {})
+          .wait();
+      pAccessor
+          ->get(
+              getAsyncSystem(),
+              "https://tile.googleapis.com/a.glb?session=s&key=k",
+              {})
+          .wait();
+
+      std::vector<std::string> urls = pAccessor->getRecordedUrls({});
+      TestEqual("count", urls.size(), size_t(2));
+      TestEqual(
+          "root",
+          urls[0],
+          std::string("https://tile.googleapis.com/root.json"));
+      TestEqual(
+          "content",
+          urls[1],
+          std::string("https://tile.googleapis.com/a.glb"));
+    });
+  });
+
+  Describe("stripCredentials", [this]() {
+    It("removes access tokens, keys, and sessions", [this]() {
+      TestEqual(
+          "ion",
+          WarmSetAssetAccessor::stripCredentials(
+              "https://assets.ion.cesium.com/1/0/0.b3dm?v=2&access_token=abc"),
+          std::string("https://assets.ion.cesium.com/1/0/0.b3dm?v=2"));
+      TestEqual(
+          "google",
+          WarmSetAssetAccessor::stripCredentials(
+              "https://tile.googleapis.com/v1/3dtiles/a.glb?session=s&key=k"),
+          std::string("https://tile.googleapis.com/v1/3dtiles/a.glb"));
+    });
+
+    It("keeps other parameters, sorted, and the fragment", [this]() {
+      TestEqual(
+          "url",
+          WarmSetAssetAccessor::stripCredentials(
+              "https://example.com/a.glb?v=1&access_token=t&lod=2#x"),
+          std::string("https://example.com/a.glb?lod=2&v=1#x"));
+    });
+
+    It("keeps parameters that are only credentials elsewhere", [this]() {
+      TestEqual(
+          "url",
+          WarmSetAssetAccessor::stripCredentials(
+              "https://example.com/a.glb?key=b&token=t"),
+          std::string("https://example.com/a.glb?key=b&token=t"));
+    });
+  });
+
+  Describe("addCredentials", [this]() {
+    It("copies the credentials of a URL from the same server", [this]() {
+      TestEqual(
+          "url",
+          WarmSetAssetAccessor::addCredentials(
+              "https://tile.googleapis.com/v1/3dtiles/b.glb",
+              "https://tile.googleapis.com/v1/3dtiles/a.glb?session=s&key=k"),
+          std::string(
+              "https://tile.googleapis.com/v1/3dtiles/b.glb?session=s&key=k"));
+    });
+
+    It("does not send credentials to another server", [this]() {
+      TestEqual(
+          "url",
+          WarmSetAssetAccessor::addCredentials(
+              "https://example.com/b.glb?v=1",
+              "https://tile.googleapis.com/v1/3dtiles/a.glb?key=k"),
+          std::string("https://example.com/b.glb?v=1"));
+    });
+  });
+}
@@ -0,0 +1,138 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "TileLoadCancellation.h"
+#include "Cesium3DTilesSelection/BoundingVolume.h"
+#include "CesiumMipResidency.h"
+#include "CesiumStats.h"
+#include <algorithm>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Tile Preparations Canceled"),
+    STAT_CesiumTilePreparationsCanceled,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Tile Preparations Wasted"),
+    STAT_CesiumTilePreparationsWasted,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_ACCUMULATOR_STAT(
+    TEXT("Tile Preparation Time Wasted (ms)"),
+    STAT_CesiumTilePreparationTimeWasted,
+    STATGROUP_Cesium);
+
+TileLoadCancellation::Check::Check(
+    const std::shared_ptr<TileLoadCancellation>& pCancellation)
+    : _pCancellation(pCancellation), _bounds(), _stopped() {}
+
+void TileLoadCancellation::Check::setBounds(
+    const CesiumGeometry::BoundingSphere& bounds) {
+  this->_bounds = bounds;
+}
+
+bool TileLoadCancellation::Check::shouldStop(Stage stage) {
+  if (this->_stopped) {
+    return true;
+  }
+
+  if (!this->_pCancellation) {
+    return false;
+  }
+
+  if (this->_pCancellation->isCanceled() ||
+      (this->_bounds && this->_pCancellation->isOutsideViews(*this->_bounds))) {
+    this->_stopped = stage;
+    return true;
+  }
+
+  return false;
+}
+
+double TileLoadCancellation::Check::computeProjectedPixels() const {
+  if (!this->_pCancellation || !this->_bounds) {
+    return 0.0;
+  }
+  return this->_pCancellation->computeProjectedPixels(*this->_bounds);
+}
+
+TileLoadCancellation::TileLoadCancellation()
+    : _canceled(false),
+      _viewsMutex(),
+      _views(),
+      _canceledCounts(),
+      _wasted(0),
+      _wastedMicroseconds(0) {
+  for (std::atomic<int64_t>& count : this->_canceledCounts) {
+    count = 0;
+  }
+}
+
+void TileLoadCancellation::cancelAll() { this->_canceled = true; }
+
+void TileLoadCancellation::setViews(
+    const std::vector<Cesium3DTilesSelection::ViewState>& views) {
+  std::lock_guard<std::mutex> lock(this->_viewsMutex);
+  this->_views = views;
+}
+
+bool TileLoadCancellation::isOutsideViews(
+    const CesiumGeometry::BoundingSphere& bounds) const {
+  CesiumGeometry::BoundingSphere enlarged(
+      bounds.getCenter(),
+      bounds.getRadius() * BoundsScale);
+
+  std::lock_guard<std::mutex> lock(this->_viewsMutex);
+  if (this->_views.empty()) {
+    return false;
+  }
+
+  for (const Cesium3DTilesSelection::ViewState& view : this->_views) {
+    if (view.isBoundingVolumeVisible(enlarged)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+double TileLoadCancellation::computeProjectedPixels(
+    const CesiumGeometry::BoundingSphere& bounds) const {
+  std::lock_guard<std::mutex> lock(this->_viewsMutex);
+
+  double projectedPixels = 0.0;
+  for (const Cesium3DTilesSelection::ViewState& view : this->_views) {
+    projectedPixels = std::max(
+        projectedPixels,
+        CesiumMipResidency::computeProjectedPixels(
+            bounds.getRadius(),
+            glm::distance(view.getPosition(), bounds.getCenter()),
+            glm::degrees(view.getHorizontalFieldOfView()),
+            view.getViewportSize().x));
+  }
+
+  return projectedPixels;
+}
+
+void TileLoadCancellation::recordCanceled(Stage stage, double seconds) {
+  ++this->_canceledCounts[size_t(stage)];
+  this->_wastedMicroseconds += int64_t(seconds * 1e6);
+  INC_DWORD_STAT(STAT_CesiumTilePreparationsCanceled);
+  INC_FLOAT_STAT_BY(STAT_CesiumTilePreparationTimeWasted, seconds * 1000.0);
+}
+
+void TileLoadCancellation::recordWasted(double seconds) {
+  ++this->_wasted;
+  this->_wastedMicroseconds += int64_t(seconds * 1e6);
+  INC_DWORD_STAT(STAT_CesiumTilePreparationsWasted);
+  INC_FLOAT_STAT_BY(STAT_CesiumTilePreparationTimeWasted, seconds * 1000.0);
+}
+
+TileLoadCancellation::Statistics TileLoadCancellation::getStatistics() const {
+  Statistics statistics;
+  for (size_t i = 0; i < StageCount; ++i) {
+    statistics.canceled[i] = this->_canceledCounts[i].load();
+  }
+  statistics.wasted = this->_wasted.load();
+  statistics.wastedSeconds = double(this->_wastedMicroseconds.load()) * 1e-6;
+  return statistics;
+}
@@ -0,0 +1,177 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "Cesium3DTilesSelection/ViewState.h"
+#include "CesiumGeometry/BoundingSphere.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * Decides whether the work of preparing a tileset's tiles for rendering in
+ * worker threads is still wanted, so that it can stop early rather than
+ * producing a result that is freed at once.
+ *
+ * Preparing any of the tileset's tiles stops once the tileset is destroyed.
+ * Preparing a tile also stops when the tile lies well outside all of the views
+ * the tileset was most recently updated with, such as after the camera has
+ * turned or moved quickly. The tile's bounds are enlarged before they are
+ * tested, so that the siblings and ancestors of visible tiles, which the
+ * tileset may load deliberately, are not affected. A tile whose preparation
+ * stops is loaded again if the tileset selects it again.
+ */
+class TileLoadCancellation {
+public:
+  /**
+   * The points in a tile's preparation at which it may stop.
+   */
+  enum class Stage : uint8_t {
+    /** After the tile's content is decoded, before any meshes are created. */
+    AfterDecode,
+    /** After a mesh's vertices are created, before the next mesh. */
+    AfterGeometry,
+    /** Before a mesh's textures are created. */
+    BeforeTextures,
+    /** Before a mesh's physics mesh is cooked. */
+    BeforeCooking
+  };
+
+  static constexpr size_t StageCount = 4;
+
+  /**
+   * The number by which a tile's bounding sphere radius is multiplied before
+   * testing whether it is outside the views. A sphere enlarged by this much
+   * encloses its parent's bounds for the usual subdivisions.
+   */
+  static constexpr double BoundsScale = 4.0;
+
+  /**
+   * Counts of the tile preparations that stopped early, and of the work that
+   * was done for nothing, since this object was created.
+   */
+  struct Statistics {
+    /**
+     * The number of tile preparations that stopped at each stage.
+     */
+    std::array<int64_t, StageCount> canceled;
+
+    /**
+     * The number of tiles fully prepared in a worker thread but freed before
+     * they were used.
+     */
+    int64_t wasted;
+
+    /**
+     * The time spent in worker threads on those tiles, and on the tiles whose
+     * preparation stopped, before it stopped.
+     */
+    double wastedSeconds;
+  };
+
+  /**
+   * The state of the preparation of one tile.
+   */
+  class Check {
+  public:
+    explicit Check(const std::shared_ptr<TileLoadCancellation>& pCancellation);
+
+    /**
+     * Sets the tile's bounds, in the tileset's coordinate system, which allow
+     * its preparation to stop when it is outside the views.
+     */
+    void setBounds(const CesiumGeometry::BoundingSphere& bounds);
+
+    /**
+     * Determines whether the tile's preparation should stop at the given
+     * stage. Once this returns true, it continues to do so, and the first
+     * stage at which it did is recorded.
+     */
+    bool shouldStop(Stage stage);
+
+    /**
+     * Computes the number of pixels that the tile is expected to span on the
+     * screen, as from {@link TileLoadCancellation::computeProjectedPixels}, or
+     * 0 if its bounds are not known.
+     */
+    double computeProjectedPixels() const;
+
+    /**
+     * Gets the stage at which the preparation stopped, if it did.
+     */
+    std::optional<Stage> getStoppedStage() const { return this->_stopped; }
+
+  private:
+    std::shared_ptr<TileLoadCancellation> _pCancellation;
+    std::optional<CesiumGeometry::BoundingSphere> _bounds;
+    std::optional<Stage> _stopped;
+  };
+
+  TileLoadCancellation();
+
+  /**
+   * Stops the preparation of all tiles, such as when the tileset is
+   * destroyed.
+   */
+  void cancelAll();
+
+  /**
+   * Whether {@link cancelAll} has been called.
+   */
+  bool isCanceled() const { return this->_canceled; }
+
+  /**
+   * Sets the views that tiles must be near in order to be prepared. If there
+   * are no views, as when frustum culling is disabled or culled tiles are
+   * loaded to a screen-space error of their own, tiles are prepared wherever
+   * they are.
+   */
+  void setViews(const std::vector<Cesium3DTilesSelection::ViewState>& views);
+
+  /**
+   * Determines whether the given bounds, enlarged by {@link BoundsScale}, are
+   * outside all of the current views.
+   */
+  bool isOutsideViews(const CesiumGeometry::BoundingSphere& bounds) const;
+
+  /**
+   * Computes the largest number of pixels that the given bounds span in any
+   * of the current views, as from CesiumMipResidency::computeProjectedPixels,
+   * or 0 if there are no views.
+   */
+  double
+  computeProjectedPixels(const CesiumGeometry::BoundingSphere& bounds) const;
+
+  /**
+   * Records a tile preparation that stopped early.
+   *
+   * @param stage The stage at which it stopped.
+   * @param seconds The time spent preparing the tile before it stopped.
+   */
+  void recordCanceled(Stage stage, double seconds);
+
+  /**
+   * Records a tile that was fully prepared in a worker thread but freed
+   * before it was used.
+   *
+   * @param seconds The time spent preparing the tile.
+   */
+  void recordWasted(double seconds);
+
+  Statistics getStatistics() const;
+
+private:
+  std::atomic<bool> _canceled;
+
+  mutable std::mutex _viewsMutex;
+  std::vector<Cesium3DTilesSelection::ViewState> _views;
+
+  std::array<std::atomic<int64_t>, StageCount> _canceledCounts;
+  std::atomic<int64_t> _wasted;
+  std::atomic<int64_t> _wastedMicroseconds;
+};
@@ -0,0 +1,635 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "TilesetArchive.h"
+#include "Async/MappedFileHandle.h"
+#include "CesiumRuntime.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Hash/CityHash.h"
+#include "Misc/Compression.h"
+#include "Misc/SecureHash.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t LocalFileHeaderSignature = 0x04034b50;
+constexpr uint32_t CentralDirectorySignature = 0x02014b50;
+constexpr uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+constexpr uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr uint32_t Zip64LocatorSignature = 0x07064b50;
+
+constexpr int64_t LocalFileHeaderSize = 30;
+constexpr int64_t CentralDirectoryHeaderSize = 46;
+constexpr int64_t EndOfCentralDirectorySize = 22;
+constexpr int64_t Zip64EndOfCentralDirectorySize = 56;
+constexpr int64_t Zip64LocatorSize = 20;
+constexpr int64_t MaximumCommentSize = 65535;
+
+constexpr uint16_t Zip64ExtraFieldId = 0x0001;
+constexpr uint32_t Zip64Marker = 0xffffffff;
+constexpr uint16_t DataDescriptorFlag = 0x0008;
+constexpr uint16_t DeflateMethod = 8;
+
+// Each entry of a 3D Tiles archive index is the MD5 hash of a path followed by
+// the offset of the file's local header.
+constexpr int64_t TilesetIndexEntrySize = 24;
+const std::string TilesetIndexName = "@3dtilesIndex1@";
+
+const char* const ArchiveExtensions[] = {".3tz", ".zip"};
+
+// ZIP archives are little-endian, as are all platforms that Unreal supports.
+uint16_t readUint16(const std::byte* p) {
+  uint16_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t readUint32(const std::byte* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t readUint64(const std::byte* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+bool hasArchiveExtension(const std::string& filename, size_t end) {
+  for (const char* extension : ArchiveExtensions) {
+    size_t length = std::strlen(extension);
+    if (end < length) {
+      continue;
+    }
+    bool matches = true;
+    for (size_t i = 0; i < length && matches; ++i) {
+      matches = std::tolower(static_cast<unsigned char>(
+                    filename[end - length + i])) == extension[i];
+    }
+    if (matches) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool pathEquals(
+    const std::byte* pName,
+    uint16_t nameLength,
+    const std::string& path) {
+  return nameLength == path.size() &&
+         std::memcmp(pName, path.data(), nameLength) == 0;
+}
+
+// The number of most recently used archives that are kept open while no
+// response refers to them, so that a tileset's archive is not reopened for
+// each of its requests.
+constexpr size_t RecentlyUsedArchiveCount = 4;
+
+// The time after which an archive that could not be opened is tried again,
+// in seconds.
+constexpr double OpenFailureRetrySeconds = 10.0;
+
+std::mutex openArchivesMutex;
+
+// The archives that are open. An archive is closed once no response refers to
+// it and it is no longer one of the most recently used.
+std::unordered_map<std::string, std::weak_ptr<TilesetArchive>> openArchives;
+std::vector<std::shared_ptr<TilesetArchive>> recentlyUsedArchives;
+
+// The archives that could not be opened, and when they were tried.
+std::unordered_map<std::string, double> failedArchives;
+
+// Must be called with openArchivesMutex held.
+void markRecentlyUsed(const std::shared_ptr<TilesetArchive>& pArchive) {
+  auto it = std::find(
+      recentlyUsedArchives.begin(),
+      recentlyUsedArchives.end(),
+      pArchive);
+  if (it != recentlyUsedArchives.end()) {
+    std::rotate(it, it + 1, recentlyUsedArchives.end());
+    return;
+  }
+
+  if (recentlyUsedArchives.size() >= RecentlyUsedArchiveCount) {
+    recentlyUsedArchives.erase(recentlyUsedArchives.begin());
+  }
+  recentlyUsedArchives.push_back(pArchive);
+}
+
+} // namespace
+
+/*static*/ std::shared_ptr<TilesetArchive>
+TilesetArchive::find(const std::string& filename, std::string& entryPath) {
+  size_t searchFrom = 0;
+  while (true) {
+    size_t separator = filename.find_first_of("/\\", searchFrom);
+    if (separator == std::string::npos) {
+      return nullptr;
+    }
+    searchFrom = separator + 1;
+
+    if (separator == 0 || !hasArchiveExtension(filename, separator)) {
+      continue;
+    }
+
+    std::string archiveFilename = filename.substr(0, separator);
+
+    std::shared_ptr<TilesetArchive> pArchive;
+    {
+      // Opening an archive under the lock ensures that it is only opened once
+      // when several of its files are requested at the same time.
+      std::lock_guard<std::mutex> lock(openArchivesMutex);
+      auto it = openArchives.find(archiveFilename);
+      if (it != openArchives.end()) {
+        pArchive = it->second.lock();
+      }
+
+      if (!pArchive) {
+        const double now = FPlatformTime::Seconds();
+        auto failedIt = failedArchives.find(archiveFilename);
+        if (failedIt == failedArchives.end() ||
+            now - failedIt->second >= OpenFailureRetrySeconds) {
+          pArchive =
+              TilesetArchive::open(UTF8_TO_TCHAR(archiveFilename.c_str()));
+          if (pArchive) {
+            failedArchives.erase(archiveFilename);
+
+            // Forget the archives that have been closed.
+            for (auto openIt = openArchives.begin();
+                 openIt != openArchives.end();) {
+              if (openIt->second.expired()) {
+                openIt = openArchives.erase(openIt);
+              } else {
+                ++openIt;
+              }
+            }
+            openArchives[archiveFilename] = pArchive;
+          } else {
+            failedArchives[archiveFilename] = now;
+          }
+        }
+      }
+
+      if (pArchive) {
+        markRecentlyUsed(pArchive);
+      }
+    }
+
+    if (pArchive) {
+      // Paths in an archive never start with a slash, but URLs that join the
+      // archive's filename and a path may repeat it.
+      entryPath = filename.substr(separator + 1);
+      std::replace(entryPath.begin(), entryPath.end(), '\\', '/');
+      entryPath.erase(0, entryPath.find_first_not_of('/'));
+      return pArchive;
+    }
+  }
+}
+
+/*static*/ std::shared_ptr<TilesetArchive>
+TilesetArchive::open(const FString& filename) {
+  IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+  if (!platformFile.FileExists(*filename)) {
+    return nullptr;
+  }
+
+  TUniquePtr<IMappedFileHandle> pMappedFile(
+      platformFile.OpenMapped(*filename));
+  if (!pMappedFile || pMappedFile->GetFileSize() <= 0) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Tileset archive %s could not be memory-mapped."),
+        *filename);
+    return nullptr;
+  }
+
+  TUniquePtr<IMappedFileRegion> pMappedRegion(
+      pMappedFile->MapRegion(0, pMappedFile->GetFileSize()));
+  if (!pMappedRegion) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Tileset archive %s could not be memory-mapped."),
+        *filename);
+    return nullptr;
+  }
+
+  std::shared_ptr<TilesetArchive> pArchive(new TilesetArchive(
+      filename,
+      MoveTemp(pMappedFile),
+      MoveTemp(pMappedRegion)));
+  if (!pArchive->readCentralDirectory()) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Tileset archive %s is not a valid ZIP archive."),
+        *filename);
+    return nullptr;
+  }
+
+  UE_LOG(
+      LogCesium,
+      Log,
+      TEXT("Opened tileset archive %s with %lld files%s."),
+      *filename,
+      pArchive->getEntryCount(),
+      pArchive->hasTilesetIndex() ? TEXT(" and a 3D Tiles archive index")
+                                  : TEXT(""));
+
+  return pArchive;
+}
+
+TilesetArchive::TilesetArchive(
+    const FString& filename,
+    TUniquePtr<IMappedFileHandle>&& pMappedFile,
+    TUniquePtr<IMappedFileRegion>&& pMappedRegion)
+    : _filename(filename),
+      _pMappedFile(MoveTemp(pMappedFile)),
+      _pMappedRegion(MoveTemp(pMappedRegion)),
+      _pData(reinterpret_cast<const std::byte*>(
+          this->_pMappedRegion->GetMappedPtr())),
+      _size(this->_pMappedRegion->GetMappedSize()),
+      _centralDirectoryOffset(0),
+      _centralDirectorySize(0),
+      _entryCount(0),
+      _tilesetIndex(),
+      _centralDirectoryIndexBuilt(),
+      _centralDirectoryIndex() {}
+
+TilesetArchive::~TilesetArchive() {
+  // The region must be unmapped before its file handle is closed.
+  this->_pMappedRegion.Reset();
+  this->_pMappedFile.Reset();
+}
+
+std::optional<TilesetArchive::Entry>
+TilesetArchive::findEntry(const std::string& path) const {
+  if (this->hasTilesetIndex()) {
+    std::optional<Entry> maybeEntry = this->findInTilesetIndex(path);
+    if (maybeEntry) {
+      return maybeEntry;
+    }
+  }
+
+  // Fall back to the central directory for archives without an index, and
+  // for files that the index does not describe completely, such as those
+  // whose sizes are only recorded after their data.
+  return this->findInCentralDirectory(path);
+}
+
+gsl::span<const std::byte>
+TilesetArchive::getStoredData(const Entry& entry) const {
+  return gsl::span<const std::byte>(
+      this->_pData + entry.dataOffset,
+      size_t(entry.compressedSize));
+}
+
+bool TilesetArchive::inflate(const Entry& entry, TArray64<uint8>& data) const {
+  if (entry.compressionMethod != DeflateMethod) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("A file in tileset archive %s uses unsupported compression "
+             "method %d."),
+        *this->_filename,
+        entry.compressionMethod);
+    return false;
+  }
+
+  if (entry.uncompressedSize > MAX_int32 || entry.compressedSize > MAX_int32) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("A compressed file in tileset archive %s is too large to "
+             "decompress."),
+        *this->_filename);
+    return false;
+  }
+
+  data.SetNumUninitialized(entry.uncompressedSize);
+
+  // A negative window size makes zlib read a raw Deflate stream, which is how
+  // ZIP archives store files, rather than one with a zlib header.
+  bool success = FCompression::UncompressMemory(
+      NAME_Zlib,
+      data.GetData(),
+      int32(entry.uncompressedSize),
+      this->_pData + entry.dataOffset,
+      int32(entry.compressedSize),
+      COMPRESS_NoFlags,
+      -DEFAULT_ZLIB_BIT_WINDOW);
+  if (!success) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("A file in tileset archive %s could not be decompressed."),
+        *this->_filename);
+    data.Empty();
+  }
+
+  return success;
+}
+
+bool TilesetArchive::readCentralDirectory() {
+  if (this->_size < EndOfCentralDirectorySize) {
+    return false;
+  }
+
+  // The end of central directory record is followed only by a comment of up
+  // to 64 KiB.
+  int64_t searchStart = std::max(
+      int64_t(0),
+      this->_size - EndOfCentralDirectorySize - MaximumCommentSize);
+  int64_t endOffset = -1;
+  for (int64_t offset = this->_size - EndOfCentralDirectorySize;
+       offset >= searchStart;
+       --offset) {
+    if (readUint32(this->_pData + offset) == EndOfCentralDirectorySignature) {
+      endOffset = offset;
+      break;
+    }
+  }
+  if (endOffset < 0) {
+    return false;
+  }
+
+  const std::byte* pEnd = this->_pData + endOffset;
+  this->_entryCount = readUint16(pEnd + 10);
+  this->_centralDirectorySize = readUint32(pEnd + 12);
+  this->_centralDirectoryOffset = readUint32(pEnd + 16);
+
+  // Archives with more than 65535 files or larger than 4 GiB record the
+  // location of the central directory in a ZIP64 record instead.
+  if (endOffset >= Zip64LocatorSize) {
+    const std::byte* pLocator = this->_pData + endOffset - Zip64LocatorSize;
+    if (readUint32(pLocator) == Zip64LocatorSignature) {
+      uint64_t zip64Offset = readUint64(pLocator + 8);
+      if (zip64Offset >
+              uint64_t(this->_size - Zip64EndOfCentralDirectorySize) ||
+          readUint32(this->_pData + zip64Offset) !=
+              Zip64EndOfCentralDirectorySignature) {
+        return false;
+      }
+      const std::byte* pZip64End = this->_pData + zip64Offset;
+      this->_entryCount = int64_t(readUint64(pZip64End + 32));
+      this->_centralDirectorySize = int64_t(readUint64(pZip64End + 40));
+      this->_centralDirectoryOffset = int64_t(readUint64(pZip64End + 48));
+    }
+  }
+
+  if (this->_entryCount < 0 || this->_centralDirectoryOffset < 0 ||
+      this->_centralDirectorySize < 0 ||
+      this->_centralDirectorySize > this->_size ||
+      this->_centralDirectoryOffset >
+          this->_size - this->_centralDirectorySize) {
+    return false;
+  }
+
+  // A 3D Tiles archive index is the last file in the central directory, so
+  // walk the directory to find it. This also validates the directory.
+  int64_t offset = this->_centralDirectoryOffset;
+  int64_t end = this->_centralDirectoryOffset + this->_centralDirectorySize;
+  int64_t lastOffset = -1;
+  for (int64_t i = 0; i < this->_entryCount; ++i) {
+    if (offset > end - CentralDirectoryHeaderSize ||
+        readUint32(this->_pData + offset) != CentralDirectorySignature) {
+      return false;
+    }
+    const std::byte* pHeader = this->_pData + offset;
+    lastOffset = offset;
+    offset += CentralDirectoryHeaderSize + readUint16(pHeader + 28) +
+              readUint16(pHeader + 30) + readUint16(pHeader + 32);
+    if (offset > end) {
+      return false;
+    }
+  }
+
+  if (lastOffset >= 0) {
+    std::optional<Entry> maybeIndex =
+        this->readCentralEntry(lastOffset, &TilesetIndexName);
+    if (maybeIndex && !maybeIndex->isCompressed() &&
+        maybeIndex->compressedSize % TilesetIndexEntrySize == 0) {
+      this->_tilesetIndex = this->getStoredData(*maybeIndex);
+    }
+  }
+
+  return true;
+}
+
+std::optional<TilesetArchive::Entry>
+TilesetArchive::readLocalEntry(int64_t offset, const std::string& path) const {
+  if (offset < 0 || offset > this->_size - LocalFileHeaderSize) {
+    return std::nullopt;
+  }
+
+  const std::byte* pHeader = this->_pData + offset;
+  if (readUint32(pHeader) != LocalFileHeaderSignature) {
+    return std::nullopt;
+  }
+
+  uint16_t flags = readUint16(pHeader + 6);
+  uint16_t nameLength = readUint16(pHeader + 26);
+  uint16_t extraLength = readUint16(pHeader + 28);
+  int64_t dataOffset =
+      offset + LocalFileHeaderSize + nameLength + extraLength;
+  if ((flags & DataDescriptorFlag) != 0 || dataOffset > this->_size ||
+      !pathEquals(pHeader + LocalFileHeaderSize, nameLength, path)) {
+    return std::nullopt;
+  }
+
+  Entry entry;
+  entry.dataOffset = dataOffset;
+  entry.compressionMethod = readUint16(pHeader + 8);
+  entry.compressedSize = readUint32(pHeader + 18);
+  entry.uncompressedSize = readUint32(pHeader + 22);
+
+  if (entry.compressedSize == Zip64Marker ||
+      entry.uncompressedSize == Zip64Marker) {
+    // A local ZIP64 field always holds both sizes.
+    const std::byte* pExtra = pHeader + LocalFileHeaderSize + nameLength;
+    const std::byte* pExtraEnd = pExtra + extraLength;
+    bool found = false;
+    while (pExtra + 4 <= pExtraEnd) {
+      uint16_t id = readUint16(pExtra);
+      uint16_t size = readUint16(pExtra + 2);
+      if (id == Zip64ExtraFieldId && size >= 16 &&
+          pExtra + 4 + 16 <= pExtraEnd) {
+        entry.uncompressedSize = int64_t(readUint64(pExtra + 4));
+        entry.compressedSize = int64_t(readUint64(pExtra + 12));
+        found = true;
+        break;
+      }
+      pExtra += 4 + size;
+    }
+    if (!found) {
+      return std::nullopt;
+    }
+  }
+
+  if (entry.compressedSize < 0 ||
+      entry.compressedSize > this->_size - entry.dataOffset) {
+    return std::nullopt;
+  }
+
+  return entry;
+}
+
+std::optional<TilesetArchive::Entry> TilesetArchive::readCentralEntry(
+    int64_t offset,
+    const std::string* pPath) const {
+  const std::byte* pHeader = this->_pData + offset;
+  uint16_t nameLength = readUint16(pHeader + 28);
+  uint16_t extraLength = readUint16(pHeader + 30);
+  if (pPath && !pathEquals(
+                   pHeader + CentralDirectoryHeaderSize,
+                   nameLength,
+                   *pPath)) {
+    return std::nullopt;
+  }
+
+  Entry entry;
+  entry.compressionMethod = readUint16(pHeader + 10);
+  entry.compressedSize = readUint32(pHeader + 20);
+  entry.uncompressedSize = readUint32(pHeader + 24);
+  int64_t localOffset = readUint32(pHeader + 42);
+
+  // A central ZIP64 field holds only the values that did not fit, in this
+  // order.
+  const std::byte* pExtra = pHeader + CentralDirectoryHeaderSize + nameLength;
+  const std::byte* pExtraEnd = pExtra + extraLength;
+  while (pExtra + 4 <= pExtraEnd) {
+    uint16_t id = readUint16(pExtra);
+    uint16_t size = readUint16(pExtra + 2);
+    if (id == Zip64ExtraFieldId) {
+      const std::byte* pValue = pExtra + 4;
+      const std::byte* pValueEnd = std::min(pValue + size, pExtraEnd);
+      auto readValue = [&pValue, pValueEnd](int64_t& value) {
+        if (value == Zip64Marker && pValue + 8 <= pValueEnd) {
+          value = int64_t(readUint64(pValue));
+          pValue += 8;
+        }
+      };
+      readValue(entry.uncompressedSize);
+      readValue(entry.compressedSize);
+      readValue(localOffset);
+      break;
+    }
+    pExtra += 4 + size;
+  }
+
+  // The data follows the local header, whose name and extra field may differ
+  // in length from those in the central directory.
+  if (localOffset < 0 || localOffset > this->_size - LocalFileHeaderSize) {
+    return std::nullopt;
+  }
+  const std::byte* pLocalHeader = this->_pData + localOffset;
+  if (readUint32(pLocalHeader) != LocalFileHeaderSignature) {
+    return std::nullopt;
+  }
+  entry.dataOffset = localOffset + LocalFileHeaderSize +
+                     readUint16(pLocalHeader + 26) +
+                     readUint16(pLocalHeader + 28);
+
+  if (entry.compressedSize < 0 || entry.dataOffset > this->_size ||
+      entry.compressedSize > this->_size - entry.dataOffset) {
+    return std::nullopt;
+  }
+
+  return entry;
+}
+
+std::optional<TilesetArchive::Entry>
+TilesetArchive::findInTilesetIndex(const std::string& path) const {
+  uint8 digest[16];
+  FMD5 md5;
+  md5.Update(reinterpret_cast<const uint8*>(path.data()), path.size());
+  md5.Final(digest);
+
+  const std::byte* pDigest = reinterpret_cast<const std::byte*>(digest);
+  uint64_t low = readUint64(pDigest);
+  uint64_t high = readUint64(pDigest + 8);
+
+  // The index is sorted by the hashes as pairs of little-endian 64-bit
+  // integers, comparing the second integer first.
+  const std::byte* pIndex = this->_tilesetIndex.data();
+  size_t first = 0;
+  size_t last = this->_tilesetIndex.size() / TilesetIndexEntrySize;
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    const std::byte* pEntry = pIndex + middle * TilesetIndexEntrySize;
+    uint64_t entryLow = readUint64(pEntry);
+    uint64_t entryHigh = readUint64(pEntry + 8);
+    if (entryHigh < high || (entryHigh == high && entryLow < low)) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+
+  if (first == this->_tilesetIndex.size() / TilesetIndexEntrySize) {
+    return std::nullopt;
+  }
+
+  const std::byte* pEntry = pIndex + first * TilesetIndexEntrySize;
+  if (readUint64(pEntry) != low || readUint64(pEntry + 8) != high) {
+    return std::nullopt;
+  }
+
+  return this->readLocalEntry(int64_t(readUint64(pEntry + 16)), path);
+}
+
+std::optional<TilesetArchive::Entry>
+TilesetArchive::findInCentralDirectory(const std::string& path) const {
+  std::call_once(this->_centralDirectoryIndexBuilt, [this]() {
+    this->buildCentralDirectoryIndex();
+  });
+
+  uint64_t pathHash = CityHash64(path.data(), uint32(path.size()));
+  auto range = std::equal_range(
+      this->_centralDirectoryIndex.begin(),
+      this->_centralDirectoryIndex.end(),
+      CentralDirectoryEntry{pathHash, 0},
+      [](const CentralDirectoryEntry& a, const CentralDirectoryEntry& b) {
+        return a.pathHash < b.pathHash;
+      });
+
+  for (auto it = range.first; it != range.second; ++it) {
+    std::optional<Entry> maybeEntry = this->readCentralEntry(it->offset, &path);
+    if (maybeEntry) {
+      return maybeEntry;
+    }
+  }
+
+  return std::nullopt;
+}
+
+void TilesetArchive::buildCentralDirectoryIndex() const {
+  this->_centralDirectoryIndex.reserve(size_t(this->_entryCount));
+
+  // The directory was validated when the archive was opened.
+  int64_t offset = this->_centralDirectoryOffset;
+  for (int64_t i = 0; i < this->_entryCount; ++i) {
+    const std::byte* pHeader = this->_pData + offset;
+    uint16_t nameLength = readUint16(pHeader + 28);
+    this->_centralDirectoryIndex.push_back(CentralDirectoryEntry{
+        CityHash64(
+            reinterpret_cast<const char*>(pHeader + CentralDirectoryHeaderSize),
+            nameLength),
+        offset});
+    offset += CentralDirectoryHeaderSize + nameLength +
+              readUint16(pHeader + 30) + readUint16(pHeader + 32);
+  }
+
+  std::sort(
+      this->_centralDirectoryIndex.begin(),
+      this->_centralDirectoryIndex.end(),
+      [](const CentralDirectoryEntry& a, const CentralDirectoryEntry& b) {
+        return a.pathHash < b.pathHash;
+      });
+}
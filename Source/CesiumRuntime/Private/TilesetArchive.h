@@ -0,0 +1,157 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "Containers/Array.h"
+#include "Containers/UnrealString.h"
+#include "Templates/UniquePtr.h"
+#include <cstddef>
+#include <cstdint>
+#include <gsl/span>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * A tileset packed into a single ZIP archive, such as a 3D Tiles archive
+ * (.3tz), which is memory-mapped and read without extracting it.
+ *
+ * The files in an archive are addressed with `file:///` URLs that continue
+ * past the archive's filename, such as
+ * `file:///C:/Data/City.3tz/tileset.json`, so that the relative URLs within
+ * the tileset resolve to other files in the same archive.
+ *
+ * When the archive has a 3D Tiles archive index (`@3dtilesIndex1@`), files are
+ * found by a binary search of the index, in place in the mapped archive.
+ * Otherwise, and for files that the index cannot locate, a compact sorted
+ * index of the archive's central directory is built the first time it is
+ * needed. Files stored without compression are returned as slices of the
+ * mapped archive, without copying them.
+ */
+class TilesetArchive {
+public:
+  /**
+   * A file in the archive.
+   */
+  struct Entry {
+    int64_t dataOffset;
+    int64_t compressedSize;
+    int64_t uncompressedSize;
+    uint16_t compressionMethod;
+
+    bool isCompressed() const { return this->compressionMethod != 0; }
+  };
+
+  /**
+   * Finds the archive that contains the given filename, opening it if it is
+   * not already open. An archive stays open while any response refers to it
+   * and while it is one of the few most recently used archives. An archive
+   * that cannot be opened is not tried again for several seconds.
+   *
+   * @param filename The filename, which may continue past the filename of an
+   * archive with the path of a file within it.
+   * @param entryPath Set to the path of the file within the archive, with
+   * forward slashes and without leading slashes, if an archive is found.
+   * @return The archive, or nullptr if the filename does not refer to a file
+   * within an archive that can be opened.
+   */
+  static std::shared_ptr<TilesetArchive>
+  find(const std::string& filename, std::string& entryPath);
+
+  /**
+   * Opens an archive.
+   *
+   * @return The archive, or nullptr if the file cannot be mapped or is not a
+   * valid ZIP archive.
+   */
+  static std::shared_ptr<TilesetArchive> open(const FString& filename);
+
+  ~TilesetArchive();
+
+  /**
+   * Finds a file in the archive, with its 3D Tiles archive index if it has
+   * one, and otherwise with its central directory.
+   *
+   * @param path The path of the file within the archive, with forward
+   * slashes.
+   */
+  std::optional<Entry> findEntry(const std::string& path) const;
+
+  /**
+   * Finds a file with the archive's 3D Tiles archive index only. Files whose
+   * sizes are only recorded after their data cannot be found this way.
+   */
+  std::optional<Entry> findInTilesetIndex(const std::string& path) const;
+
+  /**
+   * Finds a file with the archive's central directory only, building the
+   * index of the central directory if it has not been built yet.
+   */
+  std::optional<Entry> findInCentralDirectory(const std::string& path) const;
+
+  /**
+   * Gets the data of a file as it is stored in the archive, which is only its
+   * content if the file is not compressed. The span remains valid for as long
+   * as the archive is open.
+   */
+  gsl::span<const std::byte> getStoredData(const Entry& entry) const;
+
+  /**
+   * Decompresses a compressed file.
+   *
+   * @return Whether the file was decompressed. Only Deflate compression is
+   * supported.
+   */
+  bool inflate(const Entry& entry, TArray64<uint8>& data) const;
+
+  /**
+   * Gets the number of files in the archive.
+   */
+  int64_t getEntryCount() const { return this->_entryCount; }
+
+  /**
+   * Whether files are found with the archive's 3D Tiles archive index.
+   */
+  bool hasTilesetIndex() const { return !this->_tilesetIndex.empty(); }
+
+private:
+  struct CentralDirectoryEntry {
+    uint64_t pathHash;
+    int64_t offset;
+  };
+
+  TilesetArchive(
+      const FString& filename,
+      TUniquePtr<IMappedFileHandle>&& pMappedFile,
+      TUniquePtr<IMappedFileRegion>&& pMappedRegion);
+
+  bool readCentralDirectory();
+  std::optional<Entry>
+  readLocalEntry(int64_t offset, const std::string& path) const;
+  std::optional<Entry>
+  readCentralEntry(int64_t offset, const std::string* pPath) const;
+  void buildCentralDirectoryIndex() const;
+
+  FString _filename;
+  TUniquePtr<IMappedFileHandle> _pMappedFile;
+  TUniquePtr<IMappedFileRegion> _pMappedRegion;
+  const std::byte* _pData;
+  int64_t _size;
+
+  int64_t _centralDirectoryOffset;
+  int64_t _centralDirectorySize;
+  int64_t _entryCount;
+
+  // The 3D Tiles archive index, in place in the mapped archive.
+  gsl::span<const std::byte> _tilesetIndex;
+
+  // The central directory entries sorted by the hash of their paths, built
+  // the first time a file cannot be found with a 3D Tiles archive index.
+  mutable std::once_flag _centralDirectoryIndexBuilt;
+  mutable std::vector<CentralDirectoryEntry> _centralDirectoryIndex;
+};
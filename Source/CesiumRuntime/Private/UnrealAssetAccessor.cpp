@@ -3,11 +3,15 @@
 #include "UnrealAssetAccessor.h"
 #include "Async/Async.h"
 #include "Async/AsyncWork.h"
+#include "Async/MappedFileHandle.h"
 
 #include "CesiumAsync/AsyncSystem.h"
 #include "CesiumAsync/IAssetRequest.h"
 #include "CesiumAsync/IAssetResponse.h"
 #include "CesiumRuntime.h"
+#include "CesiumStats.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
 #include "HttpManager.h"
 #include "HttpModule.h"
 #include "Interfaces/IHttpRequest.h"
@@ -16,12 +20,29 @@
 #include "Misc/App.h"
 #include "Misc/EngineVersion.h"
 #include "Misc/FileHelper.h"
+#include "PrioritizedRequestQueue.h"
+#include "TilesetArchive.h"
+#include <algorithm>
+#include <cctype>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <string>
 #include <uriparser/Uri.h>
 
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Queued HTTP Requests"),
+    STAT_CesiumHttpRequestsQueued,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Active HTTP Requests"),
+    STAT_CesiumHttpRequestsActive,
+    STATGROUP_Cesium);
+
 namespace {
 
 CesiumAsync::HttpHeaders parseHeaders(const TArray<FString>& unrealHeaders) {
@@ -103,7 +124,10 @@ private:
 } // namespace
 
 UnrealAssetAccessor::UnrealAssetAccessor()
-    : _userAgent(), _cesiumRequestHeaders() {
+    : _userAgent(),
+      _cesiumRequestHeaders(),
+      _pRequestQueue(std::make_shared<PrioritizedRequestQueue>(64, 32)),
+      _maximumRetries(3) {
   FString OsVersion, OsSubVersion;
   FPlatformMisc::GetOSVersions(OsVersion, OsSubVersion);
   OsVersion += " " + FPlatformMisc::GetOSVersion();
@@ -139,10 +163,308 @@ UnrealAssetAccessor::UnrealAssetAccessor()
   this->_cesiumRequestHeaders.Add(TEXT("X-Cesium-Client-OS"), OsVersion);
 }
 
+UnrealAssetAccessor::~UnrealAssetAccessor() = default;
+
+const std::string UnrealAssetAccessor::RequestGroupHeaderName =
+    "X-Cesium-Unreal-Request-Group";
+
+/*static*/ CesiumAsync::IAssetAccessor::THeader
+UnrealAssetAccessor::requestGroupHeader(uint64_t requestGroup) {
+  return {RequestGroupHeaderName, std::to_string(requestGroup)};
+}
+
+uint64_t UnrealAssetAccessor::createRequestGroup(double priority) {
+  return this->_pRequestQueue->createGroup(priority);
+}
+
+void UnrealAssetAccessor::setRequestGroupPriority(
+    uint64_t requestGroup,
+    double priority) {
+  this->_pRequestQueue->setGroupPriority(requestGroup, priority);
+}
+
+void UnrealAssetAccessor::advanceRequestGroupView(uint64_t requestGroup) {
+  this->_pRequestQueue->advanceGroupView(requestGroup);
+}
+
+void UnrealAssetAccessor::cancelRequestGroup(uint64_t requestGroup) {
+  this->_pRequestQueue->cancelGroup(requestGroup);
+}
+
+void UnrealAssetAccessor::setMaximumSimultaneousRequests(
+    int32 maximumSimultaneousRequests) {
+  this->_pRequestQueue->setMaximumActiveRequests(maximumSimultaneousRequests);
+}
+
+void UnrealAssetAccessor::setMaximumSimultaneousRequestsPerHost(
+    int32 maximumSimultaneousRequestsPerHost) {
+  this->_pRequestQueue->setMaximumActiveRequestsPerHost(
+      maximumSimultaneousRequestsPerHost);
+}
+
+void UnrealAssetAccessor::setMaximumRetries(int32 maximumRetries) {
+  this->_maximumRetries = FMath::Max(maximumRetries, 0);
+}
+
+size_t UnrealAssetAccessor::getQueuedRequestCount() const {
+  return this->_pRequestQueue->getQueuedCount();
+}
+
+std::vector<UnrealAssetAccessor::HostStatistics>
+UnrealAssetAccessor::getHostStatistics() const {
+  std::vector<PrioritizedRequestQueue::HostStatistics> queueStatistics =
+      this->_pRequestQueue->getHostStatistics();
+
+  std::vector<HostStatistics> result;
+  result.reserve(queueStatistics.size());
+  for (PrioritizedRequestQueue::HostStatistics& host : queueStatistics) {
+    HostStatistics& statistics = result.emplace_back();
+    statistics.host = std::move(host.host);
+    statistics.requestsSent = host.requestsStarted;
+    statistics.totalQueueSeconds = host.totalQueueSeconds;
+    statistics.maximumQueueSeconds = host.maximumQueueSeconds;
+    statistics.backOffs = host.backOffs;
+    statistics.active = host.active;
+    statistics.queued = host.queued;
+  }
+  return result;
+}
+
 namespace {
 
 const char fileProtocol[] = "file:///";
 
+/**
+ * Removes the request group pseudo-header, if any, from the given headers and
+ * returns the group it names.
+ */
+uint64_t takeRequestGroup(
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    std::vector<CesiumAsync::IAssetAccessor::THeader>& remainingHeaders) {
+  uint64_t requestGroup = PrioritizedRequestQueue::DefaultGroup;
+  remainingHeaders.reserve(headers.size());
+  for (const CesiumAsync::IAssetAccessor::THeader& header : headers) {
+    if (header.first == UnrealAssetAccessor::RequestGroupHeaderName) {
+      requestGroup = std::strtoull(header.second.c_str(), nullptr, 10);
+    } else {
+      remainingHeaders.push_back(header);
+    }
+  }
+  return requestGroup;
+}
+
+/**
+ * Gets the scheme, host, and port of a URL, which identify the server that the
+ * request queue limits connections to.
+ */
+std::string getHostKey(const std::string& url) {
+  size_t hostStart = url.find("://");
+  hostStart = hostStart == std::string::npos ? 0 : hostStart + 3;
+  size_t hostEnd = url.find_first_of("/?#", hostStart);
+  std::string key = url.substr(0, hostEnd);
+  std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return key;
+}
+
+/**
+ * Whether a response status code asks the client to slow down, in which case
+ * the request is retried after a delay.
+ */
+bool isThrottled(int32 statusCode) {
+  return statusCode == EHttpResponseCodes::TooManyRequests ||
+         statusCode == EHttpResponseCodes::ServiceUnavail;
+}
+
+/**
+ * Gets the number of seconds to wait before retrying a throttled request. A
+ * Retry-After header given in seconds is honored, up to a limit. Otherwise,
+ * the delay grows exponentially with the number of attempts, with some
+ * jitter so that the retries of many requests are spread out.
+ */
+double getRetryDelay(const FHttpResponsePtr& pResponse, int32 attempt) {
+  constexpr double maximumDelay = 60.0;
+
+  FString retryAfter = pResponse->GetHeader(TEXT("Retry-After"));
+  if (!retryAfter.IsEmpty() && retryAfter.IsNumeric()) {
+    return FMath::Clamp(FCString::Atod(*retryAfter), 0.0, maximumDelay);
+  }
+
+  double delay = 0.5 * FMath::Pow(2.0, double(FMath::Min(attempt, 10)));
+  return FMath::Min(delay * FMath::FRandRange(0.75, 1.25), maximumDelay);
+}
+
+/**
+ * The state of an HTTP request as it passes through the request queue,
+ * possibly several times if it is retried.
+ */
+struct QueuedHttpRequest {
+  QueuedHttpRequest(
+      const CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>>&
+          promise_)
+      : promise(promise_) {}
+
+  std::shared_ptr<PrioritizedRequestQueue> pQueue;
+  uint64_t requestGroup = PrioritizedRequestQueue::DefaultGroup;
+  std::string host;
+  int32 maximumRetries = 0;
+  CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>> promise;
+
+  // Invoked once the request completes for the last time.
+  std::function<void()> onComplete;
+
+  // Creates the Unreal request for each attempt.
+  std::function<TSharedRef<IHttpRequest, ESPMode::ThreadSafe>()> create;
+
+  std::mutex mutex;
+  TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> pRequest;
+  PrioritizedRequestQueue::RequestId requestId = 0;
+  int32 attempt = 0;
+  bool started = false;
+  bool canceled = false;
+};
+
+void enqueueHttpRequest(const std::shared_ptr<QueuedHttpRequest>& pQueued);
+
+void onHttpRequestComplete(
+    const std::shared_ptr<QueuedHttpRequest>& pQueued,
+    FHttpRequestPtr pRequest,
+    FHttpResponsePtr pResponse,
+    bool connectedSuccessfully) {
+  pQueued->pQueue->finish(pQueued->requestId);
+
+  if (connectedSuccessfully && isThrottled(pResponse->GetResponseCode())) {
+    bool retry;
+    {
+      std::lock_guard<std::mutex> lock(pQueued->mutex);
+      retry = !pQueued->canceled && pQueued->attempt < pQueued->maximumRetries;
+      if (retry) {
+        ++pQueued->attempt;
+        pQueued->started = false;
+        pQueued->pRequest.Reset();
+      }
+    }
+
+    if (retry) {
+      // Back off the whole host, because the server is throttling this
+      // client rather than this particular request.
+      pQueued->pQueue->backOffHost(
+          pQueued->host,
+          getRetryDelay(pResponse, pQueued->attempt - 1));
+      enqueueHttpRequest(pQueued);
+      return;
+    }
+  }
+
+  if (pQueued->onComplete) {
+    pQueued->onComplete();
+  }
+
+  if (connectedSuccessfully) {
+    pQueued->promise.resolve(
+        std::make_unique<UnrealAssetRequest>(pRequest, pResponse));
+  } else {
+    switch (pRequest->GetStatus()) {
+    case EHttpRequestStatus::Failed_ConnectionError:
+      pQueued->promise.reject(std::runtime_error("Connection failed."));
+    default:
+      pQueued->promise.reject(std::runtime_error("Request failed."));
+    }
+  }
+}
+
+/**
+ * Adds an HTTP request to the queue. When the queue starts it, a new Unreal
+ * request is created and processed.
+ */
+void enqueueHttpRequest(const std::shared_ptr<QueuedHttpRequest>& pQueued) {
+  pQueued->pQueue->enqueue(
+      pQueued->requestGroup,
+      pQueued->host,
+      [pQueued](PrioritizedRequestQueue::RequestId requestId) {
+        TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest =
+            pQueued->create();
+        pRequest->OnProcessRequestComplete().BindLambda(
+            [pQueued](
+                FHttpRequestPtr pRequest,
+                FHttpResponsePtr pResponse,
+                bool connectedSuccessfully) {
+              onHttpRequestComplete(
+                  pQueued,
+                  pRequest,
+                  pResponse,
+                  connectedSuccessfully);
+            });
+
+        bool canceled;
+        {
+          std::lock_guard<std::mutex> lock(pQueued->mutex);
+          pQueued->requestId = requestId;
+          pQueued->pRequest = pRequest;
+          pQueued->started = !pQueued->canceled;
+          canceled = pQueued->canceled;
+        }
+
+        if (canceled) {
+          // Canceled after it was taken from the queue but before it started.
+          pQueued->pQueue->finish(requestId);
+          pQueued->promise.reject(std::runtime_error("Request canceled."));
+          return;
+        }
+
+        pRequest->ProcessRequest();
+      },
+      [pQueued](bool wasActive) {
+        TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> pRequest;
+        {
+          std::lock_guard<std::mutex> lock(pQueued->mutex);
+          pQueued->canceled = true;
+          if (pQueued->started) {
+            pRequest = pQueued->pRequest;
+          }
+        }
+
+        if (pRequest) {
+          // The completion delegate finishes the request and rejects the
+          // promise.
+          pRequest->CancelRequest();
+        } else if (!wasActive) {
+          pQueued->promise.reject(std::runtime_error("Request canceled."));
+        }
+      });
+}
+
+void dumpHttpHostStatistics() {
+  std::vector<UnrealAssetAccessor::HostStatistics> hosts =
+      getUnrealAssetAccessor()->getHostStatistics();
+
+  FString report = TEXT("Cesium HTTP requests by host:\n");
+  for (const UnrealAssetAccessor::HostStatistics& host : hosts) {
+    double meanQueueSeconds =
+        host.requestsSent > 0
+            ? host.totalQueueSeconds / double(host.requestsSent)
+            : 0.0;
+    report += FString::Printf(
+        TEXT("  %s\n    sent %llu  active %llu  queued %llu  back-offs %llu  "
+             "queue time mean %.2f ms  max %.2f ms\n"),
+        UTF8_TO_TCHAR(host.host.c_str()),
+        host.requestsSent,
+        uint64(host.active),
+        uint64(host.queued),
+        host.backOffs,
+        meanQueueSeconds * 1000.0,
+        host.maximumQueueSeconds * 1000.0);
+  }
+  UE_LOG(LogCesium, Display, TEXT("%s"), *report);
+}
+
+FAutoConsoleCommand DumpHttpHostStatisticsCommand(
+    TEXT("Cesium.DumpHttpHosts"),
+    TEXT("Logs the number of HTTP requests sent to each host and the time they "
+         "spent waiting in the request queue."),
+    FConsoleCommandDelegate::CreateStatic(&dumpHttpHostStatistics));
+
 bool isFile(const std::string& url) {
   return url.compare(0, sizeof(fileProtocol) - 1, fileProtocol) == 0;
 }
@@ -161,51 +483,15 @@ UnrealAssetAccessor::get(
     return getFromFile(asyncSystem, url, headers);
   }
 
-  const FString& userAgent = this->_userAgent;
-  const TMap<FString, FString>& cesiumRequestHeaders =
-      this->_cesiumRequestHeaders;
-
-  return asyncSystem.createFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>(
-      [&url, &headers, &userAgent, &cesiumRequestHeaders](const auto& promise) {
-        FHttpModule& httpModule = FHttpModule::Get();
-        TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest =
-            httpModule.CreateRequest();
-        pRequest->SetURL(UTF8_TO_TCHAR(url.c_str()));
-
-        for (const auto& header : headers) {
-          pRequest->SetHeader(
-              UTF8_TO_TCHAR(header.first.c_str()),
-              UTF8_TO_TCHAR(header.second.c_str()));
-        }
-
-        for (const auto& header : cesiumRequestHeaders) {
-          pRequest->SetHeader(header.Key, header.Value);
-        }
-
-        pRequest->AppendToHeader(TEXT("User-Agent"), userAgent);
-
-        pRequest->OnProcessRequestComplete().BindLambda(
-            [promise, CESIUM_TRACE_LAMBDA_CAPTURE_TRACK()](
-                FHttpRequestPtr pRequest,
-                FHttpResponsePtr pResponse,
-                bool connectedSuccessfully) mutable {
-              CESIUM_TRACE_USE_CAPTURED_TRACK();
-              CESIUM_TRACE_END_IN_TRACK("requestAsset");
-
-              if (connectedSuccessfully) {
-                promise.resolve(
-                    std::make_unique<UnrealAssetRequest>(pRequest, pResponse));
-              } else {
-                switch (pRequest->GetStatus()) {
-                case EHttpRequestStatus::Failed_ConnectionError:
-                  promise.reject(std::runtime_error("Connection failed."));
-                default:
-                  promise.reject(std::runtime_error("Request failed."));
-                }
-              }
-            });
-
-        pRequest->ProcessRequest();
+  return this->sendHttpRequest(
+      asyncSystem,
+      std::string(),
+      url,
+      headers,
+      gsl::span<const std::byte>(),
+      [CESIUM_TRACE_LAMBDA_CAPTURE_TRACK()]() {
+        CESIUM_TRACE_USE_CAPTURED_TRACK();
+        CESIUM_TRACE_END_IN_TRACK("requestAsset");
       });
 }
 
@@ -217,64 +503,95 @@ UnrealAssetAccessor::request(
     const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
     const gsl::span<const std::byte>& contentPayload) {
 
-  const FString& userAgent = this->_userAgent;
-  const TMap<FString, FString>& cesiumRequestHeaders =
-      this->_cesiumRequestHeaders;
+  return this->sendHttpRequest(
+      asyncSystem,
+      verb,
+      url,
+      headers,
+      contentPayload,
+      nullptr);
+}
 
-  return asyncSystem.createFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>(
-      [&verb,
-       &url,
-       &headers,
-       &userAgent,
-       &cesiumRequestHeaders,
-       &contentPayload](const auto& promise) {
-        FHttpModule& httpModule = FHttpModule::Get();
-        TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest =
-            httpModule.CreateRequest();
-        pRequest->SetVerb(UTF8_TO_TCHAR(verb.c_str()));
-        pRequest->SetURL(UTF8_TO_TCHAR(url.c_str()));
-
-        for (const auto& header : headers) {
-          pRequest->SetHeader(
-              UTF8_TO_TCHAR(header.first.c_str()),
-              UTF8_TO_TCHAR(header.second.c_str()));
-        }
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+UnrealAssetAccessor::sendHttpRequest(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload,
+    std::function<void()>&& onComplete) {
+  std::vector<CesiumAsync::IAssetAccessor::THeader> requestHeaders;
+  uint64_t requestGroup = takeRequestGroup(headers, requestHeaders);
+
+  // Everything needed to create the Unreal request is copied, because it is
+  // created again each time the request is retried.
+  TArray<TPair<FString, FString>> unrealHeaders;
+  for (const auto& header : requestHeaders) {
+    unrealHeaders.Emplace(
+        UTF8_TO_TCHAR(header.first.c_str()),
+        UTF8_TO_TCHAR(header.second.c_str()));
+  }
+  for (const auto& header : this->_cesiumRequestHeaders) {
+    unrealHeaders.Emplace(header.Key, header.Value);
+  }
 
-        for (const auto& header : cesiumRequestHeaders) {
-          pRequest->SetHeader(header.Key, header.Value);
-        }
+  TArray<uint8> content(
+      reinterpret_cast<const uint8*>(contentPayload.data()),
+      contentPayload.size());
+
+  auto create = [unrealVerb = FString(UTF8_TO_TCHAR(verb.c_str())),
+                 unrealUrl = FString(UTF8_TO_TCHAR(url.c_str())),
+                 unrealHeaders = MoveTemp(unrealHeaders),
+                 userAgent = this->_userAgent,
+                 content = MoveTemp(content)]() {
+    FHttpModule& httpModule = FHttpModule::Get();
+    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest =
+        httpModule.CreateRequest();
+    if (!unrealVerb.IsEmpty()) {
+      pRequest->SetVerb(unrealVerb);
+    }
+    pRequest->SetURL(unrealUrl);
 
-        pRequest->AppendToHeader(TEXT("User-Agent"), userAgent);
+    for (const TPair<FString, FString>& header : unrealHeaders) {
+      pRequest->SetHeader(header.Key, header.Value);
+    }
 
-        pRequest->SetContent(TArray<uint8>(
-            reinterpret_cast<const uint8*>(contentPayload.data()),
-            contentPayload.size()));
+    pRequest->AppendToHeader(TEXT("User-Agent"), userAgent);
 
-        pRequest->OnProcessRequestComplete().BindLambda(
-            [promise](
-                FHttpRequestPtr pRequest,
-                FHttpResponsePtr pResponse,
-                bool connectedSuccessfully) {
-              if (connectedSuccessfully) {
-                promise.resolve(
-                    std::make_unique<UnrealAssetRequest>(pRequest, pResponse));
-              } else {
-                switch (pRequest->GetStatus()) {
-                case EHttpRequestStatus::Failed_ConnectionError:
-                  promise.reject(std::runtime_error("Connection failed."));
-                default:
-                  promise.reject(std::runtime_error("Request failed."));
-                }
-              }
-            });
+    if (!unrealVerb.IsEmpty()) {
+      pRequest->SetContent(content);
+    }
 
-        pRequest->ProcessRequest();
+    return pRequest;
+  };
+
+  return asyncSystem.createFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>(
+      [this, &url, requestGroup, &create, &onComplete](const auto& promise) {
+        auto pQueued = std::make_shared<QueuedHttpRequest>(promise);
+        pQueued->pQueue = this->_pRequestQueue;
+        pQueued->requestGroup = requestGroup;
+        pQueued->host = getHostKey(url);
+        pQueued->maximumRetries = this->_maximumRetries;
+        pQueued->onComplete = std::move(onComplete);
+        pQueued->create = std::move(create);
+
+        enqueueHttpRequest(pQueued);
       });
 }
 
 void UnrealAssetAccessor::tick() noexcept {
   FHttpManager& manager = FHttpModule::Get().GetHttpManager();
   manager.Tick(0.0f);
+
+  // Start requests to hosts that have finished backing off.
+  this->_pRequestQueue->tick();
+
+  SET_DWORD_STAT(
+      STAT_CesiumHttpRequestsQueued,
+      this->_pRequestQueue->getQueuedCount());
+  SET_DWORD_STAT(
+      STAT_CesiumHttpRequestsActive,
+      this->_pRequestQueue->getActiveCount());
 }
 
 namespace {
@@ -286,7 +603,51 @@ public:
       std::string&& url,
       uint16_t statusCode,
       TArray64<uint8>&& data)
-      : _url(std::move(url)), _statusCode(statusCode), _data(data) {}
+      : _url(std::move(url)),
+        _statusCode(statusCode),
+        _data(MoveTemp(data)),
+        _pMappedFile(),
+        _pMappedRegion(),
+        _pArchive(),
+        _archiveData() {}
+
+  /**
+   * Creates a response whose data points directly into a memory-mapped file.
+   * The mapping stays valid for the lifetime of the response.
+   */
+  UnrealFileAssetRequestResponse(
+      std::string&& url,
+      TUniquePtr<IMappedFileHandle>&& pMappedFile,
+      TUniquePtr<IMappedFileRegion>&& pMappedRegion)
+      : _url(std::move(url)),
+        _statusCode(200),
+        _data(),
+        _pMappedFile(MoveTemp(pMappedFile)),
+        _pMappedRegion(MoveTemp(pMappedRegion)),
+        _pArchive(),
+        _archiveData() {}
+
+  /**
+   * Creates a response whose data points directly into a memory-mapped
+   * tileset archive, which is kept open for the lifetime of the response.
+   */
+  UnrealFileAssetRequestResponse(
+      std::string&& url,
+      const std::shared_ptr<TilesetArchive>& pArchive,
+      const gsl::span<const std::byte>& data)
+      : _url(std::move(url)),
+        _statusCode(200),
+        _data(),
+        _pMappedFile(),
+        _pMappedRegion(),
+        _pArchive(pArchive),
+        _archiveData(data) {}
+
+  virtual ~UnrealFileAssetRequestResponse() {
+    // The region must be unmapped before its file handle is closed.
+    this->_pMappedRegion.Reset();
+    this->_pMappedFile.Reset();
+  }
 
   virtual const std::string& method() const { return getMethod; }
 
@@ -305,6 +666,15 @@ public:
   virtual std::string contentType() const override { return std::string(); }
 
   virtual gsl::span<const std::byte> data() const override {
+    if (this->_pArchive) {
+      return this->_archiveData;
+    }
+    if (this->_pMappedRegion) {
+      return gsl::span<const std::byte>(
+          reinterpret_cast<const std::byte*>(
+              this->_pMappedRegion->GetMappedPtr()),
+          size_t(this->_pMappedRegion->GetMappedSize()));
+    }
     return gsl::span<const std::byte>(
         reinterpret_cast<const std::byte*>(this->_data.GetData()),
         size_t(this->_data.Num()));
@@ -317,6 +687,10 @@ private:
   std::string _url;
   uint16_t _statusCode;
   TArray64<uint8> _data;
+  TUniquePtr<IMappedFileHandle> _pMappedFile;
+  TUniquePtr<IMappedFileRegion> _pMappedRegion;
+  std::shared_ptr<TilesetArchive> _pArchive;
+  gsl::span<const std::byte> _archiveData;
 };
 
 const std::string UnrealFileAssetRequestResponse::getMethod = "GET";
@@ -373,8 +747,39 @@ public:
   }
 
   void DoWork() {
-    FString filename =
-        UTF8_TO_TCHAR(convertFileUriToFilename(this->_url).c_str());
+    std::string utf8Filename = convertFileUriToFilename(this->_url);
+
+    std::string entryPath;
+    std::shared_ptr<TilesetArchive> pArchive =
+        TilesetArchive::find(utf8Filename, entryPath);
+    if (pArchive) {
+      this->readFromArchive(pArchive, entryPath);
+      return;
+    }
+
+    FString filename = UTF8_TO_TCHAR(utf8Filename.c_str());
+
+    // Map the file into memory when the platform supports it, so that the
+    // response refers to the file's pages rather than to a copy of them.
+    // Otherwise, and for empty files, which cannot be mapped, fall back to
+    // reading the file into a buffer.
+    IPlatformFile& platformFile =
+        FPlatformFileManager::Get().GetPlatformFile();
+    TUniquePtr<IMappedFileHandle> pMappedFile(
+        platformFile.OpenMapped(*filename));
+    if (pMappedFile && pMappedFile->GetFileSize() > 0) {
+      TUniquePtr<IMappedFileRegion> pMappedRegion(
+          pMappedFile->MapRegion(0, pMappedFile->GetFileSize()));
+      if (pMappedRegion) {
+        this->_promise.resolve(std::make_shared<UnrealFileAssetRequestResponse>(
+            std::move(this->_url),
+            MoveTemp(pMappedFile),
+            MoveTemp(pMappedRegion)));
+        return;
+      }
+    }
+    pMappedFile.Reset();
+
     TArray64<uint8> data;
     if (FFileHelper::LoadFileToArray(data, *filename)) {
       this->_promise.resolve(std::make_shared<UnrealFileAssetRequestResponse>(
@@ -390,6 +795,35 @@ public:
   }
 
 private:
+  void readFromArchive(
+      const std::shared_ptr<TilesetArchive>& pArchive,
+      const std::string& entryPath) {
+    std::optional<TilesetArchive::Entry> maybeEntry =
+        pArchive->findEntry(entryPath);
+    if (!maybeEntry) {
+      this->_promise.resolve(std::make_shared<UnrealFileAssetRequestResponse>(
+          std::move(this->_url),
+          404,
+          TArray64<uint8>()));
+      return;
+    }
+
+    if (!maybeEntry->isCompressed()) {
+      this->_promise.resolve(std::make_shared<UnrealFileAssetRequestResponse>(
+          std::move(this->_url),
+          pArchive,
+          pArchive->getStoredData(*maybeEntry)));
+      return;
+    }
+
+    TArray64<uint8> data;
+    bool success = pArchive->inflate(*maybeEntry, data);
+    this->_promise.resolve(std::make_shared<UnrealFileAssetRequestResponse>(
+        std::move(this->_url),
+        success ? 200 : 404,
+        MoveTemp(data)));
+  }
+
   std::string _url;
   CesiumAsync::Promise<std::shared_ptr<CesiumAsync::IAssetRequest>> _promise;
 };
@@ -2,11 +2,332 @@
 
 #include "UnrealTaskProcessor.h"
 #include "Async/Async.h"
+#include "CesiumRuntime.h"
+#include "CesiumStats.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
 #include "Misc/QueuedThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Queued Decode Tasks"),
+    STAT_CesiumQueuedDecodeTasks,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Queued Geometry Tasks"),
+    STAT_CesiumQueuedGeometryTasks,
+    STATGROUP_Cesium);
+DECLARE_DWORD_ACCUMULATOR_STAT(
+    TEXT("Queued Texture Tasks"),
+    STAT_CesiumQueuedTextureTasks,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_COUNTER_STAT(
+    TEXT("Task Wait Time (ms)"),
+    STAT_CesiumTaskWaitTime,
+    STATGROUP_Cesium);
+DECLARE_FLOAT_COUNTER_STAT(
+    TEXT("Task Execution Time (ms)"),
+    STAT_CesiumTaskExecutionTime,
+    STATGROUP_Cesium);
+
+namespace {
+
+// The lane of the tasks started on each thread. A task running on a worker
+// thread starts its continuations in its own lane unless a LaneScope says
+// otherwise.
+thread_local UnrealTaskProcessor::Lane currentLane =
+    UnrealTaskProcessor::Lane::Decode;
+
+// Later stages of a tile's loading run first, so that tiles already in
+// progress are finished before new ones are started.
+EQueuedWorkPriority getPriority(UnrealTaskProcessor::Lane lane) {
+  switch (lane) {
+  case UnrealTaskProcessor::Lane::Geometry:
+    return EQueuedWorkPriority::Highest;
+  case UnrealTaskProcessor::Lane::Texture:
+    return EQueuedWorkPriority::High;
+  default:
+    return EQueuedWorkPriority::Normal;
+  }
+}
+
+void incrementQueuedTasks(UnrealTaskProcessor::Lane lane) {
+  switch (lane) {
+  case UnrealTaskProcessor::Lane::Geometry:
+    INC_DWORD_STAT(STAT_CesiumQueuedGeometryTasks);
+    break;
+  case UnrealTaskProcessor::Lane::Texture:
+    INC_DWORD_STAT(STAT_CesiumQueuedTextureTasks);
+    break;
+  default:
+    INC_DWORD_STAT(STAT_CesiumQueuedDecodeTasks);
+    break;
+  }
+}
+
+void decrementQueuedTasks(UnrealTaskProcessor::Lane lane) {
+  switch (lane) {
+  case UnrealTaskProcessor::Lane::Geometry:
+    DEC_DWORD_STAT(STAT_CesiumQueuedGeometryTasks);
+    break;
+  case UnrealTaskProcessor::Lane::Texture:
+    DEC_DWORD_STAT(STAT_CesiumQueuedTextureTasks);
+    break;
+  default:
+    DEC_DWORD_STAT(STAT_CesiumQueuedDecodeTasks);
+    break;
+  }
+}
+
+void updateMaximum(std::atomic<uint64_t>& maximum, uint64_t value) {
+  uint64_t previous = maximum.load();
+  while (previous < value && !maximum.compare_exchange_weak(previous, value)) {
+  }
+}
+
+uint64_t toNanoseconds(double seconds) {
+  return uint64_t(std::max(seconds, 0.0) * 1e9);
+}
+
+double toSeconds(uint64_t nanoseconds) { return double(nanoseconds) * 1e-9; }
+
+} // namespace
+
+struct UnrealTaskProcessor::Counters {
+  struct LaneCounters {
+    std::atomic<uint64_t> started{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> totalWaitNanoseconds{0};
+    std::atomic<uint64_t> maximumWaitNanoseconds{0};
+    std::atomic<uint64_t> totalExecutionNanoseconds{0};
+    std::atomic<uint64_t> maximumExecutionNanoseconds{0};
+  };
+
+  std::array<LaneCounters, LaneCount> lanes;
+};
+
+class UnrealTaskProcessor::QueuedWork : public IQueuedWork {
+public:
+  QueuedWork(
+      const std::shared_ptr<Counters>& pCounters,
+      UnrealTaskProcessor::Lane lane,
+      std::function<void()>&& f)
+      : _pCounters(pCounters),
+        _lane(lane),
+        _queuedTime(FPlatformTime::Seconds()),
+        _f(std::move(f)) {}
+
+  virtual void DoThreadedWork() override {
+    UnrealTaskProcessor::runTask(
+        *this->_pCounters,
+        this->_lane,
+        this->_queuedTime,
+        this->_f);
+    delete this;
+  }
+
+  virtual void Abandon() override {
+    // The pool is only abandoned when the module shuts down, when nothing
+    // waits for the task's result any more.
+    decrementQueuedTasks(this->_lane);
+    delete this;
+  }
+
+private:
+  std::shared_ptr<Counters> _pCounters;
+  UnrealTaskProcessor::Lane _lane;
+  double _queuedTime;
+  std::function<void()> _f;
+};
+
+UnrealTaskProcessor::LaneScope::LaneScope(Lane lane)
+    : _previousLane(currentLane) {
+  currentLane = lane;
+}
+
+UnrealTaskProcessor::LaneScope::~LaneScope() {
+  currentLane = this->_previousLane;
+}
+
+/*static*/ TUniquePtr<FQueuedThreadPool>
+UnrealTaskProcessor::createThreadPool(int32 threadCount) {
+  if (threadCount <= 0) {
+    return nullptr;
+  }
+
+  TUniquePtr<FQueuedThreadPool> pThreadPool(FQueuedThreadPool::Allocate());
+  // Decoding glTFs, including Draco and meshopt data, needs a larger stack
+  // than the engine's default for pooled threads.
+  if (!pThreadPool->Create(
+          uint32(threadCount),
+          1024 * 1024,
+          TPri_BelowNormal,
+          TEXT("CesiumWorker"))) {
+    UE_LOG(
+        LogCesium,
+        Warning,
+        TEXT("Could not create %d Cesium worker threads, so the engine's "
+             "background task threads will be used instead."),
+        threadCount);
+    return nullptr;
+  }
+
+  return pThreadPool;
+}
+
+UnrealTaskProcessor::UnrealTaskProcessor(FQueuedThreadPool* pThreadPool)
+    : _threadPoolMutex(),
+      _pThreadPool(pThreadPool),
+      _pCounters(std::make_shared<Counters>()) {}
+
+UnrealTaskProcessor::~UnrealTaskProcessor() = default;
+
+void UnrealTaskProcessor::detachThreadPool() {
+  std::lock_guard<std::mutex> lock(this->_threadPoolMutex);
+  this->_pThreadPool = nullptr;
+}
+
+int32 UnrealTaskProcessor::getThreadCount() const {
+  std::lock_guard<std::mutex> lock(this->_threadPoolMutex);
+  return this->_pThreadPool ? this->_pThreadPool->GetNumThreads() : 0;
+}
 
 void UnrealTaskProcessor::startTask(std::function<void()> f) {
-  AsyncTask(ENamedThreads::Type::AnyBackgroundThreadNormalTask, [f]() {
-    TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::AsyncTask)
+  this->startTask(currentLane, std::move(f));
+}
+
+void UnrealTaskProcessor::startTask(Lane lane, std::function<void()>&& f) {
+  ++this->_pCounters->lanes[size_t(lane)].started;
+  incrementQueuedTasks(lane);
+
+  {
+    // The lock keeps the pool from being detached and destroyed while the
+    // task is added to it.
+    std::lock_guard<std::mutex> lock(this->_threadPoolMutex);
+    if (this->_pThreadPool) {
+      this->_pThreadPool->AddQueuedWork(
+          new QueuedWork(this->_pCounters, lane, std::move(f)),
+          getPriority(lane));
+      return;
+    }
+  }
+
+  AsyncTask(
+      ENamedThreads::Type::AnyBackgroundThreadNormalTask,
+      [pCounters = this->_pCounters,
+       lane,
+       queuedTime = FPlatformTime::Seconds(),
+       f = std::move(f)]() mutable {
+        UnrealTaskProcessor::runTask(*pCounters, lane, queuedTime, f);
+      });
+}
+
+/*static*/ UnrealTaskProcessor::Lane UnrealTaskProcessor::getCurrentLane() {
+  return currentLane;
+}
+
+UnrealTaskProcessor::LaneStatistics
+UnrealTaskProcessor::getLaneStatistics(Lane lane) const {
+  const Counters::LaneCounters& counters =
+      this->_pCounters->lanes[size_t(lane)];
+  uint64_t started = counters.started.load();
+  uint64_t completed = counters.completed.load();
+  return LaneStatistics{
+      started,
+      completed,
+      started > completed ? started - completed : 0,
+      toSeconds(counters.totalWaitNanoseconds.load()),
+      toSeconds(counters.maximumWaitNanoseconds.load()),
+      toSeconds(counters.totalExecutionNanoseconds.load()),
+      toSeconds(counters.maximumExecutionNanoseconds.load())};
+}
+
+/*static*/ void UnrealTaskProcessor::runTask(
+    Counters& counters,
+    Lane lane,
+    double queuedTime,
+    std::function<void()>& f) {
+  TRACE_CPUPROFILER_EVENT_SCOPE(Cesium::AsyncTask)
+
+  double startTime = FPlatformTime::Seconds();
+  decrementQueuedTasks(lane);
+
+  {
+    LaneScope scope(lane);
     f();
-  });
+  }
+
+  // Release whatever the task captured before it is counted as complete.
+  f = nullptr;
+
+  double endTime = FPlatformTime::Seconds();
+  uint64_t waitNanoseconds = toNanoseconds(startTime - queuedTime);
+  uint64_t executionNanoseconds = toNanoseconds(endTime - startTime);
+
+  Counters::LaneCounters& laneCounters = counters.lanes[size_t(lane)];
+  laneCounters.totalWaitNanoseconds += waitNanoseconds;
+  updateMaximum(laneCounters.maximumWaitNanoseconds, waitNanoseconds);
+  laneCounters.totalExecutionNanoseconds += executionNanoseconds;
+  updateMaximum(
+      laneCounters.maximumExecutionNanoseconds,
+      executionNanoseconds);
+  ++laneCounters.completed;
+
+  INC_FLOAT_STAT_BY(STAT_CesiumTaskWaitTime, float(waitNanoseconds * 1e-6));
+  INC_FLOAT_STAT_BY(
+      STAT_CesiumTaskExecutionTime,
+      float(executionNanoseconds * 1e-6));
+}
+
+namespace {
+
+const TCHAR* getLaneName(UnrealTaskProcessor::Lane lane) {
+  switch (lane) {
+  case UnrealTaskProcessor::Lane::Geometry:
+    return TEXT("Geometry");
+  case UnrealTaskProcessor::Lane::Texture:
+    return TEXT("Texture");
+  default:
+    return TEXT("Decode");
+  }
 }
+
+void dumpWorkerStatistics() {
+  const std::shared_ptr<UnrealTaskProcessor>& pTaskProcessor =
+      getTaskProcessor();
+
+  int32 threadCount = pTaskProcessor->getThreadCount();
+  FString report =
+      threadCount > 0
+          ? FString::Printf(
+                TEXT("Cesium background tasks (%d dedicated threads):\n"),
+                threadCount)
+          : FString(TEXT("Cesium background tasks (engine threads):\n"));
+  for (size_t i = 0; i < UnrealTaskProcessor::LaneCount; ++i) {
+    UnrealTaskProcessor::Lane lane = UnrealTaskProcessor::Lane(i);
+    UnrealTaskProcessor::LaneStatistics statistics =
+        pTaskProcessor->getLaneStatistics(lane);
+    double completed = double(std::max(statistics.completed, uint64_t(1)));
+    report += FString::Printf(
+        TEXT("  %s\n    completed %llu  queued %llu  wait mean %.2f ms  "
+             "max %.2f ms  execution mean %.2f ms  max %.2f ms\n"),
+        getLaneName(lane),
+        uint64(statistics.completed),
+        uint64(statistics.queued),
+        statistics.totalWaitSeconds / completed * 1000.0,
+        statistics.maximumWaitSeconds * 1000.0,
+        statistics.totalExecutionSeconds / completed * 1000.0,
+        statistics.maximumExecutionSeconds * 1000.0);
+  }
+  UE_LOG(LogCesium, Display, TEXT("%s"), *report);
+}
+
+FAutoConsoleCommand DumpWorkerStatisticsCommand(
+    TEXT("Cesium.DumpWorkerStats"),
+    TEXT("Logs the number of Cesium background tasks in each lane and the "
+         "time they spent waiting and running."),
+    FConsoleCommandDelegate::CreateStatic(&dumpWorkerStatistics));
+
+} // namespace
@@ -0,0 +1,302 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#include "WarmSetAssetAccessor.h"
+#include "CesiumAsync/IAssetResponse.h"
+#include "CesiumRuntime.h"
+#include <algorithm>
+#include <optional>
+
+namespace {
+
+struct CredentialParameter {
+  // The end of the host names that use the parameter, or an empty string for
+  // every host.
+  const char* hostSuffix;
+  const char* name;
+};
+
+// The query parameters used to pass credentials by Cesium ion, Google Maps
+// Platform, Bing Maps, and ArcGIS. Other than the OAuth access token, each is
+// only a credential on its own service, because other servers may use the
+// same names for parameters that select what is returned.
+const CredentialParameter credentialParameters[] = {
+    {"", "access_token"},
+    {"googleapis.com", "key"},
+    {"googleapis.com", "session"},
+    {"virtualearth.net", "key"},
+    {"arcgis.com", "token"},
+    {"arcgisonline.com", "token"}};
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isCredentialParameter(
+    const std::string& origin,
+    const std::string& parameter) {
+  const size_t nameEnd = parameter.find('=');
+  const std::string name = parameter.substr(0, nameEnd);
+  for (const CredentialParameter& credential : credentialParameters) {
+    if (name == credential.name && endsWith(origin, credential.hostSuffix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct SplitUrl {
+  std::string base;
+  std::vector<std::string> parameters;
+  std::string fragment;
+};
+
+SplitUrl splitUrl(const std::string& url) {
+  SplitUrl result;
+
+  const size_t fragmentStart = url.find('#');
+  const std::string withoutFragment = url.substr(0, fragmentStart);
+  if (fragmentStart != std::string::npos) {
+    result.fragment = url.substr(fragmentStart);
+  }
+
+  const size_t queryStart = withoutFragment.find('?');
+  result.base = withoutFragment.substr(0, queryStart);
+  if (queryStart == std::string::npos) {
+    return result;
+  }
+
+  size_t start = queryStart + 1;
+  while (start <= withoutFragment.size()) {
+    size_t end = withoutFragment.find('&', start);
+    if (end == std::string::npos) {
+      end = withoutFragment.size();
+    }
+    if (end > start) {
+      result.parameters.emplace_back(
+          withoutFragment.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+
+  return result;
+}
+
+std::string joinUrl(
+    const std::string& base,
+    const std::vector<std::string>& parameters,
+    const std::string& fragment) {
+  std::string result = base;
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    result += i == 0 ? '?' : '&';
+    result += parameters[i];
+  }
+  result += fragment;
+  return result;
+}
+
+// The scheme and authority of a URL, such as "https://tile.googleapis.com".
+std::string getOrigin(const std::string& url) {
+  const size_t schemeEnd = url.find("://");
+  if (schemeEnd == std::string::npos) {
+    return std::string();
+  }
+  return url.substr(0, url.find_first_of("/?#", schemeEnd + 3));
+}
+
+// Headers are compared regardless of their order.
+std::vector<CesiumAsync::IAssetAccessor::THeader> sortHeaders(
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  std::vector<CesiumAsync::IAssetAccessor::THeader> result = headers;
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // namespace
+
+WarmSetAssetAccessor::WarmSetAssetAccessor(
+    const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+    std::vector<std::string>&& warmSet)
+    : _pAssetAccessor(pAssetAccessor),
+      _mutex(),
+      _warmSet(),
+      _prefetched(),
+      _recordedUrls(),
+      _recordedUrlSet(),
+      _tileContentUrls() {
+  for (const std::string& url : warmSet) {
+    this->_warmSet.insert(stripCredentials(url));
+  }
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+WarmSetAssetAccessor::get(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers) {
+  const std::string strippedUrl = stripCredentials(url);
+  const std::string origin = getOrigin(url);
+  std::vector<std::string> toPrefetch;
+  std::optional<RequestFuture> maybePrefetched;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    if (this->_recordedUrls.size() < MaximumRecordedUrls &&
+        this->_recordedUrlSet.insert(strippedUrl).second) {
+      this->_recordedUrls.push_back(strippedUrl);
+    }
+
+    auto it = this->_prefetched.find(strippedUrl);
+    if (it != this->_prefetched.end()) {
+      // A prefetched response is only used if it was requested with the same
+      // credentials and headers, because it may be specific to them. The
+      // order of the query parameters and of the headers does not matter.
+      if (it->second.url == normalizeUrl(url) &&
+          it->second.headers == sortHeaders(headers)) {
+        maybePrefetched = std::move(it->second.future);
+      }
+      this->_prefetched.erase(it);
+    } else if (this->_warmSet.erase(strippedUrl) > 0) {
+      // The first request for a URL in the warm set starts the prefetch of
+      // the other URLs from the same server. They are requested with the same
+      // credentials and headers, which carry the tileset's authorization, if
+      // any. The URLs from other servers, such as Cesium ion's asset server
+      // after its API server, wait for their own first request, because
+      // their credentials are different.
+      for (auto it = this->_warmSet.begin(); it != this->_warmSet.end();) {
+        if (getOrigin(*it) == origin) {
+          toPrefetch.emplace_back(*it);
+          it = this->_warmSet.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  if (maybePrefetched) {
+    // A prefetched request that did not succeed, for example because the
+    // warm set is stale, is retried as if it had never been prefetched.
+    return maybePrefetched->thenImmediately(
+        [asyncSystem, pAssetAccessor = this->_pAssetAccessor, url, headers](
+            const std::shared_ptr<CesiumAsync::IAssetRequest>& pRequest) {
+          const CesiumAsync::IAssetResponse* pResponse = pRequest->response();
+          if (pResponse && pResponse->statusCode() >= 200 &&
+              pResponse->statusCode() < 300) {
+            return asyncSystem.createResolvedFuture(
+                std::shared_ptr<CesiumAsync::IAssetRequest>(pRequest));
+          }
+          return pAssetAccessor->get(asyncSystem, url, headers);
+        });
+  }
+
+  if (!toPrefetch.empty()) {
+    UE_LOG(
+        LogCesium,
+        Verbose,
+        TEXT("Prefetching %d URLs from the tileset's warm set"),
+        int32(toPrefetch.size()));
+
+    std::unordered_map<std::string, Prefetch> prefetched;
+    for (std::string& warmUrl : toPrefetch) {
+      std::string prefetchUrl = addCredentials(warmUrl, url);
+      RequestFuture future =
+          this->_pAssetAccessor->get(asyncSystem, prefetchUrl, headers)
+              .share();
+      prefetched.emplace(
+          std::move(warmUrl),
+          Prefetch{
+              normalizeUrl(prefetchUrl),
+              sortHeaders(headers),
+              std::move(future)});
+    }
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    for (auto& entry : prefetched) {
+      this->_prefetched.emplace(entry.first, std::move(entry.second));
+    }
+  }
+
+  return this->_pAssetAccessor->get(asyncSystem, url, headers);
+}
+
+CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+WarmSetAssetAccessor::request(
+    const CesiumAsync::AsyncSystem& asyncSystem,
+    const std::string& verb,
+    const std::string& url,
+    const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+    const gsl::span<const std::byte>& contentPayload) {
+  return this->_pAssetAccessor
+      ->request(asyncSystem, verb, url, headers, contentPayload);
+}
+
+void WarmSetAssetAccessor::tick() noexcept { this->_pAssetAccessor->tick(); }
+
+void WarmSetAssetAccessor::markTileContent(const std::string& url) {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  if (this->_recordedUrlSet.find(url) != this->_recordedUrlSet.end()) {
+    this->_tileContentUrls.insert(url);
+  }
+}
+
+std::vector<std::string> WarmSetAssetAccessor::getRecordedUrls(
+    const std::unordered_set<std::string>& tileContentToInclude) const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  std::vector<std::string> result;
+  result.reserve(this->_recordedUrls.size());
+  for (const std::string& url : this->_recordedUrls) {
+    if (this->_tileContentUrls.find(url) == this->_tileContentUrls.end() ||
+        tileContentToInclude.find(url) != tileContentToInclude.end()) {
+      result.push_back(url);
+    }
+  }
+
+  return result;
+}
+
+void WarmSetAssetAccessor::discardUnclaimedPrefetches() {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  this->_warmSet.clear();
+  this->_prefetched.clear();
+}
+
+/*static*/ std::string
+WarmSetAssetAccessor::stripCredentials(const std::string& url) {
+  const std::string origin = getOrigin(url);
+  SplitUrl split = splitUrl(url);
+  std::vector<std::string> parameters;
+  for (std::string& parameter : split.parameters) {
+    if (!isCredentialParameter(origin, parameter)) {
+      parameters.emplace_back(std::move(parameter));
+    }
+  }
+  std::stable_sort(parameters.begin(), parameters.end());
+  return joinUrl(split.base, parameters, split.fragment);
+}
+
+/*static*/ std::string
+WarmSetAssetAccessor::normalizeUrl(const std::string& url) {
+  SplitUrl split = splitUrl(url);
+  std::stable_sort(split.parameters.begin(), split.parameters.end());
+  return joinUrl(split.base, split.parameters, split.fragment);
+}
+
+/*static*/ std::string WarmSetAssetAccessor::addCredentials(
+    const std::string& url,
+    const std::string& credentialsFrom) {
+  const std::string origin = getOrigin(url);
+  if (origin.empty() || origin != getOrigin(credentialsFrom)) {
+    return url;
+  }
+
+  SplitUrl split = splitUrl(url);
+  for (std::string& parameter : splitUrl(credentialsFrom).parameters) {
+    if (isCredentialParameter(origin, parameter)) {
+      split.parameters.emplace_back(std::move(parameter));
+    }
+  }
+  return joinUrl(split.base, split.parameters, split.fragment);
+}
@@ -0,0 +1,139 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CesiumAsync/AsyncSystem.h"
+#include "CesiumAsync/IAssetAccessor.h"
+#include "CesiumAsync/IAssetRequest.h"
+#include "CesiumAsync/SharedFuture.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * An IAssetAccessor that supports a tileset's warm set: the URLs that the
+ * tileset needed in order to reach full detail at a known view.
+ *
+ * It records the distinct URLs requested through it, with their credentials
+ * removed, so that they can be saved as a warm set snapshot. When it is given a
+ * warm set, it requests the URLs in it from one server in parallel as soon as
+ * the tileset requests the first of them, using that request's credentials
+ * and headers. Later requests for those URLs are then served from the
+ * prefetched responses rather than being discovered and fetched one level of
+ * the tile hierarchy at a time. A prefetched response is only used once, and
+ * only for a request with the same query parameters, in any order, and the
+ * same headers. A prefetch that did not succeed is requested again.
+ */
+class WarmSetAssetAccessor : public CesiumAsync::IAssetAccessor {
+public:
+  /**
+   * The maximum number of distinct URLs that are recorded. Requests beyond
+   * this are still served, but not recorded.
+   */
+  static constexpr size_t MaximumRecordedUrls = 65536;
+
+  WarmSetAssetAccessor(
+      const std::shared_ptr<CesiumAsync::IAssetAccessor>& pAssetAccessor,
+      std::vector<std::string>&& warmSet);
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  get(const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers)
+      override;
+
+  virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  request(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload) override;
+
+  virtual void tick() noexcept override;
+
+  /**
+   * Marks a recorded URL as the content of a tile, as opposed to a URL that
+   * describes the structure of the tileset, such as an external tileset or an
+   * implicit tiling subtree.
+   *
+   * @param url The URL, with its credentials removed by
+   * {@link stripCredentials}.
+   */
+  void markTileContent(const std::string& url);
+
+  /**
+   * Gets the distinct URLs requested through this accessor, with their
+   * credentials removed, in the order in which they were first requested.
+   *
+   * @param tileContentToInclude The tile content URLs to include. Tile content
+   * URLs that are not in this set are left out, so that a snapshot only
+   * includes the tiles needed for one view.
+   */
+  std::vector<std::string> getRecordedUrls(
+      const std::unordered_set<std::string>& tileContentToInclude) const;
+
+  /**
+   * Releases the prefetched responses that have not been requested by the
+   * tileset, for example because the view has moved away from the warm set.
+   * This should only be called once the tileset has completed loading a view,
+   * because every response it has not requested by then will not be needed.
+   */
+  void discardUnclaimedPrefetches();
+
+  /**
+   * Removes the query parameters that carry credentials, such as Cesium ion
+   * access tokens and Google Maps Platform keys and session IDs, from a URL,
+   * and sorts the remaining query parameters, so that the URLs of a resource
+   * that differ only in credentials or parameter order are the same. A
+   * parameter is only removed from the URLs of the service that uses it as a
+   * credential.
+   */
+  static std::string stripCredentials(const std::string& url);
+
+  /**
+   * Sorts the query parameters of a URL, so that URLs that differ only in the
+   * order of their parameters are the same.
+   */
+  static std::string normalizeUrl(const std::string& url);
+
+  /**
+   * Adds the query parameters that carry credentials in one URL to another URL
+   * from the same server.
+   *
+   * @param url The URL, without credentials.
+   * @param credentialsFrom The URL to copy the credentials from.
+   * @return The URL with the credentials, or the URL unchanged if the two URLs
+   * are not from the same server.
+   */
+  static std::string
+  addCredentials(const std::string& url, const std::string& credentialsFrom);
+
+private:
+  using RequestFuture =
+      CesiumAsync::SharedFuture<std::shared_ptr<CesiumAsync::IAssetRequest>>;
+
+  struct Prefetch {
+    // The URL that was requested, including credentials, and its headers,
+    // both sorted.
+    std::string url;
+    std::vector<CesiumAsync::IAssetAccessor::THeader> headers;
+    RequestFuture future;
+  };
+
+  std::shared_ptr<CesiumAsync::IAssetAccessor> _pAssetAccessor;
+
+  mutable std::mutex _mutex;
+
+  // The URLs of the warm set that have not been prefetched, and the prefetched
+  // requests that have not been claimed, both without credentials.
+  std::unordered_set<std::string> _warmSet;
+  std::unordered_map<std::string, Prefetch> _prefetched;
+
+  std::vector<std::string> _recordedUrls;
+  std::unordered_set<std::string> _recordedUrlSet;
+  std::unordered_set<std::string> _tileContentUrls;
+};
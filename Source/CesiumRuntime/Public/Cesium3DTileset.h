@@ -6,12 +6,15 @@
 #include "Cesium3DTilesSelection/ViewState.h"
 #include "Cesium3DTilesSelection/ViewUpdateResult.h"
 #include "Cesium3DTilesetLoadFailureDetails.h"
+#include "CesiumCamera.h"
 #include "CesiumCreditSystem.h"
 #include "CesiumEncodedMetadataComponent.h"
 #include "CesiumFeaturesMetadataComponent.h"
 #include "CesiumGeoreference.h"
 #include "CesiumIonServer.h"
 #include "CesiumPointCloudShading.h"
+#include "CesiumTileLoadLatency.h"
+#include "CesiumUtility/CreditSystem.h"
 #include "CoreMinimal.h"
 #include "CustomDepthParameters.h"
 #include "Engine/EngineTypes.h"
@@ -31,6 +34,9 @@ class ACesiumCartographicSelection;
 class ACesiumCameraManager;
 class UCesiumBoundingVolumePoolComponent;
 class CesiumViewExtension;
+class WarmSetAssetAccessor;
+class TileLoadCancellation;
+class CesiumTextureMemory;
 struct FCesiumCamera;
 
 namespace Cesium3DTilesSelection {
@@ -73,6 +79,106 @@ enum class ETilesetSource : uint8 {
 UENUM(BlueprintType)
 enum class EApplyDpiScaling : uint8 { Yes, No, UseProjectDefault };
 
+/**
+ * A snapshot of a tileset's streaming state, as returned by
+ * {@link ACesium3DTileset::GetStreamingStatistics}. This is intended for
+ * performance tests and profiling tools.
+ */
+struct FCesium3DTilesetStreamingStatistics {
+  /**
+   * The number of tiles rendered by the most recent tile selection.
+   */
+  uint32 TilesRendered = 0;
+
+  /**
+   * The number of tiles selected by the most recent tile selection that are
+   * waiting to be loaded in a worker thread.
+   */
+  uint32 TilesLoadingInWorkerThread = 0;
+
+  /**
+   * The number of tiles selected by the most recent tile selection that are
+   * waiting to be prepared for rendering in the game thread.
+   */
+  uint32 TilesLoadingInMainThread = 0;
+
+  /**
+   * The number of tiles visited by the most recent tile selection.
+   */
+  uint32 TilesVisited = 0;
+
+  /**
+   * The number of tiles culled by the most recent tile selection.
+   */
+  uint32 TilesCulled = 0;
+
+  /**
+   * The maximum tree depth reached by the most recent tile selection.
+   */
+  uint32 MaxDepthVisited = 0;
+
+  /**
+   * The total number of tiles prepared for rendering in the game thread since
+   * the tileset was loaded.
+   */
+  uint64 TilesPreparedInMainThread = 0;
+
+  /**
+   * The total time, in seconds, spent preparing tiles for rendering in the
+   * game thread since the tileset was loaded.
+   */
+  double MainThreadPrepareSeconds = 0.0;
+
+  /**
+   * The total number of tiles whose preparation for rendering in a worker
+   * thread stopped early since the tileset was loaded, because the tileset
+   * was destroyed or the tile was far outside the views.
+   */
+  uint64 TilePreparationsCanceled = 0;
+
+  /**
+   * The total number of tiles prepared for rendering in a worker thread but
+   * unloaded before they were used since the tileset was loaded.
+   */
+  uint64 TilePreparationsWasted = 0;
+
+  /**
+   * The total time, in seconds, spent in worker threads on preparing tiles
+   * that were canceled or wasted since the tileset was loaded.
+   */
+  double WastedPreparationSeconds = 0.0;
+
+  /**
+   * The bytes of the live textures referenced by the materials of this
+   * tileset's tiles.
+   */
+  int64 GltfTextureBytes = 0;
+
+  /**
+   * The bytes of the live textures that encode the features and metadata of
+   * this tileset's tiles.
+   */
+  int64 MetadataTextureBytes = 0;
+
+  /**
+   * The bytes of the live raster overlay textures last used by this tileset.
+   */
+  int64 RasterOverlayTextureBytes = 0;
+
+  /**
+   * The bytes of all of the live textures created by Cesium, for all
+   * tilesets.
+   */
+  int64 AllTilesetsTextureBytes = 0;
+
+  /**
+   * The factor by which the maximum screen-space error is currently scaled to
+   * keep this tileset within its TextureMemoryBudget, or 1.0 if it is within
+   * the budget.
+   */
+  double TextureBudgetScale = 1.0;
+};
+
 UCLASS()
 class CESIUMRUNTIME_API ACesium3DTileset : public AActor {
   GENERATED_BODY()
@@ -396,6 +502,25 @@ public:
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cesium|Tile Loading")
   int64 MaximumCachedBytes = 256 * 1024 * 1024;
 
+  /**
+   * @brief The maximum number of bytes of GPU texture memory that this
+   * tileset's tiles and raster overlays should use, or 0 for no limit.
+   *
+   * Unlike MaximumCachedBytes, this counts the textures that are actually
+   * created, including raster overlay tiles and metadata textures. While the
+   * textures exceed this budget, the maximum screen-space error is raised
+   * gradually, up to 16 times, so that coarser tiles with coarser raster
+   * overlays are selected, and tiles that are not rendered are unloaded
+   * rather than cached. It is lowered again once the textures are well under
+   * the budget.
+   */
+  UPROPERTY(
+      EditAnywhere,
+      BlueprintReadWrite,
+      Category = "Cesium|Tile Loading",
+      meta = (ClampMin = 0))
+  int64 TextureMemoryBudget = 0;
+
   /**
    * The number of loading descendents a tile should allow before deciding to
    * render itself instead of waiting.
@@ -414,6 +539,36 @@ public:
       meta = (ClampMin = 0))
   int32 LoadingDescendantLimit = 20;
 
+  /**
+   * A warm set snapshot file previously saved with SaveWarmSetSnapshot. A
+   * relative path is relative to the project directory.
+   *
+   * When the tileset is loaded, every tile in the snapshot is requested in
+   * parallel as soon as the first of them is needed, rather than each level
+   * of detail being discovered and requested in turn. This reduces the time
+   * until full detail is reached at the view for which the snapshot was
+   * saved, such as a fixed spawn point. Tiles that are not needed are
+   * released once the tileset has finished loading.
+   */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cesium|Tile Loading")
+  FString WarmSetSnapshotFile;
+
+  /**
+   * The priority of the network requests for this tileset and its raster
+   * overlays relative to those of other tilesets.
+   *
+   * When more HTTP requests are pending than the Maximum Simultaneous Http
+   * Requests project setting allows, the waiting requests of the tileset with
+   * the highest priority are sent first. Requests that are not made by a
+   * tileset have a priority of zero. This can be changed at any time, such as
+   * to favor the tileset the player is looking at. The pending requests of a
+   * tileset are canceled when it is destroyed. While the tileset is only seen
+   * by cameras with a LoadPriorityWeight below 1.0, such as scene captures,
+   * its priority is lowered by one minus the largest of their weights.
+   */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cesium|Tile Loading")
+  double RequestPriority = 0.0;
+
   /**
    * Whether to cull tiles that are outside the frustum.
    *
@@ -535,8 +690,8 @@ public:
   bool EnableOcclusionCulling = true;
 
   /**
-   * The number of CesiumBoundingVolumeComponents to use for querying the
-   * occlusion state of traversed tiles.
+   * The number of bounding volumes to use for querying the occlusion state of
+   * traversed tiles.
    *
    * Only applicable when EnableOcclusionCulling is enabled.
    */
@@ -585,6 +740,22 @@ public:
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cesium|Debug")
   bool SuspendUpdate;
 
+  /**
+   * Whether to skip tile selection while this tileset is idle.
+   *
+   * The tileset is considered idle when none of its cameras, properties, or
+   * its georeference have changed since the last frame, no tiles or raster
+   * overlay tiles are loading, and no LOD transitions are in progress. In that
+   * case the previous frame's selection is still valid, so the (relatively
+   * expensive) tile selection traversal is skipped until something changes.
+   *
+   * Tilesets with tile excluders (including those created by polygon raster
+   * overlays) or with occlusion culling enabled are never considered idle,
+   * because their selection may change without any visible trigger.
+   */
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cesium|Debug")
+  bool SkipUpdatesWhenIdle = false;
+
   /**
    * If true, this tileset is ticked/updated in the editor. If false, is only
    * ticked while playing (including Play-in-Editor).
@@ -903,6 +1074,43 @@ public:
   UFUNCTION(BlueprintGetter, Category = "Cesium")
   float GetLoadProgress() const { return LoadProgress; }
 
+  /**
+   * Gets the p50, p95, and p99 latency of the given tile load stage, measured
+   * across the tiles loaded since the tileset was loaded or since the last call
+   * to ResetTileLoadLatency. The same information is logged for all tilesets
+   * by the Cesium.DumpTileLoadLatency console command.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Cesium|Debug")
+  FCesiumTileLoadLatency GetTileLoadLatency(ECesiumTileLoadStage Stage) const;
+
+  /**
+   * Discards the tile load latency measurements reported by
+   * GetTileLoadLatency.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Cesium|Debug")
+  void ResetTileLoadLatency();
+
+  /**
+   * Saves the tiles that this tileset has requested since it was loaded to a
+   * warm set snapshot file, which can be used with WarmSetSnapshotFile to
+   * load them quickly the next time. To capture the tiles needed for a
+   * particular view, refresh the tileset at that view, wait for it to finish
+   * loading, and then call this function.
+   *
+   * The snapshot contains the content of the tiles rendered for the current
+   * view and of their ancestors, along with the external tilesets and
+   * subtrees needed to reach them, and the URL used to load the tileset
+   * itself. Cesium ion access tokens and the keys and session IDs of services
+   * such as Google Maps Platform are removed from the URLs. They are added
+   * back from the tileset's own requests when the snapshot is used.
+   *
+   * @param Filename The file to write. A relative path is relative to the
+   * project directory.
+   * @return Whether the file was written.
+   */
+  UFUNCTION(BlueprintCallable, Category = "Cesium|Tile Loading")
+  bool SaveWarmSetSnapshot(const FString& Filename) const;
+
   UFUNCTION(BlueprintGetter, Category = "Cesium")
   bool GetUseLodTransitions() const { return UseLodTransitions; }
 
@@ -1061,6 +1269,21 @@ public:
     return this->_pTileset.Get();
   }
 
+  /**
+   * Gets a snapshot of the streaming state of this tileset. The tile counts
+   * describe the most recent tile selection, while the game thread preparation
+   * totals accumulate from the time the tileset is loaded.
+   */
+  FCesium3DTilesetStreamingStatistics GetStreamingStatistics() const;
+
+  /**
+   * Resets the idle state, so that the next Tick performs a full tile
+   * selection traversal. This must be called after changing anything that the
+   * traversal depends on outside of this actor's properties, such as its
+   * raster overlays or tile excluders. See SkipUpdatesWhenIdle.
+   */
+  void invalidateIdleState();
+
   // AActor overrides (some or most of them should be protected)
   virtual bool ShouldTickIfViewportsOnly() const override;
   virtual void Tick(float DeltaTime) override;
@@ -1110,7 +1333,8 @@ private:
 
   static Cesium3DTilesSelection::ViewState CreateViewStateFromViewParameters(
       const FCesiumCamera& camera,
-      const glm::dmat4& unrealWorldToTileset);
+      const glm::dmat4& unrealWorldToTileset,
+      double screenSpaceErrorMultiplier);
 
   std::vector<FCesiumCamera> GetCameras() const;
   std::vector<FCesiumCamera> GetPlayerCameras() const;
@@ -1131,8 +1355,28 @@ private:
    * Writes the values of all properties of this actor into the
    * TilesetOptions, to take them into account during the next
    * traversal.
+   *
+   * @return Whether any of the options changed.
+   */
+  bool updateTilesetOptionsFromProperties();
+
+  /**
+   * Gets the bytes of tile data that cesium-native may keep cached, which is
+   * the MaximumCachedBytes less whatever cesium-native cannot count itself.
+   * It is computed again only when MaximumCachedBytes changes or the tileset
+   * is loaded.
    */
-  void updateTilesetOptionsFromProperties();
+  int64 getMaximumCachedBytes();
+
+  /**
+   * Determines whether the tileset has nothing left to do after the given
+   * ViewUpdateResult, meaning that subsequent traversals will produce the
+   * same result as long as the view does not change.
+   *
+   * @param result The ViewUpdateResult of the most recent traversal.
+   */
+  bool isIdleAfterUpdate(
+      const Cesium3DTilesSelection::ViewUpdateResult& result) const;
 
   /**
    * Update all the "_last..." fields of this instance based
@@ -1153,6 +1397,17 @@ private:
   void
   showTilesToRender(const std::vector<Cesium3DTilesSelection::Tile*>& tiles);
 
+  /**
+   * Releases or restores the upper mips of the textures of the given tiles
+   * according to how large each tile appears in the given views.
+   *
+   * @param tiles The tiles rendered in the current frame.
+   * @param cameras The cameras the tiles were selected for.
+   */
+  void updateMipResidency(
+      const std::vector<Cesium3DTilesSelection::Tile*>& tiles,
+      const std::vector<FCesiumCamera>& cameras);
+
   /**
    * Will be called after the tileset is loaded or spawned, to register
    * a delegate that calls OnFocusEditorViewportOnThis when this
@@ -1227,6 +1482,53 @@ private:
 
   int32 _tilesetsBeingDestroyed;
 
+  // The state of the most recent full traversal, used to detect when the view
+  // is unchanged and the traversal can be skipped. See SkipUpdatesWhenIdle.
+  bool _idleAfterLastUpdate;
+  std::vector<FCesiumCamera> _lastCameras;
+
+  // The cameras when this tileset's request group last changed its view. Once
+  // the cameras turn away from them, the tiles that are already queued are
+  // requested after those of the new view.
+  std::vector<FCesiumCamera> _requestViewCameras;
+  glm::dmat4 _lastUnrealWorldToCesiumTileset;
+
+  // The credits that this tileset added in the most recent full traversal.
+  // They are added again in each skipped frame so that they remain on screen.
+  std::vector<CesiumUtility::Credit> _lastFrameCredits;
+
+  // Totals for the tiles prepared by UnrealResourcePreparer in the game
+  // thread, reported by GetStreamingStatistics.
+  uint64 _tilesPreparedInMainThread;
+  double _mainThreadPrepareSeconds;
+
+  // The latency of each tile load stage, recorded by UnrealResourcePreparer
+  // when a tile is finalized in the game thread.
+  CesiumTileLoadLatencyHistograms _tileLoadLatency;
+
+  // Records the tiles requested by this tileset and prefetches the tiles in
+  // its WarmSetSnapshotFile, if any.
+  std::shared_ptr<WarmSetAssetAccessor> _pWarmSetAccessor;
+
+  // The UnrealAssetAccessor request group of this tileset's requests, which
+  // is canceled when the tileset is destroyed, or zero if there is none.
+  uint64 _requestGroup;
+
+  // Stops the preparation of this tileset's tiles in worker threads when they
+  // are no longer wanted, and counts the work wasted on them.
+  std::shared_ptr<TileLoadCancellation> _pTileLoadCancellation;
+
+  // The bytes of the live textures created for this tileset, and the factor
+  // by which they currently scale the maximum screen-space error to stay
+  // within the TextureMemoryBudget.
+  std::shared_ptr<CesiumTextureMemory> _pTextureMemory;
+  double _textureBudgetScale;
+
+  // The MaximumCachedBytes that _maximumCachedBytes was last computed from,
+  // or -1 if it must be computed again.
+  int64 _maximumCachedBytesProperty;
+  int64 _maximumCachedBytes;
+
   friend class UnrealResourcePreparer;
   friend class UCesiumGltfPointsComponent;
 };
@@ -56,6 +56,31 @@ public:
   UPROPERTY(BlueprintReadWrite, Category = "Cesium")
   double OverrideAspectRatio = 0.0;
 
+  /**
+   * @brief A multiplier applied to the tileset's Maximum Screen Space Error
+   * when selecting tiles for this camera.
+   *
+   * Values greater than 1.0 cause this camera to refine more coarsely than the
+   * main viewport, which is useful for secondary views such as small scene
+   * captures. A value of 1.0 selects tiles exactly like the main viewport.
+   */
+  UPROPERTY(BlueprintReadWrite, Category = "Cesium")
+  double ScreenSpaceErrorMultiplier = 1.0;
+
+  /**
+   * @brief The weight of this camera's tile loads relative to the main
+   * viewport, in the range 0.0 to 1.0.
+   *
+   * A tileset's request priority is lowered by one minus the largest weight
+   * of the cameras that see it, so that the requests of a tileset seen only by
+   * low-weight cameras are sent after those of the tilesets in the main
+   * viewport. A value of 1.0 gives this camera the same priority as the main
+   * viewport. Use ScreenSpaceErrorMultiplier to have a camera request fewer
+   * tiles.
+   */
+  UPROPERTY(BlueprintReadWrite, Category = "Cesium")
+  double LoadPriorityWeight = 1.0;
+
   /**
    * @brief Construct an uninitialized FCesiumCamera object.
    */
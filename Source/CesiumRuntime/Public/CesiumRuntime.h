@@ -8,6 +8,8 @@
 
 class ACesium3DTileset;
 class UCesiumRasterOverlay;
+class UnrealAssetAccessor;
+class UnrealTaskProcessor;
 
 namespace CesiumAsync {
 class AsyncSystem;
@@ -47,8 +49,29 @@ CESIUMRUNTIME_API extern FCesiumRasterOverlayIonTroubleshooting
     OnCesiumRasterOverlayIonTroubleshooting;
 
 CESIUMRUNTIME_API CesiumAsync::AsyncSystem& getAsyncSystem() noexcept;
+
+/**
+ * Gets the task processor that runs the background tasks of the AsyncSystem
+ * returned by getAsyncSystem.
+ */
+CESIUMRUNTIME_API const std::shared_ptr<UnrealTaskProcessor>&
+getTaskProcessor() noexcept;
+
 CESIUMRUNTIME_API const std::shared_ptr<CesiumAsync::IAssetAccessor>&
 getAssetAccessor();
 
+/**
+ * Gets the accessor that sends network requests for every other Cesium asset
+ * accessor, which allows request groups to be created and prioritized.
+ */
+CESIUMRUNTIME_API const std::shared_ptr<UnrealAssetAccessor>&
+getUnrealAssetAccessor();
+
 CESIUMRUNTIME_API std::shared_ptr<CesiumAsync::ICacheDatabase>&
 getCacheDatabase();
+
+/**
+ * Discards all cached responses, both those kept in memory and those in the
+ * disk cache.
+ */
+CESIUMRUNTIME_API void clearRequestCache();
@@ -6,6 +6,67 @@
 #include "Engine/DeveloperSettings.h"
 #include "CesiumRuntimeSettings.generated.h"
 
+/**
+ * The compression applied to responses stored in the cache of network
+ * responses.
+ */
+UENUM()
+enum class ECesiumRequestCacheCompression : uint8 {
+  /**
+   * Responses are stored as they were received.
+   */
+  None UMETA(DisplayName = "None"),
+
+  /**
+   * Fast compression that typically halves the size of tile content.
+   */
+  LZ4 UMETA(DisplayName = "LZ4"),
+
+  /**
+   * Slower compression that makes responses smaller than LZ4 does.
+   */
+  Zlib UMETA(DisplayName = "Zlib")
+};
+
+/**
+ * The storage used for the cache of network responses.
+ */
+UENUM()
+enum class ECesiumRequestCacheType : uint8 {
+  /**
+   * A single SQLite database, limited by its number of entries.
+   */
+  Sqlite UMETA(DisplayName = "SQLite Database"),
+
+  /**
+   * A directory of files, one per response, limited by their total size.
+   * This scales better to large caches and to many simultaneous requests.
+   */
+  ShardedFiles UMETA(DisplayName = "Sharded Files")
+};
+
+/**
+ * The compression applied at runtime to tile textures that are not already
+ * compressed for the GPU.
+ */
+UENUM()
+enum class ECesiumTextureCompression : uint8 {
+  /**
+   * Textures are uploaded uncompressed.
+   */
+  None UMETA(DisplayName = "None"),
+
+  /**
+   * Textures are compressed quickly, with some loss of color accuracy.
+   */
+  Fast UMETA(DisplayName = "Fast"),
+
+  /**
+   * Textures are compressed more accurately, which takes several times longer.
+   */
+  HighQuality UMETA(DisplayName = "High Quality")
+};
+
 /**
  * Stores runtime settings for the Cesium plugin.
  */
@@ -45,6 +106,16 @@ public:
   UPROPERTY(Config, EditAnywhere, Category = "Experimental Feature Flags")
   bool EnableExperimentalOcclusionCullingFeature = false;
 
+  /**
+   * The storage used for the cache of network responses.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Cache",
+      meta = (ConfigRestartRequired = true))
+  ECesiumRequestCacheType RequestCacheType = ECesiumRequestCacheType::Sqlite;
+
   /**
    * The number of requests to handle before each prune of old cached results
    * from the database.
@@ -64,6 +135,137 @@ public:
       Config,
       EditAnywhere,
       Category = "Cache",
-      meta = (ConfigRestartRequired = true))
+      meta =
+          (ConfigRestartRequired = true,
+           EditCondition = "RequestCacheType == ECesiumRequestCacheType::Sqlite"))
   int MaxCacheItems = 4096;
+
+  /**
+   * The maximum total size, in megabytes, of the responses that should be kept
+   * in the Sharded Files cache after pruning.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Cache",
+      meta =
+          (ConfigRestartRequired = true,
+           ClampMin = 1,
+           EditCondition =
+               "RequestCacheType == ECesiumRequestCacheType::ShardedFiles"))
+  int MaxCacheSizeMB = 4096;
+
+  /**
+   * The compression to apply to responses stored in the cache, so that more
+   * of them fit within the same disk space. Responses that do not compress
+   * well, such as images, are stored as they are. Responses that were stored
+   * with a different setting can still be read. Compression costs worker
+   * thread time on every cache read and write, so it is off by default.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Cache",
+      meta = (ConfigRestartRequired = true))
+  ECesiumRequestCacheCompression RequestCacheCompression =
+      ECesiumRequestCacheCompression::None;
+
+  /**
+   * The total size, in megabytes, of the recently received responses that are
+   * kept in memory, in front of the disk cache, so that recently unloaded tiles
+   * can be loaded again almost instantly. Set this to zero to disable the
+   * in-memory cache.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Cache",
+      meta = (ConfigRestartRequired = true, ClampMin = 0))
+  int InMemoryCacheSizeMB = 32;
+
+  /**
+   * The maximum number of HTTP requests that Cesium will have in flight at
+   * once. Further requests wait in a queue and are sent in order of their
+   * tileset's Request Priority.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Network",
+      meta = (ConfigRestartRequired = true, ClampMin = 1))
+  int MaximumSimultaneousHttpRequests = 64;
+
+  /**
+   * The maximum number of HTTP requests that Cesium will have in flight at
+   * once to any one server. This keeps several tilesets and overlays that
+   * use the same server from exceeding its per-client limits.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Network",
+      meta = (ConfigRestartRequired = true, ClampMin = 1))
+  int MaximumSimultaneousHttpRequestsPerHost = 32;
+
+  /**
+   * The number of times to retry an HTTP request that the server rejects with
+   * 429 Too Many Requests or 503 Service Unavailable. Requests to that server
+   * are delayed before retrying, for the time given by its Retry-After header
+   * or an exponentially increasing time.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Network",
+      meta = (ConfigRestartRequired = true, ClampMin = 0))
+  int MaximumHttpRetries = 3;
+
+  /**
+   * The number of threads in a pool dedicated to Cesium's background work,
+   * such as decoding tiles and creating their meshes and textures. When this
+   * is zero, the work is done by the engine's background task threads, where
+   * it competes with the engine's own background work.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Performance",
+      meta = (ConfigRestartRequired = true, ClampMin = 0, ClampMax = 64))
+  int WorkerThreadCount = 0;
+
+  /**
+   * Whether to compress color textures, such as raster overlay images and
+   * glTF base color textures, to BC1 or BC3 in worker threads before they are
+   * uploaded to the GPU. Compressed textures use a quarter to an eighth of the
+   * GPU memory of uncompressed ones. Textures are left uncompressed on
+   * platforms that do not support these formats, and when their dimensions are
+   * not multiples of four.
+   */
+  UPROPERTY(Config, EditAnywhere, Category = "Performance")
+  ECesiumTextureCompression TextureCompression =
+      ECesiumTextureCompression::None;
+
+  /**
+   * The number of unused raster overlay textures to keep, so that new raster
+   * overlay tiles of the same size and format can reuse their GPU resources
+   * rather than creating new ones. Set this to zero to disable the pool.
+   */
+  UPROPERTY(
+      Config,
+      EditAnywhere,
+      Category = "Performance",
+      meta = (ConfigRestartRequired = true, ClampMin = 0))
+  int RasterOverlayTexturePoolSize = 64;
+
+  /**
+   * Whether to release the upper mips of glTF textures on tiles that are far
+   * from the camera, and upload them again from the tile's glTF as the camera
+   * approaches. New tiles start with only the mips they need in the current
+   * views. This greatly reduces the GPU memory used by the textures of large
+   * views, at the cost of uploading some mips more than once. The mips are
+   * already kept in CPU memory with each tile's glTF. Textures compressed by
+   * Texture Compression are always fully resident.
+   */
+  UPROPERTY(Config, EditAnywhere, Category = "Performance")
+  bool EnableTextureMipResidency = false;
 };
@@ -0,0 +1,54 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "CoreMinimal.h"
+#include "CesiumSceneCaptureSettingsComponent.generated.h"
+
+/**
+ * Controls how Cesium3DTilesets select tiles for the view of the Scene Capture
+ * 2D Actor to which this component is attached.
+ *
+ * Scene captures such as minimaps and reflection captures are usually much
+ * smaller or less important than the main viewport. Attaching this component
+ * lets them refine more coarsely and defer their tile loads to those of the
+ * main viewport. Scene captures without this component are treated exactly
+ * like the main viewport.
+ */
+UCLASS(ClassGroup = "Cesium", Meta = (BlueprintSpawnableComponent))
+class CESIUMRUNTIME_API UCesiumSceneCaptureSettingsComponent
+    : public UActorComponent {
+  GENERATED_BODY()
+
+public:
+  /**
+   * A multiplier applied to each tileset's Maximum Screen Space Error when
+   * selecting tiles for this scene capture.
+   *
+   * Values greater than 1.0 cause this scene capture to refine more coarsely
+   * than the main viewport.
+   */
+  UPROPERTY(
+      EditAnywhere,
+      BlueprintReadWrite,
+      Category = "Cesium",
+      meta = (ClampMin = 1.0))
+  double ScreenSpaceErrorMultiplier = 4.0;
+
+  /**
+   * The weight of this scene capture's tile loads relative to the main
+   * viewport.
+   *
+   * The requests of a tileset seen only by this scene capture are sent after
+   * those of the tilesets in the main viewport, because the tileset's request
+   * priority is lowered by one minus this weight. A value of 1.0 gives this
+   * scene capture the same priority as the main viewport.
+   */
+  UPROPERTY(
+      EditAnywhere,
+      BlueprintReadWrite,
+      Category = "Cesium",
+      meta = (ClampMin = 0.01, ClampMax = 1.0))
+  double LoadPriorityWeight = 0.25;
+};
@@ -0,0 +1,124 @@
+// Copyright 2020-2023 CesiumGS, Inc. and Contributors
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <array>
+#include <cstdint>
+#include "CesiumTileLoadLatency.generated.h"
+
+/**
+ * A stage of the pipeline that loads a tile's content and prepares it for
+ * rendering.
+ */
+UENUM(BlueprintType)
+enum class ECesiumTileLoadStage : uint8 {
+  /**
+   * From the time the tile content is requested until its bytes are received,
+   * whether from the network, the local file system, or the request cache.
+   */
+  Request,
+
+  /**
+   * From the time the bytes are received until the tile is decoded and
+   * prepared for rendering in a worker thread.
+   */
+  LoadThread,
+
+  /**
+   * From the end of the worker thread preparation until the tile is finalized
+   * in the game thread, including the time spent waiting in the game thread
+   * load queue.
+   */
+  MainThread,
+
+  /**
+   * From the time the tile content is requested until the tile is finalized in
+   * the game thread.
+   */
+  Total
+};
+
+/**
+ * A summary of the latency of one tile load stage across the tiles loaded by a
+ * tileset.
+ */
+USTRUCT(BlueprintType)
+struct CESIUMRUNTIME_API FCesiumTileLoadLatency {
+  GENERATED_BODY()
+
+  /**
+   * The number of tile loads measured.
+   */
+  UPROPERTY(BlueprintReadOnly, Category = "Cesium")
+  int64 Count = 0;
+
+  /**
+   * The median latency, in seconds.
+   */
+  UPROPERTY(BlueprintReadOnly, Category = "Cesium")
+  double P50Seconds = 0.0;
+
+  /**
+   * The 95th percentile latency, in seconds.
+   */
+  UPROPERTY(BlueprintReadOnly, Category = "Cesium")
+  double P95Seconds = 0.0;
+
+  /**
+   * The 99th percentile latency, in seconds.
+   */
+  UPROPERTY(BlueprintReadOnly, Category = "Cesium")
+  double P99Seconds = 0.0;
+
+  /**
+   * The largest latency measured, in seconds.
+   */
+  UPROPERTY(BlueprintReadOnly, Category = "Cesium")
+  double MaxSeconds = 0.0;
+};
+
+/**
+ * Accumulates tile load latencies into a fixed-size, logarithmically-bucketed
+ * histogram for each {@link ECesiumTileLoadStage}. Percentiles are estimated
+ * from the buckets, so the memory used does not grow with the number of tiles.
+ *
+ * This class is not thread-safe. A tileset only records latencies in the game
+ * thread.
+ */
+class CESIUMRUNTIME_API CesiumTileLoadLatencyHistograms {
+public:
+  /**
+   * Records one latency measurement for the given stage. Negative values are
+   * ignored.
+   */
+  void record(ECesiumTileLoadStage stage, double seconds);
+
+  /**
+   * Summarizes the measurements recorded so far for the given stage.
+   */
+  FCesiumTileLoadLatency summarize(ECesiumTileLoadStage stage) const;
+
+  /**
+   * Discards all measurements.
+   */
+  void reset();
+
+private:
+  // Buckets are spaced logarithmically from 0.1 milliseconds to 1000 seconds,
+  // with the first and last buckets also holding the values outside that
+  // range.
+  static constexpr size_t BucketsPerDecade = 8;
+  static constexpr size_t BucketCount = 7 * BucketsPerDecade + 1;
+
+  struct Histogram {
+    std::array<uint64_t, BucketCount> buckets{};
+    uint64_t count = 0;
+    double max = 0.0;
+  };
+
+  static constexpr size_t StageCount =
+      size_t(ECesiumTileLoadStage::Total) + 1;
+
+  std::array<Histogram, StageCount> _histograms;
+};
@@ -7,11 +7,147 @@
 #include "Containers/UnrealString.h"
 #include "HAL/Platform.h"
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PrioritizedRequestQueue;
 
 class CESIUMRUNTIME_API UnrealAssetAccessor
     : public CesiumAsync::IAssetAccessor {
 public:
   UnrealAssetAccessor();
+  virtual ~UnrealAssetAccessor();
+
+  /**
+   * The name of a pseudo-header that assigns a request to a request group
+   * created with {@link createRequestGroup}. It is removed before the request
+   * is sent. Because it is an ordinary header, it passes through accessors
+   * that wrap this one, such as the caching accessor. Use
+   * {@link requestGroupHeader} to create it.
+   */
+  static const std::string RequestGroupHeaderName;
+
+  /**
+   * Creates the header that assigns a request to the given request group.
+   */
+  static CesiumAsync::IAssetAccessor::THeader
+  requestGroupHeader(uint64_t requestGroup);
+
+  /**
+   * Creates a group of HTTP requests that can be reprioritized and canceled
+   * together.
+   *
+   * HTTP requests wait in a queue until fewer than the maximum number of
+   * simultaneous requests are in flight. Queued requests in a group with a
+   * higher priority are sent first, and requests with the same priority are
+   * sent in the order in which they were made. Requests that are not in any
+   * group have a priority of zero.
+   *
+   * @param priority The initial priority of the group.
+   * @return The ID of the new group.
+   */
+  uint64_t createRequestGroup(double priority);
+
+  /**
+   * Changes the priority of a request group. This affects the order in which
+   * its queued requests are sent.
+   */
+  void setRequestGroupPriority(uint64_t requestGroup, double priority);
+
+  /**
+   * Notifies the accessor that the view for which a request group's requests
+   * are made has changed, such as when the camera has turned away. Requests
+   * made in the group afterward are sent before those that are already
+   * queued.
+   */
+  void advanceRequestGroupView(uint64_t requestGroup);
+
+  /**
+   * Cancels all queued and in-flight requests in a request group, and any
+   * that are made in the group afterward. Their futures are rejected.
+   */
+  void cancelRequestGroup(uint64_t requestGroup);
+
+  /**
+   * Sets the maximum number of HTTP requests that may be in flight at once.
+   * Requests beyond this wait in the queue. Requests for file:/// URLs are
+   * not limited.
+   */
+  void setMaximumSimultaneousRequests(int32 maximumSimultaneousRequests);
+
+  /**
+   * Sets the maximum number of HTTP requests to any one host that may be in
+   * flight at once. The host is identified by the scheme, host name, and port
+   * of the URL. When several hosts have requests waiting, the requests for
+   * hosts at their limit wait while those for other hosts are sent.
+   */
+  void setMaximumSimultaneousRequestsPerHost(
+      int32 maximumSimultaneousRequestsPerHost);
+
+  /**
+   * Sets the maximum number of times an HTTP request is retried after a 429
+   * Too Many Requests or 503 Service Unavailable response. Each such response
+   * makes every request to its host wait, for the time given in its
+   * Retry-After header or otherwise for an exponentially increasing time.
+   * After the last retry, the response is returned to the caller.
+   */
+  void setMaximumRetries(int32 maximumRetries);
+
+  /**
+   * Statistics for the HTTP requests sent to one host.
+   */
+  struct HostStatistics {
+    /**
+     * The scheme, host name, and port of the host.
+     */
+    std::string host;
+
+    /**
+     * The number of requests that have been sent, including retries.
+     */
+    uint64_t requestsSent = 0;
+
+    /**
+     * The total time that sent requests spent waiting in the queue, in
+     * seconds.
+     */
+    double totalQueueSeconds = 0.0;
+
+    /**
+     * The longest time that a sent request spent waiting in the queue, in
+     * seconds.
+     */
+    double maximumQueueSeconds = 0.0;
+
+    /**
+     * The number of 429 or 503 responses that caused the host to back off.
+     */
+    uint64_t backOffs = 0;
+
+    /**
+     * The number of requests currently in flight.
+     */
+    size_t active = 0;
+
+    /**
+     * The number of requests currently waiting in the queue.
+     */
+    size_t queued = 0;
+  };
+
+  /**
+   * Gets statistics, including the time spent waiting in the queue, for each
+   * host that has been sent an HTTP request.
+   */
+  std::vector<HostStatistics> getHostStatistics() const;
+
+  /**
+   * Gets the number of HTTP requests waiting in the queue to be sent.
+   */
+  size_t getQueuedRequestCount() const;
 
   virtual CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
   get(const CesiumAsync::AsyncSystem& asyncSystem,
@@ -35,6 +171,17 @@ private:
       const std::string& url,
       const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers);
 
+  CesiumAsync::Future<std::shared_ptr<CesiumAsync::IAssetRequest>>
+  sendHttpRequest(
+      const CesiumAsync::AsyncSystem& asyncSystem,
+      const std::string& verb,
+      const std::string& url,
+      const std::vector<CesiumAsync::IAssetAccessor::THeader>& headers,
+      const gsl::span<const std::byte>& contentPayload,
+      std::function<void()>&& onComplete);
+
   FString _userAgent;
   TMap<FString, FString> _cesiumRequestHeaders;
+  std::shared_ptr<PrioritizedRequestQueue> _pRequestQueue;
+  int32 _maximumRetries;
 };
@@ -4,9 +4,166 @@
 
 #include "CesiumAsync/ITaskProcessor.h"
 #include "HAL/Platform.h"
+#include "Templates/UniquePtr.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 
+class FQueuedThreadPool;
+
+/**
+ * Runs Cesium's background tasks, either on the engine's background task
+ * threads or on a dedicated pool of threads.
+ *
+ * Each task belongs to a lane, according to the kind of work it does. Because
+ * cesium-native does not say what kind of work a task is, the lane is taken
+ * from the {@link LaneScope} active on the thread that starts the task, which
+ * is inherited from the task running on that thread, if any. In a dedicated
+ * pool, geometry tasks run ahead of texture tasks, which run ahead of decode
+ * tasks, so that tiles that are already partly loaded are finished before
+ * more are started.
+ *
+ * The number of tasks waiting in each lane, and the time they spend waiting
+ * and running, are counted.
+ *
+ * A dedicated pool is owned by whoever creates it, not by the processor, so
+ * that it can be destroyed while the engine is still running even though the
+ * processor may live until the program exits. The Cesium for Unreal module
+ * destroys its pool when it shuts down.
+ */
 class CESIUMRUNTIME_API UnrealTaskProcessor
     : public CesiumAsync::ITaskProcessor {
 public:
+  /**
+   * The kind of work done by a task.
+   */
+  enum class Lane : uint8 {
+    /**
+     * Reading and decoding responses, such as parsing tilesets and glTFs.
+     */
+    Decode,
+
+    /**
+     * Creating the vertex and index buffers and physics meshes of tiles.
+     */
+    Geometry,
+
+    /**
+     * Creating textures, such as those of raster overlays.
+     */
+    Texture
+  };
+
+  static constexpr size_t LaneCount = 3;
+
+  /**
+   * Counts of the tasks in a lane since the processor was created.
+   */
+  struct LaneStatistics {
+    uint64_t started;
+    uint64_t completed;
+
+    /**
+     * The number of tasks started but not yet completed, which are either
+     * waiting for a thread or running.
+     */
+    uint64_t queued;
+
+    /**
+     * The time between starting each completed task and a thread beginning
+     * to run it.
+     */
+    double totalWaitSeconds;
+    double maximumWaitSeconds;
+
+    double totalExecutionSeconds;
+    double maximumExecutionSeconds;
+  };
+
+  /**
+   * Assigns the tasks started on the current thread to a lane for as long as
+   * the scope exists.
+   */
+  class CESIUMRUNTIME_API LaneScope {
+  public:
+    explicit LaneScope(Lane lane);
+    ~LaneScope();
+
+    LaneScope(const LaneScope&) = delete;
+    LaneScope& operator=(const LaneScope&) = delete;
+
+  private:
+    Lane _previousLane;
+  };
+
+  /**
+   * Creates a dedicated pool of threads for the tasks of a processor.
+   *
+   * @param threadCount The number of threads.
+   * @return The pool, or nullptr if the thread count is not positive or the
+   * threads could not be created.
+   */
+  static TUniquePtr<FQueuedThreadPool> createThreadPool(int32 threadCount);
+
+  /**
+   * Creates a task processor.
+   *
+   * @param pThreadPool The dedicated pool of threads for the tasks, or
+   * nullptr to run them on the engine's background task threads. The pool
+   * must outlive the processor, or be detached with
+   * {@link detachThreadPool} before it is destroyed.
+   */
+  explicit UnrealTaskProcessor(FQueuedThreadPool* pThreadPool = nullptr);
+  ~UnrealTaskProcessor();
+
+  /**
+   * Stops starting tasks in the dedicated pool, so that the pool can be
+   * destroyed. Tasks started later run on the engine's background task
+   * threads.
+   */
+  void detachThreadPool();
+
+  /**
+   * Starts a task in the lane of the current thread.
+   */
   virtual void startTask(std::function<void()> f) override;
+
+  /**
+   * Starts a task in the given lane.
+   */
+  void startTask(Lane lane, std::function<void()>&& f);
+
+  /**
+   * Gets the lane of the tasks started on the current thread.
+   */
+  static Lane getCurrentLane();
+
+  /**
+   * Gets the number of threads in the dedicated pool, or 0 if tasks run on the
+   * engine's background task threads.
+   */
+  int32 getThreadCount() const;
+
+  /**
+   * Gets the counts of the tasks in a lane.
+   */
+  LaneStatistics getLaneStatistics(Lane lane) const;
+
+private:
+  struct Counters;
+  class QueuedWork;
+
+  static void runTask(
+      Counters& counters,
+      Lane lane,
+      double queuedTime,
+      std::function<void()>& f);
+
+  mutable std::mutex _threadPoolMutex;
+  FQueuedThreadPool* _pThreadPool;
+
+  // Shared with the tasks, which may finish after the processor is destroyed.
+  std::shared_ptr<Counters> _pCounters;
 };